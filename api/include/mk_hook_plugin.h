@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef MK_HOOK_PLUGIN_H
+#define MK_HOOK_PLUGIN_H
+
+/**
+ * hook插件的C ABI，插件以动态库的形式在启动时加载(配置项hook.plugin)，
+ * 可在进程内直接处理on_publish、on_play、on_rtsp_auth等hook，省去http请求；
+ * 插件不处理的hook仍然走http hook
+ * C ABI of hook plugins. The plugin is a shared library loaded at startup (config hook.plugin),
+ * it handles hooks such as on_publish, on_play and on_rtsp_auth in process instead of http requests,
+ * hooks not handled by the plugin still fall back to http hooks
+ */
+
+#if defined(_WIN32)
+#define MK_HOOK_PLUGIN_CALL __cdecl
+#define MK_HOOK_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define MK_HOOK_PLUGIN_CALL
+#define MK_HOOK_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+// 插件ABI版本，不兼容的修改时递增
+#define MK_HOOK_PLUGIN_ABI_VERSION 1
+
+// 插件导出的入口函数名
+#define MK_HOOK_PLUGIN_ENTRY "mk_hook_plugin_load"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mk_hook_invoker_t *mk_hook_invoker;
+
+/**
+ * 回复hook结果，每个invoker必须且只能调用一次，可以在任意线程调用
+ * @param invoker on_hook传入的invoker
+ * @param json 与http hook回复相同的json，例如{"code":0}；传入NULL代表放弃处理，改走http hook
+ * Reply the hook result, must be called exactly once per invoker, from any thread
+ * @param json Same json as the http hook reply such as {"code":0}; NULL means fall back to the http hook
+ */
+typedef void(MK_HOOK_PLUGIN_CALL *mk_hook_reply)(mk_hook_invoker invoker, const char *json);
+
+typedef struct {
+    // 必须为MK_HOOK_PLUGIN_ABI_VERSION
+    int abi_version;
+
+    /**
+     * 插件是否处理该hook
+     * @param hook hook名，与配置项同名，例如on_play
+     * @return 非0代表处理
+     * Whether the plugin handles the hook, returns non-zero if handled
+     */
+    int(MK_HOOK_PLUGIN_CALL *supports)(const char *hook);
+
+    /**
+     * 处理hook，可同步或异步回复
+     * @param hook hook名
+     * @param json 与http hook请求body相同的json
+     * @param invoker 回复上下文
+     * @param reply 回复函数
+     * Handle the hook, reply synchronously or asynchronously
+     */
+    void(MK_HOOK_PLUGIN_CALL *on_hook)(const char *hook, const char *json, mk_hook_invoker invoker, mk_hook_reply reply);
+
+    // 插件卸载前回调，可为NULL；在所有invoker都已回复后、动态库关闭前调用
+    void(MK_HOOK_PLUGIN_CALL *on_unload)(void);
+} mk_hook_plugin;
+
+/**
+ * 插件需导出该原型的函数，函数名为MK_HOOK_PLUGIN_ENTRY
+ * The plugin exports a function of this type named MK_HOOK_PLUGIN_ENTRY
+ */
+typedef const mk_hook_plugin *(MK_HOOK_PLUGIN_CALL *mk_hook_plugin_load_func)(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // MK_HOOK_PLUGIN_H
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <sstream>
+#include "EventFeed.h"
+#include "Util/NoticeCenter.h"
+#include "Common/config.h"
+#include "Common/MediaSource.h"
+#include "WebApi.h"
+
+using namespace std;
+using namespace Json;
+using namespace toolkit;
+using namespace mediakit;
+
+static string toCompactString(const Value &value) {
+    StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return writeString(builder, value);
+}
+
+static Buffer::Ptr makeEvent(const string &type, const Value &body) {
+    auto event = std::make_shared<BufferLikeString>();
+    event->append("event: ");
+    event->append(type);
+    event->append("\ndata: ");
+    event->append(toCompactString(body));
+    event->append("\n\n");
+    return event;
+}
+
+static Value makeTupleJson(const MediaTuple &tuple) {
+    Value body;
+    body["vhost"] = tuple.vhost;
+    body["app"] = tuple.app;
+    body["stream"] = tuple.stream;
+    return body;
+}
+
+EventFeed &EventFeed::Instance() {
+    static EventFeed s_instance;
+    return s_instance;
+}
+
+EventFeed::EventFeed() {
+    NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastMediaChanged, [this](BroadcastMediaChangedArgs) {
+        if (!size()) {
+            return;
+        }
+        auto &tuple = sender.getMediaTuple();
+        auto body = makeTupleJson(tuple);
+        body["schema"] = sender.getSchema();
+        body["regist"] = bRegist;
+        emit("media_changed", tuple.vhost, tuple.app, tuple.stream, body);
+    });
+
+    NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastPlayerCountChanged, [this](BroadcastPlayerCountChangedArgs) {
+        if (!size()) {
+            return;
+        }
+        auto body = makeTupleJson(args);
+        body["count"] = count;
+        emit("reader_count", args.vhost, args.app, args.stream, body);
+    });
+
+    NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastStreamNoneReader, [this](BroadcastStreamNoneReaderArgs) {
+        if (!size()) {
+            return;
+        }
+        auto &tuple = sender.getMediaTuple();
+        auto body = makeTupleJson(tuple);
+        body["schema"] = sender.getSchema();
+        emit("none_reader", tuple.vhost, tuple.app, tuple.stream, body);
+    });
+
+    NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastPlayerProxyStatus, [this](BroadcastPlayerProxyStatusArgs) {
+        if (!size()) {
+            return;
+        }
+        auto body = makeTupleJson(tuple);
+        body["url"] = url;
+        body["status"] = status;
+        body["err"] = ex.getErrCode();
+        body["msg"] = ex.what();
+        emit("proxy_status", tuple.vhost, tuple.app, tuple.stream, body);
+    });
+}
+
+bool EventFeed::Subscriber::match(const string &type, const string &vhost, const string &app, const string &stream) const {
+    if (!filter.types.empty() && filter.types.find(type) == filter.types.end()) {
+        return false;
+    }
+    return (filter.vhost.empty() || filter.vhost == vhost) && (filter.app.empty() || filter.app == app) &&
+           (filter.stream.empty() || filter.stream == stream);
+}
+
+size_t EventFeed::size() {
+    lock_guard<mutex> lck(_mtx);
+    return _subscribers.size();
+}
+
+void EventFeed::subscribe(const HttpSession::Ptr &session, Filter filter) {
+    HttpSession::KeyValue header;
+    header["Cache-Control"] = "no-cache";
+    // 防止nginx等反向代理缓存事件
+    header["X-Accel-Buffering"] = "no";
+    session->startStreamResponse("text/event-stream", header);
+
+    Subscriber subscriber;
+    subscriber.session = session;
+    subscriber.poller = session->getPoller();
+    subscriber.filter = std::move(filter);
+
+    // 先推送当前已注册的流，订阅者无需再调用getMediaList获取初始状态
+    MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
+        auto &tuple = media->getMediaTuple();
+        if (!subscriber.match("media_changed", tuple.vhost, tuple.app, tuple.stream)) {
+            return;
+        }
+        auto body = makeTupleJson(tuple);
+        body["schema"] = media->getSchema();
+        body["regist"] = true;
+        session->sendStreamData(makeEvent("media_changed", body));
+    });
+
+    lock_guard<mutex> lck(_mtx);
+    _subscribers.emplace_back(std::move(subscriber));
+    if (!_timer) {
+        GET_CONFIG(float, sample_sec, API::kEventSampleSec);
+        _timer = std::make_shared<Timer>(MAX(sample_sec, 1.0f), []() {
+            EventFeed::Instance().onSample();
+            return true;
+        }, nullptr);
+    }
+}
+
+void EventFeed::emit(const string &type, const string &vhost, const string &app, const string &stream, const Value &body) {
+    Buffer::Ptr event;
+    lock_guard<mutex> lck(_mtx);
+    for (auto it = _subscribers.begin(); it != _subscribers.end();) {
+        if (it->session.expired()) {
+            it = _subscribers.erase(it);
+            continue;
+        }
+        if (it->match(type, vhost, app, stream)) {
+            if (!event) {
+                event = makeEvent(type, body);
+            }
+            weak_ptr<HttpSession> weak_session = it->session;
+            it->poller->async([weak_session, event]() {
+                if (auto strong_session = weak_session.lock()) {
+                    strong_session->sendStreamData(event);
+                }
+            }, false);
+        }
+        ++it;
+    }
+}
+
+void EventFeed::onSample() {
+    if (!size()) {
+        return;
+    }
+    struct Sample {
+        MediaTuple tuple;
+        Value body;
+    };
+    vector<Sample> samples;
+    MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
+        Sample sample;
+        sample.tuple = media->getMediaTuple();
+        sample.body = makeTupleJson(sample.tuple);
+        sample.body["schema"] = media->getSchema();
+        sample.body["bytesSpeed"] = (Json::UInt64)media->getBytesSpeed();
+        sample.body["readerCount"] = media->readerCount();
+        sample.body["totalReaderCount"] = media->totalReaderCount();
+        samples.emplace_back(std::move(sample));
+    });
+
+    // 同时作为心跳，防止http会话因长时间无数据而超时
+    auto ping = std::make_shared<BufferString>(": ping\n\n");
+    lock_guard<mutex> lck(_mtx);
+    for (auto it = _subscribers.begin(); it != _subscribers.end();) {
+        if (it->session.expired()) {
+            it = _subscribers.erase(it);
+            continue;
+        }
+        Buffer::Ptr event = ping;
+        Value data(arrayValue);
+        for (auto &sample : samples) {
+            if (it->match("stats", sample.tuple.vhost, sample.tuple.app, sample.tuple.stream)) {
+                data.append(sample.body);
+            }
+        }
+        if (data.size()) {
+            event = makeEvent("stats", data);
+        }
+        weak_ptr<HttpSession> weak_session = it->session;
+        it->poller->async([weak_session, event]() {
+            if (auto strong_session = weak_session.lock()) {
+                strong_session->sendStreamData(event);
+            }
+        }, false);
+        ++it;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_EVENTFEED_H
+#define ZLMEDIAKIT_EVENTFEED_H
+
+#include <set>
+#include <list>
+#include <mutex>
+#include <string>
+#include "json/json.h"
+#include "Poller/Timer.h"
+#include "Http/HttpSession.h"
+
+/**
+ * 基于NoticeCenter广播的流事件推送(Server-Sent Events)，替代轮询getMediaList
+ * 事件类型：media_changed(流注册/注销)、reader_count(观看人数变化)、none_reader(无人观看)、
+ * proxy_status(拉流代理状态变化)、stats(定时采样的码率与观看人数)
+ * Stream event feed over Server-Sent Events built on NoticeCenter broadcasts, replaces polling getMediaList
+ */
+class EventFeed {
+public:
+    struct Filter {
+        std::string vhost;
+        std::string app;
+        std::string stream;
+        // 为空代表订阅全部事件类型
+        std::set<std::string> types;
+    };
+
+    static EventFeed &Instance();
+
+    /**
+     * 将http会话转为事件推送会话，须在该会话poller线程调用
+     * Turn the http session into an event feed session, must be called in its poller thread
+     */
+    void subscribe(const mediakit::HttpSession::Ptr &session, Filter filter);
+
+    size_t size();
+
+private:
+    EventFeed();
+
+    struct Subscriber {
+        std::weak_ptr<mediakit::HttpSession> session;
+        toolkit::EventPoller::Ptr poller;
+        Filter filter;
+
+        bool match(const std::string &type, const std::string &vhost, const std::string &app, const std::string &stream) const;
+    };
+
+    void emit(const std::string &type, const std::string &vhost, const std::string &app, const std::string &stream, const Json::Value &body);
+    void onSample();
+
+private:
+    std::mutex _mtx;
+    std::list<Subscriber> _subscribers;
+    toolkit::Timer::Ptr _timer;
+};
+
+#endif // ZLMEDIAKIT_EVENTFEED_H
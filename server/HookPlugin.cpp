@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+#include <memory>
+#include "HookPlugin.h"
+#include "Util/logger.h"
+#include "Poller/EventPoller.h"
+
+using namespace std;
+using namespace toolkit;
+
+struct mk_hook_invoker_t {
+    HookPlugin::onReply cb;
+    // 未回复前持有插件，防止动态库被关闭
+    std::shared_ptr<void> module;
+};
+
+// 当前线程是否处于插件调用栈中(on_hook或reply期间)
+// Whether the current thread has plugin code on its stack (inside on_hook or reply)
+static thread_local int s_plugin_depth = 0;
+
+struct PluginScope {
+    PluginScope() { ++s_plugin_depth; }
+    ~PluginScope() { --s_plugin_depth; }
+};
+
+static void MK_HOOK_PLUGIN_CALL onPluginReply(mk_hook_invoker invoker, const char *json) {
+    if (!invoker) {
+        return;
+    }
+    PluginScope scope;
+    // invoker只能回复一次，回复后释放
+    std::unique_ptr<mk_hook_invoker_t> ptr(invoker);
+    try {
+        ptr->cb(json);
+    } catch (std::exception &ex) {
+        WarnL << "Exception occurred: " << ex.what();
+    }
+}
+
+static void *openLibrary(const string &path) {
+#if defined(_WIN32)
+    return (void *)LoadLibraryA(path.data());
+#else
+    return dlopen(path.data(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void *findSymbol(void *handle, const char *name) {
+#if defined(_WIN32)
+    return (void *)GetProcAddress((HMODULE)handle, name);
+#else
+    return dlsym(handle, name);
+#endif
+}
+
+static void closeLibrary(void *handle) {
+#if defined(_WIN32)
+    FreeLibrary((HMODULE)handle);
+#else
+    dlclose(handle);
+#endif
+}
+
+static string lastError() {
+#if defined(_WIN32)
+    return to_string(GetLastError());
+#else
+    auto err = dlerror();
+    return err ? err : "";
+#endif
+}
+
+struct HookPlugin::Module {
+    string path;
+    void *handle;
+    const mk_hook_plugin *plugin;
+
+    ~Module() {
+        auto handle = this->handle;
+        auto plugin = this->plugin;
+        auto path = std::move(this->path);
+        auto close = [handle, plugin, path]() {
+            if (plugin->on_unload) {
+                plugin->on_unload();
+            }
+            closeLibrary(handle);
+            InfoL << "hook plugin unloaded: " << path;
+        };
+        if (!s_plugin_depth) {
+            // 同步关闭，退出进程时也能保证on_unload被调用
+            // Close synchronously so on_unload is called even while the process is exiting
+            close();
+            return;
+        }
+        // 最后一个引用在插件调用栈中(如reply内)释放，插件代码仍在栈上，延后到poller线程关闭动态库
+        // The last reference was dropped with plugin code still on the stack (inside reply for example),
+        // so the library is closed later on a poller thread
+        EventPollerPool::Instance().getPoller()->async(std::move(close), false);
+    }
+};
+
+HookPlugin &HookPlugin::Instance() {
+    static HookPlugin s_instance;
+    return s_instance;
+}
+
+bool HookPlugin::load(const string &path) {
+    unload();
+    auto handle = openLibrary(path);
+    if (!handle) {
+        WarnL << "load hook plugin " << path << " failed: " << lastError();
+        return false;
+    }
+    auto entry = (mk_hook_plugin_load_func)findSymbol(handle, MK_HOOK_PLUGIN_ENTRY);
+    if (!entry) {
+        WarnL << "hook plugin " << path << " does not export " << MK_HOOK_PLUGIN_ENTRY;
+        closeLibrary(handle);
+        return false;
+    }
+    auto plugin = entry();
+    if (!plugin || plugin->abi_version != MK_HOOK_PLUGIN_ABI_VERSION || !plugin->supports || !plugin->on_hook) {
+        WarnL << "hook plugin " << path << " is incompatible, abi version: " << (plugin ? plugin->abi_version : 0)
+              << ", expected: " << MK_HOOK_PLUGIN_ABI_VERSION;
+        closeLibrary(handle);
+        return false;
+    }
+    auto module = std::make_shared<Module>();
+    module->path = path;
+    module->handle = handle;
+    module->plugin = plugin;
+    {
+        lock_guard<mutex> lck(_mtx);
+        _module = std::move(module);
+    }
+    InfoL << "hook plugin loaded: " << path;
+    return true;
+}
+
+void HookPlugin::unload() {
+    // 仍在处理中的调用继续持有插件，全部回复后才关闭动态库
+    // Invocations still in flight keep the plugin, the library is closed after all of them have replied
+    std::shared_ptr<Module> module;
+    {
+        lock_guard<mutex> lck(_mtx);
+        module.swap(_module);
+    }
+    // 在锁外释放，on_unload可能同步执行
+    // Released outside the lock since on_unload may run synchronously
+    module = nullptr;
+}
+
+bool HookPlugin::supports(const char *hook) {
+    lock_guard<mutex> lck(_mtx);
+    return _module && _module->plugin->supports(hook);
+}
+
+bool HookPlugin::invoke(const char *hook, const string &json, onReply cb) {
+    std::shared_ptr<Module> module;
+    {
+        lock_guard<mutex> lck(_mtx);
+        module = _module;
+    }
+    if (!module || !module->plugin->supports(hook)) {
+        return false;
+    }
+    auto plugin = module->plugin;
+    auto invoker = new mk_hook_invoker_t;
+    invoker->cb = std::move(cb);
+    invoker->module = std::move(module);
+    PluginScope scope;
+    plugin->on_hook(hook, json.data(), invoker, onPluginReply);
+    return true;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_HOOKPLUGIN_H
+#define ZLMEDIAKIT_HOOKPLUGIN_H
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <functional>
+#include "mk_hook_plugin.h"
+
+/**
+ * 加载并调用hook插件(见api/include/mk_hook_plugin.h)
+ * Loads and invokes the hook plugin (see api/include/mk_hook_plugin.h)
+ */
+class HookPlugin {
+public:
+    // json为NULL代表插件放弃处理
+    using onReply = std::function<void(const char *json)>;
+
+    static HookPlugin &Instance();
+
+    bool load(const std::string &path);
+    void unload();
+
+    bool supports(const char *hook);
+
+    /**
+     * 交给插件处理hook
+     * @return 插件不处理该hook时返回false
+     * Hand the hook to the plugin, returns false if the plugin does not handle it
+     */
+    bool invoke(const char *hook, const std::string &json, onReply cb);
+
+private:
+    HookPlugin() = default;
+
+private:
+    struct Module;
+
+    std::mutex _mtx;
+    // 每次调用都持有一份引用，卸载后待所有调用回复才关闭动态库
+    // Every invocation holds a reference, after unload the library is closed only when all of them have replied
+    std::shared_ptr<Module> _module;
+};
+
+#endif // ZLMEDIAKIT_HOOKPLUGIN_H
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <sstream>
+#include <unordered_set>
+#include "MetricsExporter.h"
+#include "WebApi.h"
+#include "Util/util.h"
+#include "Thread/WorkThreadPool.h"
+#include "Network/Socket.h"
+#include "Common/config.h"
+#include "Common/MediaSource.h"
+#include "Common/JemallocUtil.h"
+#include "Common/MultiMediaSourceMuxer.h"
+#include "Common/PollerMonitor.h"
+#include "Common/StreamCpuStat.h"
+#include "Rtsp/Rtsp.h"
+#include "Rtmp/Rtmp.h"
+#if defined(ENABLE_WEBRTC)
+#include "../webrtc/UdpBatchSender.h"
+#include "../webrtc/DtlsHandshakePool.h"
+#endif
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static string escapeLabel(const string &value) {
+    string ret;
+    ret.reserve(value.size());
+    for (auto ch : value) {
+        switch (ch) {
+            case '\\': ret.append("\\\\"); break;
+            case '"': ret.append("\\\""); break;
+            case '\n': ret.append("\\n"); break;
+            default: ret.push_back(ch); break;
+        }
+    }
+    return ret;
+}
+
+static void writeFamily(ostream &out, const char *name, const char *type, const char *help) {
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+template <typename T>
+static void writeSample(ostream &out, const char *name, const string &labels, const T &value) {
+    out << name;
+    if (!labels.empty()) {
+        out << '{' << labels << '}';
+    }
+    out << ' ' << value << '\n';
+}
+
+MetricsExporter &MetricsExporter::Instance() {
+    static MetricsExporter s_instance;
+    return s_instance;
+}
+
+void MetricsExporter::start() {
+    {
+        lock_guard<mutex> lck(_mtx);
+        if (_timer) {
+            return;
+        }
+        GET_CONFIG(float, sample_sec, API::kMetricsSampleSec);
+        _timer = std::make_shared<Timer>(MAX(sample_sec, 1.0f), []() {
+            MetricsExporter::Instance().onSample();
+            return true;
+        }, nullptr);
+    }
+    onSample();
+}
+
+void MetricsExporter::onSample() {
+    // 异步等待各线程执行任务，得到事件循环延时，结果缓存供抓取时读取
+    // Wait for each thread to run a task asynchronously to get the loop delay, cache it for scrapes
+    auto sample_delay = [this](TaskExecutorGetterImp &getter, size_t index, const char *pool) {
+        vector<string> threads;
+        getter.for_each([&](const TaskExecutor::Ptr &executor) {
+            threads.emplace_back(static_pointer_cast<EventPoller>(executor)->getThreadName());
+        });
+        getter.getExecutorDelay([this, index, pool, threads](const vector<int> &delay) {
+            lock_guard<mutex> lck(_mtx);
+            if (_poller_delay.size() <= index) {
+                _poller_delay.resize(index + 1);
+            }
+            _poller_delay[index].pool = pool;
+            _poller_delay[index].threads = threads;
+            _poller_delay[index].delay_ms = delay;
+        });
+    };
+    sample_delay(EventPollerPool::Instance(), 0, "event");
+    sample_delay(WorkThreadPool::Instance(), 1, "work");
+
+    vector<pair<string, uint64_t>> malloc_stats;
+    JemallocUtil::some_malloc_stats([&](const char *name, uint64_t value) { malloc_stats.emplace_back(name, value); });
+    lock_guard<mutex> lck(_mtx);
+    _malloc_stats = std::move(malloc_stats);
+}
+
+string MetricsExporter::scrape() {
+    start();
+
+    struct SourceRow {
+        string labels;
+        uint64_t bytes_speed;
+        uint64_t total_bytes;
+        int readers;
+    };
+
+    struct StreamRow {
+        string labels;
+        uint64_t alive_sec = 0;
+        int total_readers = 0;
+        float fps = 0;
+        size_t gop_size = 0;
+        size_t gop_interval_ms = 0;
+        size_t gop_cache_bytes = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t video_frames = 0;
+        uint64_t audio_frames = 0;
+        StreamCpuStat::Ptr cpu_stat;
+    };
+
+    vector<SourceRow> sources;
+    vector<StreamRow> streams;
+    unordered_set<string> stream_keys;
+    MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
+        auto &tuple = media->getMediaTuple();
+        string tuple_labels = StrPrinter << "vhost=\"" << escapeLabel(tuple.vhost) << "\",app=\"" << escapeLabel(tuple.app)
+                                       << "\",stream=\"" << escapeLabel(tuple.stream) << "\"";
+        // 以下均为各对象增量维护的计数器，读取开销为O(1)
+        // All of the following are counters maintained incrementally by each object, reading them is O(1)
+        SourceRow source;
+        source.labels = tuple_labels + ",schema=\"" + media->getSchema() + "\"";
+        source.bytes_speed = media->getBytesSpeed();
+        source.total_bytes = media->getTotalBytes();
+        source.readers = media->readerCount();
+        sources.emplace_back(std::move(source));
+
+        // 同一个流的多种协议共享一个muxer与track，只统计一次
+        // All protocols of a stream share one muxer and its tracks, count them once
+        auto key = tuple.shortUrl();
+        if (!stream_keys.emplace(key).second) {
+            return;
+        }
+        StreamRow stream;
+        stream.labels = tuple_labels;
+        stream.alive_sec = media->getAliveSecond();
+        stream.total_readers = media->totalReaderCount();
+        for (auto &track : media->getTracks(false)) {
+            if (track->getTrackType() == TrackAudio) {
+                stream.audio_frames += track->getFrames();
+                continue;
+            }
+            auto video = dynamic_pointer_cast<VideoTrack>(track);
+            if (!video) {
+                continue;
+            }
+            stream.video_frames += video->getFrames();
+            stream.gop_size = video->getVideoGopSize();
+            stream.gop_interval_ms = video->getVideoGopInterval();
+            stream.fps = video->getVideoFps();
+            if (stream.fps <= 1 && stream.gop_interval_ms) {
+                stream.fps = stream.gop_size * 1000.0f / stream.gop_interval_ms;
+            }
+        }
+        if (auto muxer = media->getMuxer()) {
+            stream.gop_cache_bytes = muxer->getGopCacheBytes();
+            stream.dropped_frames = muxer->getDroppedFrames();
+            stream.cpu_stat = muxer->getCpuStat();
+        }
+        streams.emplace_back(std::move(stream));
+    });
+
+    stringstream out;
+    writeFamily(out, "zlm_stream_bytes_per_second", "gauge", "Ingest bitrate of the stream in bytes per second, per protocol");
+    for (auto &row : sources) {
+        writeSample(out, "zlm_stream_bytes_per_second", row.labels, row.bytes_speed);
+    }
+    writeFamily(out, "zlm_stream_bytes_total", "counter", "Total bytes of the stream, per protocol");
+    for (auto &row : sources) {
+        writeSample(out, "zlm_stream_bytes_total", row.labels, row.total_bytes);
+    }
+    writeFamily(out, "zlm_stream_readers", "gauge", "Readers of the stream, per protocol");
+    for (auto &row : sources) {
+        writeSample(out, "zlm_stream_readers", row.labels, row.readers);
+    }
+    writeFamily(out, "zlm_stream_total_readers", "gauge", "Readers of the stream over all protocols");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_total_readers", row.labels, row.total_readers);
+    }
+    writeFamily(out, "zlm_stream_alive_seconds", "gauge", "Seconds since the stream was registered");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_alive_seconds", row.labels, row.alive_sec);
+    }
+    writeFamily(out, "zlm_stream_video_fps", "gauge", "Video frame rate of the stream");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_video_fps", row.labels, row.fps);
+    }
+    writeFamily(out, "zlm_stream_gop_frames", "gauge", "Frames of the last video gop");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_gop_frames", row.labels, row.gop_size);
+    }
+    writeFamily(out, "zlm_stream_gop_interval_ms", "gauge", "Duration of the last video gop in milliseconds");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_gop_interval_ms", row.labels, row.gop_interval_ms);
+    }
+    writeFamily(out, "zlm_stream_gop_cache_bytes", "gauge", "Bytes of the current gop held by the gop cache");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_gop_cache_bytes", row.labels, row.gop_cache_bytes);
+    }
+    writeFamily(out, "zlm_stream_dropped_frames_total", "counter", "Frames dropped while tracks were not ready");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_dropped_frames_total", row.labels, row.dropped_frames);
+    }
+    writeFamily(out, "zlm_stream_frames_total", "counter", "Frames ingested by the stream");
+    for (auto &row : streams) {
+        writeSample(out, "zlm_stream_frames_total", row.labels + ",track=\"video\"", row.video_frames);
+        writeSample(out, "zlm_stream_frames_total", row.labels + ",track=\"audio\"", row.audio_frames);
+    }
+    GET_CONFIG(bool, stream_cpu_stat, General::kStreamCpuStat);
+    if (stream_cpu_stat) {
+        writeFamily(out, "zlm_stream_cpu_seconds_total", "counter", "Thread cpu time consumed by the stream, per stage");
+        for (auto &row : streams) {
+            if (!row.cpu_stat) {
+                continue;
+            }
+            for (size_t i = 0; i < (size_t)CpuStage::max; ++i) {
+                auto stage = (CpuStage)i;
+                writeSample(out, "zlm_stream_cpu_seconds_total", row.labels + ",stage=\"" + StreamCpuStat::stageName(stage) + "\"",
+                            row.cpu_stat->get(stage) / 1e9);
+            }
+        }
+    }
+
+    vector<PollerDelay> poller_delay;
+    vector<pair<string, uint64_t>> malloc_stats;
+    {
+        lock_guard<mutex> lck(_mtx);
+        poller_delay = _poller_delay;
+        malloc_stats = _malloc_stats;
+    }
+
+    // 线程负载与fd个数由poller自身维护，直接读取
+    // Thread load and fd count are maintained by the pollers themselves, read them directly
+    struct PollerRow {
+        string labels;
+        int load;
+        size_t fd_count;
+    };
+    vector<PollerRow> pollers;
+    auto collect_pool = [&](TaskExecutorGetterImp &getter, const char *pool) {
+        auto load = getter.getExecutorLoad();
+        size_t i = 0;
+        getter.for_each([&](const TaskExecutor::Ptr &executor) {
+            auto poller = static_pointer_cast<EventPoller>(executor);
+            PollerRow row;
+            row.labels = StrPrinter << "pool=\"" << pool << "\",thread=\"" << escapeLabel(poller->getThreadName()) << "\"";
+            row.load = i < load.size() ? load[i] : 0;
+            row.fd_count = poller->fdCount();
+            pollers.emplace_back(std::move(row));
+            ++i;
+        });
+    };
+    collect_pool(EventPollerPool::Instance(), "event");
+    collect_pool(WorkThreadPool::Instance(), "work");
+
+    writeFamily(out, "zlm_poller_load", "gauge", "Busy percentage of the thread");
+    for (auto &row : pollers) {
+        writeSample(out, "zlm_poller_load", row.labels, row.load);
+    }
+    writeFamily(out, "zlm_poller_fd_count", "gauge", "File descriptors watched by the thread");
+    for (auto &row : pollers) {
+        writeSample(out, "zlm_poller_fd_count", row.labels, row.fd_count);
+    }
+
+    writeFamily(out, "zlm_poller_delay_ms", "gauge", "Sampled delay of a task queued to the thread in milliseconds");
+    for (auto &pool : poller_delay) {
+        for (size_t i = 0; i < pool.delay_ms.size() && i < pool.threads.size(); ++i) {
+            string labels = StrPrinter << "pool=\"" << pool.pool << "\",thread=\"" << escapeLabel(pool.threads[i]) << "\"";
+            writeSample(out, "zlm_poller_delay_ms", labels, pool.delay_ms[i]);
+        }
+    }
+
+    // 事件循环延时直方图，由PollerMonitor在探测时增量维护
+    // Event loop lag histograms, maintained incrementally by PollerMonitor probes
+    auto write_histogram = [&](const char *name, const string &labels, const LagHistogram &histogram) {
+        uint64_t counts[LagHistogram::kBucketSize], sum, count, acc = 0;
+        histogram.snapshot(counts, sum, count);
+        string bucket = string(name) + "_bucket";
+        for (size_t i = 0; i < LagHistogram::kBucketSize; ++i) {
+            acc += counts[i];
+            string le = i < LagHistogram::kBucketSize - 1 ? to_string(LagHistogram::kBounds[i]) : "+Inf";
+            writeSample(out, bucket.data(), (labels.empty() ? labels : labels + ",") + "le=\"" + le + "\"", acc);
+        }
+        writeSample(out, (string(name) + "_sum").data(), labels, sum);
+        writeSample(out, (string(name) + "_count").data(), labels, count);
+    };
+    writeFamily(out, "zlm_poller_async_delay_ms", "histogram", "Queueing delay of async tasks on the poller in milliseconds");
+    PollerMonitor::Instance().forEach([&](const PollerMonitor::Statistic &stat) {
+        write_histogram("zlm_poller_async_delay_ms", "thread=\"" + escapeLabel(stat.thread) + "\"", *stat.async_delay);
+    });
+    writeFamily(out, "zlm_poller_timer_late_ms", "histogram", "Lateness of timers on the poller in milliseconds");
+    PollerMonitor::Instance().forEach([&](const PollerMonitor::Statistic &stat) {
+        write_histogram("zlm_poller_timer_late_ms", "thread=\"" + escapeLabel(stat.thread) + "\"", *stat.timer_late);
+    });
+    writeFamily(out, "zlm_poller_stalls_total", "counter", "Stalls detected by the poller watchdog");
+    PollerMonitor::Instance().forEach([&](const PollerMonitor::Statistic &stat) {
+        writeSample(out, "zlm_poller_stalls_total", "thread=\"" + escapeLabel(stat.thread) + "\"", stat.stalls);
+    });
+
+    writeFamily(out, "zlm_objects", "gauge", "Alive objects by type");
+#define WRITE_OBJECT_COUNT(type) writeSample(out, "zlm_objects", "type=\"" #type "\"", ObjectStatistic<type>::count())
+    WRITE_OBJECT_COUNT(MediaSource);
+    WRITE_OBJECT_COUNT(MultiMediaSourceMuxer);
+    WRITE_OBJECT_COUNT(Socket);
+    WRITE_OBJECT_COUNT(Frame);
+    WRITE_OBJECT_COUNT(FrameImp);
+    WRITE_OBJECT_COUNT(Buffer);
+    WRITE_OBJECT_COUNT(BufferRaw);
+    WRITE_OBJECT_COUNT(BufferLikeString);
+    WRITE_OBJECT_COUNT(BufferList);
+    WRITE_OBJECT_COUNT(RtpPacket);
+    WRITE_OBJECT_COUNT(RtmpPacket);
+#undef WRITE_OBJECT_COUNT
+
+    uint64_t find_fresh, find_coalesced;
+    MediaSource::getFindAsyncStatistic(find_fresh, find_coalesced);
+    writeFamily(out, "zlm_find_async_total", "counter", "Async stream lookups, fresh or coalesced into a pending lookup");
+    writeSample(out, "zlm_find_async_total", "result=\"fresh\"", find_fresh);
+    writeSample(out, "zlm_find_async_total", "result=\"coalesced\"", find_coalesced);
+
+#if defined(ENABLE_WEBRTC)
+    auto egress = UdpBatchSender::getStatistic();
+    writeFamily(out, "zlm_webrtc_egress_packets_total", "counter", "WebRTC packets sent in batches, as GSO datagrams, or falling back to per packet sending");
+    writeSample(out, "zlm_webrtc_egress_packets_total", "mode=\"batch\"", egress.packets - egress.gso_packets);
+    writeSample(out, "zlm_webrtc_egress_packets_total", "mode=\"gso\"", egress.gso_packets);
+    writeSample(out, "zlm_webrtc_egress_packets_total", "mode=\"fallback\"", egress.fallback_packets);
+    writeFamily(out, "zlm_webrtc_egress_syscalls_total", "counter", "Syscalls of WebRTC batch sending");
+    writeSample(out, "zlm_webrtc_egress_syscalls_total", "", egress.syscalls);
+    writeFamily(out, "zlm_webrtc_egress_packets_per_syscall", "gauge", "Average packets sent per syscall by WebRTC batch sending");
+    writeSample(out, "zlm_webrtc_egress_packets_per_syscall", "", egress.syscalls ? (double)egress.packets / egress.syscalls : 0.0);
+
+    auto dtls = DtlsHandshakePool::Instance().getStatistic();
+    writeFamily(out, "zlm_webrtc_dtls_handshake_ms", "histogram", "Time from the start of a DTLS handshake to the connection in milliseconds");
+    write_histogram("zlm_webrtc_dtls_handshake_ms", "", *dtls.handshake);
+    writeFamily(out, "zlm_webrtc_dtls_queue_delay_ms", "histogram", "Queueing delay of DTLS handshake jobs on the workers in milliseconds");
+    write_histogram("zlm_webrtc_dtls_queue_delay_ms", "", *dtls.queue_delay);
+    writeFamily(out, "zlm_webrtc_dtls_pending_jobs", "gauge", "Queued and running DTLS handshake jobs");
+    writeSample(out, "zlm_webrtc_dtls_pending_jobs", "", dtls.pending);
+    writeFamily(out, "zlm_webrtc_dtls_jobs_total", "counter", "DTLS handshake packets run on the workers or shed because the queue was full");
+    writeSample(out, "zlm_webrtc_dtls_jobs_total", "result=\"offloaded\"", dtls.offloaded);
+    writeSample(out, "zlm_webrtc_dtls_jobs_total", "result=\"shed\"", dtls.shed);
+#endif
+
+    if (!malloc_stats.empty()) {
+        writeFamily(out, "zlm_jemalloc_bytes", "gauge", "jemalloc statistics");
+        for (auto &pr : malloc_stats) {
+            writeSample(out, "zlm_jemalloc_bytes", "stat=\"" + pr.first + "\"", pr.second);
+        }
+    }
+    return out.str();
+}
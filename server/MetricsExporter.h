@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_METRICSEXPORTER_H
+#define ZLMEDIAKIT_METRICSEXPORTER_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+#include "Poller/Timer.h"
+
+/**
+ * Prometheus文本格式的指标导出，覆盖流、poller线程与进程三类指标；
+ * 流指标直接读取各对象增量维护的计数器，poller延时与jemalloc统计由定时器后台采样缓存，
+ * 抓取时不会遍历播放器列表等重量级结构，也不会等待poller线程
+ * Metrics exporter in the Prometheus text format covering streams, pollers and the process.
+ * Stream metrics read counters maintained incrementally by each object, poller delays and jemalloc stats
+ * are sampled in background by a timer, so a scrape neither walks heavy structures such as player lists nor waits for pollers
+ */
+class MetricsExporter {
+public:
+    static MetricsExporter &Instance();
+
+    /**
+     * 开始后台采样
+     * Start background sampling
+     */
+    void start();
+
+    /**
+     * 生成text/plain; version=0.0.4格式的指标
+     * Render metrics in the text/plain; version=0.0.4 format
+     */
+    std::string scrape();
+
+private:
+    MetricsExporter() = default;
+
+    void onSample();
+
+private:
+    struct PollerDelay {
+        std::string pool;
+        std::vector<std::string> threads;
+        std::vector<int> delay_ms;
+    };
+
+    std::mutex _mtx;
+    toolkit::Timer::Ptr _timer;
+    std::vector<PollerDelay> _poller_delay;
+    std::vector<std::pair<std::string, uint64_t>> _malloc_stats;
+};
+
+#endif // ZLMEDIAKIT_METRICSEXPORTER_H
@@ -20,7 +20,11 @@
 #endif // _WIN32
 
 #include <functional>
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <mutex>
 #include <regex>
 #include "Util/MD5.h"
 #include "Util/util.h"
@@ -42,8 +46,14 @@
 
 #include "Common/config.h"
 #include "Common/MediaSource.h"
+#include "Common/PollerMonitor.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 #include "Http/HttpSession.h"
 #include "Http/HttpRequester.h"
+#include "Http/HttpRequesterPool.h"
+#include "EventFeed.h"
+#include "MetricsExporter.h"
 #include "Player/PlayerProxy.h"
 #include "Pusher/PusherProxy.h"
 #include "Rtp/RtpProcess.h"
@@ -57,6 +67,8 @@
 #include "../webrtc/WebRtcPlayer.h"
 #include "../webrtc/WebRtcPusher.h"
 #include "../webrtc/WebRtcEchoTest.h"
+#include "../webrtc/SdpAnswerCache.h"
+#include "../webrtc/DtlsHandshakePool.h"
 #include "../webrtc/WebRtcSignalingPeer.h"
 #include "../webrtc/WebRtcSignalingSession.h"
 #include "../webrtc/WebRtcProxyPlayer.h"
@@ -85,6 +97,12 @@ const string kSecret = API_FIELD"secret";
 const string kSnapRoot = API_FIELD"snapRoot";
 const string kDefaultSnap = API_FIELD"defaultSnap";
 const string kDownloadRoot = API_FIELD"downloadRoot";
+const string kEventSampleSec = API_FIELD"eventSampleSec";
+const string kMetricsSampleSec = API_FIELD"metricsSampleSec";
+const string kBatchConcurrency = API_FIELD"batchConcurrency";
+const string kBatchOpTimeoutSec = API_FIELD"batchOpTimeoutSec";
+const string kStartupBatch = API_FIELD"startupBatch";
+const string kStartupBatchRate = API_FIELD"startupBatchRate";
 
 static onceToken token([]() {
     mINI::Instance()[kApiDebug] = "1";
@@ -92,6 +110,12 @@ static onceToken token([]() {
     mINI::Instance()[kSnapRoot] = "./www/snap/";
     mINI::Instance()[kDefaultSnap] = "./www/logo.png";
     mINI::Instance()[kDownloadRoot] = "./www";
+    mINI::Instance()[kEventSampleSec] = 5;
+    mINI::Instance()[kMetricsSampleSec] = 5;
+    mINI::Instance()[kBatchConcurrency] = 32;
+    mINI::Instance()[kBatchOpTimeoutSec] = 30;
+    mINI::Instance()[kStartupBatch] = "";
+    mINI::Instance()[kStartupBatchRate] = 200;
 });
 }//namespace API
 
@@ -302,6 +326,9 @@ static inline void addHttpListener(){
         auto helper = static_cast<SocketHelper &>(sender).shared_from_this();
         // 在本poller线程下一次事件循环时执行http api，防止占用NoticeCenter的锁
         helper->getPoller()->async([it, parser, invoker, helper]() {
+            // 标记poller正在执行该api，卡顿时便于定位
+            // Label the poller as running this api to locate stalls
+            PollerTaskScope scope(it->first);
             try {
                 it->second(parser, invoker, *helper);
             } catch (ApiRetException &ex) {
@@ -403,6 +430,18 @@ Value makeMediaSourceJson(MediaSource &media){
     item["originUrl"] = media.getOriginUrl();
     item["isRecordingMP4"] = media.isRecording(Recorder::type_mp4);
     item["isRecordingHLS"] = media.isRecording(Recorder::type_hls);
+    if (auto muxer = media.getMuxer()) {
+        // 各协议观看端的关键帧请求经合并后发往源端的情况
+        // How key frame requests of viewers of all protocols were merged before reaching the origin
+        auto stats = muxer->getKeyFrameStats();
+        Value key_frame;
+        key_frame["requested"] = (Json::UInt64) stats.requested;
+        key_frame["forwarded"] = (Json::UInt64) stats.forwarded;
+        key_frame["suppressed"] = (Json::UInt64) stats.suppressed;
+        key_frame["fromCache"] = (Json::UInt64) stats.from_cache;
+        key_frame["unsupported"] = (Json::UInt64) stats.unsupported;
+        item["keyFrameRequests"] = key_frame;
+    }
     auto originSock = media.getOriginSock();
     if (originSock) {
         fillSockInfo(item["originSock"], originSock.get());
@@ -467,6 +506,84 @@ Value makeMediaSourceJson(MediaSource &media){
     return item;
 }
 
+/**
+ * 列表类接口的分页与字段裁剪参数
+ * count: 每页最多返回条数，0代表不分页
+ * cursor: 上一页回复中的next_cursor，为空代表从头开始
+ * fields: 逗号分隔的需要返回的字段，为空代表返回全部字段
+ * Pagination and field projection arguments of list apis
+ */
+struct ListPage {
+    size_t count = 0;
+    string cursor;
+    vector<string> fields;
+
+    ListPage(const ArgsMap &allArgs) {
+        count = allArgs["count"].as<size_t>();
+        cursor = allArgs["cursor"];
+        for (auto &field : split(allArgs["fields"], ",")) {
+            trim(field);
+            if (!field.empty()) {
+                fields.emplace_back(std::move(field));
+            }
+        }
+    }
+};
+
+/**
+ * 在后台线程按key排序、分页、裁剪字段并逐条序列化列表快照，避免大列表阻塞poller线程
+ * Sort, paginate, project and serialize a list snapshot item by item in a background thread
+ * @param items 列表快照，key用于排序与游标
+ * @param to_json 生成单条记录的json
+ */
+template <typename T>
+static void responseList(std::vector<std::pair<string, T>> items, ListPage page, std::function<Value(const T &)> to_json,
+                         const HttpSession::KeyValue &headerOut, const HttpSession::HttpResponseInvoker &invoker) {
+    auto ptr = std::make_shared<std::vector<std::pair<string, T>>>(std::move(items));
+    WorkThreadPool::Instance().getExecutor()->async([ptr, page, to_json, headerOut, invoker]() {
+        auto &items = *ptr;
+        std::sort(items.begin(), items.end(), [](const std::pair<string, T> &a, const std::pair<string, T> &b) { return a.first < b.first; });
+        auto it = items.begin();
+        if (!page.cursor.empty()) {
+            it = std::upper_bound(items.begin(), items.end(), page.cursor, [](const string &cursor, const std::pair<string, T> &item) { return cursor < item.first; });
+        }
+
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+        std::ostringstream out;
+        out << "{\"code\":" << API::Success << ",\"data\":[";
+        size_t written = 0;
+        for (; it != items.end() && (!page.count || written < page.count); ++it) {
+            auto item = to_json(it->second);
+            if (!page.fields.empty()) {
+                Value projected(objectValue);
+                for (auto &field : page.fields) {
+                    if (item.isMember(field)) {
+                        projected[field] = std::move(item[field]);
+                    }
+                }
+                item = std::move(projected);
+            }
+            if (written++) {
+                out << ',';
+            }
+            writer->write(item, &out);
+        }
+        out << ']';
+        if (page.count) {
+            out << ",\"total\":" << items.size();
+            if (it != items.end() && written) {
+                // 还有下一页
+                out << ",\"next_cursor\":";
+                writer->write(Value((it - 1)->first), &out);
+            }
+        }
+        out << '}';
+        invoker(200, headerOut, out.str());
+    });
+}
+
 #if defined(ENABLE_RTPPROXY)
 uint16_t openRtpServer(uint16_t local_port, const mediakit::MediaTuple &tuple, int tcp_mode, const string &local_ip, bool re_use_port, uint32_t ssrc, int only_track, bool multiplex) {
     auto key = tuple.shortUrl();
@@ -515,6 +632,27 @@ void getStatisticJson(const function<void(Value &val)> &cb) {
 
     val["RtpPacket"] = (Json::UInt64)(ObjectStatistic<RtpPacket>::count());
     val["RtmpPacket"] = (Json::UInt64)(ObjectStatistic<RtmpPacket>::count());
+    uint64_t find_fresh, find_coalesced;
+    MediaSource::getFindAsyncStatistic(find_fresh, find_coalesced);
+    val["FindAsyncFresh"] = (Json::UInt64)find_fresh;
+    val["FindAsyncCoalesced"] = (Json::UInt64)find_coalesced;
+#ifdef ENABLE_WEBRTC
+    val["SdpAnswerCacheHits"] = (Json::UInt64)SdpAnswerCache::Instance().getHits();
+    val["SdpAnswerCacheMisses"] = (Json::UInt64)SdpAnswerCache::Instance().getMisses();
+    {
+        auto dtls = DtlsHandshakePool::Instance().getStatistic();
+        Value obj(objectValue);
+        obj["pending"] = (Json::UInt64)dtls.pending;
+        obj["offloaded"] = (Json::UInt64)dtls.offloaded;
+        obj["shed"] = (Json::UInt64)dtls.shed;
+        obj["handshake_p50"] = (Json::UInt64)dtls.handshake->quantile(0.5f);
+        obj["handshake_p90"] = (Json::UInt64)dtls.handshake->quantile(0.9f);
+        obj["handshake_p99"] = (Json::UInt64)dtls.handshake->quantile(0.99f);
+        obj["queue_delay_p50"] = (Json::UInt64)dtls.queue_delay->quantile(0.5f);
+        obj["queue_delay_p99"] = (Json::UInt64)dtls.queue_delay->quantile(0.99f);
+        val["DtlsHandshake"] = obj;
+    }
+#endif
 #ifdef ENABLE_MEM_DEBUG
     auto bytes = getTotalMemUsage();
     val["totalMemUsage"] = (Json::UInt64) bytes;
@@ -693,6 +831,20 @@ void getThreadsLoad(TaskExecutorGetterImp &getter, API_ARGS_MAP_ASYNC) {
         auto vec = getter.getExecutorLoad();
         std::vector<EventPoller::Ptr> pollers;
         getter.for_each([&](const TaskExecutor::Ptr &exe) { pollers.emplace_back(std::static_pointer_cast<EventPoller>(exe)); });
+        // 事件循环延时统计，按线程名关联
+        // Event loop lag statistics, matched by thread name
+        unordered_map<string, Value> lags;
+        PollerMonitor::Instance().forEach([&](const PollerMonitor::Statistic &stat) {
+            Value lag(objectValue);
+            lag["async_delay_p50"] = (Json::UInt64)stat.async_delay->quantile(0.5f);
+            lag["async_delay_p99"] = (Json::UInt64)stat.async_delay->quantile(0.99f);
+            lag["timer_late_p50"] = (Json::UInt64)stat.timer_late->quantile(0.5f);
+            lag["timer_late_p99"] = (Json::UInt64)stat.timer_late->quantile(0.99f);
+            lag["stalls"] = (Json::UInt64)stat.stalls;
+            lag["last_stall_task"] = stat.last_stall_task;
+            lag["last_stall_ms"] = (Json::UInt64)stat.last_stall_ms;
+            lags.emplace(stat.thread, std::move(lag));
+        });
         int i = API::Success;
         for (auto load : vec) {
             Value obj(objectValue);
@@ -701,6 +853,10 @@ void getThreadsLoad(TaskExecutorGetterImp &getter, API_ARGS_MAP_ASYNC) {
             obj["name"] = poller->getThreadName();
             obj["fd_count"] = static_cast<Json::UInt64>(poller->fdCount());
             obj["delay"] = vecDelay[i++];
+            auto it = lags.find(obj["name"].asString());
+            if (it != lags.end()) {
+                obj["lag"] = it->second;
+            }
             val["data"].append(obj);
         }
         val["code"] = API::Success;
@@ -708,6 +864,263 @@ void getThreadsLoad(TaskExecutorGetterImp &getter, API_ARGS_MAP_ASYNC) {
     });
 }
 
+// 批量接口允许调用的api，这些api只通过CHECK_SECRET使用sender
+// Apis allowed in batch requests, they only use sender through CHECK_SECRET
+static set<string, StrCaseCompare> s_batch_api = {
+    "/index/api/addStreamProxy",
+    "/index/api/delStreamProxy",
+    "/index/api/addStreamPusherProxy",
+    "/index/api/delStreamPusherProxy",
+    "/index/api/addFFmpegSource",
+    "/index/api/delFFmpegSource",
+    "/index/api/openRtpServer",
+    "/index/api/openRtpServerMultiplex",
+    "/index/api/closeRtpServer",
+    "/index/api/startSendRtp",
+    "/index/api/startSendRtpPassive",
+    "/index/api/stopSendRtp",
+};
+
+// 批量请求中各操作使用的请求者信息快照，操作在其他poller线程执行，不能引用原http会话
+// Snapshot of the requester used by batch operations, they run on other pollers and must not reference the http session
+class BatchSockInfo : public SockInfo {
+public:
+    using Ptr = std::shared_ptr<BatchSockInfo>;
+
+    std::string get_local_ip() override { return _local_ip; }
+    uint16_t get_local_port() override { return _local_port; }
+    std::string get_peer_ip() override { return _peer_ip; }
+    uint16_t get_peer_port() override { return _peer_port; }
+    std::string getIdentifier() const override { return _identifier; }
+
+    std::string _local_ip;
+    std::string _peer_ip;
+    std::string _identifier;
+    uint16_t _local_port = 0;
+    uint16_t _peer_port = 0;
+};
+
+/**
+ * 批量执行addStreamProxy、openRtpServer、startSendRtp等操作，
+ * 限制同时执行的操作数与每秒发起的操作数，操作分散到各poller线程执行，全部完成后回复各操作的结果
+ * Executes operations such as addStreamProxy, openRtpServer and startSendRtp in batch,
+ * bounds the operations in flight and started per second, spreads them across pollers and replies per-item results when all are done
+ */
+class ApiBatch : public std::enable_shared_from_this<ApiBatch> {
+public:
+    using Ptr = std::shared_ptr<ApiBatch>;
+    using onComplete = function<void(const Value &results, size_t failed)>;
+
+    /**
+     * @param ops 操作数组，每个操作为{"api":"addStreamProxy","params":{...}}
+     * @param concurrency 同时执行的最大操作数
+     * @param rate 每秒最多发起的操作数，0代表不限制
+     * @param timeout_sec 单个操作的超时时间，超时未回复的操作以超时错误计入结果，0代表不超时
+     * @param ops Array of operations, each one is {"api":"addStreamProxy","params":{...}}
+     * @param concurrency Max operations in flight
+     * @param rate Max operations started per second, 0 means unlimited
+     * @param timeout_sec Deadline of each operation, one not replied in time is reported as a timeout error, 0 means no deadline
+     */
+    ApiBatch(Value ops, size_t concurrency, float rate, float timeout_sec, string secret, SockInfo &sender, onComplete cb) {
+        _ops = std::move(ops);
+        _results = Value(arrayValue);
+        _results.resize(_ops.size());
+        _timeouts.resize(_ops.size());
+        _concurrency = MAX(concurrency, (size_t)1);
+        _rate = rate;
+        _timeout_ms = timeout_sec > 0 ? (uint64_t)(timeout_sec * 1000) : 0;
+        _secret = std::move(secret);
+        _cb = std::move(cb);
+        _sender = std::make_shared<BatchSockInfo>();
+        _sender->_identifier = sender.getIdentifier();
+        _sender->_peer_ip = sender.get_peer_ip();
+        _sender->_peer_port = sender.get_peer_port();
+        _sender->_local_ip = sender.get_local_ip();
+        _sender->_local_port = sender.get_local_port();
+    }
+
+    void start() {
+        if (!_ops.size()) {
+            _cb(_results, 0);
+            return;
+        }
+        next();
+    }
+
+private:
+    void next() {
+        vector<size_t> indexes;
+        {
+            lock_guard<mutex> lck(_mtx);
+            while (_in_flight < _concurrency && _next < _ops.size()) {
+                if (_rate > 0 && _next >= _ticker.elapsedTime() * _rate / 1000 + 1) {
+                    // 超出速率限制，稍后再发起
+                    // Over the rate limit, start later
+                    if (!_delay_pending) {
+                        _delay_pending = true;
+                        auto self = shared_from_this();
+                        EventPollerPool::Instance().getPoller()->doDelayTask(MAX(1000 / _rate, 1.0f), [self]() {
+                            {
+                                lock_guard<mutex> lck(self->_mtx);
+                                self->_delay_pending = false;
+                            }
+                            self->next();
+                            return 0;
+                        });
+                    }
+                    break;
+                }
+                indexes.emplace_back(_next++);
+                ++_in_flight;
+            }
+        }
+        for (auto index : indexes) {
+            auto self = shared_from_this();
+            EventPollerPool::Instance().getPoller(false)->async([self, index]() { self->run(index); }, false);
+        }
+    }
+
+    void run(size_t index) {
+        const Value &op = _ops[(Value::ArrayIndex)index];
+        auto api = op["api"].asString();
+        if (!start_with(api, "/")) {
+            api = "/index/api/" + api;
+        }
+        auto it = s_map_api.find(api);
+        if (it == s_map_api.end() || s_batch_api.find(api) == s_batch_api.end()) {
+            onResult(index, API::InvalidArgs, "api not supported in batch: " + api);
+            return;
+        }
+
+        auto params = op["params"].isObject() ? op["params"] : Value(objectValue);
+        params["secret"] = _secret;
+        StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        auto request = "POST " + api + " HTTP/1.1\r\nContent-Type: application/json\r\n\r\n" + writeString(builder, params);
+        Parser parser;
+        parser.parse(request.data(), request.size());
+
+        // 由未完成的操作持有批量任务，全部完成后释放
+        // Pending operations keep the batch alive until all of them are done
+        auto self = shared_from_this();
+        if (_timeout_ms) {
+            // api未在期限内回复(例如拉流一直连不上)时以超时错误结束该操作，不阻塞整个批量请求
+            // An api not replying in time (e.g. a proxy that never connects) ends with a timeout error so the whole batch is not blocked
+            auto timeout_ms = _timeout_ms;
+            auto task = EventPoller::getCurrentPoller()->doDelayTask(timeout_ms, [self, index, timeout_ms]() {
+                self->onResult(index, API::OtherFailed, "operation timeout after " + to_string(timeout_ms) + "ms");
+                return 0;
+            });
+            lock_guard<mutex> lck(_mtx);
+            _timeouts[index] = std::move(task);
+        }
+        HttpSession::HttpResponseInvoker invoker = [self, index](int code, const StrCaseMap &headerOut, const string &body) {
+            Value result;
+            Json::Reader reader;
+            if (!reader.parse(body, result) || !result.isObject()) {
+                self->onResult(index, API::Exception, "invalid api response");
+                return;
+            }
+            self->onResult(index, std::move(result));
+        };
+        try {
+            it->second(parser, invoker, *_sender);
+        } catch (ApiRetException &ex) {
+            onResult(index, ex.code(), ex.what());
+        } catch (std::exception &ex) {
+            onResult(index, API::Exception, ex.what());
+        }
+    }
+
+    void onResult(size_t index, int code, const string &msg) {
+        Value result;
+        result["code"] = code;
+        result["msg"] = msg;
+        onResult(index, std::move(result));
+    }
+
+    void onResult(size_t index, Value result) {
+        bool finished;
+        {
+            lock_guard<mutex> lck(_mtx);
+            if (_results[(Value::ArrayIndex)index].isObject()) {
+                // api回复了多次或超时后才回复，忽略
+                // The api replied more than once or after the deadline, ignore
+                return;
+            }
+            if (_timeouts[index]) {
+                _timeouts[index]->cancel();
+                _timeouts[index] = nullptr;
+            }
+            if (result["code"].asInt() != API::Success) {
+                ++_failed;
+            }
+            _results[(Value::ArrayIndex)index] = std::move(result);
+            --_in_flight;
+            finished = ++_done == _ops.size();
+        }
+        if (finished) {
+            _cb(_results, _failed);
+            return;
+        }
+        next();
+    }
+
+private:
+    bool _delay_pending = false;
+    float _rate;
+    uint64_t _timeout_ms;
+    size_t _concurrency;
+    size_t _next = 0;
+    size_t _in_flight = 0;
+    size_t _done = 0;
+    size_t _failed = 0;
+    string _secret;
+    Value _ops;
+    Value _results;
+    Ticker _ticker;
+    onComplete _cb;
+    BatchSockInfo::Ptr _sender;
+    vector<EventPoller::DelayTask::Ptr> _timeouts;
+    mutex _mtx;
+};
+
+// 启动时执行配置的批量操作文件，格式与/index/api/batch的请求body相同
+// Run the configured batch file at startup, same format as the request body of /index/api/batch
+static void runStartupBatch() {
+    GET_CONFIG(string, startup_batch, API::kStartupBatch);
+    if (startup_batch.empty()) {
+        return;
+    }
+    auto content = File::loadFile(startup_batch);
+    Value root;
+    Json::Reader reader;
+    if (content.empty() || !reader.parse(content, root) || !root["ops"].isArray()) {
+        WarnL << "Invalid startup batch file: " << startup_batch;
+        return;
+    }
+    GET_CONFIG(string, api_secret, API::kSecret);
+    GET_CONFIG(size_t, concurrency, API::kBatchConcurrency);
+    GET_CONFIG(float, rate, API::kStartupBatchRate);
+    GET_CONFIG(float, timeout_sec, API::kBatchOpTimeoutSec);
+    BatchSockInfo sender;
+    sender._peer_ip = "127.0.0.1";
+    sender._local_ip = "127.0.0.1";
+    sender._identifier = "startup_batch";
+    auto count = root["ops"].size();
+    Ticker ticker;
+    auto batch = std::make_shared<ApiBatch>(root["ops"], concurrency, rate, timeout_sec, api_secret, sender, [startup_batch, count, ticker](const Value &results, size_t failed) {
+        InfoL << "Startup batch " << startup_batch << " finished, total: " << count << ", failed: " << failed << ", cost: " << ticker.elapsedTime() << "ms";
+        for (auto &result : results) {
+            if (result["code"].asInt() != API::Success) {
+                WarnL << "Startup batch operation failed: " << result["msg"].asString();
+            }
+        }
+    });
+    InfoL << "Run startup batch " << startup_batch << ", total: " << count << ", concurrency: " << concurrency << ", rate: " << rate;
+    batch->start();
+}
+
 /**
  * 安装api接口
  * 所有api都支持GET和POST两种方式
@@ -740,6 +1153,112 @@ void installWebApi() {
         getThreadsLoad(WorkThreadPool::Instance(), API_ARGS_VALUE, invoker);
     });
 
+    // 获取各流按处理阶段(解复用、各协议复用、分发发送、转码)消耗的线程cpu时间，按总耗时降序排列，需开启general.stream_cpu_stat
+    // 可选参数count限制返回的流个数
+    // 测试url http://127.0.0.1/index/api/getStreamCpuStat?count=10
+    api_regist("/index/api/getStreamCpuStat", [](API_ARGS_MAP) {
+        CHECK_SECRET();
+        GET_CONFIG(bool, stream_cpu_stat, General::kStreamCpuStat);
+        if (!stream_cpu_stat) {
+            throw ApiRetException("general.stream_cpu_stat is disabled", API::OtherFailed);
+        }
+        struct Item {
+            MediaTuple tuple;
+            uint64_t alive_sec;
+            StreamCpuStat::Ptr stat;
+        };
+        // 同一个流的多种协议共享一个muxer，只统计一次
+        // All protocols of a stream share one muxer, count it once
+        vector<Item> items;
+        unordered_set<string> keys;
+        MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
+            auto stat = StreamCpuStat::get(*media);
+            if (!stat || !keys.emplace(media->getMediaTuple().shortUrl()).second) {
+                return;
+            }
+            items.emplace_back(Item { media->getMediaTuple(), media->getAliveSecond(), std::move(stat) });
+        });
+        std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) { return a.stat->total() > b.stat->total(); });
+        if (!allArgs["count"].empty()) {
+            items.resize(MIN(items.size(), allArgs["count"].as<size_t>()));
+        }
+        val["data"] = Value(arrayValue);
+        for (auto &item : items) {
+            Value obj;
+            obj["vhost"] = item.tuple.vhost;
+            obj["app"] = item.tuple.app;
+            obj["stream"] = item.tuple.stream;
+            Value stages(objectValue);
+            for (size_t i = 0; i < (size_t)CpuStage::max; ++i) {
+                auto stage = (CpuStage)i;
+                stages[StreamCpuStat::stageName(stage)] = (Json::UInt64)(item.stat->get(stage) / 1000000);
+            }
+            auto total_ms = item.stat->total() / 1000000;
+            obj["stages_ms"] = stages;
+            obj["total_ms"] = (Json::UInt64)total_ms;
+            obj["aliveSecond"] = (Json::UInt64)item.alive_sec;
+            // 存活期间平均占用单核的百分比
+            // Average percentage of one core over the lifetime of the stream
+            obj["cpu_usage"] = item.alive_sec ? total_ms / 10.0 / item.alive_sec : 0.0;
+            val["data"].append(obj);
+        }
+    });
+
+    // 追踪某个流采样帧从收包到各协议发送的时延，持续duration秒后返回Chrome/Perfetto格式的trace json
+    // 可选参数duration(秒，默认5，最大60)、sample(每隔多少帧采样一帧，默认1)、max_frames(最多采样帧数，默认1000)
+    // 测试url http://127.0.0.1/index/api/getFrameTrace?app=live&stream=test&duration=5
+    api_regist("/index/api/getFrameTrace", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("app", "stream");
+        auto vhost = allArgs["vhost"].empty() ? string(DEFAULT_VHOST) : allArgs["vhost"];
+        auto src = MediaSource::find(vhost, allArgs["app"], allArgs["stream"]);
+        if (!src) {
+            throw ApiRetException("can not find the stream", API::NotFound);
+        }
+        auto tracer = FrameTracer::get(*src);
+        if (!tracer) {
+            throw ApiRetException("the stream does not support frame tracing", API::OtherFailed);
+        }
+        auto sample = allArgs["sample"].empty() ? 1 : allArgs["sample"].as<size_t>();
+        auto max_frames = allArgs["max_frames"].empty() ? 1000 : allArgs["max_frames"].as<size_t>();
+        if (!tracer->start(sample, max_frames)) {
+            throw ApiRetException("the stream is being traced", API::OtherFailed);
+        }
+        auto duration = allArgs["duration"].empty() ? 5.0f : MIN(allArgs["duration"].as<float>(), 60.0f);
+        auto title = src->getMediaTuple().shortUrl();
+        EventPollerPool::Instance().getPoller()->doDelayTask(MAX(duration, 0.0f) * 1000, [tracer, title, headerOut, invoker]() mutable {
+            headerOut["Content-Type"] = "application/json";
+            headerOut["Content-Disposition"] = "attachment; filename=\"frame_trace.json\"";
+            invoker(200, headerOut, tracer->stop(title));
+            return 0;
+        });
+    });
+
+    // 获取hook连接池统计信息，包括连接数、排队深度与请求耗时分位数(毫秒)
+    // 测试url http://127.0.0.1/index/api/getHookStatistic
+    api_regist("/index/api/getHookStatistic", [](API_ARGS_MAP) {
+        CHECK_SECRET();
+        std::vector<HttpRequesterPool::Statistic> stats;
+        HttpRequesterPool::Instance().getStatistic(stats);
+        val["data"] = Json::arrayValue;
+        for (auto &stat : stats) {
+            Value obj;
+            obj["endpoint"] = stat.endpoint;
+            obj["connections"] = (Json::UInt64)stat.connections;
+            obj["idle"] = (Json::UInt64)stat.idle;
+            obj["queue_size"] = (Json::UInt64)stat.queue_size;
+            obj["max_queue_size"] = (Json::UInt64)stat.max_queue_size;
+            obj["total"] = (Json::UInt64)stat.total;
+            obj["failed"] = (Json::UInt64)stat.failed;
+            obj["dropped"] = (Json::UInt64)stat.dropped;
+            obj["p50"] = (Json::UInt64)stat.p50;
+            obj["p90"] = (Json::UInt64)stat.p90;
+            obj["p99"] = (Json::UInt64)stat.p99;
+            obj["max"] = (Json::UInt64)stat.max;
+            val["data"].append(obj);
+        }
+    });
+
     // 获取服务器配置  [AUTO-TRANSLATED:7dd2f3da]
     // Get server configuration
     // 测试url http://127.0.0.1/index/api/getServerConfig  [AUTO-TRANSLATED:59cd0d71]
@@ -910,91 +1429,147 @@ void installWebApi() {
     // Test url1 (get streams with virtual host "__defaultVost__") http://127.0.0.1/index/api/getMediaList?vhost=__defaultVost__
     // 测试url2(获取rtsp类型的流) http://127.0.0.1/index/api/getMediaList?schema=rtsp  [AUTO-TRANSLATED:21c2c15d]
     // Test url2 (get rtsp type streams) http://127.0.0.1/index/api/getMediaList?schema=rtsp
-    api_regist("/index/api/getMediaList",[](API_ARGS_MAP){
+    // 可选分页参数count、cursor以及字段裁剪参数fields，例如 http://127.0.0.1/index/api/getMediaList?count=100&fields=app,stream,readerCount
+    // 翻页时将上一页回复中的next_cursor作为cursor参数传入
+    api_regist("/index/api/getMediaList",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
         // 获取所有MediaSource列表  [AUTO-TRANSLATED:7bf16dc2]
         // Get all MediaSource lists
+        // 持锁期间仅做快照，json生成与序列化在后台线程完成
+        std::vector<std::pair<string, MediaSource::Ptr>> medias;
         MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
-            val["data"].append(makeMediaSourceJson(*media));
+            medias.emplace_back(media->getUrl(), media);
         }, allArgs["schema"], allArgs["vhost"], allArgs["app"], allArgs["stream"]);
+        responseList<MediaSource::Ptr>(std::move(medias), ListPage(allArgs), [](const MediaSource::Ptr &media) {
+            return makeMediaSourceJson(*media);
+        }, headerOut, invoker);
+    });
+
+    // Prometheus格式的流、线程与进程指标，prometheus可通过params配置secret
+    // Prometheus metrics of streams, threads and the process, prometheus passes the secret through params
+    // 测试url http://127.0.0.1/metrics?secret=xxx
+    static auto metrics = [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        headerOut["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
+        invoker(200, headerOut, MetricsExporter::Instance().scrape());
+    };
+    api_regist("/metrics", [](API_ARGS_MAP_ASYNC) { metrics(API_ARGS_VALUE, invoker); });
+    api_regist("/index/api/metrics", [](API_ARGS_MAP_ASYNC) { metrics(API_ARGS_VALUE, invoker); });
+
+    // 订阅流事件推送(Server-Sent Events)，可按vhost/app/stream筛选，types为逗号分隔的事件类型
+    // 事件类型: media_changed、reader_count、none_reader、proxy_status、stats
+    // 测试url http://127.0.0.1/index/api/subscribeEvents?app=live&types=media_changed,stats
+    api_regist("/index/api/subscribeEvents",[](API_ARGS_MAP_ASYNC){
+        CHECK_SECRET();
+        auto session = dynamic_pointer_cast<HttpSession>(static_cast<SocketHelper &>(sender).shared_from_this());
+        if (!session) {
+            throw ApiRetException("only http session can subscribe events", API::OtherFailed);
+        }
+        EventFeed::Filter filter;
+        filter.vhost = allArgs["vhost"];
+        filter.app = allArgs["app"];
+        filter.stream = allArgs["stream"];
+        for (auto &type : split(allArgs["types"], ",")) {
+            trim(type);
+            if (!type.empty()) {
+                filter.types.emplace(type);
+            }
+        }
+        // 不调用invoker，后续事件通过该http连接持续推送
+        EventFeed::Instance().subscribe(session, std::move(filter));
+    });
+
+    // 批量执行addStreamProxy、openRtpServer、startSendRtp等操作，全部完成后回复每个操作的结果(与ops顺序一致)
+    // body示例: {"secret":"xxx","concurrency":32,"rate":0,"ops":[{"api":"addStreamProxy","params":{"vhost":"__defaultVhost__","app":"proxy","stream":"0","url":"rtmp://127.0.0.1/live/obs"}}]}
+    // concurrency为同时执行的操作数(不超过api.batchConcurrency)，rate为每秒最多发起的操作数，0代表不限制
+    // timeout_sec为单个操作的超时时间，默认为api.batchOpTimeoutSec，超时的操作以超时错误计入结果
+    api_regist("/index/api/batch", [](API_ARGS_JSON_ASYNC) {
+        CHECK_SECRET();
+        Value ops = allArgs.args["ops"];
+        if (!ops.isArray()) {
+            throw InvalidArgsException("ops must be an array");
+        }
+        GET_CONFIG(size_t, max_concurrency, API::kBatchConcurrency);
+        size_t concurrency = allArgs["concurrency"].empty() ? max_concurrency : MIN(allArgs["concurrency"].as<size_t>(), max_concurrency);
+        float rate = allArgs["rate"];
+        GET_CONFIG(float, op_timeout_sec, API::kBatchOpTimeoutSec);
+        float timeout_sec = allArgs["timeout_sec"].empty() ? op_timeout_sec : allArgs["timeout_sec"].as<float>();
+        auto batch = std::make_shared<ApiBatch>(std::move(ops), concurrency, rate, timeout_sec, allArgs["secret"], sender,
+                                                [val, headerOut, invoker](const Value &results, size_t failed) mutable {
+            val["failed"] = (Json::UInt64)failed;
+            val["data"] = results;
+            invoker(200, headerOut, val.toStyledString());
+        });
+        batch->start();
     });
 
     // 获取带 watcher 信息的流列表（在 getMediaList 基础上做轻量级 join）
-    api_regist("/index/api/getMediaListWithWatchers",[](API_ARGS_MAP){
+    // 同样支持count、cursor、fields参数
+    api_regist("/index/api/getMediaListWithWatchers",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
 
-        // 预先获取当前 watcher 列表，并按 vhost/app/stream 建索引，供后续 join 使用
-        std::vector<WatcherRecord> watchers;
-        getWatchers(watchers);
+        std::vector<std::pair<string, MediaSource::Ptr>> medias;
+        MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
+            medias.emplace_back(media->getUrl(), media);
+        }, allArgs["schema"], allArgs["vhost"], allArgs["app"], allArgs["stream"]);
 
-        using WatcherPtrList = std::vector<const WatcherRecord *>;
-        std::unordered_map<std::string, std::unordered_map<std::string, std::unordered_map<std::string, WatcherPtrList>>> watcher_index;
+        // 预先获取当前 watcher 列表，并按 vhost/app/stream 建索引，供后续 join 使用
+        using WatcherList = std::vector<WatcherRecord>;
+        auto watcher_index = std::make_shared<std::unordered_map<std::string, WatcherList>>();
+        {
+            std::vector<WatcherRecord> watchers;
+            getWatchers(watchers);
+            for (auto &rec : watchers) {
+                // 对于非 rtc 协议，仅保留当前仍在线的会话对应的记录
+                if (rec.schema != "rtc" && rec.protocol != "rtc") {
+                    auto session = SessionMap::Instance().get(rec.id);
+                    if (!session) {
+                        continue;
+                    }
+                }
 
-        for (const auto &rec : watchers) {
-            // 对于非 rtc 协议，仅保留当前仍在线的会话对应的记录
-            if (rec.schema != "rtc" && rec.protocol != "rtc") {
-                auto session = SessionMap::Instance().get(rec.id);
-                if (!session) {
+                // 仅索引当前还存在的流对应的观看记录
+                if (!MediaSource::find(rec.vhost, rec.app, rec.stream)) {
                     continue;
                 }
+                auto key = MediaTuple(rec.vhost, rec.app, rec.stream).shortUrl();
+                (*watcher_index)[key].emplace_back(std::move(rec));
             }
-
-            // 仅索引当前还存在的流对应的观看记录
-            if (!MediaSource::find(rec.vhost, rec.app, rec.stream)) {
-                continue;
-            }
-
-            auto &by_app = watcher_index[rec.vhost];
-            auto &by_stream = by_app[rec.app];
-            by_stream[rec.stream].emplace_back(&rec);
         }
 
-        // 获取所有MediaSource列表，并为每条流附加 watcher 统计信息
-        MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
+        // 为每条流附加 watcher 统计信息
+        responseList<MediaSource::Ptr>(std::move(medias), ListPage(allArgs), [watcher_index](const MediaSource::Ptr &media) {
             auto item = makeMediaSourceJson(*media);
+            auto it = watcher_index->find(media->getMediaTuple().shortUrl());
+            if (it != watcher_index->end() && !it->second.empty()) {
+                const auto &vec = it->second;
+                // watchers: 当前该流的观看者明细列表，仅保留关键字段，避免与上层媒体字段重复
+                // 规则：最多返回前4个(最早) + 最新1个，如果总数 <=4 则全部返回
+                Value watcher_array(arrayValue);
+
+                size_t n = vec.size();
+                size_t max_first = std::min<size_t>(4, n);
+
+                // 前4个(或更少)
+                for (size_t i = 0; i < max_first; ++i) {
+                    Value wj;
+                    wj["ip"] = vec[i].ip;
+                    wj["port"] = vec[i].port;
+                    watcher_array.append(std::move(wj));
+                }
 
-            const auto &tuple = media->getMediaTuple();
-            auto it_vhost = watcher_index.find(tuple.vhost);
-            if (it_vhost != watcher_index.end()) {
-                auto it_app = it_vhost->second.find(tuple.app);
-                if (it_app != it_vhost->second.end()) {
-                    auto it_stream = it_app->second.find(tuple.stream);
-                    if (it_stream != it_app->second.end()) {
-                        const auto &vec = it_stream->second;
-                        if (!vec.empty()) {
-                            // watchers: 当前该流的观看者明细列表，仅保留关键字段，避免与上层媒体字段重复
-                            // 规则：最多返回前4个(最早) + 最新1个，如果总数 <=4 则全部返回
-                            Value watcher_array(arrayValue);
-
-                            size_t n = vec.size();
-                            size_t max_first = std::min<size_t>(4, n);
-
-                            // 前4个(或更少)
-                            for (size_t i = 0; i < max_first; ++i) {
-                                auto *w = vec[i];
-                                Value wj;
-                                wj["ip"] = w->ip;
-                                wj["port"] = w->port;
-                                watcher_array.append(std::move(wj));
-                            }
-
-                            // 最新1个（如果总数大于前4个）
-                            if (n > max_first) {
-                                auto *w = vec.back();
-                                Value wj;
-                                wj["ip"] = w->ip;
-                                wj["port"] = w->port;
-                                watcher_array.append(std::move(wj));
-                            }
-
-                            item["watchers"] = std::move(watcher_array);
-                        }
-                    }
+                // 最新1个（如果总数大于前4个）
+                if (n > max_first) {
+                    Value wj;
+                    wj["ip"] = vec.back().ip;
+                    wj["port"] = vec.back().port;
+                    watcher_array.append(std::move(wj));
                 }
-            }
 
-            val["data"].append(std::move(item));
-        }, allArgs["schema"], allArgs["vhost"], allArgs["app"], allArgs["stream"]);
+                item["watchers"] = std::move(watcher_array);
+            }
+            return item;
+        }, headerOut, invoker);
     });
 
     // 测试url http://127.0.0.1/index/api/isMediaOnline?schema=rtsp&vhost=__defaultVhost__&app=live&stream=obs  [AUTO-TRANSLATED:126a75e8]
@@ -1125,12 +1700,13 @@ void installWebApi() {
     // You can filter by local port and remote ip
     // 测试url(筛选某端口下的tcp会话) http://127.0.0.1/index/api/getAllSession?local_port=1935  [AUTO-TRANSLATED:ef845193]
     // Test url (filter tcp session under a certain port) http://127.0.0.1/index/api/getAllSession?local_port=1935
-    api_regist("/index/api/getAllSession",[](API_ARGS_MAP){
+    // 支持count、cursor、fields分页与字段裁剪参数，按会话id排序
+    api_regist("/index/api/getAllSession",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
-        Value jsession;
         uint16_t local_port = allArgs["local_port"].as<uint16_t>();
         string peer_ip = allArgs["peer_ip"];
 
+        std::vector<std::pair<string, Session::Ptr>> sessions;
         SessionMap::Instance().for_each_session([&](const string &id,const Session::Ptr &session){
             if(local_port != 0 && local_port != session->get_local_port()){
                 return;
@@ -1138,11 +1714,15 @@ void installWebApi() {
             if(!peer_ip.empty() && peer_ip != session->get_peer_ip()){
                 return;
             }
+            sessions.emplace_back(id, session);
+        });
+        responseList<Session::Ptr>(std::move(sessions), ListPage(allArgs), [](const Session::Ptr &session) {
+            Value jsession;
             fillSockInfo(jsession, session.get());
-            jsession["id"] = id;
+            jsession["id"] = session->getIdentifier();
             jsession["typeid"] = toolkit::demangle(typeid(*session).name());
-            val["data"].append(jsession);
-        });
+            return jsession;
+        }, headerOut, invoker);
     });
 
     api_regist("/index/api/getWatchers", [](API_ARGS_MAP) {
@@ -2352,6 +2932,29 @@ void installWebApi() {
         });
     });
 
+    // 获取webrtc连接信息，包括推流端的jitter buffer与nack统计
+    // Get webrtc transport info, including jitter buffer and nack statistics of publishers
+    api_regist("/index/api/getWebrtcTransportInfo", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("id");
+
+        auto webrtc_transport = WebRtcTransportManager::Instance().getItem(allArgs["id"]);
+        if (!webrtc_transport) {
+            throw ApiRetException("WebRTC transport not found", API::NotFound);
+        }
+
+        webrtc_transport->getTransportInfo([val, headerOut, invoker](Json::Value transport_info) mutable {
+            if (transport_info.isMember("error")) {
+                val["code"] = API::OtherFailed;
+                val["msg"] = transport_info["error"].asString();
+                invoker(200, headerOut, val.toStyledString());
+                return;
+            }
+            val["data"] = std::move(transport_info);
+            invoker(200, headerOut, val.toStyledString());
+        });
+    });
+
     api_regist("/index/api/addWebrtcRoomKeeper",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
         CHECK_ARGS("server_host", "server_port", "room_id", "ssl");
@@ -2540,9 +3143,16 @@ void installWebApi() {
         invoker(200, headerOut, val.toStyledString());
     });
 #endif
+
+    PollerMonitor::Instance().start();
+
+    // 所有api注册完成后执行启动批量操作
+    // Run the startup batch after all apis are registered
+    EventPollerPool::Instance().getPoller()->async([]() { runStartupBatch(); });
 }
 
 void unInstallWebApi(){
+    PollerMonitor::Instance().stop();
     s_player_proxy.clear();
     s_ffmpeg_src.clear();
     s_pusher_proxy.clear();
@@ -53,6 +53,10 @@ typedef enum {
 } ApiErr;
 
 extern const std::string kSecret;
+// 事件推送接口采样码率与观看人数的间隔，单位秒
+extern const std::string kEventSampleSec;
+// 指标接口后台采样线程延时与内存统计的间隔，单位秒
+extern const std::string kMetricsSampleSec;
 }//namespace API
 
 class ApiRetException: public std::runtime_error {
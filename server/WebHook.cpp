@@ -21,10 +21,12 @@
 #include "Common/MediaSource.h"
 #include "Http/HttpSession.h"
 #include "Http/HttpRequester.h"
+#include "Http/HttpRequesterPool.h"
 #include "Network/Session.h"
 #include "Rtsp/RtspSession.h"
 #include "WebHook.h"
 #include "WebApi.h"
+#include "HookPlugin.h"
 
 using namespace std;
 using namespace Json;
@@ -58,6 +60,13 @@ const string kOnRtpServerTimeout = HOOK_FIELD "on_rtp_server_timeout";
 const string kAliveInterval = HOOK_FIELD "alive_interval";
 const string kRetry = HOOK_FIELD "retry";
 const string kRetryDelay = HOOK_FIELD "retry_delay";
+const string kMaxConnections = HOOK_FIELD "max_connections";
+const string kMaxQueueSize = HOOK_FIELD "max_queue_size";
+const string kMaxIdleConnections = HOOK_FIELD "max_idle_connections";
+const string kIdleTimeoutSec = HOOK_FIELD "idle_timeout_sec";
+const string kBatchDelayMS = HOOK_FIELD "batch_delay_ms";
+const string kBatchMaxSize = HOOK_FIELD "batch_max_size";
+const string kPlugin = HOOK_FIELD "plugin";
 
 static onceToken token([]() {
     mINI::Instance()[kEnable] = false;
@@ -85,6 +94,13 @@ static onceToken token([]() {
     mINI::Instance()[kAliveInterval] = 30.0;
     mINI::Instance()[kRetry] = 1;
     mINI::Instance()[kRetryDelay] = 3.0;
+    mINI::Instance()[kMaxConnections] = 16;
+    mINI::Instance()[kMaxQueueSize] = 10000;
+    mINI::Instance()[kMaxIdleConnections] = 16;
+    mINI::Instance()[kIdleTimeoutSec] = 30.0;
+    mINI::Instance()[kBatchDelayMS] = 0;
+    mINI::Instance()[kBatchMaxSize] = 100;
+    mINI::Instance()[kPlugin] = "";
     mINI::Instance()[kStreamChangedSchemas] = "rtsp/rtmp/fmp4/ts/hls/hls.fmp4";
 });
 } // namespace Hook
@@ -103,6 +119,8 @@ static onceToken token([]() {
 
 } // namespace Cluster
 
+static void parse_hook_reply(const string &content, const function<void(const Value &, const string &, bool)> &fun);
+
 static void parse_http_response(const SockException &ex, const Parser &res, const function<void(const Value &, const string &, bool)> &fun) {
     bool should_retry = true;
     if (ex) {
@@ -115,9 +133,14 @@ static void parse_http_response(const SockException &ex, const Parser &res, cons
         fun(Json::nullValue, errStr, should_retry);
         return;
     }
+    parse_hook_reply(res.content(), fun);
+}
+
+static void parse_hook_reply(const string &content, const function<void(const Value &, const string &, bool)> &fun) {
+    bool should_retry = true;
     Value result;
     try {
-        stringstream ss(res.content());
+        stringstream ss(content);
         ss >> result;
     } catch (std::exception &ex) {
         auto errStr = StrPrinter << "[parse json failed]:" << ex.what() << endl;
@@ -185,18 +208,19 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
     const_cast<ArgsType &>(body)["mediaServerId"] = mediaServerId;
     const_cast<ArgsType &>(body)["hook_index"] = (Json::UInt64)(s_hook_index++);
 
-    auto requester = std::make_shared<HttpRequester>();
-    requester->setMethod("POST");
-    auto bodyStr = to_string(body);
-    requester->setBody(bodyStr);
-    requester->addHeader("Content-Type", getContentType(body));
+    // 同一hook服务器的请求复用keep-alive连接，并发数超限时排队
+    HttpRequesterPool::Request req;
+    req.url = url;
+    req.body = to_string(body);
+    req.header.emplace("Content-Type", getContentType(body));
     auto vhost = getVhost(body);
     if (!vhost.empty()) {
-        requester->addHeader("X-VHOST", vhost);
+        req.header.emplace("X-VHOST", vhost);
     }
+    req.timeout_sec = hook_timeoutSec;
     Ticker ticker;
-    requester->startRequester(url, [url, func, bodyStr, body, requester, ticker, retry](const SockException &ex, const Parser &res) mutable {
-        onceToken token(nullptr, [&]() mutable { requester.reset(); });
+    auto bodyStr = req.body;
+    req.on_result = [url, func, bodyStr, body, ticker, retry](const SockException &ex, const Parser &res) mutable {
         parse_http_response(ex, res, [&](const Value &obj, const string &err, bool should_retry) {
             if (!err.empty()) {
                 // hook失败  [AUTO-TRANSLATED:68231f46]
@@ -204,7 +228,7 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
                 WarnL << "hook " << url << " " << ticker.elapsedTime() << "ms,failed" << err << ":" << bodyStr;
 
                 if (retry-- > 0 && should_retry) {
-                    requester->getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, func, retry] {
+                    EventPollerPool::Instance().getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, func, retry] {
                         do_http_hook(url, body, func, retry);
                         return 0;
                     });
@@ -223,7 +247,8 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
                 func(obj, err);
             }
         });
-    }, hook_timeoutSec);
+    };
+    HttpRequesterPool::Instance().startRequester(std::move(req));
 }
 
 void do_http_hook(const string &url, const ArgsType &body, const function<void(const Value &, const string &)> &func) {
@@ -231,6 +256,300 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
     do_http_hook(url, body, func, hook_retry);
 }
 
+static void do_http_hook_batch(const string &url, const string &body, uint32_t retry) {
+    GET_CONFIG(float, hook_timeoutSec, Hook::kTimeoutSec);
+    GET_CONFIG(float, retry_delay, Hook::kRetryDelay);
+
+    HttpRequesterPool::Request req;
+    req.url = url;
+    req.body = body;
+    req.header.emplace("Content-Type", "application/json");
+    req.timeout_sec = hook_timeoutSec;
+    Ticker ticker;
+    req.on_result = [url, body, ticker, retry](const SockException &ex, const Parser &res) mutable {
+        parse_http_response(ex, res, [&](const Value &obj, const string &err, bool should_retry) {
+            if (err.empty()) {
+                return;
+            }
+            WarnL << "batch hook " << url << " " << ticker.elapsedTime() << "ms,failed" << err << ":" << body;
+            if (retry-- > 0 && should_retry) {
+                // 整批重试
+                EventPollerPool::Instance().getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, retry] {
+                    do_http_hook_batch(url, body, retry);
+                    return 0;
+                });
+            }
+        });
+    };
+    HttpRequesterPool::Instance().startRequester(std::move(req));
+}
+
+/**
+ * 合并无需回复的通知类hook，每batch_delay_ms毫秒或攒够batch_max_size个事件后以json数组的形式一次性post
+ * Merge notification hooks that need no reply, post them as one json array
+ * every batch_delay_ms milliseconds or batch_max_size events
+ */
+class HookBatcher {
+public:
+    static HookBatcher &Instance() {
+        static HookBatcher s_instance;
+        return s_instance;
+    }
+
+    void add(const string &url, Value body) {
+        GET_CONFIG(uint32_t, batch_delay_ms, Hook::kBatchDelayMS);
+        GET_CONFIG(uint32_t, batch_max_size, Hook::kBatchMaxSize);
+
+        Value events;
+        {
+            lock_guard<mutex> lck(_mtx);
+            auto &batch = _batches[url];
+            if (batch.events.empty()) {
+                // 新批次开始计时
+                auto seq = ++batch.seq;
+                EventPollerPool::Instance().getPoller()->doDelayTask(batch_delay_ms, [url, seq]() {
+                    HookBatcher::Instance().flush(url, seq);
+                    return 0;
+                });
+                batch.events = Json::arrayValue;
+            }
+            batch.events.append(std::move(body));
+            if (batch.events.size() < MAX(batch_max_size, 1u)) {
+                return;
+            }
+            events.swap(batch.events);
+        }
+        send(url, events);
+    }
+
+    void flushAll() {
+        decltype(_batches) batches;
+        {
+            lock_guard<mutex> lck(_mtx);
+            batches.swap(_batches);
+        }
+        for (auto &pr : batches) {
+            if (!pr.second.events.empty()) {
+                send(pr.first, pr.second.events);
+            }
+        }
+    }
+
+private:
+    struct Batch {
+        uint64_t seq = 0;
+        Value events;
+    };
+
+    void flush(const string &url, uint64_t seq) {
+        Value events;
+        {
+            lock_guard<mutex> lck(_mtx);
+            auto it = _batches.find(url);
+            // 该批次已因数量达到上限而提前发送
+            if (it == _batches.end() || it->second.seq != seq || it->second.events.empty()) {
+                return;
+            }
+            events.swap(it->second.events);
+        }
+        send(url, events);
+    }
+
+    static void send(const string &url, const Value &events) {
+        GET_CONFIG(uint32_t, hook_retry, Hook::kRetry);
+        do_http_hook_batch(url, to_string(events), hook_retry);
+    }
+
+private:
+    mutex _mtx;
+    unordered_map<string, Batch> _batches;
+};
+
+/**
+ * 触发无需回复的通知类hook，开启hook.batch_delay_ms后将合并发送
+ * Trigger a notification hook which needs no reply, merged when hook.batch_delay_ms is enabled
+ */
+static void do_http_hook_notify(const string &url, const ArgsType &body) {
+#ifdef JSON_ARGS
+    GET_CONFIG(uint32_t, batch_delay_ms, Hook::kBatchDelayMS);
+    if (batch_delay_ms) {
+        GET_CONFIG(string, mediaServerId, General::kMediaServerId);
+        auto event = body;
+        event["mediaServerId"] = mediaServerId;
+        event["hook_index"] = (Json::UInt64)(s_hook_index++);
+        HookBatcher::Instance().add(url, std::move(event));
+        return;
+    }
+#endif
+    do_http_hook(url, body, nullptr);
+}
+
+/**
+ * 缓存on_play、on_rtsp_auth等鉴权hook的成功回复，hook回复中携带cache_ttl(秒)时生效；
+ * cache_scope指定缓存key除流名外还包括哪些字段，可选params、ip，以逗号分隔，
+ * 为stream时同一个流的所有请求共享鉴权结果，未指定时默认为params,ip
+ * Cache successful replies of auth hooks such as on_play and on_rtsp_auth when the reply carries cache_ttl (seconds).
+ * cache_scope lists which fields besides the stream form the cache key: params, ip (comma separated),
+ * "stream" shares the decision across the whole stream, the default is "params,ip"
+ */
+class HookReplyCache {
+public:
+    static HookReplyCache &Instance() {
+        static HookReplyCache s_instance;
+        return s_instance;
+    }
+
+    bool get(const string &base, const string &params, const string &ip, Value &reply) {
+        auto now = getCurrentMillisecond();
+        lock_guard<mutex> lck(_mtx);
+        auto scope_it = _scopes.find(base);
+        if (scope_it == _scopes.end()) {
+            return false;
+        }
+        if (scope_it->second.expire_ms < now) {
+            _scopes.erase(scope_it);
+            return false;
+        }
+        auto it = _replies.find(makeKey(base, scope_it->second.flags, params, ip));
+        if (it == _replies.end()) {
+            return false;
+        }
+        if (it->second.expire_ms < now) {
+            _replies.erase(it);
+            return false;
+        }
+        reply = it->second.reply;
+        return true;
+    }
+
+    void put(const string &base, const string &params, const string &ip, const Value &reply) {
+        auto ttl_ms = (uint64_t)(reply["cache_ttl"].asDouble() * 1000);
+        if (!ttl_ms) {
+            return;
+        }
+        int flags = kScopeParams | kScopeIp;
+        if (reply.isMember("cache_scope")) {
+            flags = 0;
+            for (auto &item : split(reply["cache_scope"].asString(), ",")) {
+                trim(item);
+                if (item == "params") {
+                    flags |= kScopeParams;
+                } else if (item == "ip") {
+                    flags |= kScopeIp;
+                }
+            }
+        }
+        auto expire_ms = getCurrentMillisecond() + ttl_ms;
+        lock_guard<mutex> lck(_mtx);
+        if (_replies.size() >= kMaxSize) {
+            purge();
+        }
+        auto &scope = _scopes[base];
+        scope.flags = flags;
+        scope.expire_ms = MAX(scope.expire_ms, expire_ms);
+        auto &entry = _replies[makeKey(base, flags, params, ip)];
+        entry.reply = reply;
+        entry.expire_ms = expire_ms;
+    }
+
+private:
+    HookReplyCache() {
+        // 重载配置(例如修改hook地址)后丢弃所有缓存的鉴权结果
+        NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastReloadConfig, [this](BroadcastReloadConfigArgs) {
+            lock_guard<mutex> lck(_mtx);
+            _scopes.clear();
+            _replies.clear();
+        });
+    }
+
+    static string makeKey(const string &base, int flags, const string &params, const string &ip) {
+        string key = base;
+        key += '\n';
+        if (flags & kScopeParams) {
+            key += params;
+        }
+        key += '\n';
+        if (flags & kScopeIp) {
+            key += ip;
+        }
+        return key;
+    }
+
+    void purge() {
+        auto now = getCurrentMillisecond();
+        for (auto it = _replies.begin(); it != _replies.end();) {
+            it = it->second.expire_ms < now ? _replies.erase(it) : std::next(it);
+        }
+        for (auto it = _scopes.begin(); it != _scopes.end();) {
+            it = it->second.expire_ms < now ? _scopes.erase(it) : std::next(it);
+        }
+        if (_replies.size() >= kMaxSize) {
+            WarnL << "hook reply cache is full, clear it";
+            _replies.clear();
+            _scopes.clear();
+        }
+    }
+
+private:
+    static constexpr size_t kMaxSize = 100000;
+    static constexpr int kScopeParams = 1 << 0;
+    static constexpr int kScopeIp = 1 << 1;
+
+    struct Scope {
+        int flags = 0;
+        uint64_t expire_ms = 0;
+    };
+    struct Entry {
+        Value reply;
+        uint64_t expire_ms = 0;
+    };
+
+    mutex _mtx;
+    unordered_map<string, Scope> _scopes;
+    unordered_map<string, Entry> _replies;
+};
+
+/**
+ * 该hook是否由hook插件处理或者配置了http hook地址
+ * Whether the hook is handled by the hook plugin or has an http hook url
+ */
+static bool has_hook(const char *name, const string &url) {
+    return !url.empty() || HookPlugin::Instance().supports(name);
+}
+
+/**
+ * 优先交给hook插件在进程内处理，插件不处理时走http hook
+ * Let the hook plugin handle the hook in process first, fall back to the http hook
+ */
+static void do_hook(const char *name, const string &url, const ArgsType &body, const function<void(const Value &, const string &)> &func) {
+    if (!HookPlugin::Instance().supports(name)) {
+        do_http_hook(url, body, func);
+        return;
+    }
+    GET_CONFIG(string, mediaServerId, General::kMediaServerId);
+    auto plugin_body = body;
+    plugin_body["mediaServerId"] = mediaServerId;
+    HookPlugin::Instance().invoke(name, to_string(plugin_body), [url, body, func](const char *json) {
+        if (!json) {
+            // 插件放弃处理
+            if (!url.empty()) {
+                do_http_hook(url, body, func);
+            } else if (func) {
+                func(Json::nullValue, "hook plugin declined and no http hook configured");
+            }
+            return;
+        }
+        parse_hook_reply(json, [&](const Value &obj, const string &err, bool should_retry) {
+            if (!err.empty()) {
+                WarnL << "hook plugin failed" << err;
+            }
+            if (func) {
+                func(obj, err);
+            }
+        });
+    });
+}
+
 void dumpMediaTuple(const MediaTuple &tuple, Json::Value& item);
 
 static ArgsType make_json(const MediaInfo &args) {
@@ -404,12 +723,31 @@ static mINI jsonToMini(const Value &obj) {
     return ret;
 }
 
+static void applyRequesterPoolConfig() {
+    auto &pool = HttpRequesterPool::Instance();
+    pool.setMaxConnections(mINI::Instance()[Hook::kMaxConnections].as<size_t>());
+    pool.setMaxQueueSize(mINI::Instance()[Hook::kMaxQueueSize].as<size_t>());
+    pool.setMaxIdle(mINI::Instance()[Hook::kMaxIdleConnections].as<size_t>());
+    pool.setIdleTimeout(mINI::Instance()[Hook::kIdleTimeoutSec].as<float>());
+}
+
 void installWebHook() {
     GET_CONFIG(bool, hook_enable, Hook::kEnable);
+    GET_CONFIG(string, hook_plugin, Hook::kPlugin);
+    if (!hook_plugin.empty()) {
+        // 加载hook插件，插件处理的hook不再发起http请求
+        HookPlugin::Instance().load(hook_plugin);
+    }
+
+    // hook连接池参数在加载与重载配置时生效
+    applyRequesterPoolConfig();
+    NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastReloadConfig, [](BroadcastReloadConfigArgs) {
+        applyRequesterPoolConfig();
+    });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastMediaPublish, [](BroadcastMediaPublishArgs) {
         GET_CONFIG(string, hook_publish, Hook::kOnPublish);
-        if (!hook_enable || hook_publish.empty()) {
+        if (!hook_enable || !has_hook("on_publish", hook_publish)) {
             invoker("", ProtocolOption());
             return;
         }
@@ -423,7 +761,7 @@ void installWebHook() {
         body["originTypeStr"] = getOriginTypeString(type);
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_publish, body, [invoker](const Value &obj, const string &err) mutable {
+        do_hook("on_publish", hook_publish, body, [invoker](const Value &obj, const string &err) mutable {
             if (err.empty()) {
                 // 推流鉴权成功  [AUTO-TRANSLATED:e4285dab]
                 // Push stream authentication succeeded
@@ -440,17 +778,30 @@ void installWebHook() {
         recordWatcher(args, sender);
 
         GET_CONFIG(string, hook_play, Hook::kOnPlay);
-        if (!hook_enable || hook_play.empty()) {
+        if (!hook_enable || !has_hook("on_play", hook_play)) {
+            invoker("");
+            return;
+        }
+        auto cache_base = hook_play + '\n' + args.getUrl();
+        auto peer_ip = sender.get_peer_ip();
+        Value cached;
+        if (HookReplyCache::Instance().get(cache_base, args.params, peer_ip, cached)) {
             invoker("");
             return;
         }
         auto body = make_json(args);
-        body["ip"] = sender.get_peer_ip();
+        body["ip"] = peer_ip;
         body["port"] = sender.get_peer_port();
         body["id"] = sender.getIdentifier();
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_play, body, [invoker](const Value &obj, const string &err) { invoker(err); });
+        auto params = args.params;
+        do_hook("on_play", hook_play, body, [invoker, cache_base, params, peer_ip](const Value &obj, const string &err) {
+            if (err.empty()) {
+                HookReplyCache::Instance().put(cache_base, params, peer_ip, obj);
+            }
+            invoker(err);
+        });
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastMediaPlayed, [](BroadcastMediaPlayedArgs) {
@@ -476,7 +827,7 @@ void installWebHook() {
         body["id"] = sender.getIdentifier();
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_play_report, body, nullptr);
+        do_http_hook_notify(hook_play_report, body);
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastFlowReport, [](BroadcastFlowReportArgs) {
@@ -507,7 +858,7 @@ void installWebHook() {
         body["id"] = sender.getIdentifier();
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_flowreport, body, nullptr);
+        do_http_hook_notify(hook_flowreport, body);
     });
 
     static const string unAuthedRealm = "unAuthedRealm";
@@ -516,7 +867,7 @@ void installWebHook() {
     // Listen to the kBroadcastOnGetRtspRealm event to determine whether the rtsp link needs authentication (traditional rtsp authentication scheme) to access
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastOnGetRtspRealm, [](BroadcastOnGetRtspRealmArgs) {
         GET_CONFIG(string, hook_rtsp_realm, Hook::kOnRtspRealm);
-        if (!hook_enable || hook_rtsp_realm.empty()) {
+        if (!hook_enable || !has_hook("on_rtsp_realm", hook_rtsp_realm)) {
             // 无需认证  [AUTO-TRANSLATED:77728e07]
             // No authentication required
             invoker("");
@@ -528,7 +879,7 @@ void installWebHook() {
         body["id"] = sender.getIdentifier();
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_rtsp_realm, body, [invoker](const Value &obj, const string &err) {
+        do_hook("on_rtsp_realm", hook_rtsp_realm, body, [invoker](const Value &obj, const string &err) {
             if (!err.empty()) {
                 // 如果接口访问失败，那么该rtsp流认证失败  [AUTO-TRANSLATED:81b19b72]
                 // If the interface access fails, then the rtsp stream authentication fails
@@ -543,14 +894,21 @@ void installWebHook() {
     // Listen to the kBroadcastOnRtspAuth event to return the correct rtsp authentication username and password
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastOnRtspAuth, [](BroadcastOnRtspAuthArgs) {
         GET_CONFIG(string, hook_rtsp_auth, Hook::kOnRtspAuth);
-        if (unAuthedRealm == realm || !hook_enable || hook_rtsp_auth.empty()) {
+        if (unAuthedRealm == realm || !hook_enable || !has_hook("on_rtsp_auth", hook_rtsp_auth)) {
             // 认证失败  [AUTO-TRANSLATED:70cf56ff]
             // Authentication failed
             invoker(false, makeRandStr(12));
             return;
         }
+        auto cache_base = hook_rtsp_auth + '\n' + args.getUrl() + '\n' + realm + '\n' + user_name + '\n' + (must_no_encrypt ? "1" : "0");
+        auto peer_ip = sender.get_peer_ip();
+        Value cached;
+        if (HookReplyCache::Instance().get(cache_base, args.params, peer_ip, cached)) {
+            invoker(cached["encrypted"].asBool(), cached["passwd"].asString());
+            return;
+        }
         auto body = make_json(args);
-        body["ip"] = sender.get_peer_ip();
+        body["ip"] = peer_ip;
         body["port"] = sender.get_peer_port();
         body["id"] = sender.getIdentifier();
         body["user_name"] = user_name;
@@ -558,13 +916,15 @@ void installWebHook() {
         body["realm"] = realm;
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_rtsp_auth, body, [invoker](const Value &obj, const string &err) {
+        auto params = args.params;
+        do_hook("on_rtsp_auth", hook_rtsp_auth, body, [invoker, cache_base, params, peer_ip](const Value &obj, const string &err) {
             if (!err.empty()) {
                 // 认证失败  [AUTO-TRANSLATED:70cf56ff]
                 // Authentication failed
                 invoker(false, makeRandStr(12));
                 return;
             }
+            HookReplyCache::Instance().put(cache_base, params, peer_ip, obj);
             invoker(obj["encrypted"].asBool(), obj["passwd"].asString());
         });
     });
@@ -604,7 +964,7 @@ void installWebHook() {
         }
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_stream_changed, body, nullptr);
+        do_http_hook_notify(hook_stream_changed, body);
     });
 
     GET_CONFIG_FUNC(vector<string>, origin_urls, Cluster::kOriginUrl, [](const string &str) {
@@ -638,7 +998,7 @@ void installWebHook() {
         }
 
         GET_CONFIG(string, hook_stream_not_found, Hook::kOnStreamNotFound);
-        if (!hook_enable || hook_stream_not_found.empty()) {
+        if (!hook_enable || !has_hook("on_stream_not_found", hook_stream_not_found)) {
             return;
         }
         auto body = make_json(args);
@@ -657,7 +1017,7 @@ void installWebHook() {
 
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_stream_not_found, body, res_cb);
+        do_hook("on_stream_not_found", hook_stream_not_found, body, res_cb);
     });
 
     static auto getRecordInfo = [](const RecordInfo &info) {
@@ -683,7 +1043,7 @@ void installWebHook() {
         }
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_record_mp4, getRecordInfo(info), nullptr);
+        do_http_hook_notify(hook_record_mp4, getRecordInfo(info));
     });
 #endif // ENABLE_MP4
 
@@ -694,12 +1054,12 @@ void installWebHook() {
         }
         // 执行 hook  [AUTO-TRANSLATED:d9d66f75]
         // Execute hook
-        do_http_hook(hook_record_ts, getRecordInfo(info), nullptr);
+        do_http_hook_notify(hook_record_ts, getRecordInfo(info));
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastShellLogin, [](BroadcastShellLoginArgs) {
         GET_CONFIG(string, hook_shell_login, Hook::kOnShellLogin);
-        if (!hook_enable || hook_shell_login.empty()) {
+        if (!hook_enable || !has_hook("on_shell_login", hook_shell_login)) {
             invoker("");
             return;
         }
@@ -712,7 +1072,7 @@ void installWebHook() {
 
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_shell_login, body, [invoker](const Value &, const string &err) { invoker(err); });
+        do_hook("on_shell_login", hook_shell_login, body, [invoker](const Value &, const string &err) { invoker(err); });
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastStreamNoneReader, [](BroadcastStreamNoneReaderArgs) {
@@ -749,7 +1109,7 @@ void installWebHook() {
         }
 
         GET_CONFIG(string, hook_stream_none_reader, Hook::kOnStreamNoneReader);
-        if (!hook_enable || hook_stream_none_reader.empty()) {
+        if (!hook_enable || !has_hook("on_stream_none_reader", hook_stream_none_reader)) {
             return;
         }
 
@@ -759,7 +1119,7 @@ void installWebHook() {
         weak_ptr<MediaSource> weakSrc = sender.shared_from_this();
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_stream_none_reader, body, [weakSrc, auto_close](const Value &obj, const string &err) {
+        do_hook("on_stream_none_reader", hook_stream_none_reader, body, [weakSrc, auto_close](const Value &obj, const string &err) {
             if (auto_close) {
                 // 在上层已经关闭了
                 return;
@@ -790,7 +1150,7 @@ void installWebHook() {
         body["err"] = ex.getErrCode();
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_send_rtp_stopped, body, nullptr);
+        do_http_hook_notify(hook_send_rtp_stopped, body);
     });
 
     /**
@@ -825,7 +1185,7 @@ void installWebHook() {
     // The purpose of tracking users is to cache the last authentication result, reduce the number of authentication times, and improve performance
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastHttpAccess, [](BroadcastHttpAccessArgs) {
         GET_CONFIG(string, hook_http_access, Hook::kOnHttpAccess);
-        if (!hook_enable || hook_http_access.empty()) {
+        if (!hook_enable || !has_hook("on_http_access", hook_http_access)) {
             // 未开启http文件访问鉴权，那么允许访问，但是每次访问都要鉴权；  [AUTO-TRANSLATED:deb3a0ae]
             // If http file access authentication is not enabled, then access is allowed, but authentication is required for each access;
             // 因为后续随时都可能开启鉴权(重载配置文件后可能重新开启鉴权)  [AUTO-TRANSLATED:a090bf06]
@@ -850,7 +1210,7 @@ void installWebHook() {
         }
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_http_access, body, [invoker](const Value &obj, const string &err) {
+        do_hook("on_http_access", hook_http_access, body, [invoker](const Value &obj, const string &err) {
             if (!err.empty()) {
                 // 如果接口访问失败，那么仅限本次没有访问http服务器的权限  [AUTO-TRANSLATED:f8afd1fd]
                 // If the interface access fails, then only this time does not have permission to access the http server
@@ -881,7 +1241,7 @@ void installWebHook() {
         body["tcp_mode"] = tcp_mode;
         body["re_use_port"] = re_use_port;
         body["ssrc"] = ssrc;
-        do_http_hook(rtp_server_timeout, body);
+        do_http_hook_notify(rtp_server_timeout, body);
     });
 
     // 汇报服务器重新启动  [AUTO-TRANSLATED:bd7d83df]
@@ -896,9 +1256,11 @@ void installWebHook() {
 void unInstallWebHook() {
     g_keepalive_timer.reset();
     NoticeCenter::Instance().delListener(&web_hook_tag);
+    HookPlugin::Instance().unload();
 }
 
 void onProcessExited() {
+    HookBatcher::Instance().flushAll();
     reportServerExited();
 }
 
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "FrameThinner.h"
+#include "Common/config.h"
+#include "Util/util.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+void FrameThinner::updateBySendQueue(size_t queued) {
+    GET_CONFIG(size_t, threshold, General::kFrameThinningQueue);
+    if (!threshold) {
+        return;
+    }
+    if (!_thinning && queued > threshold) {
+        setThinning(true);
+    } else if (_thinning && queued < threshold / 4) {
+        setThinning(false);
+    }
+}
+
+void FrameThinner::updateByBitrate(uint32_t estimate_bps, uint32_t source_bps) {
+    if (!estimate_bps || !source_bps) {
+        return;
+    }
+    if (!_thinning && estimate_bps < source_bps * 0.85) {
+        setThinning(true);
+    } else if (_thinning && estimate_bps > source_bps) {
+        setThinning(false);
+    }
+}
+
+void FrameThinner::setThinning(bool flag) {
+    GET_CONFIG(bool, enable, General::kFrameThinning);
+    _thinning = flag && enable;
+}
+
+int FrameThinner::classifyNal(CodecId codec, const uint8_t *nal, size_t size) {
+    switch (codec) {
+        case CodecH264: {
+            if (size < 1) {
+                return kNalOther;
+            }
+            // slice(1~5)的nal_ref_idc为0时不被参考
+            // A slice (1~5) with nal_ref_idc 0 is not referenced
+            auto type = nal[0] & 0x1F;
+            if (type < 1 || type > 5) {
+                return kNalOther;
+            }
+            return (nal[0] & 0x60) ? kNalReference : kNalDisposable;
+        }
+        case CodecH265: {
+            if (size < 2) {
+                return kNalOther;
+            }
+            auto type = (nal[0] >> 1) & 0x3F;
+            if (type == 33) {
+                // sps的sps_max_sub_layers_minus1即最高时域层，位于nal头之后首字节，不受防竞争字节影响
+                // sps_max_sub_layers_minus1 of the sps is the highest temporal layer, it is in the first byte after the nal header and never escaped
+                if (size >= 3) {
+                    _h265_max_tid = (nal[2] >> 1) & 0x07;
+                }
+                return kNalOther;
+            }
+            if (type > 31) {
+                return kNalOther;
+            }
+            int tid = (nal[1] & 0x07) - 1;
+            // 子层非参考图像(TRAIL_N/TSA_N/STSA_N/RADL_N/RASL_N/RSV_VCL_N)可被更高时域层参考，只有最高时域层的可以丢弃；
+            // 未获取sps前不知道最高时域层，不丢弃
+            // Sub-layer non-reference pictures may be referenced by higher temporal layers, only those of the highest layer are disposable;
+            // nothing is disposable before the sps tells the highest layer
+            if (type <= 14 && !(type & 0x01) && _h265_max_tid >= 0 && tid >= _h265_max_tid) {
+                return kNalDisposable;
+            }
+            return kNalReference;
+        }
+        default: return kNalOther;
+    }
+}
+
+int FrameThinner::classifyRtp(CodecId codec, const RtpPacket::Ptr &rtp) {
+    auto payload = rtp->getPayload();
+    auto size = rtp->getPayloadSize();
+    if (!size) {
+        return kNalOther;
+    }
+    // 聚合包取其中各nal的最高类别
+    // Aggregation packets take the highest class of their nals
+    auto aggregate = [&](size_t offset) {
+        int ret = kNalOther;
+        while (offset + 2 < size) {
+            size_t nal_size = (payload[offset] << 8) | payload[offset + 1];
+            offset += 2;
+            if (!nal_size || offset + nal_size > size) {
+                break;
+            }
+            ret = MAX(ret, classifyNal(codec, payload + offset, nal_size));
+            offset += nal_size;
+        }
+        return ret;
+    };
+    switch (codec) {
+        case CodecH264: {
+            auto type = payload[0] & 0x1F;
+            if (type == 24) {
+                // STAP-A
+                return aggregate(1);
+            }
+            if (type == 28) {
+                // FU-A，nal头由FU indicator的nri与FU header的类型组成
+                // FU-A, the nal header is made of the nri of the FU indicator and the type of the FU header
+                if (size < 2) {
+                    return kNalOther;
+                }
+                uint8_t header = (payload[0] & 0xE0) | (payload[1] & 0x1F);
+                return classifyNal(codec, &header, 1);
+            }
+            return classifyNal(codec, payload, size);
+        }
+        case CodecH265: {
+            if (size < 3) {
+                return kNalOther;
+            }
+            auto type = (payload[0] >> 1) & 0x3F;
+            if (type == 48) {
+                // AP
+                return aggregate(2);
+            }
+            if (type == 49) {
+                // FU，nal头由payload header与FU header的类型组成
+                // FU, the nal header is made of the payload header and the type of the FU header
+                uint8_t header[2] = { (uint8_t)((payload[0] & 0x81) | ((payload[2] & 0x3F) << 1)), payload[1] };
+                return classifyNal(codec, header, 2);
+            }
+            return classifyNal(codec, payload, size);
+        }
+        default: return kNalOther;
+    }
+}
+
+bool FrameThinner::dropRtp(CodecId codec, const RtpPacket::Ptr &rtp) {
+    if (rtp->type != TrackVideo) {
+        return false;
+    }
+    auto stamp = rtp->getStamp();
+    if (!_frame_valid || stamp != _frame_stamp) {
+        _frame_valid = true;
+        _frame_stamp = stamp;
+        _frame_state = FrameState::undecided;
+    }
+    if (_frame_state == FrameState::undecided) {
+        if (!_thinning && codec != CodecH265) {
+            // 未拥塞时无需解析，h265需要持续从sps获取时域层数
+            // No need to parse while not congested, except h265 which keeps reading the temporal layers from the sps
+            _frame_state = FrameState::keep;
+            return false;
+        }
+        auto cls = classifyRtp(codec, rtp);
+        if (cls == kNalOther) {
+            // 参数集、sei等，等待首个slice再决定
+            // Parameter sets, sei and so on, wait for the first slice to decide
+            return false;
+        }
+        _frame_state = (_thinning && cls == kNalDisposable) ? FrameState::drop : FrameState::keep;
+        if (_frame_state == FrameState::drop) {
+            ++_dropped_frames;
+        }
+    }
+    return _frame_state == FrameState::drop;
+}
+
+void FrameThinner::parseHevcConfig(const uint8_t *record, size_t size) {
+    // HEVCDecoderConfigurationRecord第22字节：constantFrameRate(2) numTemporalLayers(3) temporalIdNested(1) lengthSizeMinusOne(2)；
+    // numTemporalLayers为0表示未知
+    // Byte 22 of HEVCDecoderConfigurationRecord: constantFrameRate(2) numTemporalLayers(3) temporalIdNested(1) lengthSizeMinusOne(2);
+    // numTemporalLayers 0 means unknown
+    if (size < 22) {
+        return;
+    }
+    auto layers = (record[21] >> 3) & 0x07;
+    if (layers) {
+        _h265_max_tid = layers - 1;
+    }
+}
+
+bool FrameThinner::dropRtmp(const RtmpPacket::Ptr &pkt) {
+    if (pkt->type_id != MSG_VIDEO || pkt->size() < 5) {
+        return false;
+    }
+    auto data = (const uint8_t *)pkt->data();
+    auto size = pkt->size();
+    CodecId codec = CodecInvalid;
+    size_t offset = 0;
+    auto enhanced = (const RtmpVideoHeaderEnhanced *)data;
+    if (enhanced->enhanced) {
+        if ((RtmpVideoCodec)ntohl(enhanced->fourcc) != RtmpVideoCodec::fourcc_hevc) {
+            return false;
+        }
+        codec = CodecH265;
+        switch ((RtmpPacketType)enhanced->pkt_type) {
+            case RtmpPacketType::PacketTypeCodedFrames: offset = RtmpPacketInfo::kEnhancedRtmpHeaderSize + 3; break;
+            case RtmpPacketType::PacketTypeCodedFramesX: offset = RtmpPacketInfo::kEnhancedRtmpHeaderSize; break;
+            case RtmpPacketType::PacketTypeSequenceStart:
+                if (size > RtmpPacketInfo::kEnhancedRtmpHeaderSize) {
+                    parseHevcConfig(data + RtmpPacketInfo::kEnhancedRtmpHeaderSize, size - RtmpPacketInfo::kEnhancedRtmpHeaderSize);
+                }
+                return false;
+            default: return false;
+        }
+    } else {
+        auto classic = (const RtmpVideoHeaderClassic *)data;
+        switch ((RtmpVideoCodec)classic->codec_id) {
+            case RtmpVideoCodec::h264: codec = CodecH264; break;
+            case RtmpVideoCodec::h265: codec = CodecH265; break;
+            default: return false;
+        }
+        if (codec == CodecH265 && (RtmpH264PacketType)classic->h264_pkt_type == RtmpH264PacketType::h264_config_header) {
+            parseHevcConfig(data + 5, size - 5);
+            return false;
+        }
+        if ((RtmpH264PacketType)classic->h264_pkt_type != RtmpH264PacketType::h264_nalu) {
+            return false;
+        }
+        // 2字节头与3字节cts
+        // 2 bytes header and 3 bytes cts
+        offset = 5;
+    }
+    if (!_thinning && codec != CodecH265) {
+        return false;
+    }
+
+    // 4字节长度前缀的nal
+    // Nals prefixed with 4 bytes length
+    int cls = kNalOther;
+    while (offset + 4 < size) {
+        size_t nal_size = (data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+        offset += 4;
+        if (!nal_size || offset + nal_size > size) {
+            break;
+        }
+        cls = MAX(cls, classifyNal(codec, data + offset, nal_size));
+        offset += nal_size;
+    }
+    if (!_thinning || cls != kNalDisposable) {
+        return false;
+    }
+    ++_dropped_frames;
+    return true;
+}
+
+} // namespace mediakit
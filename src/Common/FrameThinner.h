@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_FRAMETHINNER_H
+#define ZLMEDIAKIT_FRAMETHINNER_H
+
+#include <cstdint>
+#include "Rtsp/Rtsp.h"
+#include "Rtmp/Rtmp.h"
+
+namespace mediakit {
+
+/**
+ * 播放器级别的抽帧：观看端拥塞时只丢弃不被其他帧参考的视频帧，解码器的参考关系不受影响
+ * h264丢弃nal_ref_idc为0的帧，h265丢弃最高时域层的子层非参考帧，其他编码不丢帧
+ * Per player frame thinning: drop only video frames nobody references while the viewer is congested, the reference state of the decoder is intact.
+ * h264 frames with nal_ref_idc 0 and h265 sub-layer non-reference pictures of the highest temporal layer are dropped, other codecs are never thinned
+ */
+class FrameThinner {
+public:
+    /**
+     * 按tcp发送队列中待发送的数据包个数更新拥塞状态，超过阈值开始抽帧，回落到阈值1/4以下停止
+     * Update the congestion state by the packets queued in the tcp send buffer, start above the threshold and stop below a quarter of it
+     */
+    void updateBySendQueue(size_t queued);
+
+    /**
+     * 按带宽估计更新拥塞状态，估计值低于源码率的85%开始抽帧，恢复到源码率以上停止
+     * Update the congestion state by the bandwidth estimate, start below 85% of the source bitrate and stop above it
+     */
+    void updateByBitrate(uint32_t estimate_bps, uint32_t source_bps);
+
+    bool isThinning() const { return _thinning; }
+    uint64_t getDroppedFrames() const { return _dropped_frames; }
+
+    /**
+     * 是否丢弃该rtp，一帧的所有rtp(时间戳相同)在首个slice处统一决定
+     * Whether to drop the rtp, all rtp of a frame (same timestamp) follow the decision made at its first slice
+     */
+    bool dropRtp(CodecId codec, const RtpPacket::Ptr &rtp);
+
+    /**
+     * 是否丢弃该rtmp视频包
+     * Whether to drop the rtmp video packet
+     */
+    bool dropRtmp(const RtmpPacket::Ptr &pkt);
+
+private:
+    enum NalClass : int {
+        kNalOther = 0,
+        kNalDisposable,
+        kNalReference,
+    };
+
+    int classifyNal(CodecId codec, const uint8_t *nal, size_t size);
+    int classifyRtp(CodecId codec, const RtpPacket::Ptr &rtp);
+    void parseHevcConfig(const uint8_t *record, size_t size);
+    void setThinning(bool flag);
+
+private:
+    bool _thinning = false;
+    // h265最高temporal id，取自sps或rtmp的sequence header，-1为未知；只有该时域层的子层非参考帧不会被任何帧参考
+    // Highest h265 temporal id from the sps or the rtmp sequence header, -1 if unknown; only sub-layer non-reference pictures of this layer are referenced by no picture
+    int _h265_max_tid = -1;
+    uint64_t _dropped_frames = 0;
+
+    enum class FrameState : uint8_t { undecided, keep, drop };
+    bool _frame_valid = false;
+    uint32_t _frame_stamp = 0;
+    FrameState _frame_state = FrameState::undecided;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_FRAMETHINNER_H
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <sstream>
+#include "FrameTracer.h"
+#include "Util/util.h"
+#include "Common/MultiMediaSourceMuxer.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+std::atomic<int> FrameTracer::s_enabled_count { 0 };
+
+// 当前线程正在处理的数据包的接收时间
+// Receive time of the packet the current thread is handling
+static thread_local uint64_t s_ingest_us = 0;
+
+// trace json中的线程id，首次使用时分配并登记线程名
+// Thread id in the trace json, allocated and registered with the thread name on first use
+static mutex s_thread_mtx;
+static map<uint64_t, string> s_thread_names;
+
+static uint64_t traceThreadId() {
+    static atomic<uint64_t> s_next_tid { 0 };
+    static thread_local uint64_t s_tid = 0;
+    if (!s_tid) {
+        s_tid = ++s_next_tid;
+        lock_guard<mutex> lck(s_thread_mtx);
+        s_thread_names[s_tid] = getThreadName();
+    }
+    return s_tid;
+}
+
+static string escapeJson(const string &str) {
+    string ret;
+    ret.reserve(str.size());
+    for (auto ch : str) {
+        switch (ch) {
+            case '\\': ret.append("\\\\"); break;
+            case '"': ret.append("\\\""); break;
+            case '\n': ret.append("\\n"); break;
+            default: ret.push_back(ch); break;
+        }
+    }
+    return ret;
+}
+
+FrameTracer::Ptr FrameTracer::get(MediaSource &src) {
+    auto muxer = src.getMuxer();
+    return muxer ? muxer->getFrameTracer() : nullptr;
+}
+
+bool FrameTracer::start(size_t sample, size_t max_frames) {
+    lock_guard<mutex> lck(_mtx);
+    if (_enabled) {
+        return false;
+    }
+    _sample = MAX(sample, (size_t)1);
+    _max_frames = max_frames;
+    _frame_index = 0;
+    _records.clear();
+    _stamp_to_id.clear();
+    _events.clear();
+    _enabled = true;
+    ++s_enabled_count;
+    return true;
+}
+
+uint64_t FrameTracer::sample(const Frame::Ptr &frame) {
+    if (!_enabled) {
+        return 0;
+    }
+    // 音视频帧时间戳可能相同，为了发送时能按时间戳唯一匹配，有视频时仅采样视频帧
+    // Audio and video frames may share a timestamp, only video frames are sampled if any, so sends can be matched by timestamp
+    auto type = frame->getTrackType();
+    if (frame->configFrame() || (type != TrackVideo && type != TrackAudio)) {
+        return 0;
+    }
+    auto now = getCurrentMicrosecond();
+    lock_guard<mutex> lck(_mtx);
+    if (!_enabled || _records.size() >= _max_frames) {
+        return 0;
+    }
+    if (type == TrackAudio && !_records.empty() && _records.back().type == TrackVideo) {
+        return 0;
+    }
+    if (_frame_index++ % _sample) {
+        return 0;
+    }
+    Record record;
+    record.id = ++_next_id;
+    record.dts = frame->dts();
+    record.pts = frame->pts();
+    record.type = type;
+    record.key = frame->keyFrame();
+    record.in_us = now;
+    _records.emplace_back(std::move(record));
+    _stamp_to_id[frame->dts()] = _next_id;
+    _stamp_to_id[frame->pts()] = _next_id;
+
+    auto ingest_us = FrameTraceIngest::currentUS();
+    if (ingest_us && ingest_us <= now) {
+        _events.emplace_back(Event { "receive_demux", _next_id, ingest_us, now - ingest_us, traceThreadId() });
+    }
+    return _next_id;
+}
+
+uint64_t FrameTracer::find(const Frame::Ptr &frame, const char *queue_span) {
+    if (!_enabled) {
+        return 0;
+    }
+    lock_guard<mutex> lck(_mtx);
+    auto it = _stamp_to_id.find(frame->dts());
+    if (it == _stamp_to_id.end()) {
+        return 0;
+    }
+    auto record = findRecord_l(it->second);
+    if (!record || record->dts != frame->dts() || record->type != frame->getTrackType()) {
+        return 0;
+    }
+    if (queue_span) {
+        auto now = getCurrentMicrosecond();
+        _events.emplace_back(Event { queue_span, record->id, record->in_us, now - MIN(now, record->in_us), traceThreadId() });
+    }
+    return record->id;
+}
+
+FrameTracer::Record *FrameTracer::findRecord_l(uint64_t id) {
+    if (_records.empty() || id < _records.front().id) {
+        return nullptr;
+    }
+    auto index = id - _records.front().id;
+    return index < _records.size() ? &_records[index] : nullptr;
+}
+
+void FrameTracer::addSpan(uint64_t id, const char *name, uint64_t begin_us, uint64_t end_us) {
+    lock_guard<mutex> lck(_mtx);
+    if (_enabled) {
+        _events.emplace_back(Event { name, id, begin_us, end_us - MIN(end_us, begin_us), traceThreadId() });
+    }
+}
+
+void FrameTracer::onRingWrite(uint64_t id) {
+    if (!id) {
+        return;
+    }
+    lock_guard<mutex> lck(_mtx);
+    if (auto record = findRecord_l(id)) {
+        record->ring_us = getCurrentMicrosecond();
+    }
+}
+
+void FrameTracer::onSend(uint64_t stamp_ms, const char *protocol) {
+    if (!_enabled) {
+        return;
+    }
+    auto now = getCurrentMicrosecond();
+    lock_guard<mutex> lck(_mtx);
+    auto it = _stamp_to_id.find(stamp_ms);
+    if (it == _stamp_to_id.end()) {
+        return;
+    }
+    auto record = findRecord_l(it->second);
+    if (!record || !record->ring_us) {
+        return;
+    }
+    auto &send = record->sends[protocol];
+    if (!send.count++) {
+        send.first_us = now;
+        send.first_tid = traceThreadId();
+    }
+    send.last_us = now;
+    send.last_tid = traceThreadId();
+}
+
+string FrameTracer::stop(const string &title) {
+    lock_guard<mutex> lck(_mtx);
+    if (_enabled.exchange(false)) {
+        --s_enabled_count;
+    }
+
+    stringstream ss;
+    bool first = true;
+    auto write_event = [&](const string &name, const Record *record, uint64_t ts, uint64_t dur, uint64_t tid, const string &extra) {
+        ss << (first ? "\n" : ",\n") << "{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+           << ",\"ts\":" << ts << ",\"dur\":" << dur << ",\"args\":{";
+        if (record) {
+            ss << "\"frame\":" << record->id << ",\"track\":\"" << getTrackString(record->type) << "\",\"dts\":" << record->dts
+               << ",\"pts\":" << record->pts << ",\"key\":" << (record->key ? "true" : "false");
+        }
+        ss << extra << "}}";
+        first = false;
+    };
+
+    ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    ss << "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" << escapeJson(title) << "\"}}";
+    first = false;
+    {
+        lock_guard<mutex> thread_lck(s_thread_mtx);
+        for (auto &pr : s_thread_names) {
+            ss << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pr.first << ",\"args\":{\"name\":\""
+               << escapeJson(pr.second) << "\"}}";
+        }
+    }
+    for (auto &event : _events) {
+        write_event(event.name, findRecord_l(event.id), event.ts, event.dur, event.tid, "");
+    }
+    // 从环形缓存写入到各协议首个与最后一个数据包发出的时延，包含合并写、发送节流等缓存时间
+    // Latency from the ring write to the first and last packet sent per protocol, including merge-write and pacing buffering
+    for (auto &record : _records) {
+        for (auto &pr : record.sends) {
+            auto &send = pr.second;
+            string extra = StrPrinter << ",\"packets\":" << send.count;
+            write_event("send_first " + pr.first, &record, record.ring_us, send.first_us - MIN(send.first_us, record.ring_us), send.first_tid, extra);
+            write_event("send_last " + pr.first, &record, record.ring_us, send.last_us - MIN(send.last_us, record.ring_us), send.last_tid, extra);
+        }
+    }
+    ss << "\n]}\n";
+
+    _records.clear();
+    _stamp_to_id.clear();
+    _events.clear();
+    return ss.str();
+}
+
+FrameTraceSpan::FrameTraceSpan(FrameTracer *tracer, uint64_t id, const char *name) {
+    _tracer = tracer;
+    _id = id;
+    _name = name;
+    if (_id) {
+        _begin = getCurrentMicrosecond();
+    }
+}
+
+FrameTraceSpan::~FrameTraceSpan() {
+    if (_id) {
+        _tracer->addSpan(_id, _name, _begin, getCurrentMicrosecond());
+    }
+}
+
+FrameTraceIngest::FrameTraceIngest() {
+    if (FrameTracer::anyEnabled() && !s_ingest_us) {
+        s_ingest_us = getCurrentMicrosecond();
+        _owner = true;
+    }
+}
+
+FrameTraceIngest::~FrameTraceIngest() {
+    if (_owner) {
+        s_ingest_us = 0;
+    }
+}
+
+uint64_t FrameTraceIngest::currentUS() {
+    return s_ingest_us;
+}
+
+} // namespace mediakit
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_FRAMETRACER_H
+#define ZLMEDIAKIT_FRAMETRACER_H
+
+#include <map>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Extension/Frame.h"
+
+namespace mediakit {
+
+class MediaSource;
+
+/**
+ * 按需开启的单流帧级时延追踪：对采样帧记录从收包解复用、onTrackFrame、各协议复用、环形缓存写入
+ * 到各协议首个/最后一个播放器发送的时间点，导出为Chrome/Perfetto可加载的trace json；
+ * 未开启追踪时各埋点仅有一次原子变量读取的开销
+ * On-demand per-stream frame latency tracing: sampled frames are timed from packet receive and demux, onTrackFrame,
+ * every protocol muxer and the ring write to the first/last reader send of each protocol, exported as trace json
+ * loadable by Chrome/Perfetto; every trace point costs a single atomic load while tracing is off
+ */
+class FrameTracer {
+public:
+    using Ptr = std::shared_ptr<FrameTracer>;
+
+    /**
+     * 获取媒体源所属流的追踪对象，可能为nullptr
+     * Get the tracer of the stream the source belongs to, may be nullptr
+     */
+    static Ptr get(MediaSource &src);
+
+    /**
+     * 是否有任意流正在追踪
+     * Whether any stream is being traced
+     */
+    static bool anyEnabled() { return s_enabled_count > 0; }
+
+    bool enabled() const { return _enabled; }
+
+    /**
+     * 开始追踪
+     * @param sample 每隔多少帧采样一帧
+     * @param max_frames 最多采样的帧数
+     * @return 已在追踪时返回false
+     * Start tracing
+     * @param sample Sample one of every sample frames
+     * @param max_frames Max frames to sample
+     * @return false if already tracing
+     */
+    bool start(size_t sample, size_t max_frames);
+
+    /**
+     * 结束追踪并生成trace json
+     * Stop tracing and render the trace json
+     */
+    std::string stop(const std::string &title);
+
+    /**
+     * 帧进入muxer时调用，返回采样帧的id，未采样返回0
+     * Called when a frame enters the muxer, returns the id of a sampled frame, 0 if not sampled
+     */
+    uint64_t sample(const Frame::Ptr &frame);
+
+    /**
+     * 查找已采样帧的id，未采样返回0
+     * @param queue_span 不为空时记录该帧从进入muxer到此处的排队耗时
+     * Find the id of a sampled frame, 0 if not sampled
+     * @param queue_span If not null, record the time the frame queued since entering the muxer
+     */
+    uint64_t find(const Frame::Ptr &frame, const char *queue_span = nullptr);
+
+    void addSpan(uint64_t id, const char *name, uint64_t begin_us, uint64_t end_us);
+
+    /**
+     * 标记帧已写入环形缓存，后续发送时延以此为起点
+     * Mark the frame as written to the ring, send latency is measured from here
+     */
+    void onRingWrite(uint64_t id);
+
+    /**
+     * 播放器发送某时间戳的数据时调用
+     * Called when a reader sends data of a timestamp
+     */
+    void onSend(uint64_t stamp_ms, const char *protocol);
+
+private:
+    struct Send {
+        uint64_t first_us = 0;
+        uint64_t first_tid = 0;
+        uint64_t last_us = 0;
+        uint64_t last_tid = 0;
+        size_t count = 0;
+    };
+
+    struct Record {
+        uint64_t id;
+        uint64_t dts;
+        uint64_t pts;
+        TrackType type;
+        bool key;
+        uint64_t in_us;
+        uint64_t ring_us = 0;
+        std::map<std::string, Send> sends;
+    };
+
+    struct Event {
+        const char *name;
+        uint64_t id;
+        uint64_t ts;
+        uint64_t dur;
+        uint64_t tid;
+    };
+
+    Record *findRecord_l(uint64_t id);
+
+private:
+    static std::atomic<int> s_enabled_count;
+
+    std::atomic<bool> _enabled { false };
+    std::mutex _mtx;
+    size_t _sample = 1;
+    size_t _max_frames = 0;
+    size_t _frame_index = 0;
+    uint64_t _next_id = 0;
+    std::deque<Record> _records;
+    std::unordered_map<uint64_t, uint64_t> _stamp_to_id;
+    std::vector<Event> _events;
+};
+
+/**
+ * 记录采样帧在作用域内的耗时
+ * Record the time a sampled frame spends within the scope
+ */
+class FrameTraceSpan {
+public:
+    FrameTraceSpan(FrameTracer *tracer, uint64_t id, const char *name);
+    ~FrameTraceSpan();
+
+    FrameTraceSpan(const FrameTraceSpan &) = delete;
+    FrameTraceSpan &operator=(const FrameTraceSpan &) = delete;
+
+private:
+    FrameTracer *_tracer;
+    uint64_t _id;
+    const char *_name;
+    uint64_t _begin = 0;
+};
+
+/**
+ * 标记当前线程开始处理一个收到的数据包，该包解复用出的帧的接收时间取自此处
+ * Mark the current thread as handling a received packet, frames demuxed from it take their receive time from here
+ */
+class FrameTraceIngest {
+public:
+    FrameTraceIngest();
+    ~FrameTraceIngest();
+
+    /**
+     * 当前线程正在处理的数据包的接收时间，不在FrameTraceIngest作用域内时为0
+     * Receive time of the packet the current thread is handling, 0 outside of FrameTraceIngest scopes
+     */
+    static uint64_t currentUS();
+
+private:
+    bool _owner = false;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_FRAMETRACER_H
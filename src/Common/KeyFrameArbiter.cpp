@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "KeyFrameArbiter.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+KeyFrameArbiter::Result KeyFrameArbiter::onRequest(bool joining, uint64_t now_ms, uint64_t &defer_ms) {
+    GET_CONFIG(uint32_t, interval_ms, General::kKeyFrameRequestMS);
+    GET_CONFIG(uint32_t, cache_max_ms, General::kKeyFrameCacheMaxMS);
+    lock_guard<mutex> lck(_mtx);
+    ++_stats.requested;
+    auto key_ms = _key_ms.load(std::memory_order_relaxed);
+    if (joining && cache_max_ms && key_ms && now_ms - MIN(now_ms, key_ms) <= cache_max_ms) {
+        // 加入时已从gop缓存收到该关键帧
+        // The key frame was received from the gop cache on joining
+        ++_stats.from_cache;
+        return Result::from_cache;
+    }
+    if (_forward_ms && now_ms - _forward_ms < interval_ms) {
+        if (!_outstanding.load(std::memory_order_relaxed) && !_pending.exchange(true, std::memory_order_relaxed)) {
+            // 上次请求的关键帧已到达，本次请求在间隔结束时再发出
+            // The key frame of the last request arrived already, this one is sent when the interval ends
+            defer_ms = interval_ms - (now_ms - _forward_ms);
+        }
+        ++_stats.suppressed;
+        return Result::coalesced;
+    }
+    // 先占用间隔，并发的请求合并到本次请求，由onForwarded确认或撤销
+    // Take the interval first so concurrent requests merge into this one, onForwarded confirms or undoes it
+    _prev_forward_ms = _forward_ms;
+    _forward_ms = now_ms;
+    _outstanding.store(true, std::memory_order_relaxed);
+    _pending.store(false, std::memory_order_relaxed);
+    return Result::forward;
+}
+
+void KeyFrameArbiter::onKeyFrame(uint64_t now_ms) {
+    // 关键帧满足此前所有的请求
+    // A key frame satisfies all earlier requests
+    _key_ms.store(now_ms, std::memory_order_relaxed);
+    _outstanding.store(false, std::memory_order_relaxed);
+    _pending.store(false, std::memory_order_relaxed);
+}
+
+bool KeyFrameArbiter::onTimer(uint64_t now_ms) {
+    lock_guard<mutex> lck(_mtx);
+    if (!_pending.exchange(false, std::memory_order_relaxed)) {
+        // 间隔内已收到关键帧
+        // A key frame arrived within the interval
+        return false;
+    }
+    _prev_forward_ms = _forward_ms;
+    _forward_ms = now_ms;
+    _outstanding.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void KeyFrameArbiter::onForwarded(bool ok, bool deferred) {
+    lock_guard<mutex> lck(_mtx);
+    if (deferred) {
+        // 延后的请求之一最终发往源端
+        // One of the deferred requests goes to the origin after all
+        --_stats.suppressed;
+    }
+    if (ok) {
+        ++_stats.forwarded;
+        return;
+    }
+    // 源端不支持，没有关键帧可等
+    // The origin does not support it, there is no key frame to wait for
+    _forward_ms = _prev_forward_ms;
+    _outstanding.store(false, std::memory_order_relaxed);
+    ++_stats.unsupported;
+}
+
+KeyFrameArbiter::Stats KeyFrameArbiter::getStats() const {
+    lock_guard<mutex> lck(_mtx);
+    return _stats;
+}
+
+} // namespace mediakit
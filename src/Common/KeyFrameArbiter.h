@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_KEYFRAMEARBITER_H
+#define ZLMEDIAKIT_KEYFRAMEARBITER_H
+
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace mediakit {
+
+/**
+ * 一路流的关键帧请求仲裁：合并各协议各观看端的请求并限制发往源端的频率
+ * 已发出的请求尚未等到关键帧时，新的请求直接合并；间隔内关键帧已到达后的请求延后到间隔结束时发出一次；
+ * 新加入的观看端在gop缓存足够新时由gop缓存满足。
+ * 请求侧可在任意线程调用并加锁；帧侧只在muxer线程调用且无锁
+ * Key frame request arbitration of a stream: requests of all protocols and viewers are merged and the rate sent to the origin is limited.
+ * New requests merge into a sent one still waiting for its key frame; requests made after that key frame within the interval
+ * are deferred and sent once when the interval ends; joining viewers are served by the gop cache when it is recent enough.
+ * The request side may be called from any thread and is locked; the frame side is called on the muxer thread only and is lock-free
+ */
+class KeyFrameArbiter {
+public:
+    enum class Result {
+        // 需立即向源端请求
+        // Ask the origin right now
+        forward,
+        // 合并到已发出或延后的请求
+        // Merged into a sent or deferred request
+        coalesced,
+        // 由gop缓存满足
+        // Served by the gop cache
+        from_cache
+    };
+
+    struct Stats {
+        uint64_t requested = 0;
+        uint64_t forwarded = 0;
+        // 合并而未发往源端的请求数
+        // Requests merged and not sent to the origin
+        uint64_t suppressed = 0;
+        uint64_t from_cache = 0;
+        // 源端不支持而未能发出的请求数
+        // Requests that could not be sent since the origin does not support them
+        uint64_t unsupported = 0;
+    };
+
+    /**
+     * 收到关键帧请求
+     * A key frame request arrived
+     * @param joining 是否为刚加入、已收到gop缓存的观看端 / whether it comes from a viewer that just joined and received the gop cache
+     * @param defer_ms 新产生延后的请求时置为距间隔结束的毫秒数，调用方需届时调用onTimer，否则不修改
+     *                 set to the milliseconds until the interval ends when a new deferred request is created, the caller must call onTimer then; untouched otherwise
+     */
+    Result onRequest(bool joining, uint64_t now_ms, uint64_t &defer_ms);
+
+    /**
+     * 源端输出关键帧，满足此前所有的请求；仅在muxer线程调用
+     * The origin produced a key frame which satisfies all earlier requests; muxer thread only
+     */
+    void onKeyFrame(uint64_t now_ms);
+
+    /**
+     * 延后请求的间隔结束，返回true表示该请求仍未被关键帧满足，需发往源端
+     * The interval of the deferred request ended, true if no key frame satisfied it and it must be sent to the origin
+     */
+    bool onTimer(uint64_t now_ms);
+
+    /**
+     * onRequest返回forward或onTimer返回true后，报告请求是否已发往源端；未发出时撤销本次请求对间隔与统计的影响
+     * Report whether the request was sent to the origin after onRequest returned forward or onTimer returned true;
+     * if not, the request leaves no trace on the interval or the statistics
+     * @param deferred 是否为onTimer发出的延后请求 / whether it is the deferred request of onTimer
+     */
+    void onForwarded(bool ok, bool deferred);
+
+    Stats getStats() const;
+
+private:
+    // 以下由请求侧在锁内访问
+    // Accessed by the request side under the lock
+    mutable std::mutex _mtx;
+    // 最近一次发往源端的时间
+    // Time of the last request sent to the origin
+    uint64_t _forward_ms = 0;
+    // 尚未确认发出的请求之前的_forward_ms，发出失败时恢复
+    // _forward_ms before the request not yet confirmed, restored if it could not be sent
+    uint64_t _prev_forward_ms = 0;
+    Stats _stats;
+
+    // 以下由帧侧无锁写入
+    // Written lock-free by the frame side
+    // 最近一个关键帧的时间
+    // Time of the latest key frame
+    std::atomic<uint64_t> _key_ms { 0 };
+    // 已发出的请求还在等待关键帧
+    // The sent request is still waiting for its key frame
+    std::atomic<bool> _outstanding { false };
+    // 有延后到间隔结束时再发出的请求
+    // A request is deferred to the end of the interval
+    std::atomic<bool> _pending { false };
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_KEYFRAMEARBITER_H
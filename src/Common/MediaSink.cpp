@@ -64,6 +64,7 @@ bool MediaSink::addTrack(const Track::Ptr &track_in) {
         if (frame_unread.size() > kMaxUnreadyFrame) {
             // 未就绪的的track，不能缓存太多的帧，否则可能内存溢出  [AUTO-TRANSLATED:23958376]
             // Unready tracks cannot cache too many frames, otherwise memory may overflow
+            _dropped_frames += frame_unread.size();
             frame_unread.clear();
             WarnL << "Cached frame of unready track(" << frame->getCodecName() << ") is too much, now cleared";
         }
@@ -345,6 +346,10 @@ bool MediaSink::haveVideo() const {
     return _have_video;
 }
 
+uint64_t MediaSink::getDroppedFrames() const {
+    return _dropped_frames;
+}
+
 ///////////////////////////DemuxerSink//////////////////////////////
 
 void MediaSinkDelegate::setTrackListener(TrackListener *listener) {
@@ -12,6 +12,7 @@
 #define ZLMEDIAKIT_MEDIASINK_H
 
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include "Util/TimeTicker.h"
 #include "Extension/Frame.h"
@@ -186,6 +187,12 @@ public:
      */
     bool haveVideo() const;
 
+    /**
+     * track未就绪期间因缓存过多而丢弃的帧数
+     * Frames dropped because too many were cached while tracks were not ready
+     */
+    uint64_t getDroppedFrames() const;
+
 protected:
     /**
      * 某track已经准备好，其ready()状态返回true，
@@ -250,6 +257,7 @@ private:
     bool _add_mute_audio = true;
     bool _all_track_ready = false;
     size_t _max_track_size = 2;
+    std::atomic<uint64_t> _dropped_frames { 0 };
 
     toolkit::Ticker _ticker;
     MuteAudioMaker::Ptr _mute_audio_maker;
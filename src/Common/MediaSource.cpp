@@ -206,6 +206,14 @@ bool MediaSource::speed(float speed) {
     return listener->speed(*this, speed);
 }
 
+bool MediaSource::requestKeyFrame(bool joining) {
+    auto listener = _listener.lock();
+    if (!listener) {
+        return false;
+    }
+    return listener->requestKeyFrame(*this, joining);
+}
+
 bool MediaSource::close(bool force) {
     auto listener = _listener.lock();
     if (!listener) {
@@ -382,6 +390,48 @@ static MediaSource::Ptr find_l(const string &schema, const string &vhost_in, con
     return ret;
 }
 
+// 同一个流的并发异步查找共享一次未找到流事件(以及其触发的hook与拉流)
+struct FindAsyncWaiters {
+    using Ptr = std::shared_ptr<FindAsyncWaiters>;
+    bool closed = false;
+    // 各等待者的关闭回调，按等待者id索引
+    // Close callbacks of the waiters, indexed by waiter id
+    unordered_map<uint64_t, function<void()>> close_players;
+};
+
+static mutex s_find_waiters_mtx;
+static unordered_map<string, FindAsyncWaiters::Ptr> s_find_waiters;
+static atomic<uint64_t> s_find_waiter_id { 0 };
+static atomic<uint64_t> s_find_fresh { 0 };
+static atomic<uint64_t> s_find_coalesced { 0 };
+
+static void eraseFindWaiters_l(const string &key, const FindAsyncWaiters::Ptr &waiters) {
+    auto it = s_find_waiters.find(key);
+    if (it != s_find_waiters.end() && it->second == waiters) {
+        s_find_waiters.erase(it);
+    }
+}
+
+static void eraseFindWaiters(const string &key, const FindAsyncWaiters::Ptr &waiters) {
+    lock_guard<mutex> lck(s_find_waiters_mtx);
+    eraseFindWaiters_l(key, waiters);
+}
+
+// 单个等待者结束等待，最后一个等待者离开后，后续的查找重新触发未找到流事件
+// A single waiter stops waiting, after the last one leaves the next lookup fires the not found event again
+static void removeFindWaiter(const string &key, const FindAsyncWaiters::Ptr &waiters, uint64_t id) {
+    lock_guard<mutex> lck(s_find_waiters_mtx);
+    waiters->close_players.erase(id);
+    if (waiters->close_players.empty()) {
+        eraseFindWaiters_l(key, waiters);
+    }
+}
+
+void MediaSource::getFindAsyncStatistic(uint64_t &fresh, uint64_t &coalesced) {
+    fresh = s_find_fresh;
+    coalesced = s_find_coalesced;
+}
+
 static void findAsync_l(const MediaInfo &info, const std::shared_ptr<Session> &session, bool retry,
                         const function<void(const MediaSource::Ptr &src)> &cb){
     auto src = find_l(info.schema, info.vhost, info.app, info.stream, true);
@@ -390,6 +440,22 @@ static void findAsync_l(const MediaInfo &info, const std::shared_ptr<Session> &s
         return;
     }
 
+    // 按vhost/app/stream合并，不区分协议：拉流一次即可注册所有协议的媒体源，各等待者各自监听本协议的注册事件
+    // Coalesce by vhost/app/stream regardless of the schema: a single pull registers sources of every schema, each waiter listens for the registration of its own schema
+    auto key = info.shortUrl();
+    FindAsyncWaiters::Ptr waiters;
+    bool fresh = false;
+    {
+        lock_guard<mutex> lck(s_find_waiters_mtx);
+        auto &ref = s_find_waiters[key];
+        if (!ref) {
+            ref = std::make_shared<FindAsyncWaiters>();
+            fresh = true;
+        }
+        waiters = ref;
+    }
+    ++(fresh ? s_find_fresh : s_find_coalesced);
+
     GET_CONFIG(int, maxWaitMS, General::kMaxStreamWaitTimeMS);
     void *listener_tag = session.get();
     auto poller = session->getPoller();
@@ -403,10 +469,16 @@ static void findAsync_l(const MediaInfo &info, const std::shared_ptr<Session> &s
         cb(src);
     };
 
-    auto on_timeout = poller->doDelayTask(maxWaitMS, [cb_once, listener_tag]() {
+    auto waiter_id = ++s_find_waiter_id;
+    auto session_id = session->getIdentifier();
+    auto on_timeout = poller->doDelayTask(maxWaitMS, [cb_once, listener_tag, info, key, waiters, waiter_id, session_id]() {
         // 最多等待一定时间，如在这个时间内，流还未注册上，则返回空  [AUTO-TRANSLATED:e8851208]
         // Wait for a certain amount of time at most, if the stream is not registered within this time, return empty
         NoticeCenter::Instance().delListener(listener_tag, Broadcast::kBroadcastMediaChanged);
+        // 每个等待者各自超时，不影响共享同一未找到流事件的其他等待者
+        // Every waiter times out on its own, other waiters sharing the not found event are not affected
+        removeFindWaiter(key, waiters, waiter_id);
+        WarnL << "Wait for stream timeout: " << info.getUrl() << ", session: " << session_id;
         cb_once(nullptr);
         return 0;
     });
@@ -421,7 +493,7 @@ static void findAsync_l(const MediaInfo &info, const std::shared_ptr<Session> &s
     };
 
     weak_ptr<Session> weak_session = session;
-    auto on_register = [weak_session, info, cb_once, cancel_all, poller](BroadcastMediaChangedArgs) {
+    auto on_register = [weak_session, info, cb_once, cancel_all, poller, key, waiters](BroadcastMediaChangedArgs) {
         if (!bRegist ||
             sender.getSchema() != info.schema ||
             !equalMediaTuple(sender.getMediaTuple(), info)) {
@@ -429,6 +501,7 @@ static void findAsync_l(const MediaInfo &info, const std::shared_ptr<Session> &s
             // Not an event of interest, ignore it
             return;
         }
+        eraseFindWaiters(key, waiters);
 
         poller->async([weak_session, cancel_all, info, cb_once]() {
             cancel_all();
@@ -455,9 +528,40 @@ static void findAsync_l(const MediaInfo &info, const std::shared_ptr<Session> &s
             cb_once(nullptr);
         });
     };
+    {
+        lock_guard<mutex> lck(s_find_waiters_mtx);
+        if (!waiters->closed) {
+            waiters->close_players.emplace(waiter_id, close_player);
+            close_player = nullptr;
+        }
+    }
+    if (close_player) {
+        // 共享的未找到流事件已经被关闭
+        close_player();
+        return;
+    }
+    if (!fresh) {
+        // 该流已经触发过未找到流事件，等待其注册或关闭即可
+        // The not found event of the stream has been fired already, wait for it to be registered or closed
+        DebugL << "Wait for stream coalesced: " << info.getUrl() << ", session: " << session_id;
+        return;
+    }
+
+    function<void()> close_all = [key, waiters]() {
+        unordered_map<uint64_t, function<void()>> close_players;
+        {
+            lock_guard<mutex> lck(s_find_waiters_mtx);
+            waiters->closed = true;
+            close_players.swap(waiters->close_players);
+            eraseFindWaiters_l(key, waiters);
+        }
+        for (auto &pr : close_players) {
+            pr.second();
+        }
+    };
     // 广播未找到流,此时可以立即去拉流，这样还来得及  [AUTO-TRANSLATED:794014f1]
     // Broadcast that the stream is not found, at this time you can immediately pull the stream, so it is still in time
-    NOTICE_EMIT(BroadcastNotFoundStreamArgs, Broadcast::kBroadcastNotFoundStream, info, *session, close_player);
+    NOTICE_EMIT(BroadcastNotFoundStreamArgs, Broadcast::kBroadcastNotFoundStream, info, *session, close_all);
 }
 
 void MediaSource::findAsync(const MediaInfo &info, const std::shared_ptr<Session> &session, const function<void (const Ptr &)> &cb) {
@@ -766,6 +870,14 @@ bool MediaSourceEventInterceptor::speed(MediaSource &sender, float speed) {
     return listener->speed(sender, speed);
 }
 
+bool MediaSourceEventInterceptor::requestKeyFrame(MediaSource &sender, bool joining) {
+    auto listener = _listener.lock();
+    if (!listener) {
+        return MediaSourceEvent::requestKeyFrame(sender, joining);
+    }
+    return listener->requestKeyFrame(sender, joining);
+}
+
 bool MediaSourceEventInterceptor::close(MediaSource &sender) {
     auto listener = _listener.lock();
     if (!listener) {
@@ -78,6 +78,9 @@ public:
     // 通知其停止产生流  [AUTO-TRANSLATED:62c9022c]
     // Notify it to stop generating streams
     virtual bool close(MediaSource &sender) { return false; }
+    // 请求源端尽快产生关键帧，返回false表示不支持；joining表示请求来自刚加入且已收到gop缓存的观看端
+    // Ask the origin to produce a key frame as soon as possible, returns false if not supported; joining means the request comes from a viewer that just joined and received the gop cache
+    virtual bool requestKeyFrame(MediaSource &sender, bool joining) { return false; }
     // 获取观看总人数，此函数一般强制重载  [AUTO-TRANSLATED:1da20a10]
     // Get the total number of viewers, this function is generally forced to overload
     virtual int totalReaderCount(MediaSource &sender) { throw NotImplemented(toolkit::demangle(typeid(*this).name()) + "::totalReaderCount not implemented"); }
@@ -359,6 +362,7 @@ public:
     bool pause(MediaSource &sender,  bool pause) override;
     bool speed(MediaSource &sender, float speed) override;
     bool close(MediaSource &sender) override;
+    bool requestKeyFrame(MediaSource &sender, bool joining) override;
     int totalReaderCount(MediaSource &sender) override;
     void onReaderChanged(MediaSource &sender, int size) override;
     void onRegist(MediaSource &sender, bool regist) override;
@@ -503,6 +507,9 @@ public:
     // 关闭该流  [AUTO-TRANSLATED:b3867b98]
     // Close the stream
     bool close(bool force);
+    // 请求关键帧
+    // Request a key frame
+    bool requestKeyFrame(bool joining = false);
     // 该流观看人数变化  [AUTO-TRANSLATED:8e583993]
     // The number of viewers of this stream changes
     void onReaderChanged(int size);
@@ -548,6 +555,9 @@ public:
     // 异步查找流  [AUTO-TRANSLATED:4decf738]
     // Asynchronously find the stream
     static void findAsync(const MediaInfo &info, const std::shared_ptr<toolkit::Session> &session, const std::function<void(const Ptr &src)> &cb);
+    // 异步查找流时，触发了未找到流事件的次数与合并至已有等待的次数
+    // Count of async lookups that fired the not found event and that were coalesced into an existing wait
+    static void getFindAsyncStatistic(uint64_t &fresh, uint64_t &coalesced);
     // 遍历所有流  [AUTO-TRANSLATED:a39b2399]
     // Traverse all streams
     static void for_each_media(const std::function<void(const Ptr &src)> &cb, const std::string &schema = "", const std::string &vhost = "", const std::string &app = "", const std::string &stream = "");
@@ -11,6 +11,9 @@
 #include <math.h>
 #include "Common/config.h"
 #include "MultiMediaSourceMuxer.h"
+#include "PollerMonitor.h"
+#include "StreamCpuStat.h"
+#include "FrameTracer.h"
 #include "Thread/WorkThreadPool.h"
 
 using namespace std;
@@ -211,6 +214,9 @@ MultiMediaSourceMuxer::MultiMediaSourceMuxer(const MediaTuple& tuple, float dur_
         // Support replacing stream_id in on_publish hook
         _tuple.stream = option.stream_replace;
     }
+    _task_name = "stream " + _tuple.shortUrl();
+    _cpu_stat = StreamCpuStat::create();
+    _frame_tracer = std::make_shared<FrameTracer>();
     _poller = EventPollerPool::Instance().getPoller();
     _create_in_poller = _poller->isCurrentThread();
     _option = option;
@@ -606,6 +612,46 @@ EventPoller::Ptr MultiMediaSourceMuxer::getOwnerPoller(MediaSource &sender) {
     }
 }
 
+bool MultiMediaSourceMuxer::requestKeyFrame(MediaSource &sender, bool joining) {
+    uint64_t defer_ms = 0;
+    switch (_key_frame_arbiter.onRequest(joining, getCurrentMillisecond(), defer_ms)) {
+        case KeyFrameArbiter::Result::forward: {
+            auto ok = MediaSourceEventInterceptor::requestKeyFrame(sender, false);
+            _key_frame_arbiter.onForwarded(ok, false);
+            return ok;
+        }
+        case KeyFrameArbiter::Result::coalesced: {
+            {
+                lock_guard<mutex> lck(_key_frame_mtx);
+                _key_frame_sender = sender.shared_from_this();
+            }
+            if (defer_ms) {
+                // 间隔结束时若仍未收到关键帧再发出请求，不依赖后续视频帧触发(源端可能已停止出帧)
+                // Send the request when the interval ends if no key frame arrived, without relying on later video frames (the origin may have stopped producing them)
+                weak_ptr<MultiMediaSourceMuxer> weak_self = shared_from_this();
+                getOwnerPoller(MediaSource::NullMediaSource())->doDelayTask(defer_ms, [weak_self]() {
+                    auto strong_self = weak_self.lock();
+                    if (strong_self && strong_self->_key_frame_arbiter.onTimer(getCurrentMillisecond())) {
+                        strong_self->forwardKeyFrameRequest();
+                    }
+                    return 0;
+                });
+            }
+            return true;
+        }
+        default: return true;
+    }
+}
+
+void MultiMediaSourceMuxer::forwardKeyFrameRequest() {
+    MediaSource::Ptr sender;
+    {
+        lock_guard<mutex> lck(_key_frame_mtx);
+        sender = _key_frame_sender.lock();
+    }
+    _key_frame_arbiter.onForwarded(sender && MediaSourceEventInterceptor::requestKeyFrame(*sender, false), true);
+}
+
 bool MultiMediaSourceMuxer::close(MediaSource &sender) {
     MediaSourceEventInterceptor::close(sender);
     _rtmp = nullptr;
@@ -788,29 +834,40 @@ void MultiMediaSourceMuxer::resetTracks() {
 }
 
 bool MultiMediaSourceMuxer::onTrackFrame(const Frame::Ptr &frame_in) {
+    // 标记poller正在处理本流的帧，卡顿时便于定位
+    // Label the poller as handling frames of this stream to locate stalls
+    PollerTaskScope scope(_task_name);
     auto frame = frame_in;
     if (_option.modify_stamp != ProtocolOption::kModifyStampOff) {
         // 时间戳不采用原始的绝对时间戳  [AUTO-TRANSLATED:8beb3bf7]
         // Timestamp does not use the original absolute timestamp
         frame = std::make_shared<FrameStamp>(frame, _stamps[frame->getIndex()], _option.modify_stamp);
     }
+    // 按修改后的时间戳采样，播放器发送时以此匹配
+    // Sample by the modified timestamp, which is what readers send
+    FrameTraceSpan trace_span(_frame_tracer.get(), _frame_tracer->sample(frame), "on_track_frame");
     return _paced_sender ? _paced_sender->inputFrame(frame) : onTrackFrame_l(frame);
 }
 
 bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     auto frame = frame_in;
+    auto trace_id = _frame_tracer->find(frame, _paced_sender ? "paced_sender" : nullptr);
     
 #if defined(ENABLE_FFMPEG)
     // 音频转码处理：输入原始 AAC 帧到转码器
     if (_audio_transcoder && 
         frame->getTrackType() == TrackAudio && 
         frame->getCodecId() == CodecAAC) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::transcode);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "transcode");
         _audio_transcoder->inputFrame(frame);
     }
 #endif
     
     bool ret = false;
     if (_rtmp) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_rtmp);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_rtmp");
         ret = _rtmp->inputFrame(frame) ? true : ret;
     }
     
@@ -820,32 +877,62 @@ bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
                          frame->getTrackType() == TrackAudio && 
                          frame->getCodecId() == CodecAAC;
     if (_rtsp && !skip_rtsp_aac) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_rtsp);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_rtsp");
         ret = _rtsp->inputFrame(frame) ? true : ret;
     }
 #else
     if (_rtsp) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_rtsp);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_rtsp");
         ret = _rtsp->inputFrame(frame) ? true : ret;
     }
 #endif
     if (_ts) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_ts);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_ts");
         ret = _ts->inputFrame(frame) ? true : ret;
     }
 
     if (_hls) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_hls);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_hls");
         ret = _hls->inputFrame(frame) ? true : ret;
     }
 
     if (_hls_fmp4) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_hls);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_hls_fmp4");
         ret = _hls_fmp4->inputFrame(frame) ? true : ret;
     }
 
     if (_mp4) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_mp4);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_mp4");
         ret = _mp4->inputFrame(frame) ? true : ret;
     }
     if (_fmp4) {
+        CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_fmp4);
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "mux_fmp4");
         ret = _fmp4->inputFrame(frame) ? true : ret;
     }
+
+    // 各协议的gop缓存在遇到关键帧时清空，按相同规则统计当前gop的字节数，供指标接口读取
+    // The gop caches of all protocols are reset on key frames, count bytes of the current gop the same way for metrics
+    if (frame->getTrackType() == TrackVideo) {
+        if (frame->keyFrame()) {
+            _gop_cache_bytes = 0;
+            _key_frame_arbiter.onKeyFrame(getCurrentMillisecond());
+        }
+        _gop_cache_bytes += frame->size();
+    } else if (!haveVideo()) {
+        _gop_cache_bytes = frame->size();
+    } else {
+        _gop_cache_bytes += frame->size();
+    }
+
     if (_ring) {
+        FrameTraceSpan trace_span(_frame_tracer.get(), trace_id, "ring_write");
         // 此场景由于直接转发，可能存在切换线程引起的数据被缓存在管道，所以需要CacheAbleFrame  [AUTO-TRANSLATED:528afbb7]
         // In this scenario, due to direct forwarding, there may be data cached in the pipeline due to thread switching, so CacheAbleFrame is needed
         frame = Frame::getCacheAbleFrame(frame);
@@ -863,9 +950,22 @@ bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
             _ring->write(frame, !haveVideo());
         }
     }
+    _frame_tracer->onRingWrite(trace_id);
     return ret;
 }
 
+size_t MultiMediaSourceMuxer::getGopCacheBytes() const {
+    return _gop_cache_bytes;
+}
+
+const std::shared_ptr<StreamCpuStat> &MultiMediaSourceMuxer::getCpuStat() const {
+    return _cpu_stat;
+}
+
+const std::shared_ptr<FrameTracer> &MultiMediaSourceMuxer::getFrameTracer() const {
+    return _frame_tracer;
+}
+
 bool MultiMediaSourceMuxer::isEnabled(){
     GET_CONFIG(uint32_t, stream_none_reader_delay_ms, General::kStreamNoneReaderDelayMS);
     if (!_is_enable || _last_check.elapsedTime() > stream_none_reader_delay_ms) {
@@ -921,6 +1021,7 @@ void MultiMediaSourceMuxer::createAudioTranscoder(const Track::Ptr &track) {
     _audio_transcoder->setOnOutput([this](const Frame::Ptr &opus_frame) {
         // 将 Opus 帧输出到 RTSP（用于 WebRTC）
         if (_rtsp) {
+            CpuTimeScope cpu_scope(_cpu_stat, CpuStage::mux_rtsp);
             _rtsp->inputFrame(opus_frame);
         }
     });
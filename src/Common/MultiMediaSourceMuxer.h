@@ -14,6 +14,7 @@
 #include "Common/Stamp.h"
 #include "Common/MediaSource.h"
 #include "Common/MediaSink.h"
+#include "Common/KeyFrameArbiter.h"
 #include "Record/Recorder.h"
 #include "Rtp/RtpSender.h"
 #include "Record/HlsRecorder.h"
@@ -29,6 +30,9 @@
 
 namespace mediakit {
 
+class StreamCpuStat;
+class FrameTracer;
+
 class MultiMediaSourceMuxer : public MediaSourceEventInterceptor, public MediaSink, public std::enable_shared_from_this<MultiMediaSourceMuxer>{
 public:
     using Ptr = std::shared_ptr<MultiMediaSourceMuxer>;
@@ -78,6 +82,24 @@ public:
      */
     bool isEnabled();
 
+    /**
+     * gop缓存中当前gop的字节数，写入时增量维护
+     * Bytes of the current gop in the gop cache, maintained on write
+     */
+    size_t getGopCacheBytes() const;
+
+    /**
+     * 本流按处理阶段的cpu时间统计，未开启general.stream_cpu_stat时为nullptr
+     * Cpu time statistic of this stream by stage, nullptr if general.stream_cpu_stat is disabled
+     */
+    const std::shared_ptr<StreamCpuStat> &getCpuStat() const;
+
+    /**
+     * 本流的帧级时延追踪
+     * Frame latency tracer of this stream
+     */
+    const std::shared_ptr<FrameTracer> &getFrameTracer() const;
+
     /**
      * 设置MediaSource时间戳
      * @param stamp 时间戳
@@ -201,6 +223,18 @@ public:
      */
     bool close(MediaSource &sender) override;
 
+    /**
+     * 请求关键帧，经仲裁合并与限频后再转发给源端
+     * Request a key frame, forwarded to the origin after merging and rate limiting
+     */
+    bool requestKeyFrame(MediaSource &sender, bool joining) override;
+
+    /**
+     * 获取关键帧请求的统计，可在任意线程调用
+     * Get key frame request statistics, may be called from any thread
+     */
+    KeyFrameArbiter::Stats getKeyFrameStats() const { return _key_frame_arbiter.getStats(); }
+
     /**
      * 获取本对象
      * Get this object
@@ -251,6 +285,7 @@ protected:
 
 private:
     void createGopCacheIfNeed(size_t gop_count);
+    void forwardKeyFrameRequest();
     std::shared_ptr<MediaSinkInterface> makeRecorder(MediaSource &sender, Recorder::type type);
 
 private:
@@ -258,12 +293,21 @@ private:
     bool _create_in_poller = false;
     bool _video_key_pos = false;
     float _dur_sec;
+    std::atomic<size_t> _gop_cache_bytes { 0 };
+    std::string _task_name;
+    std::shared_ptr<StreamCpuStat> _cpu_stat;
+    std::shared_ptr<FrameTracer> _frame_tracer;
     std::shared_ptr<class FramePacedSender> _paced_sender;
     MediaTuple _tuple;
     ProtocolOption _option;
     toolkit::Ticker _last_check;
     std::unordered_map<int, Stamp> _stamps;
     std::weak_ptr<Listener> _track_listener;
+    KeyFrameArbiter _key_frame_arbiter;
+    // 延后发出的关键帧请求的请求方
+    // Requester of the deferred key frame request
+    std::mutex _key_frame_mtx;
+    std::weak_ptr<MediaSource> _key_frame_sender;
 #if defined(ENABLE_RTPPROXY)
     std::unordered_multimap<std::string, std::tuple<RingType::RingReader::Ptr, std::weak_ptr<RtpSender>>> _rtp_sender;
 #endif // ENABLE_RTPPROXY
@@ -12,6 +12,7 @@
 #include "Parser.h"
 #include "strCoding.h"
 #include "Util/base64.h"
+#include "Util/onceToken.h"
 #include "Network/sockutil.h"
 #include "Common/macros.h"
 
@@ -44,8 +45,55 @@ string findSubString(const char *buf, const char *start, const char *end, size_t
     return string(msg_start, msg_end);
 }
 
+static inline bool isBlank(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+static inline bool isCaseEqual(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Parser::addHeaderField(const char *buf, const char *key, const char *key_end, const char *value, const char *value_end) {
+    while (key < key_end && isBlank(*key)) {
+        ++key;
+    }
+    while (key_end > key && isBlank(*(key_end - 1))) {
+        --key_end;
+    }
+    while (value < value_end && isBlank(*value)) {
+        ++value;
+    }
+    while (value_end > value && isBlank(*(value_end - 1))) {
+        --value_end;
+    }
+    if (_header_count == _header_fields.size()) {
+        _header_fields.emplace_back();
+    }
+    // 复用之前的HeaderField对象，其value字符串的内存也得以复用
+    // Reuse the previous HeaderField object, so the memory of its value string is also reused
+    auto &field = _header_fields[_header_count++];
+    field.key_offset = key - buf;
+    field.key_size = key_end - key;
+    field.value_offset = value - buf;
+    field.value_size = value_end - value;
+    field.value_ready = false;
+}
+
 void Parser::parse(const char *buf, size_t size) {
     clear();
+    bool finished = false;
+    // 解析失败(CHECK抛异常)时_raw为空，需丢弃已记录的header偏移，否则findHeader会越界访问
+    // _raw is empty when parsing fails (CHECK throws), drop the recorded header offsets or findHeader would read out of bounds
+    onceToken token(nullptr, [&]() {
+        if (!finished) {
+            _header_count = 0;
+        }
+    });
     auto ptr = buf;
     while (true) {
         auto next_line = strchr(ptr, '\n');
@@ -58,32 +106,31 @@ void Parser::parse(const char *buf, size_t size) {
         if (ptr == buf) {
             auto blank = strchr(ptr, ' ');
             CHECK(blank > ptr && blank < next_line);
-           _method = std::string(ptr, blank - ptr);
+            _method.assign(ptr, blank);
             auto next_blank = strchr(blank + 1, ' ');
             CHECK(next_blank && next_blank < next_line);
-            _url.assign(blank + 1, next_blank);
-            auto pos = _url.find('?');
-            if (pos != string::npos) {
-                _params = _url.substr(pos + 1);
-                _url_args = parseArgs(_params);
-                _url = _url.substr(0, pos);
+            auto pos = (const char *)memchr(blank + 1, '?', next_blank - blank - 1);
+            if (pos) {
+                // url参数延时到getUrlArgs()时才解析
+                // Url parameters are not parsed until getUrlArgs() is called
+                _params.assign(pos + 1, next_blank);
+                _url.assign(blank + 1, pos);
+            } else {
+                _url.assign(blank + 1, next_blank);
             }
-            _protocol = std::string(next_blank + 1, next_line);
+            _protocol.assign(next_blank + 1, next_line);
         } else {
             auto pos = strchr(ptr, ':');
             CHECK(pos > ptr && pos < next_line);
-            std::string key { ptr, static_cast<std::size_t>(pos - ptr) };
-            std::string value;
-            if (pos[1] == ' ') {
-                value.assign(pos + 2, next_line);
-            } else {
-                value.assign(pos + 1, next_line);
-            }
-            _headers.emplace_force(trim(std::move(key)), trim(std::move(value)));
+            addHeaderField(buf, ptr, pos, pos + 1, next_line);
         }
         ptr = next_line + offset;
         if (strncmp(ptr, "\r\n", 2) == 0) { // 协议解析完毕
+            // 只拷贝一次协议头，header的key/value都指向该拷贝
+            // Only copy the header once, the keys/values of headers all point to this copy
+            _raw.assign(buf, ptr);
             _content.assign(ptr + 2, buf + size);
+            finished = true;
             break;
         }
     }
@@ -118,7 +165,31 @@ const std::string &Parser::statusStr() const {
 
 static std::string kNull;
 
+const string &Parser::findHeader(const char *name) const {
+    auto len = strlen(name);
+    // 本对象被移动后_header_fields可能为空
+    // _header_fields may be empty after this object is moved
+    auto count = MIN(_header_count, _header_fields.size());
+    for (size_t i = 0; i < count; ++i) {
+        auto &field = _header_fields[i];
+        if (field.key_size != len || !isCaseEqual(_raw.data() + field.key_offset, name, len)) {
+            continue;
+        }
+        if (!field.value_ready) {
+            field.value.assign(_raw.data() + field.value_offset, field.value_size);
+            field.value_ready = true;
+        }
+        return field.value;
+    }
+    return kNull;
+}
+
 const string &Parser::operator[](const char *name) const {
+    if (!_headers_ready) {
+        // header map尚未生成(也就未被修改)，直接从原始数据中查找，不分配map节点
+        // The header map has not been generated (and so not been modified), search directly in the raw data without allocating map nodes
+        return findHeader(name);
+    }
     auto it = _headers.find(name);
     if (it == _headers.end()) {
         return kNull;
@@ -136,7 +207,12 @@ void Parser::clear() {
     _params.clear();
     _protocol.clear();
     _content.clear();
+    _raw.clear();
+    _header_count = 0;
+    _headers_ready = false;
     _headers.clear();
+    _url_args_ready = false;
+    _url_args_decode = false;
     _url_args.clear();
 }
 
@@ -152,11 +228,44 @@ void Parser::setContent(string content) {
     _content = std::move(content);
 }
 
+void Parser::setContent(const char *data, size_t size) {
+    _content.assign(data, size);
+}
+
+void Parser::setUrlArgsDecode(bool decode) {
+    _url_args_decode = decode;
+    if (decode && _url_args_ready) {
+        // 参数列表已经生成，立即解码
+        // The parameter list has been generated, decode it immediately
+        for (auto &pr : _url_args) {
+            pr.second = strCoding::UrlDecodeComponent(pr.second);
+        }
+    }
+}
+
 StrCaseMap &Parser::getHeader() const {
+    if (!_headers_ready) {
+        auto count = MIN(_header_count, _header_fields.size());
+        for (size_t i = 0; i < count; ++i) {
+            auto &field = _header_fields[i];
+            _headers.emplace_force(_raw.substr(field.key_offset, field.key_size),
+                                   field.value_ready ? field.value : _raw.substr(field.value_offset, field.value_size));
+        }
+        _headers_ready = true;
+    }
     return _headers;
 }
 
 StrCaseMap &Parser::getUrlArgs() const {
+    if (!_url_args_ready) {
+        _url_args = parseArgs(_params);
+        if (_url_args_decode) {
+            for (auto &pr : _url_args) {
+                pr.second = strCoding::UrlDecodeComponent(pr.second);
+            }
+        }
+        _url_args_ready = true;
+    }
     return _url_args;
 }
 
@@ -13,6 +13,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include "Util/util.h"
 
 namespace mediakit {
@@ -111,6 +112,13 @@ public:
     // 重新设置content  [AUTO-TRANSLATED:ac8fc8c0]
     // Reset content
     void setContent(std::string content);
+    // 重新设置content，复用已有内存
+    // Reset content, reusing the allocated memory
+    void setContent(const char *data, size_t size);
+
+    // 获取url参数列表时是否对参数值进行url解码(延时到首次访问时才解码)
+    // Whether to url decode the values when getting the url parameter list (deferred until the first access)
+    void setUrlArgsDecode(bool decode);
 
     // 获取header列表  [AUTO-TRANSLATED:90d90b03]
     // Get header list
@@ -127,11 +135,36 @@ public:
     static std::string mergeUrl(const std::string &base_url, const std::string &path);
 
 private:
+    // header在_raw中的位置，value按需生成并复用内存
+    // The position of the header in _raw, the value is generated on demand and its memory is reused
+    struct HeaderField {
+        size_t key_offset;
+        size_t key_size;
+        size_t value_offset;
+        size_t value_size;
+        bool value_ready;
+        std::string value;
+    };
+
+    const std::string &findHeader(const char *name) const;
+    void addHeaderField(const char *buf, const char *key, const char *key_end, const char *value, const char *value_end);
+
+private:
+    bool _url_args_decode = false;
+    mutable bool _headers_ready = false;
+    mutable bool _url_args_ready = false;
     std::string _method;
     std::string _url;
     std::string _protocol;
     std::string _content;
     std::string _params;
+    // 协议头原始数据，clear后保留容量，长连接下解析无需再分配内存
+    // Raw header data, the capacity is kept after clear, so no memory is allocated when parsing on keep-alive connections
+    std::string _raw;
+    size_t _header_count = 0;
+    mutable std::vector<HeaderField> _header_fields;
+    // 首次调用getHeader()/getUrlArgs()时才生成
+    // Only generated when getHeader()/getUrlArgs() is called for the first time
     mutable StrCaseMap _headers;
     mutable StrCaseMap _url_args;
 };
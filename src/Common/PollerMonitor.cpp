@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstring>
+#include "PollerMonitor.h"
+#include "Common/config.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Poller/EventPoller.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+const uint32_t LagHistogram::kBounds[LagHistogram::kBucketSize - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+void LagHistogram::record(uint64_t ms) {
+    size_t i = 0;
+    while (i < kBucketSize - 1 && ms > kBounds[i]) {
+        ++i;
+    }
+    ++_counts[i];
+    _sum += ms;
+    ++_count;
+    auto max = _max.load();
+    while (ms > max && !_max.compare_exchange_weak(max, ms)) {}
+}
+
+void LagHistogram::snapshot(uint64_t (&counts)[kBucketSize], uint64_t &sum, uint64_t &count) const {
+    for (size_t i = 0; i < kBucketSize; ++i) {
+        counts[i] = _counts[i];
+    }
+    sum = _sum;
+    count = _count;
+}
+
+uint64_t LagHistogram::quantile(float q) const {
+    uint64_t counts[kBucketSize], sum, count;
+    snapshot(counts, sum, count);
+    if (!count) {
+        return 0;
+    }
+    uint64_t target = count * q, acc = 0;
+    for (size_t i = 0; i < kBucketSize - 1; ++i) {
+        acc += counts[i];
+        if (acc > target) {
+            return kBounds[i];
+        }
+    }
+    return _max;
+}
+
+struct PollerMonitor::State {
+    std::string thread;
+    std::weak_ptr<EventPoller> poller;
+    LagHistogram async_delay;
+    LagHistogram timer_late;
+    // 探测任务最近一次在poller上执行的时间
+    // Last time a probe ran on the poller
+    std::atomic<uint64_t> heartbeat_ms { 0 };
+    std::atomic<uint64_t> stalls { 0 };
+    // 以下仅由看门狗线程访问
+    // Accessed by the watchdog thread only
+    bool stalled = false;
+
+    // 当前任务名与开始时间，仅由poller线程写入，看门狗通过序列锁读取副本；序号为奇数时正在写入
+    // Name and begin time of the current task, written by the poller thread only, the watchdog reads a copy through a seqlock; an odd sequence means a write is in progress
+    std::atomic<uint32_t> task_seq { 0 };
+    std::atomic<uint64_t> task[kTaskWords] {};
+    std::atomic<uint64_t> task_begin_ms { 0 };
+
+    void setTask(const uint64_t (&words)[kTaskWords], uint64_t begin_ms) {
+        auto seq = task_seq.load(std::memory_order_relaxed);
+        task_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kTaskWords; ++i) {
+            task[i].store(words[i], std::memory_order_relaxed);
+        }
+        task_begin_ms.store(begin_ms, std::memory_order_relaxed);
+        task_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // 仅poller线程调用，无需序列锁
+    // Called on the poller thread only, no seqlock needed
+    void getOwnTask(uint64_t (&words)[kTaskWords], uint64_t &begin_ms) const {
+        for (size_t i = 0; i < kTaskWords; ++i) {
+            words[i] = task[i].load(std::memory_order_relaxed);
+        }
+        begin_ms = task_begin_ms.load(std::memory_order_relaxed);
+    }
+
+    bool getTask(std::string &name, uint64_t &begin_ms) const {
+        uint64_t words[kTaskWords];
+        // 写入频繁但很短，重试几次仍冲突则放弃
+        // Writes are frequent but short, give up after a few conflicting retries
+        for (int retry = 0; retry < 16; ++retry) {
+            auto seq = task_seq.load(std::memory_order_acquire);
+            if (seq & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            getOwnTask(words, begin_ms);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (task_seq.load(std::memory_order_relaxed) != seq) {
+                continue;
+            }
+            auto str = (const char *)words;
+            name.assign(str, strnlen(str, sizeof(words)));
+            return true;
+        }
+        return false;
+    }
+
+    std::mutex mtx;
+    std::string last_stall_task;
+    uint64_t last_stall_ms = 0;
+};
+
+// 当前poller线程的监控状态，非poller线程为nullptr
+// Monitor state of the current poller thread, nullptr on other threads
+static thread_local PollerMonitor::State *s_thread_state = nullptr;
+
+PollerMonitor &PollerMonitor::Instance() {
+    static PollerMonitor s_instance;
+    return s_instance;
+}
+
+void PollerMonitor::start() {
+    GET_CONFIG(uint32_t, probe_ms, General::kPollerProbeMS);
+    if (!probe_ms || _running.exchange(true)) {
+        return;
+    }
+    {
+        lock_guard<mutex> lck(_mtx);
+        EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+            auto poller = static_pointer_cast<EventPoller>(executor);
+            auto state = std::make_shared<State>();
+            state->thread = poller->getThreadName();
+            state->poller = poller;
+            state->heartbeat_ms = getCurrentMillisecond();
+            _states.emplace_back(state);
+            poller->async([state]() { s_thread_state = state.get(); }, false);
+            probe(state);
+        });
+    }
+    _watchdog = std::thread([this]() {
+        setThreadName("poller watchdog");
+        watch();
+    });
+}
+
+void PollerMonitor::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    _cond.notify_all();
+    if (_watchdog.joinable()) {
+        _watchdog.join();
+    }
+}
+
+void PollerMonitor::probe(const std::shared_ptr<State> &state) {
+    GET_CONFIG(uint32_t, probe_ms, General::kPollerProbeMS);
+    auto poller = state->poller.lock();
+    if (!poller) {
+        return;
+    }
+    auto expected = std::make_shared<uint64_t>(getCurrentMillisecond() + probe_ms);
+    poller->doDelayTask(probe_ms, [this, state, expected]() -> uint64_t {
+        if (!_running) {
+            return 0;
+        }
+        // 定时器迟到时间
+        // Timer lateness
+        auto now = getCurrentMillisecond();
+        state->timer_late.record(now > *expected ? now - *expected : 0);
+        state->heartbeat_ms = now;
+        GET_CONFIG(uint32_t, probe_ms, General::kPollerProbeMS);
+        *expected = now + probe_ms;
+
+        // async任务从投递到执行的排队延时
+        // Queueing delay of an async task from post to run
+        if (auto poller = state->poller.lock()) {
+            poller->async([state, now]() {
+                auto run = getCurrentMillisecond();
+                state->async_delay.record(run > now ? run - now : 0);
+                state->heartbeat_ms = run;
+            }, false);
+        }
+        return probe_ms;
+    });
+}
+
+void PollerMonitor::watch() {
+    unique_lock<mutex> lck(_mtx);
+    while (_running) {
+        GET_CONFIG(uint32_t, stall_ms, General::kPollerStallMS);
+        GET_CONFIG(uint32_t, probe_ms, General::kPollerProbeMS);
+        _cond.wait_for(lck, std::chrono::milliseconds(MAX(stall_ms / 4, 10u)));
+        if (!_running || !stall_ms) {
+            continue;
+        }
+        auto now = getCurrentMillisecond();
+        for (auto &state : _states) {
+            auto silent_ms = now - MIN(now, state->heartbeat_ms.load());
+            if (silent_ms <= stall_ms + probe_ms) {
+                if (state->stalled) {
+                    state->stalled = false;
+                    WarnL << "Poller " << state->thread << " recovered from stall";
+                }
+                continue;
+            }
+            if (state->stalled) {
+                continue;
+            }
+            // 探测任务超过阈值未执行，说明该poller被某个任务阻塞
+            // The probe did not run within the threshold, the poller is blocked by some task
+            state->stalled = true;
+            ++state->stalls;
+            string task;
+            uint64_t task_ms = 0, task_begin_ms = 0;
+            if (state->getTask(task, task_begin_ms) && !task.empty()) {
+                task_ms = now - MIN(now, task_begin_ms);
+            }
+            {
+                lock_guard<mutex> task_lck(state->mtx);
+                state->last_stall_task = task;
+                state->last_stall_ms = now;
+            }
+            if (task.empty()) {
+                WarnL << "Poller " << state->thread << " stalled for " << silent_ms << "ms, running task: unknown";
+            } else {
+                WarnL << "Poller " << state->thread << " stalled for " << silent_ms << "ms, running task: " << task
+                      << ", task running for " << task_ms << "ms";
+            }
+        }
+    }
+}
+
+void PollerMonitor::forEach(const std::function<void(const Statistic &stat)> &cb) {
+    lock_guard<mutex> lck(_mtx);
+    for (auto &state : _states) {
+        Statistic stat;
+        stat.thread = state->thread;
+        stat.async_delay = &state->async_delay;
+        stat.timer_late = &state->timer_late;
+        stat.stalls = state->stalls;
+        {
+            lock_guard<mutex> task_lck(state->mtx);
+            stat.last_stall_task = state->last_stall_task;
+            stat.last_stall_ms = state->last_stall_ms;
+        }
+        cb(stat);
+    }
+}
+
+PollerTaskScope::PollerTaskScope(const std::string &name) {
+    _state = s_thread_state;
+    if (!_state) {
+        return;
+    }
+    // 每帧都会进入，不加锁；拷贝任务名，看门狗不会访问name本身
+    // Entered for every frame, no locking; the name is copied so the watchdog never touches name itself
+    _state->getOwnTask(_prev_task, _prev_begin);
+    uint64_t words[PollerMonitor::kTaskWords] = { 0 };
+    memcpy(words, name.data(), MIN(name.size(), sizeof(words) - 1));
+    _state->setTask(words, getCurrentMillisecond());
+}
+
+PollerTaskScope::~PollerTaskScope() {
+    if (!_state) {
+        return;
+    }
+    _state->setTask(_prev_task, _prev_begin);
+}
+
+} // namespace mediakit
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_POLLERMONITOR_H
+#define ZLMEDIAKIT_POLLERMONITOR_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+namespace mediakit {
+
+/**
+ * 毫秒级延时直方图，各桶计数为原子变量，可在任意线程读写
+ * Millisecond delay histogram, bucket counters are atomics and can be accessed from any thread
+ */
+class LagHistogram {
+public:
+    // 各桶上限(毫秒)，最后一个桶为+Inf
+    // Upper bounds of the buckets in milliseconds, the last bucket is +Inf
+    static constexpr size_t kBucketSize = 11;
+    static const uint32_t kBounds[kBucketSize - 1];
+
+    void record(uint64_t ms);
+
+    /**
+     * 获取非累积的各桶计数与总和
+     * Get non-cumulative bucket counts and the sum
+     */
+    void snapshot(uint64_t (&counts)[kBucketSize], uint64_t &sum, uint64_t &count) const;
+
+    /**
+     * 按桶估算分位值，返回所在桶上限，落在+Inf桶时返回最大观测值
+     * Estimate the quantile by bucket, returns the upper bound of the bucket, or the max observed value for the +Inf bucket
+     */
+    uint64_t quantile(float q) const;
+
+private:
+    std::atomic<uint64_t> _counts[kBucketSize] {};
+    std::atomic<uint64_t> _sum { 0 };
+    std::atomic<uint64_t> _count { 0 };
+    std::atomic<uint64_t> _max { 0 };
+};
+
+/**
+ * 各EventPoller的事件循环延时监控与卡顿看门狗：
+ * 定时在每个poller上投递探测任务，统计async任务排队延时与定时器迟到时间；
+ * 看门狗线程发现poller超过阈值未响应时，打印其正在执行的任务名(由PollerTaskScope标记)
+ * Event loop lag monitor and stall watchdog of each EventPoller:
+ * probes are posted to every poller periodically to measure async queueing delay and timer lateness;
+ * the watchdog thread logs the running task (labelled by PollerTaskScope) of any poller that stops responding for longer than the threshold
+ */
+class PollerMonitor {
+public:
+    struct State;
+
+    // 任务名以定长缓冲区发布，超出部分截断
+    // Task names are published in a fixed size buffer, longer names are truncated
+    static constexpr size_t kTaskWords = 8;
+
+    struct Statistic {
+        std::string thread;
+        const LagHistogram *async_delay;
+        const LagHistogram *timer_late;
+        uint64_t stalls;
+        std::string last_stall_task;
+        uint64_t last_stall_ms;
+    };
+
+    static PollerMonitor &Instance();
+
+    void start();
+    void stop();
+
+    /**
+     * 遍历各poller的统计，回调期间统计对象有效
+     * Iterate statistics of each poller, the objects are valid during the callback
+     */
+    void forEach(const std::function<void(const Statistic &stat)> &cb);
+
+private:
+    PollerMonitor() = default;
+
+    void probe(const std::shared_ptr<State> &state);
+    void watch();
+
+private:
+    std::atomic<bool> _running { false };
+    std::thread _watchdog;
+    std::mutex _mtx;
+    std::condition_variable _cond;
+    std::vector<std::shared_ptr<State>> _states;
+};
+
+/**
+ * 标记当前poller线程正在执行的任务，卡顿时看门狗会打印该任务名；非poller线程上无开销
+ * Label the task running on the current poller thread, the watchdog logs it on stalls; no-op on other threads
+ */
+class PollerTaskScope {
+public:
+    PollerTaskScope(const std::string &name);
+    ~PollerTaskScope();
+
+private:
+    PollerMonitor::State *_state;
+    uint64_t _prev_task[PollerMonitor::kTaskWords];
+    uint64_t _prev_begin = 0;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_POLLERMONITOR_H
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <time.h>
+#include "StreamCpuStat.h"
+#include "Util/util.h"
+#include "Common/config.h"
+#include "Common/MultiMediaSourceMuxer.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 当前线程的线程cpu时间，单位纳秒
+// Thread cpu time of the current thread in nanoseconds
+static uint64_t threadCpuNanosecond() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+#endif
+    return 0;
+}
+
+// 当前线程最内层的作用域
+// Innermost scope of the current thread
+static thread_local CpuTimeScope *s_current_scope = nullptr;
+
+StreamCpuStat::Ptr StreamCpuStat::create() {
+    GET_CONFIG(bool, enable, General::kStreamCpuStat);
+    return enable ? std::make_shared<StreamCpuStat>() : nullptr;
+}
+
+StreamCpuStat::Ptr StreamCpuStat::get(MediaSource &src) {
+    auto muxer = src.getMuxer();
+    return muxer ? muxer->getCpuStat() : nullptr;
+}
+
+const char *StreamCpuStat::stageName(CpuStage stage) {
+    switch (stage) {
+        case CpuStage::demux: return "demux";
+        case CpuStage::mux_rtsp: return "mux_rtsp";
+        case CpuStage::mux_rtmp: return "mux_rtmp";
+        case CpuStage::mux_ts: return "mux_ts";
+        case CpuStage::mux_fmp4: return "mux_fmp4";
+        case CpuStage::mux_hls: return "mux_hls";
+        case CpuStage::mux_mp4: return "mux_mp4";
+        case CpuStage::send: return "send";
+        case CpuStage::transcode: return "transcode";
+        default: return "unknown";
+    }
+}
+
+uint64_t StreamCpuStat::total() const {
+    uint64_t ret = 0;
+    for (auto &ns : _ns) {
+        ret += ns;
+    }
+    return ret;
+}
+
+CpuTimeScope::CpuTimeScope(StreamCpuStat *stat, CpuStage stage) {
+    _stat = stat;
+    _stage = stage;
+    if (!_stat) {
+        return;
+    }
+    _begin = threadCpuNanosecond();
+    _parent = s_current_scope;
+    if (_parent) {
+        // 外层作用域暂停计时，先结算其已消耗的时间
+        // Pause the outer scope and charge the time it has consumed
+        _parent->_stat->add(_parent->_stage, _begin - MIN(_begin, _parent->_begin));
+    }
+    s_current_scope = this;
+}
+
+CpuTimeScope::~CpuTimeScope() {
+    if (!_stat) {
+        return;
+    }
+    auto now = threadCpuNanosecond();
+    _stat->add(_stage, now - MIN(now, _begin));
+    if (_parent) {
+        // 外层作用域恢复计时
+        // Resume the outer scope
+        _parent->_begin = now;
+    }
+    s_current_scope = _parent;
+}
+
+} // namespace mediakit
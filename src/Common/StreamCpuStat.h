@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_STREAMCPUSTAT_H
+#define ZLMEDIAKIT_STREAMCPUSTAT_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace mediakit {
+
+class MediaSource;
+
+// 流处理阶段
+// Processing stages of a stream
+enum class CpuStage : uint8_t {
+    demux = 0,
+    mux_rtsp,
+    mux_rtmp,
+    mux_ts,
+    mux_fmp4,
+    mux_hls,
+    mux_mp4,
+    send,
+    transcode,
+    max
+};
+
+/**
+ * 按处理阶段累计某个流消耗的线程cpu时间(纳秒)，由CpuTimeScope在各poller线程上增量累加
+ * Thread cpu time (nanoseconds) consumed by a stream per stage, accumulated by CpuTimeScope on the pollers
+ */
+class StreamCpuStat {
+public:
+    using Ptr = std::shared_ptr<StreamCpuStat>;
+
+    /**
+     * 未开启general.stream_cpu_stat时返回nullptr
+     * Returns nullptr if general.stream_cpu_stat is disabled
+     */
+    static Ptr create();
+
+    /**
+     * 获取媒体源所属流的统计对象，可能为nullptr
+     * Get the statistic of the stream the source belongs to, may be nullptr
+     */
+    static Ptr get(MediaSource &src);
+
+    static const char *stageName(CpuStage stage);
+
+    void add(CpuStage stage, uint64_t ns) { _ns[(size_t)stage] += ns; }
+    uint64_t get(CpuStage stage) const { return _ns[(size_t)stage]; }
+    uint64_t total() const;
+
+private:
+    std::atomic<uint64_t> _ns[(size_t)CpuStage::max] {};
+};
+
+/**
+ * 将作用域内当前线程消耗的cpu时间计入某流的某阶段；
+ * 作用域嵌套时只计独占时间，内层作用域的时间不会重复计入外层
+ * Charge the cpu time of the current thread within the scope to a stage of a stream;
+ * nested scopes are charged exclusively, time of the inner scope is not counted again by the outer one
+ */
+class CpuTimeScope {
+public:
+    CpuTimeScope(StreamCpuStat *stat, CpuStage stage);
+    CpuTimeScope(const StreamCpuStat::Ptr &stat, CpuStage stage) : CpuTimeScope(stat.get(), stage) {}
+    ~CpuTimeScope();
+
+    CpuTimeScope(const CpuTimeScope &) = delete;
+    CpuTimeScope &operator=(const CpuTimeScope &) = delete;
+
+private:
+    StreamCpuStat *_stat;
+    CpuStage _stage;
+    uint64_t _begin = 0;
+    CpuTimeScope *_parent = nullptr;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_STREAMCPUSTAT_H
@@ -66,6 +66,7 @@ const string kBroadcastRtcSctpClosed = "kBroadcastRtcSctpClosed";
 const string kBroadcastRtcSctpSend = "kBroadcastRtcSctpSend";
 const string kBroadcastRtcSctpReceived = "kBroadcastRtcSctpReceived";
 const string kBroadcastPlayerCountChanged = "kBroadcastPlayerCountChanged";
+const string kBroadcastPlayerProxyStatus = "kBroadcastPlayerProxyStatus";
 
 } // namespace Broadcast
 
@@ -88,6 +89,13 @@ const string kWaitAddTrackMS = GENERAL_FIELD "wait_add_track_ms";
 const string kUnreadyFrameCache = GENERAL_FIELD "unready_frame_cache";
 const string kBroadcastPlayerCountChanged = GENERAL_FIELD "broadcast_player_count_changed";
 const string kListenIP = GENERAL_FIELD "listen_ip";
+const string kPollerProbeMS = GENERAL_FIELD "poller_probe_ms";
+const string kPollerStallMS = GENERAL_FIELD "poller_stall_ms";
+const string kStreamCpuStat = GENERAL_FIELD "stream_cpu_stat";
+const string kFrameThinning = GENERAL_FIELD "frame_thinning";
+const string kFrameThinningQueue = GENERAL_FIELD "frame_thinning_queue";
+const string kKeyFrameRequestMS = GENERAL_FIELD "keyframe_request_ms";
+const string kKeyFrameCacheMaxMS = GENERAL_FIELD "keyframe_cache_max_ms";
 
 static onceToken token([]() {
     mINI::Instance()[kFlowThreshold] = 1024;
@@ -105,6 +113,13 @@ static onceToken token([]() {
     mINI::Instance()[kUnreadyFrameCache] = 100;
     mINI::Instance()[kBroadcastPlayerCountChanged] = 0;
     mINI::Instance()[kListenIP] = "::";
+    mINI::Instance()[kPollerProbeMS] = 100;
+    mINI::Instance()[kPollerStallMS] = 500;
+    mINI::Instance()[kStreamCpuStat] = 0;
+    mINI::Instance()[kFrameThinning] = 0;
+    mINI::Instance()[kFrameThinningQueue] = 256;
+    mINI::Instance()[kKeyFrameRequestMS] = 1000;
+    mINI::Instance()[kKeyFrameCacheMaxMS] = 5000;
 });
 
 } // namespace General
@@ -195,6 +210,8 @@ const string kForbidCacheSuffix = HTTP_FIELD "forbidCacheSuffix";
 const string kForwardedIpHeader = HTTP_FIELD "forwarded_ip_header";
 const string kAllowCrossDomains = HTTP_FIELD "allow_cross_domains";
 const string kAllowIPRange = HTTP_FIELD "allow_ip_range";
+const string kFileCacheMaxCount = HTTP_FIELD "fileCacheMaxCount";
+const string kFileCacheMaxMB = HTTP_FIELD "fileCacheMaxMB";
 
 static onceToken token([]() {
     mINI::Instance()[kSendBufSize] = 64 * 1024;
@@ -219,6 +236,8 @@ static onceToken token([]() {
     mINI::Instance()[kForwardedIpHeader] = "";
     mINI::Instance()[kAllowCrossDomains] = 1;
     mINI::Instance()[kAllowIPRange] = "::1,127.0.0.1,172.16.0.0-172.31.255.255,192.168.0.0-192.168.255.255,10.0.0.0-10.255.255.255";
+    mINI::Instance()[kFileCacheMaxCount] = 1024;
+    mINI::Instance()[kFileCacheMaxMB] = 256;
 });
 
 } // namespace Http
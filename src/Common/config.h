@@ -161,6 +161,11 @@ extern const std::string kBroadcastRtcSctpReceived;
 extern const std::string kBroadcastPlayerCountChanged;
 #define BroadcastPlayerCountChangedArgs const MediaTuple& args, const int& count
 
+// 拉流代理状态变化广播，status为playing/retrying/closed
+// broadcast pull proxy status changes, status is playing/retrying/closed
+extern const std::string kBroadcastPlayerProxyStatus;
+#define BroadcastPlayerProxyStatusArgs const MediaTuple &tuple, const std::string &url, const std::string &status, const SockException &ex
+
 #define ReloadConfigTag ((void *)(0xFF))
 #define RELOAD_KEY(arg, key)                                                                                           \
     do {                                                                                                               \
@@ -262,6 +267,27 @@ extern const std::string kBroadcastPlayerCountChanged;
 // 绑定的本地网卡ip  [AUTO-TRANSLATED:daa90832]
 // Bound local network card ip
 extern const std::string kListenIP;
+// 事件循环延时探测间隔，单位毫秒，置0关闭延时统计与卡顿看门狗
+// Interval of event loop lag probes in milliseconds, 0 disables lag statistics and the stall watchdog
+extern const std::string kPollerProbeMS;
+// poller超过该时间未响应则认为卡顿并打印正在执行的任务，单位毫秒，置0关闭看门狗
+// A poller not responding for longer than this is considered stalled and its running task is logged, 0 disables the watchdog
+extern const std::string kPollerStallMS;
+// 是否按处理阶段统计各流消耗的线程cpu时间，开启后每个处理阶段会额外调用clock_gettime
+// Whether to account thread cpu time of each stream by stage, costs extra clock_gettime calls per stage when enabled
+extern const std::string kStreamCpuStat;
+// 观看端拥塞时是否丢弃不被参考的视频帧(h264 nal_ref_idc为0、h265最高时域层的子层非参考帧)
+// Whether to drop video frames nobody references (h264 nal_ref_idc 0, h265 sub-layer non-reference pictures of the highest temporal layer) for congested viewers
+extern const std::string kFrameThinning;
+// tcp协议发送队列中待发送的数据包超过该个数时开始抽帧，回落到1/4以下时停止
+// Start thinning when more packets than this are queued in the tcp send buffer, stop when it falls below a quarter of it
+extern const std::string kFrameThinningQueue;
+// 同一路流向源端请求关键帧的最小间隔，单位毫秒，期间各协议各观看端的请求合并为一次
+// Min interval of key frame requests sent to the origin of a stream in milliseconds, requests of all protocols and viewers in between are merged
+extern const std::string kKeyFrameRequestMS;
+// 新加入的观看端请求关键帧时，若gop缓存中的关键帧不超过该时长，则由gop缓存满足而不向源端请求，单位毫秒，置0关闭
+// A joining viewer asking for a key frame is served by the gop cache without asking the origin when the cached key frame is at most this old, 0 disables it
+extern const std::string kKeyFrameCacheMaxMS;
 } // namespace General
 
 namespace Protocol {
@@ -382,6 +408,12 @@ extern const std::string kAllowCrossDomains;
 // 允许访问http api和http文件索引的ip地址范围白名单，置空情况下不做限制  [AUTO-TRANSLATED:ab939863]
 // Whitelist of IP address ranges allowed to access HTTP API and HTTP file index. No restrictions are imposed when empty
 extern const std::string kAllowIPRange;
+// 文件(mmap)缓存最大个数，置0关闭缓存
+// Maximum number of cached files (mmap), set to 0 to disable the cache
+extern const std::string kFileCacheMaxCount;
+// 文件(mmap)缓存总大小上限(MB)，超过时淘汰最久未访问的文件，大于该值的文件不缓存，置0关闭缓存
+// Byte budget of the file (mmap) cache in MB, least recently accessed files are evicted beyond it and larger files are not cached, set to 0 to disable the cache
+extern const std::string kFileCacheMaxMB;
 } // namespace Http
 
 // //////////SHELL配置///////////  [AUTO-TRANSLATED:f023ec45]
@@ -9,7 +9,9 @@
  */
 
 #include <csignal>
+#include <cinttypes>
 #include <tuple>
+#include <sys/stat.h>
 
 #ifndef _WIN32
 #include <sys/mman.h>
@@ -25,7 +27,9 @@
 #include "Util/uv_errno.h"
 
 #include "HttpBody.h"
+#include "HttpConst.h"
 #include "HttpClient.h"
+#include "Common/config.h"
 #include "Common/macros.h"
 
 using namespace std;
@@ -83,8 +87,8 @@ static void delSharedMmap(const string &file_path, char *ptr) {
     }
 }
 
-static std::shared_ptr<char> getSharedMmap(const string &file_path, int64_t &file_size) {
-    {
+static std::shared_ptr<char> getSharedMmap(const string &file_path, int64_t &file_size, bool reuse = true) {
+    if (reuse) {
         lock_guard<mutex> lck(s_mtx);
         auto it = s_shared_mmap.find(file_path);
         if (it != s_shared_mmap.end()) {
@@ -193,8 +197,156 @@ static std::shared_ptr<char> getSharedMmap(const string &file_path, int64_t &fil
     return ret;
 }
 
-HttpFileBody::HttpFileBody(const string &file_path, bool use_mmap) {
+//////////////////////////////////////////////////////////////////
+
+static bool statFile(const string &file_path, uint64_t &inode, int64_t &mtime_ns, int64_t &file_size) {
+    struct stat st;
+    if (0 != stat(file_path.data(), &st) || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    inode = st.st_ino;
+    file_size = st.st_size;
+#if defined(__APPLE__)
+    mtime_ns = st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    mtime_ns = st.st_mtime * 1000000000LL;
+#else
+    mtime_ns = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+static string httpDateStr(time_t tt) {
+    char buf[64];
+    struct tm tm;
+#if defined(_WIN32)
+    gmtime_s(&tm, &tt);
+#else
+    gmtime_r(&tt, &tm);
+#endif
+    strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+INSTANCE_IMP(HttpFileCache)
+
+HttpFileCache::HttpFileCache() {
+    // 字符集等配置变更后，预先生成的http头需要重新生成
+    // After configurations such as charset are changed, the precomputed http headers need to be regenerated
+    NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastReloadConfig, [this](BroadcastReloadConfigArgs) { clear(); });
+}
+
+HttpFileCache::Entry::Ptr HttpFileCache::get(const string &file_path) {
+    GET_CONFIG(size_t, max_count, Http::kFileCacheMaxCount);
+    GET_CONFIG(uint64_t, max_mb, Http::kFileCacheMaxMB);
+    if (!max_count || !max_mb) {
+        return nullptr;
+    }
+    auto max_bytes = max_mb * 1024 * 1024;
+
+    uint64_t inode;
+    int64_t mtime_ns, file_size;
+    if (!statFile(file_path, inode, mtime_ns, file_size) || file_size <= 0 || (uint64_t)file_size > max_bytes) {
+        // 文件不存在、为文件夹、空文件或超过缓存字节上限
+        // The file does not exist, is a folder, is empty or exceeds the byte budget of the cache
+        invalidate(file_path);
+        return nullptr;
+    }
+
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _map.find(file_path);
+        if (it != _map.end()) {
+            auto &entry = it->second->second;
+            if (entry->inode == inode && entry->mtime_ns == mtime_ns && entry->file_size == file_size) {
+                // 命中缓存，移至lru头部
+                // Hit the cache, move it to the head of lru
+                _lru.splice(_lru.begin(), _lru, it->second);
+                return entry;
+            }
+        }
+    }
 
+    // 未命中缓存或文件已变更，重新mmap(不复用可能已过期的共享mmap)
+    // Cache missed or file changed, mmap again (do not reuse the shared mmap which may be stale)
+    int64_t map_size = 0;
+    auto map_addr = getSharedMmap(file_path, map_size, false);
+    if (!map_addr || map_size != file_size) {
+        invalidate(file_path);
+        return nullptr;
+    }
+
+    GET_CONFIG(string, charSet, Http::kCharSet);
+    auto entry = std::make_shared<Entry>();
+    entry->inode = inode;
+    entry->mtime_ns = mtime_ns;
+    entry->file_size = file_size;
+    entry->map_addr = std::move(map_addr);
+    entry->content_type = HttpConst::getHttpContentType(file_path.data()) + "; charset=" + charSet;
+    entry->last_modified = httpDateStr((time_t)(mtime_ns / 1000000000LL));
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%" PRIx64 "-%" PRIx64 "-%" PRIx64 "\"", inode, (uint64_t)file_size, (uint64_t)mtime_ns);
+    entry->etag = etag;
+
+    lock_guard<mutex> lck(_mtx);
+    erase_l(file_path);
+    _lru.emplace_front(file_path, entry);
+    _map.emplace(file_path, _lru.begin());
+    _bytes += file_size;
+    while (_lru.size() > max_count || _bytes > max_bytes) {
+        // 淘汰最久未访问的文件，正在发送中的文件由HttpFileBody继续持有
+        // Evict the least recently accessed file, files being sent are still held by HttpFileBody
+        erase_l(_lru.back().first);
+    }
+    return entry;
+}
+
+void HttpFileCache::erase_l(const string &file_path) {
+    auto it = _map.find(file_path);
+    if (it == _map.end()) {
+        return;
+    }
+    _bytes -= it->second->second->file_size;
+    _lru.erase(it->second);
+    _map.erase(it);
+}
+
+void HttpFileCache::invalidate(const string &file_path) {
+    {
+        lock_guard<mutex> lck(_mtx);
+        erase_l(file_path);
+    }
+    // 同时移除共享mmap记录，防止后续请求复用已被删除或重写的文件
+    // Also remove the shared mmap record to prevent subsequent requests from reusing deleted or rewritten files
+    lock_guard<mutex> lck(s_mtx);
+    s_shared_mmap.erase(file_path);
+}
+
+void HttpFileCache::clear() {
+    lock_guard<mutex> lck(_mtx);
+    _map.clear();
+    _lru.clear();
+    _bytes = 0;
+}
+
+size_t HttpFileCache::size() {
+    lock_guard<mutex> lck(_mtx);
+    return _lru.size();
+}
+
+uint64_t HttpFileCache::bytes() {
+    lock_guard<mutex> lck(_mtx);
+    return _bytes;
+}
+
+//////////////////////////////////////////////////////////////////
+
+HttpFileBody::HttpFileBody(const HttpFileCache::Entry::Ptr &cache) {
+    _map_addr = cache->map_addr;
+    _read_to = cache->file_size;
+}
+
+HttpFileBody::HttpFileBody(const string &file_path, bool use_mmap) {
     // 判断是否为目录，避免对目录进行mmap操作，导致程序崩溃。
     if (File::is_dir(file_path)) {
         _read_to = -1;
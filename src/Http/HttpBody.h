@@ -13,6 +13,9 @@
 
 #include <stdlib.h>
 #include <memory>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include "Network/Buffer.h"
 #include "Util/ResourcePool.h"
 #include "Util/logger.h"
@@ -127,6 +130,61 @@ private:
     toolkit::Buffer::Ptr _buffer;
 };
 
+/**
+ * 打开文件(mmap)缓存，按文件路径索引，并通过inode/mtime/size校验文件是否变更
+ * 同时预先生成Content-Type、Last-Modified、ETag等http回复头，避免每次请求重复计算
+ * Open file (mmap) cache, indexed by file path and validated by inode/mtime/size
+ * Http response headers such as Content-Type, Last-Modified and ETag are precomputed for each entry
+ */
+class HttpFileCache {
+public:
+    struct Entry {
+        using Ptr = std::shared_ptr<Entry>;
+        uint64_t inode = 0;
+        int64_t mtime_ns = 0;
+        int64_t file_size = 0;
+        std::shared_ptr<char> map_addr;
+        std::string content_type;
+        std::string last_modified;
+        std::string etag;
+    };
+
+    static HttpFileCache &Instance();
+
+    /**
+     * 获取文件缓存，未命中或文件已变更时重新打开并mmap
+     * @param file_path 文件路径
+     * @return 缓存对象，文件不存在、是文件夹、空文件或mmap失败时返回nullptr
+     * Get file cache, reopen and mmap the file when missing or changed
+     * @param file_path File path
+     * @return Cache entry, nullptr if the file does not exist, is a folder, is empty or mmap failed
+     */
+    Entry::Ptr get(const std::string &file_path);
+
+    /**
+     * 文件被删除或重写时，使该文件缓存失效
+     * Invalidate the cache of the file when it is deleted or rewritten
+     */
+    void invalidate(const std::string &file_path);
+
+    void clear();
+    size_t size();
+    uint64_t bytes();
+
+private:
+    HttpFileCache();
+
+    void erase_l(const std::string &file_path);
+
+private:
+    std::mutex _mtx;
+    // 已缓存文件的总字节数
+    // Total bytes of the cached files
+    uint64_t _bytes = 0;
+    std::list<std::pair<std::string, Entry::Ptr> > _lru;
+    std::unordered_map<std::string, decltype(_lru)::iterator> _map;
+};
+
 /**
  * 文件类型的content
  * File type content
@@ -149,6 +207,14 @@ public:
      */
     HttpFileBody(const std::string &file_path, bool use_mmap = true);
 
+    /**
+     * 通过文件缓存构造，省去stat/open/mmap等系统调用
+     * @param cache 文件缓存
+     * Construct from the file cache, saving system calls such as stat/open/mmap
+     * @param cache File cache entry
+     */
+    HttpFileBody(const HttpFileCache::Entry::Ptr &cache);
+
     /**
      * 设置读取范围
      * @param offset 相对文件头的偏移量
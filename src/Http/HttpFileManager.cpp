@@ -468,6 +468,22 @@ static string pathCat(const string &a, const string &b){
     return a + '/' + b;
 }
 
+/**
+ * 是否禁止缓存该文件
+ * Whether caching of this file is forbidden
+ */
+static bool isForbidCache(const string &file_path) {
+    GET_CONFIG_FUNC(vector<string>, forbidCacheSuffix, Http::kForbidCacheSuffix, [](const string &str) {
+        return split(str, ",");
+    });
+    for (auto &suffix : forbidCacheSuffix) {
+        if (suffix != "" && end_with(file_path, suffix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * 访问文件
  * @param sender 事件触发者
@@ -539,17 +555,7 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
                 }
                 cb(code, HttpFileManager::getContentType(file_path.data()), headerOut, body);
             };
-            GET_CONFIG_FUNC(vector<string>, forbidCacheSuffix, Http::kForbidCacheSuffix, [](const string &str) {
-                return split(str, ",");
-            });
-            bool is_forbid_cache = false;
-            for (auto &suffix : forbidCacheSuffix) {
-                if (suffix != "" && end_with(file_path, suffix)) {
-                    is_forbid_cache = true;
-                    break;
-                }
-            }
-            invoker.responseFile(parser.getHeader(), httpHeader, file_content.empty() ? file_path : file_content, !is_hls && !is_forbid_cache, file_content.empty());
+            invoker.responseFile(parser.getHeader(), httpHeader, file_content.empty() ? file_path : file_content, !is_hls && !isForbidCache(file_path), file_content.empty());
         };
 
         if (!is_hls || !cookie) {
@@ -768,7 +774,10 @@ void HttpResponseInvokerImp::responseFile(const StrCaseMap &requestHeader,
     // file is the file path
     GET_CONFIG(string, charSet, Http::kCharSet);
     StrCaseMap &httpHeader = const_cast<StrCaseMap &>(responseHeader);
-    auto fileBody = std::make_shared<HttpFileBody>(file, use_mmap);
+    // 鉴权通过后才查找文件缓存(未命中时打开并mmap)，且每个请求只查找一次
+    // The file cache is looked up (opening and mmapping the file on miss) only after authorization, and only once per request
+    auto cache = use_mmap ? HttpFileCache::Instance().get(file) : nullptr;
+    auto fileBody = cache ? std::make_shared<HttpFileBody>(cache) : std::make_shared<HttpFileBody>(file, use_mmap);
     if (fileBody->remainSize() < 0) {
         // 打开文件失败  [AUTO-TRANSLATED:1f0405cb]
         // Failed to open file
@@ -780,9 +789,24 @@ void HttpResponseInvokerImp::responseFile(const StrCaseMap &requestHeader,
         return;
     }
 
-    // 尝试添加Content-Type  [AUTO-TRANSLATED:2c08b371]
-    // Try to add Content-Type
-    httpHeader.emplace("Content-Type", HttpConst::getHttpContentType(file.data()) + "; charset=" + charSet);
+    if (cache) {
+        // 使用文件缓存中预先生成的回复头
+        // Use the response headers precomputed in the file cache
+        httpHeader.emplace("Content-Type", cache->content_type);
+        httpHeader.emplace("Last-Modified", cache->last_modified);
+        httpHeader.emplace("ETag", cache->etag);
+        auto it = requestHeader.find("If-None-Match");
+        if (it != requestHeader.end() && it->second == cache->etag) {
+            // 文件未变更，客户端可以使用本地缓存
+            // The file has not changed, the client can use its local cache
+            (*this)(304, httpHeader, HttpBody::Ptr());
+            return;
+        }
+    } else {
+        // 尝试添加Content-Type  [AUTO-TRANSLATED:2c08b371]
+        // Try to add Content-Type
+        httpHeader.emplace("Content-Type", HttpConst::getHttpContentType(file.data()) + "; charset=" + charSet);
+    }
 
     auto &strRange = const_cast<StrCaseMap &>(requestHeader)["Range"];
     int code = 200;
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+#include "HttpRequesterPool.h"
+#include "Util/util.h"
+#include "Poller/EventPoller.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 每个服务端保留最近多少次请求耗时用于计算分位数
+static constexpr size_t kLatencySamples = 1024;
+
+INSTANCE_IMP(HttpRequesterPool)
+
+static string getEndpointName(const string &url) {
+    auto pos = url.find("://");
+    if (pos == string::npos) {
+        return url;
+    }
+    auto end = url.find_first_of("/?#", pos + 3);
+    return end == string::npos ? url : url.substr(0, end);
+}
+
+void HttpRequesterPool::Endpoint::addLatency(uint32_t ms) {
+    if (latency.size() < kLatencySamples) {
+        latency.emplace_back(ms);
+        return;
+    }
+    latency[latency_pos] = ms;
+    latency_pos = (latency_pos + 1) % kLatencySamples;
+}
+
+void HttpRequesterPool::Endpoint::expireIdle_l(uint64_t now_ms, uint64_t timeout_ms, vector<HttpRequester::Ptr> &expired) {
+    if (!timeout_ms) {
+        return;
+    }
+    while (!idle.empty() && now_ms - MIN(now_ms, idle.front().release_ms) >= timeout_ms) {
+        expired.emplace_back(std::move(idle.front().requester));
+        idle.pop_front();
+    }
+}
+
+HttpRequesterPool::Endpoint::Ptr HttpRequesterPool::getEndpoint(const string &url) {
+    auto name = getEndpointName(url);
+    startIdleTimer();
+    lock_guard<mutex> lck(_mtx);
+    auto &ep = _endpoints[name];
+    if (!ep) {
+        ep = std::make_shared<Endpoint>();
+        ep->name = std::move(name);
+    }
+    return ep;
+}
+
+void HttpRequesterPool::startIdleTimer() {
+    std::call_once(_idle_timer_flag, [this]() {
+        // 没有新请求时也要关闭超时的空闲连接
+        _idle_timer = std::make_shared<Timer>(1.0f, [this]() {
+            vector<Endpoint::Ptr> endpoints;
+            {
+                lock_guard<mutex> lck(_mtx);
+                for (auto &pr : _endpoints) {
+                    endpoints.emplace_back(pr.second);
+                }
+            }
+            auto now = getCurrentMillisecond();
+            vector<HttpRequester::Ptr> expired;
+            for (auto &ep : endpoints) {
+                lock_guard<mutex> lck(ep->mtx);
+                ep->expireIdle_l(now, _idle_timeout_ms, expired);
+            }
+            closeRequesters(std::move(expired));
+            return true;
+        }, nullptr);
+    });
+}
+
+void HttpRequesterPool::closeRequesters(vector<HttpRequester::Ptr> requesters) {
+    for (auto &requester : requesters) {
+        // 在连接所属poller线程中释放
+        auto poller = requester->getPoller();
+        poller->async([requester]() mutable { requester = nullptr; }, false);
+    }
+}
+
+void HttpRequesterPool::startRequester(Request req) {
+    auto ep = getEndpoint(req.url);
+    PendingRequest pending;
+    pending.req = std::move(req);
+
+    HttpRequester::Ptr requester;
+    vector<HttpRequester::Ptr> expired;
+    {
+        lock_guard<mutex> lck(ep->mtx);
+        size_t max_connections = _max_connections;
+        // 超时的空闲连接可能已被服务器关闭，不再复用；优先复用最近归还的连接
+        ep->expireIdle_l(getCurrentMillisecond(), _idle_timeout_ms, expired);
+        if (!ep->idle.empty()) {
+            requester = std::move(ep->idle.back().requester);
+            ep->idle.pop_back();
+        } else if (!max_connections || ep->busy < max_connections) {
+            requester = std::make_shared<HttpRequester>();
+            // 复用的keep-alive连接可能已被服务器关闭，此时允许重发请求
+            requester->setAllowResendRequest(true);
+        } else if (ep->queue.size() < _max_queue_size) {
+            ep->queue.emplace_back(std::move(pending));
+            ep->max_queue_size = MAX(ep->max_queue_size, ep->queue.size());
+            return;
+        } else {
+            ++ep->total;
+            ++ep->failed;
+            ++ep->dropped;
+        }
+        if (requester) {
+            ++ep->busy;
+        }
+    }
+    closeRequesters(std::move(expired));
+
+    if (!requester) {
+        auto on_result = std::move(pending.req.on_result);
+        auto name = ep->name;
+        WarnL << "http request queue of " << name << " is full, drop request: " << pending.req.url;
+        if (on_result) {
+            EventPollerPool::Instance().getPoller()->async([on_result, name]() {
+                Parser parser;
+                on_result(SockException(Err_other, "http request queue of " + name + " is full"), parser);
+            }, false);
+        }
+        return;
+    }
+    dispatch(ep, requester, std::move(pending));
+}
+
+void HttpRequesterPool::dispatch(const Endpoint::Ptr &ep, const HttpRequester::Ptr &requester, PendingRequest pending) {
+    auto pending_ptr = std::make_shared<PendingRequest>(std::move(pending));
+    requester->getPoller()->async([this, ep, requester, pending_ptr]() {
+        auto &req = pending_ptr->req;
+        requester->clear();
+        requester->setMethod(req.method);
+        requester->setHeader(req.header);
+        requester->setBody(req.body);
+        try {
+            requester->startRequester(req.url, [this, ep, requester, pending_ptr](const SockException &ex, const Parser &res) {
+                {
+                    lock_guard<mutex> lck(ep->mtx);
+                    ++ep->total;
+                    if (ex) {
+                        ++ep->failed;
+                    }
+                    ep->addLatency((uint32_t)pending_ptr->ticker.elapsedTime());
+                }
+                if (pending_ptr->req.on_result) {
+                    pending_ptr->req.on_result(ex, res);
+                }
+                // 回调可能处于HttpClient的数据处理流程中，延后归还连接
+                requester->getPoller()->async([this, ep, requester]() { release(ep, requester); }, false);
+            }, req.timeout_sec);
+        } catch (std::exception &ex) {
+            WarnL << "start http request failed: " << ex.what();
+            {
+                lock_guard<mutex> lck(ep->mtx);
+                ++ep->total;
+                ++ep->failed;
+            }
+            if (req.on_result) {
+                Parser parser;
+                req.on_result(SockException(Err_other, ex.what()), parser);
+            }
+            release(ep, requester);
+        }
+    }, false);
+}
+
+void HttpRequesterPool::release(const Endpoint::Ptr &ep, const HttpRequester::Ptr &requester) {
+    PendingRequest pending;
+    {
+        lock_guard<mutex> lck(ep->mtx);
+        if (ep->queue.empty()) {
+            --ep->busy;
+            if (ep->idle.size() >= _max_idle) {
+                // 空闲连接已达上限(max_connections不限制时也生效)，关闭该连接
+                closeRequesters({ requester });
+                return;
+            }
+            ep->idle.emplace_back(IdleRequester { requester, getCurrentMillisecond() });
+            return;
+        }
+        pending = std::move(ep->queue.front());
+        ep->queue.pop_front();
+    }
+    // 直接复用该连接处理排队中的请求
+    dispatch(ep, requester, std::move(pending));
+}
+
+void HttpRequesterPool::getStatistic(vector<Statistic> &out) {
+    vector<Endpoint::Ptr> endpoints;
+    {
+        lock_guard<mutex> lck(_mtx);
+        for (auto &pr : _endpoints) {
+            endpoints.emplace_back(pr.second);
+        }
+    }
+    for (auto &ep : endpoints) {
+        Statistic stat;
+        vector<uint32_t> latency;
+        {
+            lock_guard<mutex> lck(ep->mtx);
+            stat.endpoint = ep->name;
+            stat.connections = ep->busy + ep->idle.size();
+            stat.idle = ep->idle.size();
+            stat.queue_size = ep->queue.size();
+            stat.max_queue_size = ep->max_queue_size;
+            stat.total = ep->total;
+            stat.failed = ep->failed;
+            stat.dropped = ep->dropped;
+            latency = ep->latency;
+        }
+        if (!latency.empty()) {
+            auto percentile = [&](size_t percent) -> uint64_t {
+                auto index = MIN(latency.size() - 1, latency.size() * percent / 100);
+                std::nth_element(latency.begin(), latency.begin() + index, latency.end());
+                return latency[index];
+            };
+            stat.p50 = percentile(50);
+            stat.p90 = percentile(90);
+            stat.p99 = percentile(99);
+            stat.max = *std::max_element(latency.begin(), latency.end());
+        }
+        out.emplace_back(std::move(stat));
+    }
+}
+
+} // namespace mediakit
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_HTTPREQUESTERPOOL_H
+#define ZLMEDIAKIT_HTTPREQUESTERPOOL_H
+
+#include <list>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include "HttpRequester.h"
+#include "Poller/Timer.h"
+
+namespace mediakit {
+
+/**
+ * 按服务端(scheme://host:port)复用的HttpRequester连接池
+ * 每个服务端最多同时打开max_connections个keep-alive连接，超出的请求排队等待空闲连接，
+ * 队列满时请求立即失败；同时统计每个服务端的请求耗时分位数与排队深度
+ * Pool of keep-alive HttpRequester connections grouped by endpoint (scheme://host:port).
+ * At most max_connections requests are in flight per endpoint, the rest wait in a FIFO queue.
+ */
+class HttpRequesterPool {
+public:
+    struct Request {
+        std::string url;
+        std::string method = "POST";
+        std::string body;
+        HttpClient::HttpHeader header;
+        float timeout_sec = 10;
+        HttpRequester::HttpRequesterResult on_result;
+    };
+
+    struct Statistic {
+        std::string endpoint;
+        size_t connections = 0;
+        size_t idle = 0;
+        size_t queue_size = 0;
+        size_t max_queue_size = 0;
+        uint64_t total = 0;
+        uint64_t failed = 0;
+        uint64_t dropped = 0;
+        // 最近若干次请求的耗时(毫秒)，包含排队时间
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t max = 0;
+    };
+
+    static HttpRequesterPool &Instance();
+
+    /**
+     * 设置每个服务端的最大并发连接数，0代表不限制
+     * Max concurrent connections per endpoint, 0 means unlimited
+     */
+    void setMaxConnections(size_t count) { _max_connections = count; }
+
+    /**
+     * 设置每个服务端的最大排队请求数，超出后请求立即失败
+     * Max queued requests per endpoint, extra requests fail immediately
+     */
+    void setMaxQueueSize(size_t count) { _max_queue_size = count; }
+
+    /**
+     * 设置每个服务端最多保留的空闲连接数，不受max_connections是否限制影响，超出的连接归还时直接关闭
+     * Max idle connections kept per endpoint, applies even when max_connections is unlimited, extra connections are closed on release
+     */
+    void setMaxIdle(size_t count) { _max_idle = count; }
+
+    /**
+     * 设置空闲连接的超时时间，超时未被复用的连接将被关闭，0代表不超时
+     * Idle timeout in seconds, connections not reused within it are closed, 0 means never
+     */
+    void setIdleTimeout(float sec) { _idle_timeout_ms = (uint64_t)(sec * 1000); }
+
+    /**
+     * 发起http请求，回调在连接所属的poller线程触发
+     * Start a request, the result callback is triggered in the poller thread of the connection
+     */
+    void startRequester(Request req);
+
+    void getStatistic(std::vector<Statistic> &out);
+
+private:
+    HttpRequesterPool() = default;
+
+    struct PendingRequest {
+        Request req;
+        toolkit::Ticker ticker;
+    };
+
+    struct IdleRequester {
+        HttpRequester::Ptr requester;
+        uint64_t release_ms;
+    };
+
+    class Endpoint {
+    public:
+        using Ptr = std::shared_ptr<Endpoint>;
+        std::string name;
+        std::mutex mtx;
+        size_t busy = 0;
+        // 尾部为最近归还的连接，优先复用；头部的连接最先超时
+        std::list<IdleRequester> idle;
+        std::deque<PendingRequest> queue;
+        size_t max_queue_size = 0;
+        uint64_t total = 0;
+        uint64_t failed = 0;
+        uint64_t dropped = 0;
+        std::vector<uint32_t> latency;
+        size_t latency_pos = 0;
+
+        void addLatency(uint32_t ms);
+        // 移除超时的空闲连接，通过expired返回
+        void expireIdle_l(uint64_t now_ms, uint64_t timeout_ms, std::vector<HttpRequester::Ptr> &expired);
+    };
+
+    Endpoint::Ptr getEndpoint(const std::string &url);
+    void dispatch(const Endpoint::Ptr &ep, const HttpRequester::Ptr &requester, PendingRequest pending);
+    void release(const Endpoint::Ptr &ep, const HttpRequester::Ptr &requester);
+    void startIdleTimer();
+    void closeRequesters(std::vector<HttpRequester::Ptr> requesters);
+
+private:
+    std::atomic<size_t> _max_connections { 16 };
+    std::atomic<size_t> _max_queue_size { 10000 };
+    std::atomic<size_t> _max_idle { 16 };
+    std::atomic<uint64_t> _idle_timeout_ms { 30 * 1000 };
+    std::once_flag _idle_timer_flag;
+    std::shared_ptr<toolkit::Timer> _idle_timer;
+    std::mutex _mtx;
+    std::unordered_map<std::string, Endpoint::Ptr> _endpoints;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_HTTPREQUESTERPOOL_H
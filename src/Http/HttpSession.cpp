@@ -12,6 +12,8 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include "Common/config.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 #include "Common/strCoding.h"
 #include "HttpSession.h"
 #include "HttpConst.h"
@@ -142,7 +144,7 @@ ssize_t HttpSession::onRecvHeader(const char *header, size_t len) {
     _on_recv_body = [this, it](const char *data, size_t len) mutable {
         // 收集body完毕  [AUTO-TRANSLATED:981ad2c8]
         // Body collection complete
-        _parser.setContent(std::string(data, len));
+        _parser.setContent(data, len);
         (this->*(it->second))();
         _parser.clear();
 
@@ -392,6 +394,8 @@ bool HttpSession::checkLiveStreamFMP4(const function<void()> &cb) {
         weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
         fmp4_src->pause(false);
         _fmp4_reader = fmp4_src->getRing()->attach(getPoller());
+        auto cpu_stat = StreamCpuStat::get(*fmp4_src);
+        auto tracer = FrameTracer::get(*fmp4_src);
         _fmp4_reader->setGetInfoCB([weak_self]() {
             Any ret;
             ret.set(static_pointer_cast<Session>(weak_self.lock()));
@@ -406,16 +410,20 @@ bool HttpSession::checkLiveStreamFMP4(const function<void()> &cb) {
             }
             strong_self->shutdown(SockException(Err_shutdown, "fmp4 ring buffer detached"));
         });
-        _fmp4_reader->setReadCB([weak_self](const FMP4MediaSource::RingDataType &fmp4_list) {
+        _fmp4_reader->setReadCB([weak_self, cpu_stat, tracer](const FMP4MediaSource::RingDataType &fmp4_list) {
             auto strong_self = weak_self.lock();
             if (!strong_self) {
                 // 本对象已经销毁  [AUTO-TRANSLATED:713e0f23]
                 // This object has been destroyed
                 return;
             }
+            CpuTimeScope cpu_scope(cpu_stat, CpuStage::send);
             size_t i = 0;
             auto size = fmp4_list->size();
             fmp4_list->for_each([&](const FMP4Packet::Ptr &ts) { strong_self->onWrite(ts, ++i == size); });
+            if (tracer && tracer->enabled()) {
+                fmp4_list->for_each([&](const FMP4Packet::Ptr &fmp4) { tracer->onSend(fmp4->time_stamp, "http-fmp4"); });
+            }
         });
     });
 }
@@ -442,6 +450,8 @@ bool HttpSession::checkLiveStreamTS(const function<void()> &cb) {
         weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
         ts_src->pause(false);
         _ts_reader = ts_src->getRing()->attach(getPoller());
+        auto cpu_stat = StreamCpuStat::get(*ts_src);
+        auto tracer = FrameTracer::get(*ts_src);
         _ts_reader->setGetInfoCB([weak_self]() {
             Any ret;
             ret.set(static_pointer_cast<Session>(weak_self.lock()));
@@ -456,16 +466,20 @@ bool HttpSession::checkLiveStreamTS(const function<void()> &cb) {
             }
             strong_self->shutdown(SockException(Err_shutdown, "ts ring buffer detached"));
         });
-        _ts_reader->setReadCB([weak_self](const TSMediaSource::RingDataType &ts_list) {
+        _ts_reader->setReadCB([weak_self, cpu_stat, tracer](const TSMediaSource::RingDataType &ts_list) {
             auto strong_self = weak_self.lock();
             if (!strong_self) {
                 // 本对象已经销毁  [AUTO-TRANSLATED:713e0f23]
                 // This object has been destroyed
                 return;
             }
+            CpuTimeScope cpu_scope(cpu_stat, CpuStage::send);
             size_t i = 0;
             auto size = ts_list->size();
             ts_list->for_each([&](const TSPacket::Ptr &ts) { strong_self->onWrite(ts, ++i == size); });
+            if (tracer && tracer->enabled()) {
+                ts_list->for_each([&](const TSPacket::Ptr &ts) { tracer->onSend(ts->time_stamp, "http-ts"); });
+            }
         });
     });
 }
@@ -773,10 +787,12 @@ void HttpSession::sendResponse(int code,
 }
 
 void HttpSession::urlDecode(Parser &parser) {
-    parser.setUrl(strCoding::UrlDecodePath(parser.url()));
-    for (auto &pr : _parser.getUrlArgs()) {
-        const_cast<string &>(pr.second) = strCoding::UrlDecodeComponent(pr.second);
+    if (parser.url().find('%') != string::npos) {
+        parser.setUrl(strCoding::UrlDecodePath(parser.url()));
     }
+    // url参数延时到被访问时才解析并解码
+    // Url parameters are parsed and decoded only when they are accessed
+    parser.setUrlArgsDecode(true);
 }
 
 bool HttpSession::emitHttpEvent(bool doInvoke) {
@@ -840,6 +856,14 @@ void HttpSession::setSocketFlags() {
     }
 }
 
+void HttpSession::startStreamResponse(const char *content_type, const KeyValue &header) {
+    sendResponse(200, false, content_type, header, nullptr, true);
+}
+
+void HttpSession::sendStreamData(const Buffer::Ptr &data) {
+    onWrite(data, true);
+}
+
 void HttpSession::onWrite(const Buffer::Ptr &buffer, bool flush) {
     if (flush) {
         // 需要flush那么一次刷新缓存  [AUTO-TRANSLATED:8d1ec961]
@@ -872,6 +896,25 @@ void HttpSession::onWebSocketEncodeData(Buffer::Ptr buffer) {
     send(std::move(buffer));
 }
 
+void HttpSession::onWebSocketEncodeFrame(Buffer::Ptr header, Buffer::Ptr payload) {
+    if (!payload || !payload->size()) {
+        onWebSocketEncodeData(std::move(header));
+        return;
+    }
+    // 帧头先放入发送缓存，与负载数据一起通过一次writev/sendmsg发送，负载数据无需拷贝
+    // The frame header is put into the send buffer first, and sent together with the payload by one writev/sendmsg, without copying the payload
+    auto flush_flag = _send_flush_flag;
+    toolkit::Session::setSendFlushFlag(false);
+    onWebSocketEncodeData(std::move(header));
+    toolkit::Session::setSendFlushFlag(flush_flag);
+    onWebSocketEncodeData(std::move(payload));
+}
+
+void HttpSession::setSendFlushFlag(bool try_flush) {
+    _send_flush_flag = try_flush;
+    toolkit::Session::setSendFlushFlag(try_flush);
+}
+
 void HttpSession::onWebSocketDecodeComplete(const WebSocketHeader &header_in) {
     WebSocketHeader &header = const_cast<WebSocketHeader &>(header_in);
     header._mask_flag = false;
@@ -895,4 +938,9 @@ std::shared_ptr<FlvMuxer> HttpSession::getSharedPtr() {
     return dynamic_pointer_cast<FlvMuxer>(shared_from_this());
 }
 
+size_t HttpSession::getSendQueueSize() const {
+    auto sock = getSock();
+    return sock ? sock->getSendBufferCount() : 0;
+}
+
 } /* namespace mediakit */
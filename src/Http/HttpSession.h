@@ -52,11 +52,27 @@ public:
     void setTimeoutSec(size_t second);
     void setMaxReqSize(size_t max_req_size);
 
+    /**
+     * 发送不定长的流式回复头(例如Server-Sent Events)，之后通过sendStreamData推送数据，须在本对象poller线程调用
+     * @param content_type 回复的Content-Type
+     * @param header 额外的回复头
+     * Send the header of an unbounded streaming response (such as Server-Sent Events),
+     * push data with sendStreamData afterwards, must be called in the poller thread of this session
+     */
+    void startStreamResponse(const char *content_type, const KeyValue &header = KeyValue());
+
+    /**
+     * 推送流式回复数据，须在本对象poller线程调用
+     * Push data of the streaming response, must be called in the poller thread of this session
+     */
+    void sendStreamData(const toolkit::Buffer::Ptr &data);
+
 protected:
     //FlvMuxer override
     void onWrite(const toolkit::Buffer::Ptr &data, bool flush) override ;
     void onDetach() override;
     std::shared_ptr<FlvMuxer> getSharedPtr() override;
+    size_t getSendQueueSize() const override;
 
     //HttpRequestSplitter override
     ssize_t onRecvHeader(const char *data,size_t len) override;
@@ -114,6 +130,18 @@ protected:
      */
     void onWebSocketEncodeData(toolkit::Buffer::Ptr buffer) override;
 
+    /**
+     * 帧头不立即刷新，与负载数据合并为一次写操作
+     * The frame header is not flushed immediately, it is merged with the payload into one write
+     */
+    void onWebSocketEncodeFrame(toolkit::Buffer::Ptr header, toolkit::Buffer::Ptr payload) override;
+
+    /**
+     * 设置发送是否立即刷新，并记录该状态以便临时修改后恢复
+     * Set whether sending flushes immediately, and record it so that it can be restored after temporary changes
+     */
+    void setSendFlushFlag(bool try_flush);
+
     /**
      * 接收到完整的一个webSocket数据包后回调
      * @param header 数据包包头
@@ -159,6 +187,7 @@ private:
     bool _is_live_stream = false;
     bool _live_over_websocket = false;
     bool _is_websocket = false;
+    bool _send_flush_flag = true;
     // 超时时间  [AUTO-TRANSLATED:f15e2672]
     // Timeout
     size_t _keep_alive_sec = 0;
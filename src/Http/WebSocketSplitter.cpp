@@ -9,12 +9,24 @@
  */
 
 #include "WebSocketSplitter.h"
+#include <cstring>
 #include <sys/types.h>
 #if !defined(_WIN32)
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #endif //!defined(_WIN32)
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WS_MASK_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define WS_MASK_NEON
+#endif
+
 #include "Util/logger.h"
 #include "Util/util.h"
 
@@ -144,18 +156,62 @@ begin_decode:
     _remain_data.clear();
 }
 
+void WebSocketSplitter::applyMask(uint8_t *data, size_t len, const uint8_t *mask, size_t offset) {
+    // 按偏移旋转掩码，使m[0]对应data[0]；后续每次处理4字节的整数倍，掩码相位保持不变
+    // Rotate the mask by offset so that m[0] corresponds to data[0]; multiples of 4 bytes are processed each time, so the mask phase is kept
+    uint8_t m[4] = { mask[offset % 4], mask[(offset + 1) % 4], mask[(offset + 2) % 4], mask[(offset + 3) % 4] };
+    uint32_t mask32;
+    memcpy(&mask32, m, 4);
+    size_t i = 0;
+#if defined(__AVX2__)
+    auto mask256 = _mm256_set1_epi32((int)mask32);
+    for (; i + 32 <= len; i += 32) {
+        auto v = _mm256_loadu_si256((const __m256i *)(data + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_xor_si256(v, mask256));
+    }
+#endif
+#if defined(WS_MASK_SSE2)
+    auto mask128 = _mm_set1_epi32((int)mask32);
+    for (; i + 16 <= len; i += 16) {
+        auto v = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(v, mask128));
+    }
+#elif defined(WS_MASK_NEON)
+    auto mask128 = vreinterpretq_u8_u32(vdupq_n_u32(mask32));
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), mask128));
+    }
+#endif
+    uint64_t mask64 = ((uint64_t)mask32 << 32) | mask32;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= mask64;
+        memcpy(data + i, &v, 8);
+    }
+    for (; i < len; ++i) {
+        data[i] ^= m[i % 4];
+    }
+}
+
 void WebSocketSplitter::onPayloadData(uint8_t *data, size_t len) {
     if(_mask_flag){
-        for(size_t i = 0; i < len ; ++i,++data){
-            *(data) ^= _mask[(i + _mask_offset) % 4];
-        }
+        applyMask(data, len, _mask.data(), _mask_offset);
         _mask_offset = (_mask_offset + len) % 4;
     }
-    onWebSocketDecodePayload(*this, _mask_flag ? data - len : data, len, _payload_offset);
+    onWebSocketDecodePayload(*this, data, len, _payload_offset);
+}
+
+void WebSocketSplitter::onWebSocketEncodeFrame(Buffer::Ptr header, Buffer::Ptr payload) {
+    onWebSocketEncodeData(std::move(header));
+    if (payload && payload->size()) {
+        onWebSocketEncodeData(std::move(payload));
+    }
 }
 
 void WebSocketSplitter::encode(const WebSocketHeader &header,const Buffer::Ptr &buffer) {
     string ret;
+    ret.reserve(14);
     uint64_t len = buffer ? buffer->size() : 0;
     uint8_t byte = header._fin << 7 | ((header._reserved & 0x07) << 4) | (header._opcode & 0x0F) ;
     ret.push_back(byte);
@@ -185,18 +241,10 @@ void WebSocketSplitter::encode(const WebSocketHeader &header,const Buffer::Ptr &
         ret.append((char *)header._mask.data(),4);
     }
 
-    onWebSocketEncodeData(std::make_shared<BufferString>(std::move(ret)));
-
-    if(len > 0){
-        if(mask_flag){
-            uint8_t *ptr = (uint8_t*)buffer->data();
-            for(size_t i = 0; i < len ; ++i,++ptr){
-                *(ptr) ^= header._mask[i % 4];
-            }
-        }
-        onWebSocketEncodeData(buffer);
+    if (len > 0 && mask_flag) {
+        applyMask((uint8_t *)buffer->data(), len, header._mask.data(), 0);
     }
-
+    onWebSocketEncodeFrame(std::make_shared<BufferString>(std::move(ret)), len > 0 ? buffer : nullptr);
 }
 
 
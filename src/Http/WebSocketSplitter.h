@@ -103,11 +103,11 @@ public:
 
     /**
      * 编码一个数据包
-     * 将触发2次onWebSocketEncodeData回调
+     * 将触发onWebSocketEncodeFrame回调
      * @param header 数据头
      * @param buffer 负载数据
      * Encode a data packet
-     * Will trigger 2 onWebSocketEncodeData callbacks
+     * Will trigger the onWebSocketEncodeFrame callback
      * @param header Data header
      * @param buffer Payload data
      
@@ -165,6 +165,32 @@ protected:
      */
     virtual void onWebSocketEncodeData(toolkit::Buffer::Ptr buffer){};
 
+    /**
+     * websocket帧编码回调，帧头与负载分开回调以免拷贝负载数据
+     * 默认依次触发onWebSocketEncodeData，子类可以重载本函数把两者合并为一次写操作
+     * @param header 帧头
+     * @param payload 负载数据，可能为空
+     * websocket frame encoding callback, header and payload are passed separately to avoid copying the payload
+     * By default onWebSocketEncodeData is triggered in turn, subclasses can override it to merge them into one write
+     * @param header Frame header
+     * @param payload Payload data, may be null
+     */
+    virtual void onWebSocketEncodeFrame(toolkit::Buffer::Ptr header, toolkit::Buffer::Ptr payload);
+
+    /**
+     * 对数据进行websocket掩码运算
+     * @param data 数据指针，原地修改
+     * @param len 数据长度
+     * @param mask 4字节掩码
+     * @param offset 本段数据在负载中的偏移
+     * Apply the websocket mask to the data
+     * @param data Data pointer, modified in place
+     * @param len Data length
+     * @param mask 4-byte mask
+     * @param offset Offset of this data in the payload
+     */
+    static void applyMask(uint8_t *data, size_t len, const uint8_t *mask, size_t offset);
+
 private:
     void onPayloadData(uint8_t *data, size_t len);
 
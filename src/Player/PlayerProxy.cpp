@@ -101,6 +101,10 @@ static int getMaxTrackSize(const std::string &url) {
     return 2;
 }
 
+static void emitProxyStatus(const MediaTuple &tuple, const string &url, const string &status, const SockException &ex) {
+    NOTICE_EMIT(BroadcastPlayerProxyStatusArgs, Broadcast::kBroadcastPlayerProxyStatus, tuple, url, status, ex);
+}
+
 void PlayerProxy::play(const string &strUrlTmp) {
     _option.max_track = getMaxTrackSize(strUrlTmp);
     weak_ptr<PlayerProxy> weakSelf = shared_from_this();
@@ -128,16 +132,19 @@ void PlayerProxy::play(const string &strUrlTmp) {
             strongSelf->onPlaySuccess();
             strongSelf->setTranslationInfo();
             strongSelf->_on_connect(strongSelf->_transtalion_info);  
+            emitProxyStatus(strongSelf->_tuple, strUrlTmp, "playing", err);
 
             InfoL << "play " << strUrlTmp << " success";
         } else if (*piFailedCnt < strongSelf->_retry_count || strongSelf->_retry_count < 0) {
             // 播放失败，延时重试播放  [AUTO-TRANSLATED:d7537c9c]
             // Play failed, retry playing with delay
             strongSelf->_on_disconnect();
+            emitProxyStatus(strongSelf->_tuple, strUrlTmp, "retrying", err);
             strongSelf->rePlay(strUrlTmp, (*piFailedCnt)++);
         } else {
             // 达到了最大重试次数，回调关闭  [AUTO-TRANSLATED:610f31f3]
             // Reached the maximum number of retries, callback to close
+            emitProxyStatus(strongSelf->_tuple, strUrlTmp, "closed", err);
             strongSelf->_on_close(err);
         }
     });
@@ -177,10 +184,12 @@ void PlayerProxy::play(const string &strUrlTmp) {
         // Play interrupted abnormally, retry playing with delay
         if (*piFailedCnt < strongSelf->_retry_count || strongSelf->_retry_count < 0) {
             strongSelf->_repull_count++;
+            emitProxyStatus(strongSelf->_tuple, strUrlTmp, "retrying", err);
             strongSelf->rePlay(strUrlTmp, (*piFailedCnt)++);
         } else {
             // 达到了最大重试次数，回调关闭  [AUTO-TRANSLATED:610f31f3]
             // Reached the maximum number of retries, callback to close
+            emitProxyStatus(strongSelf->_tuple, strUrlTmp, "closed", err);
             strongSelf->_on_close(err);
         }
     });
@@ -16,6 +16,7 @@
 #include "Util/uv_errno.h"
 #include "Util/File.h"
 #include "Common/config.h"
+#include "Http/HttpBody.h"
 
 using namespace std;
 using namespace toolkit;
@@ -62,6 +63,7 @@ void HlsMakerImp::clearCache() {
 
 static void clearHls(const std::list<std::string> &files) {
     for (auto &file : files) {
+        HttpFileCache::Instance().invalidate(file);
         File::delete_file(file);
     }
     File::deleteEmptyDir(File::parentDir(files.back()));
@@ -188,6 +190,7 @@ void HlsMakerImp::onDelSegment(uint64_t index) {
     if (it == _segment_file_paths.end()) {
         return;
     }
+    HttpFileCache::Instance().invalidate(it->second);
     File::delete_file(it->second.data(), true);
     _segment_file_paths.erase(it);
 }
@@ -245,6 +248,9 @@ void HlsMakerImp::onFlushLastSegment(uint64_t duration_ms) {
 }
 
 std::shared_ptr<FILE> HlsMakerImp::makeFile(const string &file, bool setbuf) {
+    // 文件将被重写，使http文件缓存失效
+    // The file will be rewritten, invalidate the http file cache
+    HttpFileCache::Instance().invalidate(file);
     auto file_buf = _file_buf;
     auto ret = shared_ptr<FILE>(File::create_file(file.data(), "wb"), [file_buf](FILE *fp) {
         if (fp) {
@@ -480,9 +480,13 @@ FCI_TWCC::TwccPacketStatus FCI_TWCC::getPacketChunkList(size_t total_size) const
         }
         ptr += 2;
     }
-    for (auto &pr : ret) {
+    // recv delta须按序号顺序读取，seq回环时map的遍历顺序与之不同
+    // Recv deltas must be read in sequence order, which differs from the map order when seq wraps around
+    seq = getBaseSeq();
+    for (uint16_t i = 0; i < rtp_count; ++i, ++seq) {
         CHECK(ptr <= end);
-        pr.second.second = getRecvDelta(pr.second.first, ptr, end);
+        auto &pr = ret[seq];
+        pr.second = getRecvDelta(pr.first, ptr, end);
     }
     return ret;
 }
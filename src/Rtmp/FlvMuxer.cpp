@@ -12,6 +12,8 @@
 #include "Util/File.h"
 #include "Rtmp/utils.h"
 #include "Http/HttpSession.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 
 
 using namespace std;
@@ -60,14 +62,19 @@ void FlvMuxer::start(const EventPoller::Ptr &poller, const RtmpMediaSource::Ptr
     });
 
     bool check = start_pts > 0;
-    _ring_reader->setReadCB([weak_self, start_pts, check](const RtmpMediaSource::RingDataType &pkt) mutable {
+    auto cpu_stat = StreamCpuStat::get(*media);
+    auto tracer = FrameTracer::get(*media);
+    _ring_reader->setReadCB([weak_self, start_pts, check, cpu_stat, tracer](const RtmpMediaSource::RingDataType &pkt) mutable {
         auto strong_self = weak_self.lock();
         if (!strong_self) {
             return;
         }
+        CpuTimeScope cpu_scope(cpu_stat, CpuStage::send);
+        strong_self->_thinner.updateBySendQueue(strong_self->getSendQueueSize());
 
-        size_t i = 0;
-        auto size = pkt->size();
+        // 延后一个包写入，确保最后写入的包带flush标记
+        // Write one packet behind so the last one written carries the flush flag
+        RtmpPacket::Ptr last;
         pkt->for_each([&](const RtmpPacket::Ptr &rtmp) {
             if (check) {
                 if (rtmp->time_stamp < start_pts) {
@@ -75,8 +82,20 @@ void FlvMuxer::start(const EventPoller::Ptr &poller, const RtmpMediaSource::Ptr
                 }
                 check = false;
             }
-            strong_self->onWriteRtmp(rtmp, ++i == size);
+            if (strong_self->_thinner.dropRtmp(rtmp)) {
+                return;
+            }
+            if (last) {
+                strong_self->onWriteRtmp(last, false);
+            }
+            last = rtmp;
         });
+        if (last) {
+            strong_self->onWriteRtmp(last, true);
+        }
+        if (tracer && tracer->enabled()) {
+            pkt->for_each([&](const RtmpPacket::Ptr &rtmp) { tracer->onSend(rtmp->time_stamp, "flv"); });
+        }
     });
 }
 
@@ -13,6 +13,7 @@
 
 #include "Rtmp/Rtmp.h"
 #include "Rtmp/RtmpMediaSource.h"
+#include "Common/FrameThinner.h"
 #include "Poller/EventPoller.h"
 
 namespace mediakit {
@@ -30,6 +31,9 @@ protected:
     virtual void onWrite(const toolkit::Buffer::Ptr &data, bool flush) = 0;
     virtual void onDetach() = 0;
     virtual std::shared_ptr<FlvMuxer> getSharedPtr() = 0;
+    // 待发送的数据包个数，用于判断是否需要抽帧，录制等场景返回0
+    // Packets waiting to be sent, used to decide frame thinning, 0 for recording and the like
+    virtual size_t getSendQueueSize() const { return 0; }
 
 private:
     void onWriteFlvHeader(const RtmpMediaSource::Ptr &src);
@@ -42,6 +46,7 @@ private:
 private:
     toolkit::ResourcePool<toolkit::BufferRaw> _packet_pool;
     RtmpMediaSource::RingType::RingReader::Ptr _ring_reader;
+    FrameThinner _thinner;
 };
 
 class FlvRecorder : public FlvMuxer , public std::enable_shared_from_this<FlvRecorder>{
@@ -1,5 +1,7 @@
 ﻿#include "RtmpDemuxer.h"
 #include "RtmpMediaSourceImp.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 
 namespace mediakit {
 
@@ -111,6 +113,8 @@ void RtmpMediaSourceImp::onWrite(RtmpPacket::Ptr pkt, bool /*= true*/) {
     if (!_all_track_ready || _muxer->isEnabled()) {
         // 未获取到所有Track后，或者开启转协议，那么需要解复用rtmp  [AUTO-TRANSLATED:76f6f56e]
         // If all Tracks are not obtained, or protocol conversion is enabled, then demultiplexing rtmp is required
+        CpuTimeScope cpu_scope(_muxer ? _muxer->getCpuStat() : nullptr, CpuStage::demux);
+        FrameTraceIngest trace_ingest;
         _demuxer->inputRtmp(pkt);
     }
     GET_CONFIG(bool, directProxy, Rtmp::kDirectProxy);
@@ -10,6 +10,8 @@
 
 #include "RtmpSession.h"
 #include "Common/config.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 #include "Util/onceToken.h"
 
 using namespace std;
@@ -305,26 +307,42 @@ void RtmpSession::sendPlayResponse(const string &err, const RtmpMediaSource::Ptr
 
     src->pause(false);
     _ring_reader = src->getRing()->attach(getPoller());
+    auto cpu_stat = StreamCpuStat::get(*src);
+    auto tracer = FrameTracer::get(*src);
     weak_ptr<RtmpSession> weak_self = static_pointer_cast<RtmpSession>(shared_from_this());
     _ring_reader->setGetInfoCB([weak_self]() {
         Any ret;
         ret.set(static_pointer_cast<Session>(weak_self.lock()));
         return ret;
     });
-    _ring_reader->setReadCB([weak_self](const RtmpMediaSource::RingDataType &pkt) {
+    _ring_reader->setReadCB([weak_self, cpu_stat, tracer](const RtmpMediaSource::RingDataType &pkt) {
         auto strong_self = weak_self.lock();
         if (!strong_self) {
             return;
         }
+        CpuTimeScope cpu_scope(cpu_stat, CpuStage::send);
+        strong_self->_thinner.updateBySendQueue(strong_self->getSock()->getSendBufferCount());
         size_t i = 0;
         auto size = pkt->size();
+        bool dropped = false;
         strong_self->setSendFlushFlag(false);
         pkt->for_each([&](const RtmpPacket::Ptr &rtmp){
             if(++i == size){
                 strong_self->setSendFlushFlag(true);
             }
-            strong_self->onSendMedia(rtmp);
+            dropped = strong_self->_thinner.dropRtmp(rtmp);
+            if (!dropped) {
+                strong_self->onSendMedia(rtmp);
+            }
         });
+        if (dropped) {
+            // 最后一个包被丢弃，刷新此前缓存的数据
+            // The last packet was dropped, flush the data buffered before it
+            strong_self->flushAll();
+        }
+        if (tracer && tracer->enabled()) {
+            pkt->for_each([&](const RtmpPacket::Ptr &rtmp) { tracer->onSend(rtmp->time_stamp, "rtmp"); });
+        }
     });
     _ring_reader->setDetachCB([weak_self]() {
         auto strong_self = weak_self.lock();
@@ -17,6 +17,7 @@
 #include "utils.h"
 #include "RtmpProtocol.h"
 #include "RtmpMediaSourceImp.h"
+#include "Common/FrameThinner.h"
 #include "Util/TimeTicker.h"
 #include "Network/Session.h"
 
@@ -109,6 +110,9 @@ private:
     RtmpMediaSourceImp::Ptr _push_src;
     std::shared_ptr<void> _push_src_ownership;
     RtmpMediaSource::RingType::RingReader::Ptr _ring_reader;
+    // 发送队列堆积时丢弃不被参考的帧
+    // Drop frames nobody references when the send queue piles up
+    FrameThinner _thinner;
 };
 
 /**
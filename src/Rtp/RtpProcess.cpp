@@ -13,6 +13,8 @@
 #include "RtpProcess.h"
 #include "Util/File.h"
 #include "Common/config.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 
 using namespace std;
 using namespace toolkit;
@@ -142,6 +144,8 @@ bool RtpProcess::inputRtp(bool is_udp, const Socket::Ptr &sock, const char *data
         return false;
     }
 
+    CpuTimeScope cpu_scope(_muxer ? _muxer->getCpuStat() : nullptr, CpuStage::demux);
+    FrameTraceIngest trace_ingest;
     bool ret = _process ? _process->inputRtp(is_udp, data, len) : false;
     if (dts_out) {
         *dts_out = _dts;
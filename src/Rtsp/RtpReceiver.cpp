@@ -30,6 +30,16 @@ void RtpTrack::clear() {
 }
 
 RtpPacket::Ptr RtpTrack::inputRtp(TrackType type, int sample_rate, uint8_t *ptr, size_t len) {
+    auto rtp = decodeRtp(type, sample_rate, ptr, len);
+    if (!rtp) {
+        return rtp;
+    }
+    onBeforeRtpSorted(rtp);
+    sortPacket(rtp->getSeq(), rtp);
+    return rtp;
+}
+
+RtpPacket::Ptr RtpTrack::decodeRtp(TrackType type, int sample_rate, uint8_t *ptr, size_t len) {
     if (len < RtpPacket::kRtpHeaderSize) {
         throw BadRtpException("rtp size less than 12");
     }
@@ -114,8 +124,6 @@ RtpPacket::Ptr RtpTrack::inputRtp(TrackType type, int sample_rate, uint8_t *ptr,
         // Set NTP timestamp
         rtp->ntp_stamp = _ntp_stamp.getNtpStamp(rtp->getStamp(), sample_rate);
     }
-    onBeforeRtpSorted(rtp);
-    sortPacket(rtp->getSeq(), rtp);
     return rtp;
 }
 
@@ -268,6 +268,12 @@ protected:
     virtual void onRtpSorted(RtpPacket::Ptr rtp) {}
     virtual void onBeforeRtpSorted(const RtpPacket::Ptr &rtp) {}
 
+    /**
+     * 校验并解析rtp(锁定pt与ssrc、生成ntp时间戳)，但不进入排序器
+     * Validate and decode the rtp (locks the pt and ssrc, generates the ntp stamp) without feeding the sorter
+     */
+    RtpPacket::Ptr decodeRtp(TrackType type, int sample_rate, uint8_t *ptr, size_t len);
+
 private:
     bool _disable_ntp = false;
     uint8_t _pt = 0xFF;
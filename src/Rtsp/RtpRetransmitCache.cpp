@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "RtpRetransmitCache.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 不超过seq空间的一半，避免seq回环后新旧包落在同一位置时无法区分
+// No more than half of the seq space, so old and new packets sharing a slot after wrap around stay distinguishable
+static constexpr size_t kMaxCacheSize = 0x8000;
+
+RtpRetransmitCache::RtpRetransmitCache(size_t max_size, uint32_t max_ms) {
+    size_t size = 1;
+    while (size < max_size && size < kMaxCacheSize) {
+        size <<= 1;
+    }
+    _mask = size - 1;
+    _max_ms = max_ms;
+}
+
+void RtpRetransmitCache::input(const RtpPacket::Ptr &rtp) {
+    if (rtp->type < 0 || rtp->type >= TrackMax) {
+        return;
+    }
+    auto packet = rtp;
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto &track = _tracks[rtp->type];
+        if (track.packets.empty()) {
+            track.packets.resize(_mask + 1);
+        }
+        track.newest_ms = rtp->getStampMS();
+        // 被替换的旧包在锁外释放
+        // The replaced packet is released outside of the lock
+        track.packets[rtp->getSeq() & _mask].swap(packet);
+    }
+}
+
+RtpPacket::Ptr RtpRetransmitCache::get(TrackType type, uint16_t seq) const {
+    if (type < 0 || type >= TrackMax) {
+        return nullptr;
+    }
+    lock_guard<mutex> lck(_mtx);
+    auto &track = _tracks[type];
+    if (track.packets.empty()) {
+        return nullptr;
+    }
+    auto &rtp = track.packets[seq & _mask];
+    if (!rtp || rtp->getSeq() != seq) {
+        return nullptr;
+    }
+    auto stamp = rtp->getStampMS();
+    if (track.newest_ms > stamp && track.newest_ms - stamp > _max_ms) {
+        return nullptr;
+    }
+    return rtp;
+}
+
+} // namespace mediakit
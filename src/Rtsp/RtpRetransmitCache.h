@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RTPRETRANSMITCACHE_H
+#define ZLMEDIAKIT_RTPRETRANSMITCACHE_H
+
+#include <mutex>
+#include <vector>
+#include <memory>
+#include "Rtsp.h"
+
+namespace mediakit {
+
+/**
+ * 按seq索引的rtp重传环形缓存，由媒体源写入，同一源的所有播放器只读共享；
+ * 每个轨道一个长度为2的幂的数组，按seq取模定位，查找为O(1)
+ * Seq indexed rtp retransmission ring, written by the media source and shared read-only by all its players;
+ * every track has an array with power of two length indexed by seq modulo the length, lookups are O(1)
+ */
+class RtpRetransmitCache {
+public:
+    using Ptr = std::shared_ptr<RtpRetransmitCache>;
+
+    /**
+     * @param max_size 每个轨道最多缓存的rtp个数，向上取整为2的幂
+     * @param max_ms 最长缓存时间，单位毫秒
+     * @param max_size Max rtp packets cached per track, rounded up to a power of two
+     * @param max_ms Max cache duration in milliseconds
+     */
+    RtpRetransmitCache(size_t max_size, uint32_t max_ms);
+
+    void input(const RtpPacket::Ptr &rtp);
+
+    /**
+     * 查找某轨道某seq的rtp，不存在或已过期时返回nullptr
+     * Find the rtp of a seq on a track, nullptr if absent or expired
+     */
+    RtpPacket::Ptr get(TrackType type, uint16_t seq) const;
+
+private:
+    struct Track {
+        uint64_t newest_ms = 0;
+        std::vector<RtpPacket::Ptr> packets;
+    };
+
+    size_t _mask;
+    uint32_t _max_ms;
+    mutable std::mutex _mtx;
+    Track _tracks[TrackMax];
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RTPRETRANSMITCACHE_H
@@ -17,6 +17,7 @@
 #include <functional>
 #include "Common/MediaSource.h"
 #include "Common/PacketCache.h"
+#include "RtpRetransmitCache.h"
 #include "Util/RingBuffer.h"
 
 #define RTP_GOP_SIZE 512
@@ -177,6 +178,24 @@ public:
      */
     void onWrite(RtpPacket::Ptr rtp, bool keyPos) override;
 
+    /**
+     * 获取各播放器共享的rtp重传缓存，首次调用时创建，此后写入的每个rtp包都会进入该缓存；线程安全
+     * @param max_size 每个轨道最多缓存的rtp个数，仅首次调用时有效
+     * @param max_ms 最长缓存时间，单位毫秒，仅首次调用时有效
+     * Get the rtp retransmission cache shared by all players, created on the first call,
+     * every rtp packet written afterwards goes into it; thread safe
+     * @param max_size Max rtp packets cached per track, only effective on the first call
+     * @param max_ms Max cache duration in milliseconds, only effective on the first call
+     */
+    RtpRetransmitCache::Ptr getRetransmitCache(size_t max_size, uint32_t max_ms) {
+        std::lock_guard<std::mutex> lck(_rtx_cache_mtx);
+        if (!_rtx_cache) {
+            _rtx_cache = std::make_shared<RtpRetransmitCache>(max_size, max_ms);
+            _rtx_cache_enabled = true;
+        }
+        return _rtx_cache;
+    }
+
     void clearCache() override{
         PacketCache<RtpPacket>::clearCache();
         _ring->clearCache();
@@ -205,6 +224,11 @@ private:
     std::string _sdp;
     RingType::Ptr _ring;
     SdpTrack::Ptr _tracks[TrackMax];
+    // 重传缓存创建后不再改变，写入线程通过_rtx_cache_enabled判断是否已创建
+    // The retransmission cache never changes once created, the writing thread checks _rtx_cache_enabled
+    std::atomic<bool> _rtx_cache_enabled { false };
+    std::mutex _rtx_cache_mtx;
+    RtpRetransmitCache::Ptr _rtx_cache;
 };
 
 } /* namespace mediakit */
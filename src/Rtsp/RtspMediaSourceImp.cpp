@@ -1,6 +1,8 @@
 ﻿#include "RtspMediaSourceImp.h"
 #include "RtspDemuxer.h"
 #include "Common/config.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 namespace mediakit {
 void RtspMediaSource::setSdp(const std::string &sdp) {
     SdpParser sdp_parser(sdp);
@@ -79,6 +81,9 @@ void RtspMediaSource::onWrite(RtpPacket::Ptr rtp, bool keyPos) {
             regist();
         }
     }
+    if (_rtx_cache_enabled) {
+        _rtx_cache->input(rtp);
+    }
    
     PacketCache<RtpPacket>::inputPacket(stamp, is_video, std::move(rtp), keyPos);
 }
@@ -109,6 +114,8 @@ void RtspMediaSourceImp::onWrite(RtpPacket::Ptr rtp, bool key_pos)
     } else {
         // 需要解复用rtp  [AUTO-TRANSLATED:0deaf9f1]
         // Need to demultiplex rtp
+        CpuTimeScope cpu_scope(_muxer ? _muxer->getCpuStat() : nullptr, CpuStage::demux);
+        FrameTraceIngest trace_ingest;
         key_pos = _demuxer->inputRtp(rtp);
     }
     GET_CONFIG(bool, directProxy, Rtsp::kDirectProxy);
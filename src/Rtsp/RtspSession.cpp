@@ -11,6 +11,8 @@
 #include <atomic>
 #include <iomanip>
 #include "Common/config.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 #include "UDPServer.h"
 #include "RtspSession.h"
 #include "Util/MD5.h"
@@ -126,7 +128,7 @@ void RtspSession::onRecv(const Buffer::Ptr &buf) {
 }
 
 void RtspSession::onWholeRtspPacket(Parser &parser) {
-    string method = parser.method(); //提取出请求命令字
+    auto &method = parser.method(); //提取出请求命令字
     _cseq = atoi(parser["CSeq"].data());
     if (_content_base.empty() && method != "GET" && method != "POST" ) {
         RtspUrl rtsp;
@@ -861,6 +863,10 @@ void RtspSession::handleReq_Play(const Parser &parser) {
     if (!_play_reader && _rtp_type != Rtsp::RTP_MULTICAST) {
         weak_ptr<RtspSession> weak_self = static_pointer_cast<RtspSession>(shared_from_this());
         _play_reader = play_src->getRing()->attach(getPoller(), use_gop);
+        auto video = play_src->getTrack(TrackVideo, false);
+        _video_codec = video ? video->getCodecId() : CodecInvalid;
+        auto cpu_stat = StreamCpuStat::get(*play_src);
+        auto tracer = FrameTracer::get(*play_src);
         _play_reader->setGetInfoCB([weak_self]() {
             Any ret;
             ret.set(static_pointer_cast<Session>(weak_self.lock()));
@@ -873,12 +879,16 @@ void RtspSession::handleReq_Play(const Parser &parser) {
             }
             strong_self->shutdown(SockException(Err_shutdown, "rtsp ring buffer detached"));
         });
-        _play_reader->setReadCB([weak_self](const RtspMediaSource::RingDataType &pack) {
+        _play_reader->setReadCB([weak_self, cpu_stat, tracer](const RtspMediaSource::RingDataType &pack) {
             auto strong_self = weak_self.lock();
             if (!strong_self) {
                 return;
             }
+            CpuTimeScope cpu_scope(cpu_stat, CpuStage::send);
             strong_self->sendRtpPacket(pack);
+            if (tracer && tracer->enabled()) {
+                pack->for_each([&](const RtpPacket::Ptr &rtp) { tracer->onSend(rtp->getStampMS(false), "rtsp"); });
+            }
         });
     }
 }
@@ -1242,11 +1252,30 @@ void RtspSession::updateRtcpContext(const RtpPacket::Ptr &rtp){
 void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
     switch (_rtp_type) {
         case Rtsp::RTP_TCP: {
+            _thinner.updateBySendQueue(getSock()->getSendBufferCount());
             setSendFlushFlag(false);
             pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+                if (_thinner.dropRtp(_video_codec, rtp)) {
+                    // 被丢弃的帧不被参考，不影响后续解码
+                    // The frames dropped are referenced by nobody so decoding goes on
+                    --_thinned_seq_offset;
+                    return;
+                }
                 if (_target_play_track == TrackInvalid || _target_play_track == rtp->type) {
-                    updateRtcpContext(rtp);
-                    send(rtp);
+                    auto out = rtp;
+                    if (_thinned_seq_offset && rtp->type == TrackVideo) {
+                        // 源rtp被多个播放器共享，改写seq需拷贝
+                        // The source rtp is shared by all players, copy it to rewrite the seq
+                        out = RtpPacket::create();
+                        out->assign(rtp->data(), rtp->size());
+                        out->type = rtp->type;
+                        out->sample_rate = rtp->sample_rate;
+                        out->ntp_stamp = rtp->ntp_stamp;
+                        out->track_index = rtp->track_index;
+                        out->getHeader()->seq = htons((uint16_t)(rtp->getSeq() + _thinned_seq_offset));
+                    }
+                    updateRtcpContext(out);
+                    send(std::move(out));
                 }
             });
             flushAll();
@@ -21,6 +21,7 @@
 #include "RtspMediaSource.h"
 #include "RtspMediaSourceImp.h"
 #include "RtpMultiCaster.h"
+#include "Common/FrameThinner.h"
 
 namespace mediakit {
 
@@ -238,6 +239,13 @@ private:
     // 直播源读取器  [AUTO-TRANSLATED:e1edc193]
     // Live source reader
     RtspMediaSource::RingType::RingReader::Ptr _play_reader;
+    // rtp over tcp时，发送队列堆积则丢弃不被参考的帧
+    // With rtp over tcp, drop frames nobody references when the send queue piles up
+    FrameThinner _thinner;
+    CodecId _video_codec = CodecInvalid;
+    // 已丢弃的视频rtp个数(取负)，后续视频rtp的seq前移以免播放端认为丢包
+    // Negated count of dropped video rtp, later video rtp seqs are shifted so the player does not see a loss
+    uint16_t _thinned_seq_offset = 0;
     // sdp里面有效的track,包含音频或视频  [AUTO-TRANSLATED:64e2fcdf]
     // Valid track in SDP, including audio or video
     std::vector<SdpTrack::Ptr> _sdp_track;
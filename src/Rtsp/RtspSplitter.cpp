@@ -100,7 +100,7 @@ ssize_t RtspSplitter::onRecvHeader(const char *data, size_t len) {
 }
 
 void RtspSplitter::onRecvContent(const char *data, size_t len) {
-    _parser.setContent(string(data,len));
+    _parser.setContent(data, len);
     onWholeRtspPacket(_parser);
     _parser.clear();
 }
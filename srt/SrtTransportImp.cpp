@@ -2,6 +2,8 @@
 #include <memory>
 #include "Common/Parser.h"
 #include "Common/config.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 #include "SrtTransportImp.hpp"
 
 namespace SRT {
@@ -130,6 +132,8 @@ void SrtTransportImp::onSRTData(DataPacket::Ptr pkt) {
         return;
     }
     if (_decoder) {
+        CpuTimeScope cpu_scope(_muxer ? _muxer->getCpuStat() : nullptr, CpuStage::demux);
+        FrameTraceIngest trace_ingest;
         _decoder->input(reinterpret_cast<const uint8_t *>(pkt->payloadData()), pkt->payloadSize());
         //TraceL<<" size "<<pkt->payloadSize();
     } else {
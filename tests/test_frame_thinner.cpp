@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+#include <cstring>
+#include "Util/logger.h"
+#include "Util/NoticeCenter.h"
+#include "Common/config.h"
+#include "Common/macros.h"
+#include "Common/FrameThinner.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static RtpPacket::Ptr makeRtp(uint32_t stamp, const string &payload, TrackType type = TrackVideo) {
+    auto size = RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize + payload.size();
+    auto rtp = RtpPacket::create();
+    rtp->setCapacity(size);
+    rtp->setSize(size);
+    memset(rtp->data(), 0, size);
+    rtp->type = type;
+    rtp->sample_rate = 90000;
+    auto header = rtp->getHeader();
+    header->version = RtpPacket::kRtpVersion;
+    header->stamp = htonl(stamp);
+    memcpy(rtp->getPayload(), payload.data(), payload.size());
+    return rtp;
+}
+
+// h265 nal头：类型与temporal id
+// h265 nal header of a type and temporal id
+static string h265Nal(int type, int tid) {
+    string ret;
+    ret.push_back((char)(type << 1));
+    ret.push_back((char)(tid + 1));
+    ret.append("\x01\x02", 2);
+    return ret;
+}
+
+// h265 sps，仅填充sps_max_sub_layers_minus1
+// h265 sps with only sps_max_sub_layers_minus1 filled
+static string h265Sps(int max_tid) {
+    string ret;
+    ret.push_back((char)(33 << 1));
+    ret.push_back((char)1);
+    ret.push_back((char)((max_tid << 1) | 0x01));
+    ret.push_back((char)0x02);
+    return ret;
+}
+
+static void setConfig(bool enable, size_t queue) {
+    mINI::Instance()[General::kFrameThinning] = enable;
+    mINI::Instance()[General::kFrameThinningQueue] = queue;
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+}
+
+// 按发送队列与带宽估计进入、退出抽帧状态，均带滞回
+// Thinning starts and stops by the send queue and by the bandwidth estimate, both with hysteresis
+static void test_congestion_state() {
+    setConfig(true, 100);
+    FrameThinner thinner;
+    thinner.updateBySendQueue(100);
+    CHECK(!thinner.isThinning());
+    thinner.updateBySendQueue(101);
+    CHECK(thinner.isThinning());
+    thinner.updateBySendQueue(25);
+    CHECK(thinner.isThinning());
+    thinner.updateBySendQueue(24);
+    CHECK(!thinner.isThinning());
+
+    thinner.updateByBitrate(900 * 1000, 1000 * 1000);
+    CHECK(!thinner.isThinning());
+    thinner.updateByBitrate(800 * 1000, 1000 * 1000);
+    CHECK(thinner.isThinning());
+    thinner.updateByBitrate(1000 * 1000, 1000 * 1000);
+    CHECK(thinner.isThinning());
+    thinner.updateByBitrate(1001 * 1000, 1000 * 1000);
+    CHECK(!thinner.isThinning());
+    // 缺少估计值或源码率时保持原状态
+    // The state is kept without an estimate or a source bitrate
+    thinner.updateByBitrate(0, 1000 * 1000);
+    thinner.updateByBitrate(100 * 1000, 0);
+    CHECK(!thinner.isThinning());
+
+    // 关闭抽帧后不再进入抽帧状态
+    // Never thin once disabled
+    setConfig(false, 100);
+    thinner.updateBySendQueue(1000);
+    CHECK(!thinner.isThinning());
+    setConfig(true, 256);
+}
+
+// h264只丢弃nal_ref_idc为0的帧，同一帧的所有rtp一起丢弃
+// H264 drops only frames with nal_ref_idc 0, all rtp of a frame are dropped together
+static void test_h264_rtp() {
+    setConfig(true, 100);
+    FrameThinner thinner;
+    // 未拥塞时不丢帧
+    // Nothing is dropped while not congested
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(0, "\x01\xAA")));
+    thinner.updateBySendQueue(1000);
+    CHECK(thinner.isThinning());
+
+    // 参数集等待首个slice再决定，idr帧与参考帧保留
+    // Parameter sets wait for the first slice, idr and reference frames are kept
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(3000, "\x67\xAA")));
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(3000, "\x65\xAA")));
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(6000, "\x41\xAA")));
+
+    // FU-A分片的非参考帧：首个分片决定，后续分片跟随
+    // A non-reference frame fragmented by FU-A: the first fragment decides and the others follow
+    CHECK(thinner.dropRtp(CodecH264, makeRtp(9000, string("\x1C\x81\xAA", 3))));
+    CHECK(thinner.dropRtp(CodecH264, makeRtp(9000, string("\x1C\x01\xAA", 3))));
+    CHECK(thinner.dropRtp(CodecH264, makeRtp(9000, string("\x1C\x41\xAA", 3))));
+    CHECK(thinner.getDroppedFrames() == 1);
+
+    // STAP-A聚合包取各nal的最高类别
+    // A STAP-A packet takes the highest class of its nals
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(12000, string("\x18\x00\x02\x01\xAA\x00\x02\x41\xAA", 9))));
+    CHECK(thinner.dropRtp(CodecH264, makeRtp(15000, string("\x18\x00\x02\x06\xAA\x00\x02\x01\xAA", 9))));
+    CHECK(thinner.getDroppedFrames() == 2);
+
+    // 音频不受影响
+    // Audio is not affected
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(18000, "\x01\xAA", TrackAudio)));
+
+    // 恢复后不再丢帧
+    // Nothing is dropped after recovery
+    thinner.updateBySendQueue(0);
+    CHECK(!thinner.dropRtp(CodecH264, makeRtp(21000, "\x01\xAA")));
+    CHECK(thinner.getDroppedFrames() == 2);
+    setConfig(true, 256);
+}
+
+// h265只丢弃最高时域层的子层非参考帧
+// H265 drops only sub-layer non-reference pictures of the highest temporal layer
+static void test_h265_rtp() {
+    setConfig(true, 100);
+    FrameThinner thinner;
+    thinner.updateBySendQueue(1000);
+    uint32_t stamp = 0;
+    // 未获取sps前不知道最高时域层，不丢弃
+    // The highest temporal layer is unknown before the sps, nothing is dropped
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Nal(0, 0))));
+
+    // sps声明只有时域层0时，TRAIL_N可以丢弃，TRAIL_R保留
+    // With only temporal layer 0 declared by the sps, TRAIL_N is disposable and TRAIL_R is kept
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Sps(0))));
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp, h265Nal(19, 0))));
+    CHECK(thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Nal(0, 0))));
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Nal(1, 0))));
+
+    // sps声明时域层1后，即使时域层1的帧尚未出现，时域层0的TRAIL_N也可能被参考，不再丢弃
+    // Once the sps declares temporal layer 1, TRAIL_N of layer 0 may be referenced and is kept even before any layer 1 picture shows up
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Sps(1))));
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp, h265Nal(19, 0))));
+    CHECK(!thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Nal(0, 0))));
+    CHECK(thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, h265Nal(0, 1))));
+
+    // FU分片：nal类型取自FU header，temporal id取自payload header
+    // FU fragments: the nal type comes from the FU header and the temporal id from the payload header
+    string fu_start("\x62\x02\x80\xAA", 4);
+    string fu_end("\x62\x02\x40\xAA", 4);
+    CHECK(thinner.dropRtp(CodecH265, makeRtp(stamp += 3000, fu_start)));
+    CHECK(thinner.dropRtp(CodecH265, makeRtp(stamp, fu_end)));
+    CHECK(thinner.getDroppedFrames() == 3);
+    setConfig(true, 256);
+}
+
+// rtmp按4字节长度前缀的nal判断
+// Rtmp is judged by its nals prefixed with 4 bytes length
+static void test_h264_rtmp() {
+    setConfig(true, 100);
+    FrameThinner thinner;
+    auto makeRtmp = [](uint8_t nal) {
+        auto pkt = RtmpPacket::create();
+        pkt->type_id = MSG_VIDEO;
+        // 非关键帧、avc、nalu、cts为0
+        // Inter frame, avc, nalu, cts 0
+        pkt->buffer.append("\x27\x01\x00\x00\x00", 5);
+        pkt->buffer.append("\x00\x00\x00\x02", 4);
+        pkt->buffer.push_back((char)nal);
+        pkt->buffer.push_back((char)0xAA);
+        pkt->body_size = pkt->buffer.size();
+        return pkt;
+    };
+    CHECK(!thinner.dropRtmp(makeRtmp(0x01)));
+    thinner.updateBySendQueue(1000);
+    CHECK(thinner.dropRtmp(makeRtmp(0x01)));
+    CHECK(!thinner.dropRtmp(makeRtmp(0x41)));
+    CHECK(!thinner.dropRtmp(makeRtmp(0x65)));
+
+    // 音频与sequence header不丢弃
+    // Audio and sequence headers are never dropped
+    auto audio = makeRtmp(0x01);
+    audio->type_id = MSG_AUDIO;
+    CHECK(!thinner.dropRtmp(audio));
+    auto config = makeRtmp(0x01);
+    config->data()[1] = 0;
+    CHECK(!thinner.dropRtmp(config));
+    CHECK(thinner.getDroppedFrames() == 1);
+    setConfig(true, 256);
+}
+
+// rtmp h265的时域层数取自sequence header
+// The number of temporal layers of rtmp h265 comes from the sequence header
+static void test_h265_rtmp() {
+    setConfig(true, 100);
+    FrameThinner thinner;
+    thinner.updateBySendQueue(1000);
+    auto makeRtmp = [](const string &nal) {
+        auto pkt = RtmpPacket::create();
+        pkt->type_id = MSG_VIDEO;
+        pkt->buffer.append("\x2C\x01\x00\x00\x00", 5);
+        pkt->buffer.append("\x00\x00\x00", 3);
+        pkt->buffer.push_back((char)nal.size());
+        pkt->buffer.append(nal);
+        pkt->body_size = pkt->buffer.size();
+        return pkt;
+    };
+    CHECK(!thinner.dropRtmp(makeRtmp(h265Nal(0, 0))));
+
+    // HEVCDecoderConfigurationRecord声明2个时域层
+    // HEVCDecoderConfigurationRecord declaring 2 temporal layers
+    auto config = RtmpPacket::create();
+    config->type_id = MSG_VIDEO;
+    config->buffer.append("\x1C\x00\x00\x00\x00", 5);
+    string record(23, '\0');
+    record[0] = 1;
+    record[21] = (char)((2 << 3) | 0x03);
+    config->buffer.append(record);
+    config->body_size = config->buffer.size();
+    CHECK(!thinner.dropRtmp(config));
+
+    CHECK(!thinner.dropRtmp(makeRtmp(h265Nal(0, 0))));
+    CHECK(thinner.dropRtmp(makeRtmp(h265Nal(0, 1))));
+    CHECK(thinner.getDroppedFrames() == 1);
+    setConfig(true, 256);
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_congestion_state();
+        test_h264_rtp();
+        test_h265_rtp();
+        test_h264_rtmp();
+        test_h265_rtmp();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all frame thinner tests passed";
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstdio>
+#include <string>
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/NoticeCenter.h"
+#include "Common/config.h"
+#include "Common/macros.h"
+#include "Http/HttpBody.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static string filePath(int index) {
+    return exeDir() + "test_http_file_cache_" + to_string(index) + ".bin";
+}
+
+static void writeFile(const string &path, size_t size) {
+    auto fp = fopen(path.data(), "wb");
+    CHECK(fp, "open file failed:", path);
+    string data(size, 'a');
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+}
+
+static void setConfig(size_t max_count, size_t max_mb) {
+    mINI::Instance()[Http::kFileCacheMaxCount] = max_count;
+    mINI::Instance()[Http::kFileCacheMaxMB] = max_mb;
+    // 重载配置时缓存同时被清空
+    // The cache is cleared as well when the config is reloaded
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+}
+
+// 命中时返回同一缓存对象，文件变更后重新mmap
+// A hit returns the same entry, the file is mapped again after it changes
+static void test_hit_and_change() {
+    auto &cache = HttpFileCache::Instance();
+    setConfig(16, 16);
+    writeFile(filePath(0), 1024);
+    auto entry = cache.get(filePath(0));
+    CHECK(entry && entry->file_size == 1024);
+    CHECK(!entry->etag.empty() && !entry->last_modified.empty());
+    CHECK(cache.get(filePath(0)) == entry);
+    CHECK(cache.size() == 1 && cache.bytes() == 1024);
+
+    writeFile(filePath(0), 2048);
+    auto changed = cache.get(filePath(0));
+    CHECK(changed && changed != entry && changed->file_size == 2048);
+    CHECK(changed->etag != entry->etag);
+    CHECK(cache.size() == 1 && cache.bytes() == 2048);
+
+    // 被淘汰的缓存仍可由发送中的body持有
+    // An evicted entry may still be held by a body being sent
+    HttpFileBody body(changed);
+    CHECK(body.remainSize() == 2048);
+
+    File::delete_file(filePath(0));
+    CHECK(!cache.get(filePath(0)));
+    CHECK(cache.size() == 0 && cache.bytes() == 0);
+    // 文件夹与不存在的文件不缓存
+    // Folders and missing files are not cached
+    CHECK(!cache.get(exeDir()));
+    CHECK(!cache.get(filePath(100)));
+}
+
+// 按文件个数淘汰最久未访问的文件
+// Evict the least recently accessed file by file count
+static void test_evict_by_count() {
+    auto &cache = HttpFileCache::Instance();
+    setConfig(2, 16);
+    for (int i = 0; i < 3; ++i) {
+        writeFile(filePath(i), 100);
+    }
+    auto first = cache.get(filePath(0));
+    cache.get(filePath(1));
+    // 访问0号文件后，1号文件成为最久未访问的
+    // File 1 becomes the least recently accessed after file 0 is accessed
+    CHECK(cache.get(filePath(0)) == first);
+    cache.get(filePath(2));
+    CHECK(cache.size() == 2 && cache.bytes() == 200);
+    CHECK(cache.get(filePath(0)) == first);
+    for (int i = 0; i < 3; ++i) {
+        File::delete_file(filePath(i));
+    }
+}
+
+// 按总字节数淘汰，超过上限的文件不缓存
+// Evict by total bytes, files larger than the budget are not cached
+static void test_evict_by_bytes() {
+    auto &cache = HttpFileCache::Instance();
+    setConfig(16, 1);
+    writeFile(filePath(0), 600 * 1024);
+    writeFile(filePath(1), 600 * 1024);
+    writeFile(filePath(2), 2 * 1024 * 1024);
+
+    CHECK(cache.get(filePath(0)));
+    CHECK(cache.get(filePath(1)));
+    CHECK(cache.size() == 1 && cache.bytes() == 600 * 1024);
+    CHECK(!cache.get(filePath(2)));
+    CHECK(cache.bytes() <= 1024 * 1024);
+
+    // 置0关闭缓存
+    // Setting it to 0 disables the cache
+    setConfig(16, 0);
+    CHECK(!cache.get(filePath(0)));
+    CHECK(cache.size() == 0 && cache.bytes() == 0);
+    for (int i = 0; i < 3; ++i) {
+        File::delete_file(filePath(i));
+    }
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_hit_and_change();
+        test_evict_by_count();
+        test_evict_by_bytes();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all http file cache tests passed";
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+#include <cstring>
+#include "Util/logger.h"
+#include "Common/macros.h"
+#include "../webrtc/JitterBuffer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+// h264 nal头
+// h264 nal headers
+static constexpr uint8_t kNalIdr = 0x65;
+static constexpr uint8_t kNalP = 0x41;
+
+static RtpPacket::Ptr makeRtp(TrackType type, uint16_t seq, uint32_t stamp, uint8_t nal, bool mark) {
+    auto size = RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize + 2;
+    auto rtp = RtpPacket::create();
+    rtp->setCapacity(size);
+    rtp->setSize(size);
+    memset(rtp->data(), 0, size);
+    rtp->type = type;
+    rtp->sample_rate = type == TrackVideo ? 90000 : 48000;
+    auto header = rtp->getHeader();
+    header->version = RtpPacket::kRtpVersion;
+    header->mark = mark;
+    header->seq = htons(seq);
+    header->stamp = htonl(stamp);
+    auto payload = rtp->getPayload();
+    payload[0] = nal;
+    payload[1] = 0xAA;
+    return rtp;
+}
+
+class Tester {
+public:
+    Tester(TrackType type, CodecId codec) : _jb(type, codec), _type(type) {
+        _jb.setOnRtp([this](RtpPacket::Ptr rtp) { output.emplace_back(rtp->getSeq()); });
+        _jb.setOnKeyFrameRequest([this]() { ++key_requests; });
+    }
+
+    void input(uint16_t seq, uint32_t stamp, uint8_t nal, bool mark, uint64_t now_ms) {
+        _jb.inputRtp(makeRtp(_type, seq, stamp, nal, mark), false, now_ms);
+    }
+
+    JitterBuffer &jb() { return _jb; }
+
+public:
+    vector<uint16_t> output;
+    size_t key_requests = 0;
+
+private:
+    JitterBuffer _jb;
+    TrackType _type;
+};
+
+// 首个关键帧之前的帧无法解码，被丢弃并请求关键帧
+// Frames before the first key frame cannot be decoded, they are dropped and a key frame is requested
+static void test_wait_first_key() {
+    Tester tester(TrackVideo, CodecH264);
+    uint64_t now_ms = 10000;
+    tester.input(10, 0, kNalP, true, now_ms);
+    CHECK(tester.output.empty() && tester.key_requests == 1);
+    tester.input(11, 3000, kNalIdr, true, now_ms += 33);
+    CHECK(tester.output == vector<uint16_t>({ 11 }));
+    auto &stats = tester.jb().getStats();
+    CHECK(stats.frames_output == 1 && stats.frames_dropped == 1 && stats.keyframe_requests == 1);
+}
+
+// seq回环与乱序：按seq顺序输出完整的帧
+// Seq wrap around and reordering: complete frames are released in seq order
+static void test_unwrap_reorder() {
+    Tester tester(TrackVideo, CodecH264);
+    uint64_t now_ms = 10000;
+    tester.input(65534, 0, kNalIdr, false, now_ms);
+    tester.input(0, 3000, kNalP, false, now_ms);
+    CHECK(tester.output.empty());
+    tester.input(65535, 0, kNalIdr, true, now_ms);
+    CHECK(tester.output == vector<uint16_t>({ 65534, 65535 }));
+    tester.input(1, 3000, kNalP, true, now_ms);
+    CHECK(tester.output == vector<uint16_t>({ 65534, 65535, 0, 1 }));
+
+    // 缺少marker位的帧在下一帧的首包到达后输出
+    // A frame without the marker bit is released once the first packet of the next frame arrives
+    tester.input(2, 6000, kNalP, false, now_ms += 33);
+    tester.input(3, 9000, kNalP, true, now_ms += 33);
+    CHECK(tester.output == vector<uint16_t>({ 65534, 65535, 0, 1, 2, 3 }));
+
+    // 重复或已输出的包计为迟到
+    // Duplicated or released packets count as late
+    tester.input(1, 3000, kNalP, true, now_ms);
+    auto &stats = tester.jb().getStats();
+    CHECK(stats.packets_late == 1 && stats.frames_output == 4 && stats.frames_dropped == 0);
+    CHECK(tester.key_requests == 0);
+}
+
+// 不完整的帧超过目标延时后丢弃，后续帧丢弃至下一个关键帧
+// An incomplete frame is dropped past the target delay, and the following frames up to the next key frame
+static void test_drop_and_seek() {
+    Tester tester(TrackVideo, CodecH264);
+    uint64_t now_ms = 10000;
+    tester.input(100, 0, kNalIdr, true, now_ms);
+    CHECK(tester.output == vector<uint16_t>({ 100 }));
+    // 缺少102
+    // 102 is missing
+    tester.input(101, 3000, kNalP, false, now_ms += 33);
+    tester.input(103, 3000, kNalP, true, now_ms);
+    auto &stats = tester.jb().getStats();
+    CHECK(stats.target_delay_ms == 20);
+    tester.jb().process(now_ms + 19);
+    CHECK(stats.frames_dropped == 0);
+
+    // 超时后丢弃101~103并请求关键帧，104参考了丢弃的帧
+    // 101~103 are dropped past the deadline and a key frame is requested, 104 references the dropped frame
+    tester.input(104, 6000, kNalP, true, now_ms += 33);
+    CHECK(stats.frames_dropped == 1 && tester.key_requests == 1);
+    tester.jb().process(now_ms += 20);
+    CHECK(stats.frames_dropped == 2);
+
+    // 迟到的重传包
+    // A late retransmission
+    tester.jb().inputRtp(makeRtp(TrackVideo, 102, 3000, kNalP, false), true, now_ms);
+    CHECK(stats.packets_late == 1);
+
+    tester.input(105, 9000, kNalIdr, true, now_ms += 13);
+    CHECK(tester.output == vector<uint16_t>({ 100, 105 }));
+    CHECK(stats.frames_output == 2 && tester.key_requests == 1);
+}
+
+// 首帧完整而之前整帧缺失：完整的关键帧立即输出，不能识别关键帧的编码等待重传超时后输出，都不丢弃完整的帧
+// The head frame is complete while a whole frame before it is missing: a complete key frame is released at once,
+// codecs without key frame recognition release it once the retransmission wait times out, complete frames are never dropped
+static void test_skip_gap() {
+    {
+        Tester tester(TrackVideo, CodecH264);
+        uint64_t now_ms = 10000;
+        tester.input(100, 0, kNalIdr, true, now_ms);
+        // 101整帧丢失
+        // Frame 101 is lost entirely
+        tester.input(102, 6000, kNalIdr, true, now_ms += 66);
+        CHECK(tester.output == vector<uint16_t>({ 100, 102 }));
+        tester.input(103, 9000, kNalP, true, now_ms += 33);
+        CHECK(tester.output == vector<uint16_t>({ 100, 102, 103 }));
+        auto &stats = tester.jb().getStats();
+        CHECK(stats.frames_dropped == 0 && tester.key_requests == 0);
+    }
+    {
+        Tester tester(TrackVideo, CodecInvalid);
+        uint64_t now_ms = 10000;
+        tester.input(100, 0, kNalP, true, now_ms);
+        tester.input(102, 6000, kNalP, true, now_ms += 66);
+        CHECK(tester.output == vector<uint16_t>({ 100 }));
+        tester.jb().process(now_ms + 19);
+        CHECK(tester.output == vector<uint16_t>({ 100 }));
+        tester.jb().process(now_ms + 20);
+        CHECK(tester.output == vector<uint16_t>({ 100, 102 }));
+        auto &stats = tester.jb().getStats();
+        CHECK(stats.frames_dropped == 0 && tester.key_requests == 0);
+    }
+}
+
+// 音频每个包即一帧，缺失的包超时后跳过，不请求关键帧
+// Each audio packet is a frame, missing packets are skipped past the deadline and no key frame is requested
+static void test_audio() {
+    Tester tester(TrackAudio, CodecOpus);
+    uint64_t now_ms = 10000;
+    tester.input(1, 960, 0, true, now_ms);
+    tester.input(2, 1920, 0, true, now_ms += 20);
+    tester.input(4, 3840, 0, true, now_ms += 40);
+    CHECK(tester.output == vector<uint16_t>({ 1, 2 }));
+    tester.jb().process(now_ms += 20);
+    CHECK(tester.output == vector<uint16_t>({ 1, 2, 4 }));
+    auto &stats = tester.jb().getStats();
+    CHECK(stats.frames_dropped == 1 && tester.key_requests == 0);
+}
+
+// 目标延时按nack重传成功率预留rtt，快升慢降
+// The target delay reserves rtt by the nack success ratio, rising fast and falling slowly
+static void test_target_delay() {
+    JitterBuffer jb(TrackVideo, CodecH264);
+    auto &stats = jb.getStats();
+    CHECK(stats.target_delay_ms == 20);
+    jb.updateNackState(100, 10, 0);
+    CHECK(stats.target_delay_ms == 150);
+    jb.updateNackState(100, 10, 10);
+    CHECK(stats.nack_recover_ratio < 1);
+    CHECK(stats.target_delay_ms < 150 && stats.target_delay_ms > 140, stats.target_delay_ms);
+    jb.updateNackState(10000, 20, 10);
+    CHECK(stats.target_delay_ms == 1000);
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_wait_first_key();
+        test_unwrap_reorder();
+        test_drop_and_seek();
+        test_skip_gap();
+        test_audio();
+        test_target_delay();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all jitter buffer tests passed";
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <thread>
+#include <vector>
+#include "Util/logger.h"
+#include "Util/NoticeCenter.h"
+#include "Common/config.h"
+#include "Common/macros.h"
+#include "Common/KeyFrameArbiter.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+using Result = KeyFrameArbiter::Result;
+
+// 未产生延后请求时defer_ms保持不变
+// defer_ms is untouched unless a deferred request is created
+static constexpr uint64_t kNoDefer = UINT64_MAX;
+
+// 请求已发往源端
+// The request reached the origin
+static Result forward(KeyFrameArbiter &arbiter, bool joining, uint64_t now_ms, uint64_t &defer_ms) {
+    auto ret = arbiter.onRequest(joining, now_ms, defer_ms);
+    if (ret == Result::forward) {
+        arbiter.onForwarded(true, false);
+    }
+    return ret;
+}
+
+static bool timer(KeyFrameArbiter &arbiter, uint64_t now_ms) {
+    if (!arbiter.onTimer(now_ms)) {
+        return false;
+    }
+    arbiter.onForwarded(true, true);
+    return true;
+}
+
+static void setConfig(uint32_t interval_ms, uint32_t cache_max_ms) {
+    mINI::Instance()[General::kKeyFrameRequestMS] = interval_ms;
+    mINI::Instance()[General::kKeyFrameCacheMaxMS] = cache_max_ms;
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+}
+
+// 已发出的请求等待关键帧期间合并；关键帧到达后间隔内的请求延后到间隔结束时发出一次
+// Requests merge while the sent one waits for its key frame; requests after the key frame within the interval are sent once when it ends
+static void test_coalesce_and_defer() {
+    KeyFrameArbiter arbiter;
+    uint64_t now_ms = 10000;
+    uint64_t defer_ms = kNoDefer;
+    CHECK(forward(arbiter, false, now_ms, defer_ms) == Result::forward);
+    CHECK(forward(arbiter, false, now_ms + 100, defer_ms) == Result::coalesced);
+    CHECK(forward(arbiter, false, now_ms + 200, defer_ms) == Result::coalesced);
+    CHECK(defer_ms == kNoDefer);
+
+    arbiter.onKeyFrame(now_ms + 300);
+    CHECK(forward(arbiter, false, now_ms + 400, defer_ms) == Result::coalesced);
+    CHECK(defer_ms == 600, defer_ms);
+    // 已有延后的请求，不再重复计时
+    // A request is deferred already, no second timer
+    defer_ms = kNoDefer;
+    CHECK(forward(arbiter, false, now_ms + 500, defer_ms) == Result::coalesced);
+    CHECK(defer_ms == kNoDefer);
+
+    CHECK(timer(arbiter, now_ms + 1000));
+    auto stats = arbiter.getStats();
+    CHECK(stats.requested == 5 && stats.forwarded == 2 && stats.suppressed == 3 && stats.from_cache == 0);
+
+    // 延后的请求发出后，间隔从发出时重新计算
+    // The interval restarts when the deferred request is sent
+    CHECK(forward(arbiter, false, now_ms + 1500, defer_ms) == Result::coalesced);
+    CHECK(defer_ms == kNoDefer);
+    CHECK(forward(arbiter, false, now_ms + 2000, defer_ms) == Result::forward);
+}
+
+// 间隔内关键帧已到达时，延后的请求不再发出
+// The deferred request is not sent when a key frame arrives within the interval
+static void test_timer_satisfied() {
+    KeyFrameArbiter arbiter;
+    uint64_t now_ms = 10000;
+    uint64_t defer_ms = kNoDefer;
+    CHECK(forward(arbiter, false, now_ms, defer_ms) == Result::forward);
+    arbiter.onKeyFrame(now_ms + 100);
+    CHECK(forward(arbiter, false, now_ms + 200, defer_ms) == Result::coalesced);
+    CHECK(defer_ms == 800, defer_ms);
+    arbiter.onKeyFrame(now_ms + 500);
+    CHECK(!timer(arbiter, now_ms + 1000));
+    auto stats = arbiter.getStats();
+    CHECK(stats.requested == 2 && stats.forwarded == 1 && stats.suppressed == 1);
+}
+
+// 新加入的观看端在gop缓存足够新时由缓存满足
+// Joining viewers are served by the gop cache when it is recent enough
+static void test_from_cache() {
+    KeyFrameArbiter arbiter;
+    uint64_t now_ms = 10000;
+    uint64_t defer_ms = kNoDefer;
+    // 尚无关键帧
+    // No key frame yet
+    CHECK(forward(arbiter, true, now_ms, defer_ms) == Result::forward);
+    arbiter.onKeyFrame(now_ms + 100);
+    CHECK(forward(arbiter, true, now_ms + 4000, defer_ms) == Result::from_cache);
+    CHECK(forward(arbiter, true, now_ms + 5100, defer_ms) == Result::from_cache);
+    CHECK(forward(arbiter, true, now_ms + 5101, defer_ms) == Result::forward);
+    // 非加入的请求不由缓存满足
+    // Requests not from joining viewers are never served by the cache
+    arbiter.onKeyFrame(now_ms + 5200);
+    CHECK(forward(arbiter, false, now_ms + 7000, defer_ms) == Result::forward);
+    auto stats = arbiter.getStats();
+    CHECK(stats.requested == 5 && stats.forwarded == 3 && stats.from_cache == 2);
+
+    // 置0关闭由gop缓存满足
+    // 0 disables serving from the gop cache
+    setConfig(1000, 0);
+    arbiter.onKeyFrame(now_ms + 8000);
+    CHECK(forward(arbiter, true, now_ms + 9000, defer_ms) == Result::forward);
+    setConfig(1000, 5000);
+}
+
+// 多线程请求与帧侧并发时统计保持一致
+// The statistics stay consistent with requests from many threads racing the frame side
+static void test_concurrent() {
+    KeyFrameArbiter arbiter;
+    static constexpr int kThreads = 4;
+    static constexpr int kRequests = 10000;
+    vector<thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&arbiter]() {
+            for (int j = 0; j < kRequests; ++j) {
+                uint64_t defer_ms = kNoDefer;
+                forward(arbiter, j % 7 == 0, 10000 + j, defer_ms);
+            }
+        });
+    }
+    for (int j = 0; j < kRequests; ++j) {
+        arbiter.onKeyFrame(10000 + j);
+        if (j % 100 == 0) {
+            timer(arbiter, 10000 + j);
+        }
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    auto stats = arbiter.getStats();
+    CHECK(stats.requested == kThreads * kRequests);
+    CHECK(stats.requested == stats.forwarded + stats.suppressed + stats.from_cache);
+}
+
+// 源端不支持时不计为已发出，也不占用间隔
+// A request the origin does not support is neither counted as forwarded nor holds the interval
+static void test_unsupported() {
+    KeyFrameArbiter arbiter;
+    uint64_t now_ms = 10000;
+    uint64_t defer_ms = kNoDefer;
+    CHECK(arbiter.onRequest(false, now_ms, defer_ms) == Result::forward);
+    arbiter.onForwarded(false, false);
+    CHECK(arbiter.onRequest(false, now_ms + 100, defer_ms) == Result::forward);
+    arbiter.onForwarded(true, false);
+    CHECK(arbiter.onRequest(false, now_ms + 200, defer_ms) == Result::coalesced);
+
+    // 延后的请求未能发出
+    // The deferred request could not be sent
+    arbiter.onKeyFrame(now_ms + 300);
+    CHECK(arbiter.onRequest(false, now_ms + 400, defer_ms) == Result::coalesced);
+    CHECK(defer_ms == 700, defer_ms);
+    CHECK(arbiter.onTimer(now_ms + 1100));
+    arbiter.onForwarded(false, true);
+    CHECK(arbiter.onRequest(false, now_ms + 1200, defer_ms) == Result::forward);
+    arbiter.onForwarded(true, false);
+    auto stats = arbiter.getStats();
+    CHECK(stats.requested == 5 && stats.forwarded == 2 && stats.suppressed == 1 && stats.unsupported == 2);
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        setConfig(1000, 5000);
+        test_coalesce_and_defer();
+        test_timer_satisfied();
+        test_from_cache();
+        test_concurrent();
+        test_unsupported();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all key frame arbiter tests passed";
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+#include <iostream>
+#include "Util/logger.h"
+#include "Common/Parser.h"
+#include "Common/macros.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static void parse(Parser &parser, const string &str) {
+    parser.parse(str.data(), str.size());
+}
+
+// header按偏移索引，大小写不敏感，取值去除首尾空白
+// Headers are indexed by offset, looked up case-insensitively, with values trimmed
+static void test_header_index() {
+    Parser parser;
+    parse(parser, "GET /live/test.flv?token=abc HTTP/1.1\r\n"
+                  "Host: 127.0.0.1:8080\r\n"
+                  "Connection:keep-alive  \r\n"
+                  "X-Empty:\r\n"
+                  "\r\n"
+                  "body");
+    CHECK(parser.method() == "GET");
+    CHECK(parser.url() == "/live/test.flv");
+    CHECK(parser.params() == "token=abc");
+    CHECK(parser.protocol() == "HTTP/1.1");
+    CHECK(parser.content() == "body");
+    CHECK(parser["Host"] == "127.0.0.1:8080");
+    CHECK(parser["host"] == "127.0.0.1:8080");
+    CHECK(parser["Connection"] == "keep-alive");
+    CHECK(parser["X-Empty"].empty());
+    CHECK(parser["Not-Exist"].empty());
+    CHECK(parser.getUrlArgs()["token"] == "abc");
+
+    // 生成header map后仍可查找与修改
+    // Headers can still be found and modified after the map is generated
+    auto &header = parser.getHeader();
+    CHECK(header.size() == 3);
+    header["Host"] = "localhost";
+    CHECK(parser["Host"] == "localhost");
+}
+
+// 长连接下复用Parser，上一次请求的header不应残留
+// Headers of the previous request must not survive when the Parser is reused on a keep-alive connection
+static void test_reuse() {
+    Parser parser;
+    parse(parser, "POST /index/api/getServerConfig HTTP/1.1\r\nContent-Length: 4\r\nX-Old: 1\r\n\r\nbody");
+    CHECK(parser["X-Old"] == "1");
+    parse(parser, "GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+    CHECK(parser["X-Old"].empty());
+    CHECK(parser["Content-Length"].empty());
+    CHECK(parser["Host"] == "a");
+    CHECK(parser.getHeader().size() == 1);
+}
+
+// 解析失败后不应残留指向空缓存的header偏移
+// No header offsets into the empty buffer must survive a failed parse
+static void test_parse_failure() {
+    Parser parser;
+    parse(parser, "GET / HTTP/1.1\r\nHost: a\r\nX-Long-Header: 0123456789\r\n\r\n");
+    bool thrown = false;
+    try {
+        // 第二行缺少':'
+        // The second line lacks ':'
+        parse(parser, "GET / HTTP/1.1\r\nHost: b\r\nbroken line\r\n\r\n");
+    } catch (std::exception &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(parser["Host"].empty());
+    CHECK(parser["X-Long-Header"].empty());
+    CHECK(parser.getHeader().empty());
+}
+
+// 移动后源对象的_header_fields可能为空
+// _header_fields of the source may be empty after a move
+static void test_move() {
+    Parser parser;
+    parse(parser, "GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+    Parser other(std::move(parser));
+    CHECK(other["Host"] == "a");
+    CHECK(parser["Host"].empty());
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_header_index();
+        test_reuse();
+        test_parse_failure();
+        test_move();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all parser tests passed";
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "Util/logger.h"
+#include "Common/macros.h"
+#include "../webrtc/RtpFec.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static constexpr uint8_t kMediaPt = 96;
+static constexpr uint8_t kRedPt = 116;
+static constexpr uint8_t kUlpfecPt = 117;
+static constexpr uint32_t kSsrc = 0x12345678;
+
+static RtpPacket::Ptr makeRtp(TrackType type, uint16_t seq, uint32_t stamp, const string &payload, bool mark = false) {
+    auto size = RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize + payload.size();
+    auto rtp = RtpPacket::create();
+    rtp->setCapacity(size);
+    rtp->setSize(size);
+    memset(rtp->data(), 0, size);
+    rtp->type = type;
+    rtp->sample_rate = type == TrackVideo ? 90000 : 48000;
+    auto header = rtp->getHeader();
+    header->version = RtpPacket::kRtpVersion;
+    header->mark = mark;
+    header->pt = kMediaPt;
+    header->seq = htons(seq);
+    header->stamp = htonl(stamp);
+    header->ssrc = htonl(kSsrc);
+    memcpy(rtp->getPayload(), payload.data(), payload.size());
+    return rtp;
+}
+
+// 模拟发送流程：封装red、分配发送seq、计入ulpfec分组
+// Simulate the send path: wrap in red, allocate the sent seq and add to the ulpfec group
+static Buffer::Ptr sendVideo(RtpFecEncoder &encoder, const RtpPacket::Ptr &rtp) {
+    auto red = encoder.wrapRed(rtp, kMediaPt);
+    if (!red) {
+        return nullptr;
+    }
+    auto header = (RtpHeader *)red->data();
+    header->pt = encoder.getRedPt();
+    header->seq = htons(encoder.allocSeq(rtp->getSeq()));
+    encoder.onSendRed(red->data(), red->size(), kMediaPt);
+    return red;
+}
+
+struct FecPacket {
+    uint16_t seq;
+    uint16_t sn_base;
+    uint16_t mask;
+    uint32_t stamp_recovery;
+    uint16_t length_recovery;
+    string payload;
+};
+
+static FecPacket parseFec(const Buffer::Ptr &buf) {
+    CHECK(buf && buf->size() > RtpPacket::kRtpHeaderSize + 1 + 14);
+    auto header = (RtpHeader *)buf->data();
+    CHECK(header->pt == kRedPt);
+    CHECK(ntohl(header->ssrc) == kSsrc);
+    auto ptr = (const uint8_t *)buf->data() + RtpPacket::kRtpHeaderSize;
+    // red头中唯一的块为ulpfec
+    // The only block in the red header is ulpfec
+    CHECK(ptr[0] == kUlpfecPt);
+    ++ptr;
+    FecPacket ret;
+    ret.seq = ntohs(header->seq);
+    ret.sn_base = (ptr[2] << 8) | ptr[3];
+    ret.stamp_recovery = ((uint32_t)ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
+    ret.length_recovery = (ptr[8] << 8) | ptr[9];
+    size_t protect_size = (ptr[10] << 8) | ptr[11];
+    ret.mask = (ptr[12] << 8) | ptr[13];
+    CHECK(buf->size() == RtpPacket::kRtpHeaderSize + 1 + 14 + protect_size);
+    ret.payload.assign((const char *)ptr + 14, protect_size);
+    return ret;
+}
+
+// 未丢包时不封装，seq不变
+// Nothing is wrapped and seqs are unchanged without loss
+static void test_no_loss() {
+    RtpFecEncoder video(TrackVideo, kRedPt, kUlpfecPt);
+    CHECK(!video.wrapRed(makeRtp(TrackVideo, 100, 0, "abc"), kMediaPt));
+    CHECK(video.allocSeq(100) == 100);
+    CHECK(video.getSentSeq(100) == 100);
+    CHECK(!video.takeFecPacket());
+
+    // 未协商ulpfec时视频不封装
+    // Video is not wrapped if ulpfec was not negotiated
+    RtpFecEncoder no_fec(TrackVideo, kRedPt, 0);
+    no_fec.setRatio(0.5);
+    CHECK(!no_fec.wrapRed(makeRtp(TrackVideo, 100, 0, "abc"), kMediaPt));
+
+    RtpFecEncoder audio(TrackAudio, kRedPt, 0);
+    CHECK(!audio.wrapRed(makeRtp(TrackAudio, 100, 0, "abc"), kMediaPt));
+}
+
+// 每4个包生成一个ulpfec包，可恢复其中任一丢失的包；ulpfec包占用的seq使后续媒体包顺延
+// An ulpfec packet is generated every 4 packets and recovers any one of them; the seq it takes shifts the following media packets
+static void test_video_fec() {
+    RtpFecEncoder encoder(TrackVideo, kRedPt, kUlpfecPt);
+    encoder.setRatio(0.25);
+    vector<string> payloads { "first packet", "2nd", "the third packet is longest", "4" };
+    vector<Buffer::Ptr> sent;
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        auto red = sendVideo(encoder, makeRtp(TrackVideo, 1000 + i, 9000 + i, payloads[i]));
+        CHECK(red);
+        // 1字节red头，其后为原始负载
+        // 1 byte red header followed by the original payload
+        auto red_payload = ((RtpHeader *)red->data())->getPayloadData();
+        CHECK(red_payload[0] == kMediaPt);
+        CHECK(string((char *)red_payload + 1, payloads[i].size()) == payloads[i]);
+        CHECK(i + 1 == payloads.size() || !encoder.takeFecPacket());
+        sent.emplace_back(red);
+    }
+    auto fec = parseFec(encoder.takeFecPacket());
+    CHECK(!encoder.takeFecPacket());
+    CHECK(fec.seq == 1004 && fec.sn_base == 1000 && fec.mask == 0xF000);
+
+    // 通过ulpfec包与其他3个包恢复第3个包
+    // Recover the third packet from the ulpfec packet and the other 3 packets
+    auto payload = fec.payload;
+    auto length = fec.length_recovery;
+    auto stamp = fec.stamp_recovery;
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        if (i == 2) {
+            continue;
+        }
+        length ^= payloads[i].size();
+        stamp ^= 9000 + i;
+        for (size_t j = 0; j < payloads[i].size(); ++j) {
+            payload[j] ^= payloads[i][j];
+        }
+    }
+    CHECK(length == payloads[2].size());
+    CHECK(stamp == 9002);
+    CHECK(payload.substr(0, length) == payloads[2]);
+
+    // ulpfec包之后的媒体包seq顺延1
+    // Media seqs after the ulpfec packet are shifted by one
+    auto next = sendVideo(encoder, makeRtp(TrackVideo, 1004, 9004, "next"));
+    CHECK(ntohs(((RtpHeader *)next->data())->seq) == 1005);
+    CHECK(encoder.getSentSeq(1004) == 1005);
+    CHECK(encoder.getSentSeq(1003) == 1003);
+    uint16_t media_seq;
+    CHECK(!encoder.getMediaSeq(1004, media_seq));
+    CHECK(encoder.getMediaSeq(1005, media_seq) && media_seq == 1004);
+    CHECK(encoder.getMediaSeq(1002, media_seq) && media_seq == 1002);
+}
+
+// 帧尾(mark位)提前结束分组，冗余度在下一个分组开始时生效
+// The end of a frame (mark bit) closes the group early, the redundancy takes effect when the next group starts
+static void test_video_frame_end() {
+    RtpFecEncoder encoder(TrackVideo, kRedPt, kUlpfecPt);
+    encoder.setRatio(0.1);
+    sendVideo(encoder, makeRtp(TrackVideo, 0, 0, "a"));
+    // 分组进行中修改冗余度不影响当前分组
+    // Changing the redundancy in the middle of a group does not affect it
+    encoder.setRatio(0);
+    CHECK(sendVideo(encoder, makeRtp(TrackVideo, 1, 0, "b", true)));
+    auto fec = parseFec(encoder.takeFecPacket());
+    CHECK(fec.seq == 2 && fec.sn_base == 0 && fec.mask == 0xC000);
+    CHECK(fec.length_recovery == 0 && fec.payload == string(1, 'a' ^ 'b'));
+    CHECK(!sendVideo(encoder, makeRtp(TrackVideo, 2, 3000, "c")));
+}
+
+// 音频red携带上一个包作为冗余
+// Audio red carries the previous packet as redundancy
+static void test_audio_red() {
+    RtpFecEncoder encoder(TrackAudio, kRedPt, 0);
+    encoder.setRatio(0.1);
+    auto first = encoder.wrapRed(makeRtp(TrackAudio, 0, 960, "opus0"), kMediaPt);
+    CHECK(first && first->size() == RtpPacket::kRtpHeaderSize + 1 + 5);
+    auto ptr = (const uint8_t *)first->data() + RtpPacket::kRtpHeaderSize;
+    CHECK(ptr[0] == kMediaPt);
+
+    auto second = encoder.wrapRed(makeRtp(TrackAudio, 1, 1920, "opus-1"), kMediaPt);
+    CHECK(second && second->size() == RtpPacket::kRtpHeaderSize + 4 + 1 + 5 + 6);
+    ptr = (const uint8_t *)second->data() + RtpPacket::kRtpHeaderSize;
+    // 冗余块头：F位、pt、14位时间戳偏移与10位长度
+    // Redundant block header: F bit, pt, 14 bits timestamp offset and 10 bits length
+    CHECK(ptr[0] == (0x80 | kMediaPt));
+    uint32_t offset = (ptr[1] << 6) | (ptr[2] >> 2);
+    uint32_t len = ((ptr[2] & 0x03) << 8) | ptr[3];
+    CHECK(offset == 960 && len == 5);
+    CHECK(ptr[4] == kMediaPt);
+    CHECK(string((const char *)ptr + 5, 5) == "opus0");
+    CHECK(string((const char *)ptr + 10, 6) == "opus-1");
+
+    // 关闭冗余后不再封装
+    // Nothing is wrapped once the redundancy is off
+    encoder.setRatio(0);
+    CHECK(!encoder.wrapRed(makeRtp(TrackAudio, 2, 2880, "opus2"), kMediaPt));
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_no_loss();
+        test_video_fec();
+        test_video_frame_end();
+        test_audio_red();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all rtp fec tests passed";
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+#include <cstring>
+#include "Util/logger.h"
+#include "Common/macros.h"
+#include "../webrtc/RtpPacer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+struct SentItem {
+    uint16_t seq;
+    bool rtx;
+    bool flush;
+    uint64_t send_ms;
+};
+
+static RtpPacket::Ptr makeRtp(uint16_t seq, size_t payload_size) {
+    auto size = RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize + payload_size;
+    auto rtp = RtpPacket::create();
+    rtp->setCapacity(size);
+    rtp->setSize(size);
+    memset(rtp->data(), 0, rtp->size());
+    rtp->type = TrackVideo;
+    rtp->sample_rate = 90000;
+    auto header = rtp->getHeader();
+    header->version = RtpPacket::kRtpVersion;
+    header->seq = htons(seq);
+    return rtp;
+}
+
+// 每个rtp(不含tcp头)大小为1000字节
+// Every rtp is 1000 bytes without the tcp header
+static constexpr size_t kPayloadSize = 1000 - RtpPacket::kRtpHeaderSize;
+
+// 按设定速率匀速发出
+// Packets are sent evenly at the pacing rate
+static void test_pacing_rate() {
+    uint64_t now_ms = 1000;
+    vector<SentItem> sent;
+    RtpPacer pacer(1000, [&](const RtpPacket::Ptr &rtp, bool rtx, bool flush) {
+        sent.emplace_back(SentItem { rtp->getSeq(), rtx, flush, now_ms });
+    });
+    // 800kbps即每毫秒100字节
+    // 800kbps is 100 bytes per millisecond
+    pacer.setPacingRate(800 * 1000);
+    for (uint16_t seq = 0; seq < 20; ++seq) {
+        pacer.enqueue(makeRtp(seq, kPayloadSize), false, now_ms);
+    }
+    CHECK(pacer.getQueueSize() == 20 && pacer.getQueueBytes() == 20 * 1000);
+    for (; now_ms <= 1100; now_ms += RtpPacer::kIntervalMS) {
+        pacer.process(now_ms);
+    }
+    // 100ms内发出约10000字节，允许一个包的额度透支
+    // About 10000 bytes are sent in 100ms, overdrawing the budget by one packet is allowed
+    CHECK(sent.size() >= 9 && sent.size() <= 11, sent.size());
+    for (size_t i = 0; i < sent.size(); ++i) {
+        CHECK(sent[i].seq == i && !sent[i].rtx);
+        // 每轮只发出一个包，且都需要刷新批量发送缓存
+        // Only one packet is sent per round and each needs to flush the batch
+        CHECK(sent[i].flush);
+    }
+    CHECK(pacer.getQueueSize() == 20 - sent.size());
+    CHECK(pacer.getQueueDelay(now_ms) == now_ms - 1000);
+}
+
+// 重传包优先于已排队的媒体包发出
+// Retransmissions are sent ahead of queued media packets
+static void test_rtx_first() {
+    uint64_t now_ms = 1000;
+    vector<SentItem> sent;
+    RtpPacer pacer(1000, [&](const RtpPacket::Ptr &rtp, bool rtx, bool flush) {
+        sent.emplace_back(SentItem { rtp->getSeq(), rtx, flush, now_ms });
+    });
+    pacer.setPacingRate(8000 * 1000);
+    for (uint16_t seq = 0; seq < 3; ++seq) {
+        pacer.enqueue(makeRtp(seq, kPayloadSize), false, now_ms);
+    }
+    now_ms += 1;
+    pacer.enqueue(makeRtp(100, kPayloadSize), true, now_ms);
+    CHECK(pacer.getQueueSize() == 4);
+    // 重传包入队较晚，排队时长仍以最早入队的媒体包为准
+    // The retransmission is queued later, the queueing delay still follows the oldest media packet
+    CHECK(pacer.getQueueDelay(now_ms + 9) == 10);
+
+    pacer.process(now_ms);
+    now_ms += RtpPacer::kIntervalMS;
+    pacer.process(now_ms);
+    CHECK(sent.size() == 4, sent.size());
+    CHECK(sent[0].seq == 100 && sent[0].rtx);
+    for (size_t i = 1; i < sent.size(); ++i) {
+        CHECK(sent[i].seq == i - 1 && !sent[i].rtx);
+    }
+    // 仅本轮最后一个包刷新批量发送缓存
+    // Only the last packet of the round flushes the batch
+    CHECK(!sent[0].flush && !sent[1].flush && !sent[2].flush && sent[3].flush);
+    CHECK(pacer.getQueueSize() == 0 && pacer.getQueueBytes() == 0);
+    CHECK(pacer.getQueueDelay(now_ms) == 0);
+}
+
+// 发送速率不足时按排队字节数与排队时长上限临时提速
+// The rate is raised temporarily by the queued bytes over the max queueing time when it is insufficient
+static void test_max_queue_time() {
+    uint64_t now_ms = 1000;
+    vector<SentItem> sent;
+    RtpPacer pacer(100, [&](const RtpPacket::Ptr &rtp, bool rtx, bool flush) {
+        sent.emplace_back(SentItem { rtp->getSeq(), rtx, flush, now_ms });
+    });
+    pacer.setPacingRate(8 * 1000);
+    for (uint16_t seq = 0; seq < 50; ++seq) {
+        pacer.enqueue(makeRtp(seq, kPayloadSize), false, now_ms);
+    }
+    for (; now_ms <= 1100; now_ms += RtpPacer::kIntervalMS) {
+        pacer.process(now_ms);
+    }
+    // 按8kbps发送时100ms内只能发出1个包
+    // Only one packet could be sent in 100ms at 8kbps
+    CHECK(sent.size() >= 25, sent.size());
+    for (; now_ms <= 2000 && pacer.getQueueSize(); now_ms += RtpPacer::kIntervalMS) {
+        pacer.process(now_ms);
+    }
+    CHECK(sent.size() == 50, sent.size());
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_pacing_rate();
+        test_rtx_first();
+        test_max_queue_time();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all rtp pacer tests passed";
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+#include <cstring>
+#include "Util/logger.h"
+#include "Common/macros.h"
+#include "Rtsp/RtpRetransmitCache.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static RtpPacket::Ptr makeRtp(TrackType type, uint16_t seq, uint64_t stamp_ms) {
+    auto rtp = RtpPacket::create();
+    rtp->setCapacity(RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize);
+    rtp->setSize(RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize);
+    memset(rtp->data(), 0, rtp->size());
+    rtp->type = type;
+    rtp->sample_rate = 90000;
+    rtp->ntp_stamp = stamp_ms;
+    auto header = rtp->getHeader();
+    header->version = RtpPacket::kRtpVersion;
+    header->seq = htons(seq);
+    header->stamp = htonl(uint32_t(stamp_ms * 90));
+    return rtp;
+}
+
+// seq回环前后均可命中，被覆盖的位置不会返回错误的包
+// Lookups hit across the seq wrap around, an overwritten slot never returns the wrong packet
+static void test_wrap_around() {
+    // 100向上取整为128
+    // 100 is rounded up to 128
+    RtpRetransmitCache cache(100, 10000);
+    uint16_t seq = 65500;
+    for (int i = 0; i < 128; ++i, ++seq) {
+        cache.input(makeRtp(TrackVideo, seq, 1000));
+    }
+    for (uint16_t s = 65500, i = 0; i < 128; ++s, ++i) {
+        auto rtp = cache.get(TrackVideo, s);
+        CHECK(rtp && rtp->getSeq() == s, "seq:", s);
+    }
+    // 再写入一个包，覆盖最早的65500
+    // One more packet overwrites the oldest 65500
+    cache.input(makeRtp(TrackVideo, seq, 1000));
+    CHECK(!cache.get(TrackVideo, 65500));
+    CHECK(cache.get(TrackVideo, seq));
+    CHECK(!cache.get(TrackVideo, seq + 1));
+}
+
+// 各轨道独立缓存
+// Every track has its own cache
+static void test_tracks() {
+    RtpRetransmitCache cache(16, 10000);
+    cache.input(makeRtp(TrackVideo, 1, 1000));
+    CHECK(cache.get(TrackVideo, 1));
+    CHECK(!cache.get(TrackAudio, 1));
+    cache.input(makeRtp(TrackAudio, 1, 1000));
+    CHECK(cache.get(TrackAudio, 1)->type == TrackAudio);
+    CHECK(cache.get(TrackVideo, 1)->type == TrackVideo);
+    CHECK(!cache.get(TrackInvalid, 1));
+}
+
+// 比最新包早于max_ms的包视为过期
+// Packets older than the newest one by more than max_ms are expired
+static void test_expire() {
+    RtpRetransmitCache cache(64, 500);
+    cache.input(makeRtp(TrackVideo, 1, 1000));
+    cache.input(makeRtp(TrackVideo, 2, 1400));
+    CHECK(cache.get(TrackVideo, 1));
+    cache.input(makeRtp(TrackVideo, 3, 1501));
+    CHECK(!cache.get(TrackVideo, 1));
+    CHECK(cache.get(TrackVideo, 2));
+    CHECK(cache.get(TrackVideo, 3));
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_wrap_around();
+        test_tracks();
+        test_expire();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all rtp retransmit cache tests passed";
+    return 0;
+}
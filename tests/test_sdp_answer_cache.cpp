@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+#include "Util/logger.h"
+#include "Util/NoticeCenter.h"
+#include "Common/config.h"
+#include "Common/macros.h"
+#include "../webrtc/SdpAnswerCache.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static constexpr char kFingerprintA[] = "sha-256 7B:8B:F0:65:5F:78:E2:51:3B:AC:6F:F3:3F:46:1B:35:DC:B8:5F:64:1A:24:C2:43:F0:A1:58:D0:A1:2C:19:08";
+static constexpr char kFingerprintB[] = "sha-256 0A:1B:2C:3D:4E:5F:60:71:82:93:A4:B5:C6:D7:E8:F9:0A:1B:2C:3D:4E:5F:60:71:82:93:A4:B5:C6:D7:E8:F9";
+
+// 拉流端(recvonly、无ssrc/msid)的offer，会话相关的字段由参数指定
+// A player offer (recvonly without ssrc/msid), the per session fields come from the arguments
+static string makeOffer(const string &session_id, const string &ufrag, const string &fingerprint, const string &host,
+                        const string &video_fmtp = "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f") {
+    auto pwd = ufrag + "0123456789abcdefghij";
+    string ret;
+    ret += "v=0\r\n";
+    ret += "o=- " + session_id + " 2 IN IP4 127.0.0.1\r\n";
+    ret += "s=-\r\n";
+    ret += "t=0 0\r\n";
+    ret += "a=group:BUNDLE 0 1\r\n";
+    ret += "a=msid-semantic: WMS\r\n";
+    ret += "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\n";
+    ret += "c=IN IP4 0.0.0.0\r\n";
+    ret += "a=rtcp:9 IN IP4 0.0.0.0\r\n";
+    ret += "a=candidate:1 1 udp 2122260223 " + host + " 50000 typ host generation 0\r\n";
+    ret += "a=ice-ufrag:" + ufrag + "\r\n";
+    ret += "a=ice-pwd:" + pwd + "\r\n";
+    ret += "a=ice-options:trickle\r\n";
+    ret += "a=fingerprint:" + fingerprint + "\r\n";
+    ret += "a=setup:actpass\r\n";
+    ret += "a=mid:0\r\n";
+    ret += "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n";
+    ret += "a=recvonly\r\n";
+    ret += "a=rtcp-mux\r\n";
+    ret += "a=rtpmap:111 opus/48000/2\r\n";
+    ret += "a=rtcp-fb:111 transport-cc\r\n";
+    ret += "a=fmtp:111 minptime=10;useinbandfec=1\r\n";
+    ret += "m=video 9 UDP/TLS/RTP/SAVPF 96 97\r\n";
+    ret += "c=IN IP4 0.0.0.0\r\n";
+    ret += "a=rtcp:9 IN IP4 0.0.0.0\r\n";
+    ret += "a=candidate:1 1 udp 2122260223 " + host + " 50002 typ host generation 0\r\n";
+    ret += "a=ice-ufrag:" + ufrag + "\r\n";
+    ret += "a=ice-pwd:" + pwd + "\r\n";
+    ret += "a=ice-options:trickle\r\n";
+    ret += "a=fingerprint:" + fingerprint + "\r\n";
+    ret += "a=setup:actpass\r\n";
+    ret += "a=mid:1\r\n";
+    ret += "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n";
+    ret += "a=recvonly\r\n";
+    ret += "a=rtcp-mux\r\n";
+    ret += "a=rtcp-rsize\r\n";
+    ret += "a=rtpmap:96 H264/90000\r\n";
+    ret += "a=rtcp-fb:96 nack\r\n";
+    ret += "a=rtcp-fb:96 nack pli\r\n";
+    ret += "a=fmtp:96 " + video_fmtp + "\r\n";
+    ret += "a=rtpmap:97 rtx/90000\r\n";
+    ret += "a=fmtp:97 apt=96\r\n";
+    return ret;
+}
+
+static string splitKey(const string &offer) {
+    SdpOfferDynamic dynamic;
+    string key;
+    CHECK(dynamic.split(offer, key));
+    return key;
+}
+
+// 仅会话相关字段不同的offer共用同一个key，影响协商结果的字段改变key
+// Offers differing only in per session fields share a key, fields affecting the negotiation change it
+static void test_split_key() {
+    auto offer_a = makeOffer("8056465047193717905", "aaaa", kFingerprintA, "192.168.1.2");
+    auto offer_b = makeOffer("1234567890123456789", "bbbb", kFingerprintB, "10.0.0.3");
+    auto key = splitKey(offer_a);
+    CHECK(key == splitKey(offer_b));
+    CHECK(key.find("8056465047193717905") == string::npos);
+    CHECK(key.find("aaaa") == string::npos);
+    CHECK(key.find("192.168.1.2") == string::npos);
+    CHECK(key.find("7B:8B") == string::npos);
+
+    // 重复的行被忽略
+    // Duplicated lines are ignored
+    auto dup = offer_a;
+    dup.insert(dup.find("a=rtcp-mux\r\n"), "a=rtcp-mux\r\n");
+    CHECK(key == splitKey(dup));
+
+    // 编码参数与fingerprint摘要算法参与key
+    // Codec parameters and the fingerprint hash algorithm are part of the key
+    auto codec = makeOffer("8056465047193717905", "aaaa", kFingerprintA, "192.168.1.2",
+                           "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=640032");
+    CHECK(key != splitKey(codec));
+    string sha384 = kFingerprintA;
+    sha384.replace(0, 7, "sha-384");
+    CHECK(key != splitKey(makeOffer("8056465047193717905", "aaaa", sha384, "192.168.1.2")));
+}
+
+// 推流端offer与缺少m段的offer不可缓存
+// Publisher offers and offers without a m section are not cacheable
+static void test_split_uncacheable() {
+    auto offer = makeOffer("8056465047193717905", "aaaa", kFingerprintA, "192.168.1.2");
+    string key;
+    auto ssrc = offer;
+    ssrc.append("a=ssrc:3825024340 cname:Ht8Yp5vHeT0o1Hct\r\n");
+    CHECK(!SdpOfferDynamic().split(ssrc, key));
+    auto msid = offer;
+    msid.insert(msid.find("a=rtcp-mux\r\n"), "a=msid:stream track\r\n");
+    CHECK(!SdpOfferDynamic().split(msid, key));
+    CHECK(!SdpOfferDynamic().split(offer.substr(0, offer.find("m=audio")), key));
+}
+
+// 将本会话的字段填入缓存的offer，结果与直接解析本会话的offer一致
+// Filling this session's fields into the cached offer matches parsing this session's offer directly
+static void test_apply_to() {
+    auto offer_a = makeOffer("8056465047193717905", "aaaa", kFingerprintA, "192.168.1.2");
+    auto offer_b = makeOffer("1234567890123456789", "bbbb", kFingerprintB, "10.0.0.3");
+    RtcSession cached;
+    cached.loadFrom(offer_a);
+    RtcSession expected;
+    expected.loadFrom(offer_b);
+
+    SdpOfferDynamic dynamic;
+    string key;
+    CHECK(dynamic.split(offer_b, key));
+    dynamic.applyTo(cached);
+    CHECK(cached.origin.session_id == expected.origin.session_id);
+    CHECK(cached.origin.session_version == expected.origin.session_version);
+    CHECK(cached.media.size() == 2);
+    for (size_t i = 0; i < cached.media.size(); ++i) {
+        auto &m = cached.media[i];
+        auto &exp = expected.media[i];
+        CHECK(m.ice_ufrag == "bbbb" && m.ice_ufrag == exp.ice_ufrag);
+        CHECK(m.ice_pwd == exp.ice_pwd);
+        CHECK(m.fingerprint.algorithm == exp.fingerprint.algorithm && m.fingerprint.hash == exp.fingerprint.hash);
+        CHECK(m.candidate.size() == 1 && exp.candidate.size() == 1);
+        CHECK(m.candidate[0].address == "10.0.0.3" && m.candidate[0].port == exp.candidate[0].port);
+    }
+    CHECK(cached.toString() == expected.toString());
+}
+
+// 命中缓存后生成的answer只替换会话相关字段，字符串与answer对象一致
+// The answer stamped out of a cache hit only replaces per session fields, and the string matches the answer object
+static void test_stamp() {
+    auto &cache = SdpAnswerCache::Instance();
+    cache.clear();
+    auto offer_a = makeOffer("8056465047193717905", "aaaa", kFingerprintA, "192.168.1.2");
+    auto offer_b = makeOffer("1234567890123456789", "bbbb", kFingerprintB, "10.0.0.3");
+    auto key = splitKey(offer_a);
+    RtcSession offer;
+    offer.loadFrom(offer_a);
+    // 以另一份sdp模拟本端answer
+    // Another sdp stands in for the local answer
+    RtcSession answer;
+    answer.loadFrom(makeOffer("8056465047193717905", "server", kFingerprintB, "127.0.0.1"));
+
+    auto misses = cache.getMisses();
+    CHECK(!cache.get(key));
+    CHECK(cache.getMisses() == misses + 1);
+    cache.put(key, offer, answer);
+    auto hits = cache.getHits();
+    auto entry = cache.get(key);
+    CHECK(entry);
+    CHECK(cache.getHits() == hits + 1);
+    CHECK(entry->answer_str.find(SdpAnswerCache::kIceUfrag) != string::npos);
+
+    RtcSession offer_session;
+    offer_session.loadFrom(offer_b);
+    RtcSession answer_out;
+    auto str = SdpAnswerCache::stamp(*entry, offer_session, answer_out, "ufrag1", "pwd1234567890abcdefghijk");
+    CHECK(str.find('{') == string::npos, str);
+    CHECK(str.find("o=- 1234567890123456789 2 IN IP4 127.0.0.1") != string::npos, str);
+    CHECK(str.find("a=ice-ufrag:ufrag1") != string::npos);
+    CHECK(str.find("a=ice-pwd:pwd1234567890abcdefghijk") != string::npos);
+    CHECK(str.find("server") == string::npos);
+    CHECK(answer_out.origin.session_id == "1234567890123456789");
+    for (auto &m : answer_out.media) {
+        CHECK(m.ice_ufrag == "ufrag1" && m.ice_pwd == "pwd1234567890abcdefghijk");
+    }
+    CHECK(str == answer_out.toString());
+}
+
+// 置0关闭缓存，配置重载清空缓存
+// 0 disables the cache, reloading the config clears it
+static void test_config() {
+    auto &cache = SdpAnswerCache::Instance();
+    auto offer_a = makeOffer("8056465047193717905", "aaaa", kFingerprintA, "192.168.1.2");
+    auto key = splitKey(offer_a);
+    RtcSession offer;
+    offer.loadFrom(offer_a);
+    cache.put(key, offer, offer);
+    CHECK(cache.get(key));
+
+    mINI::Instance()[Rtc::kAnswerCacheSize] = 0;
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+    cache.put(key, offer, offer);
+    CHECK(!cache.get(key));
+
+    mINI::Instance()[Rtc::kAnswerCacheSize] = 64;
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+    CHECK(!cache.get(key));
+    cache.put(key, offer, offer);
+    CHECK(cache.get(key));
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+    CHECK(!cache.get(key));
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_split_key();
+        test_split_uncacheable();
+        test_apply_to();
+        test_stamp();
+        test_config();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all sdp answer cache tests passed";
+    return 0;
+}
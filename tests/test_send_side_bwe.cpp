@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cmath>
+#include <string>
+#include <cstring>
+#include <functional>
+#include "Util/logger.h"
+#include "Common/macros.h"
+#include "../webrtc/SendSideBwe.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static constexpr size_t kPacketSize = 1200;
+static constexpr uint64_t kSendIntervalMS = 10;
+static constexpr size_t kFeedbackPackets = 10;
+
+// 返回到达时间，小于0表示丢包
+// Returns the arrival time, less than 0 means the packet is lost
+using ArrivalFunc = function<double(size_t index, uint64_t send_ms)>;
+
+// 每10ms发送一个包，每10个包回复一次transport-cc反馈
+// Send a packet every 10ms and reply a transport-cc feedback every 10 packets
+static void simulate(SendSideBwe &bwe, uint16_t &seq, uint64_t &now_ms, size_t count, const ArrivalFunc &arrival) {
+    static uint8_t fb_count = 0;
+    size_t index = 0;
+    while (index < count) {
+        FCI_TWCC::TwccPacketStatus status;
+        uint32_t ref_time = 0;
+        double last_arrival = -1;
+        double last_ms = 0;
+        for (size_t i = 0; i < kFeedbackPackets; ++i, ++index, ++seq, now_ms += kSendIntervalMS) {
+            bwe.onPacketSent(seq, kPacketSize, now_ms);
+            auto arrival_ms = arrival(index, now_ms);
+            if (arrival_ms < 0) {
+                status.emplace(seq, make_pair(SymbolStatus::not_received, 0));
+                continue;
+            }
+            if (last_arrival < 0) {
+                ref_time = (uint32_t)(arrival_ms / 64);
+                last_ms = ref_time * 64.0;
+            }
+            auto delta = (int16_t)lround((arrival_ms - last_ms) * 4);
+            status.emplace(seq, make_pair(delta >= 0 && delta <= 0xFF ? SymbolStatus::small_delta : SymbolStatus::large_delta, delta));
+            last_ms += delta * 0.25;
+            last_arrival = arrival_ms;
+        }
+        auto fci = FCI_TWCC::create(ref_time, fb_count++, status);
+        bwe.onTransportFeedback(*((FCI_TWCC *)fci.data()), fci.size(), MAX((uint64_t)last_arrival, now_ms));
+    }
+}
+
+// getPacketChunkList须按序号顺序读取recv delta，seq回环时map的遍历顺序与之不同
+// getPacketChunkList must read recv deltas in sequence order, which differs from the map order when seq wraps around
+static void test_twcc_chunk_wrap_around() {
+    FCI_TWCC::TwccPacketStatus status;
+    status.emplace(0, make_pair(SymbolStatus::small_delta, 10));
+    status.emplace(1, make_pair(SymbolStatus::large_delta, 1000));
+    status.emplace(2, make_pair(SymbolStatus::small_delta, 20));
+    status.emplace(3, make_pair(SymbolStatus::not_received, 0));
+    status.emplace(4, make_pair(SymbolStatus::small_delta, 30));
+    auto fci = FCI_TWCC::create(100, 0, status);
+    // 将基础序号改为65534，使这些包跨越seq回环
+    // Change the base seq to 65534 so these packets cross the seq wrap around
+    uint16_t base_seq = htons(65534);
+    memcpy(&fci[0], &base_seq, sizeof(base_seq));
+
+    auto twcc = (FCI_TWCC *)fci.data();
+    CHECK(twcc->getBaseSeq() == 65534 && twcc->getPacketCount() == 5);
+    auto status_list = twcc->getPacketChunkList(fci.size());
+    CHECK(status_list.size() == 5);
+    CHECK(status_list[65534] == make_pair(SymbolStatus::small_delta, (int16_t)10));
+    CHECK(status_list[65535] == make_pair(SymbolStatus::large_delta, (int16_t)1000));
+    CHECK(status_list[0] == make_pair(SymbolStatus::small_delta, (int16_t)20));
+    CHECK(status_list[1] == make_pair(SymbolStatus::not_received, (int16_t)0));
+    CHECK(status_list[2] == make_pair(SymbolStatus::small_delta, (int16_t)30));
+}
+
+// 时延恒定且无丢包时，码率缓慢上升且不超过确认码率的1.5倍
+// With a constant delay and no loss, the rate ramps up slowly and stays below 1.5 times the acknowledged bitrate
+static void test_stable() {
+    SendSideBwe bwe(300 * 1000, 50 * 1000, 5000 * 1000);
+    uint16_t seq = 1000;
+    uint64_t now_ms = 10000;
+    simulate(bwe, seq, now_ms, 500, [](size_t index, uint64_t send_ms) { return send_ms + 20.0; });
+    // 每10ms发送1200字节，即960kbps
+    // 1200 bytes every 10ms is 960kbps
+    auto acked = bwe.getAckedBitrate();
+    CHECK(acked > 900 * 1000 && acked < 1000 * 1000, acked);
+    CHECK(bwe.getUsage() == SendSideBwe::BandwidthUsage::normal);
+    CHECK(bwe.getLossRate() == 0);
+    auto bitrate = bwe.getBitrate();
+    CHECK(bitrate > 300 * 1000 && bitrate <= 1.5 * acked + 10000, bitrate);
+}
+
+// 排队时延持续增长时检测到过载并降低码率
+// Overuse is detected and the rate decreases when the queueing delay keeps growing
+static void test_overuse() {
+    SendSideBwe bwe(2000 * 1000, 50 * 1000, 5000 * 1000);
+    uint16_t seq = 1000;
+    uint64_t now_ms = 10000;
+    bool overusing = false;
+    for (int i = 0; i < 20; ++i) {
+        // 每个包的到达间隔为12ms，即排队时延每包增长2ms
+        // Packets arrive every 12ms, the queueing delay grows 2ms per packet
+        simulate(bwe, seq, now_ms, kFeedbackPackets, [i](size_t index, uint64_t send_ms) {
+            return 10000 + 20.0 + (i * kFeedbackPackets + index) * 12.0;
+        });
+        overusing |= bwe.getUsage() == SendSideBwe::BandwidthUsage::overusing;
+    }
+    CHECK(overusing);
+    auto bitrate = bwe.getBitrate();
+    CHECK(bitrate < 1000 * 1000, bitrate);
+}
+
+// 持续丢包时基于丢包的码率控制降低码率
+// The loss based controller decreases the rate under sustained loss
+static void test_loss() {
+    SendSideBwe bwe(1000 * 1000, 50 * 1000, 5000 * 1000);
+    uint16_t seq = 1000;
+    uint64_t now_ms = 10000;
+    simulate(bwe, seq, now_ms, 200, [](size_t index, uint64_t send_ms) { return index % 5 == 0 ? -1.0 : send_ms + 20.0; });
+    CHECK(std::fabs(bwe.getLossRate() - 0.2f) < 0.05f, bwe.getLossRate());
+    auto bitrate = bwe.getBitrate();
+    CHECK(bitrate < 1000 * 1000, bitrate);
+    CHECK(bitrate >= 50 * 1000, bitrate);
+}
+
+// remb作为估计值的上限，未收到twcc反馈时直接使用remb
+// Remb caps the estimate, and is used directly before any twcc feedback
+static void test_remb() {
+    SendSideBwe bwe(300 * 1000, 50 * 1000, 5000 * 1000);
+    CHECK(bwe.getBitrate() == 300 * 1000);
+    bwe.onRemb(1000 * 1000);
+    CHECK(bwe.getBitrate() == 1000 * 1000);
+    bwe.onRemb(10 * 1000);
+    CHECK(bwe.getBitrate() == 50 * 1000);
+
+    uint16_t seq = 1000;
+    uint64_t now_ms = 10000;
+    bwe.onRemb(200 * 1000);
+    simulate(bwe, seq, now_ms, 500, [](size_t index, uint64_t send_ms) { return send_ms + 20.0; });
+    CHECK(bwe.getBitrate() == 200 * 1000);
+    CHECK(bwe.getNextSeq() == seq);
+}
+
+int main() {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    try {
+        test_twcc_chunk_wrap_around();
+        test_stable();
+        test_overuse();
+        test_loss();
+        test_remb();
+    } catch (std::exception &ex) {
+        ErrorL << "test failed: " << ex.what();
+        return -1;
+    }
+    InfoL << "all send side bwe tests passed";
+    return 0;
+}
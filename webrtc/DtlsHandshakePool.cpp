@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <thread>
+#include "DtlsHandshakePool.h"
+#include "Common/config.h"
+#include "Util/util.h"
+#include "Thread/ThreadPool.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+namespace Rtc {
+#define RTC_FIELD "rtc."
+const string kDtlsWorkerThreads = RTC_FIELD "dtlsWorkerThreads";
+const string kDtlsMaxPendingHandshakes = RTC_FIELD "dtlsMaxPendingHandshakes";
+
+static onceToken token([]() {
+    mINI::Instance()[kDtlsWorkerThreads] = -1;
+    mINI::Instance()[kDtlsMaxPendingHandshakes] = 256;
+});
+} // namespace Rtc
+
+INSTANCE_IMP(DtlsHandshakePool)
+
+DtlsHandshakePool::DtlsHandshakePool() {
+    GET_CONFIG(int, threads, Rtc::kDtlsWorkerThreads);
+    if (threads < 0) {
+        // 与poller线程数一致，大量观众同时加入时握手吞吐不低于在poller线程上握手
+        // As many as the poller threads, so the handshake throughput of a join storm is no lower than handshaking on the pollers
+        threads = thread::hardware_concurrency();
+    }
+    if (threads > 0) {
+        // 与WorkThreadPool一样使用最低优先级，握手计算让位于媒体转发
+        // The lowest priority like WorkThreadPool, handshake crypto yields to media forwarding
+        addPoller("dtls worker", threads, ThreadPool::PRIORITY_LOWEST, false);
+        _enabled = true;
+    }
+}
+
+bool DtlsHandshakePool::async(std::function<void()> task) {
+    GET_CONFIG(uint32_t, max_pending, Rtc::kDtlsMaxPendingHandshakes);
+    if (_pending.fetch_add(1) >= max_pending) {
+        --_pending;
+        ++_shed;
+        return false;
+    }
+    ++_offloaded;
+    auto begin = getCurrentMillisecond();
+    getExecutor()->async([this, begin, task]() {
+        _queue_delay.record(getCurrentMillisecond() - begin);
+        task();
+        --_pending;
+    }, false);
+    return true;
+}
+
+DtlsHandshakePool::Statistic DtlsHandshakePool::getStatistic() const {
+    Statistic ret;
+    ret.pending = _pending;
+    ret.offloaded = _offloaded;
+    ret.shed = _shed;
+    ret.handshake = &_handshake;
+    ret.queue_delay = &_queue_delay;
+    return ret;
+}
+
+} // namespace mediakit
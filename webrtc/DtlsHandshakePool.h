@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DTLSHANDSHAKEPOOL_H
+#define ZLMEDIAKIT_DTLSHANDSHAKEPOOL_H
+
+#include <atomic>
+#include <string>
+#include <functional>
+#include "Thread/TaskExecutor.h"
+#include "Common/PollerMonitor.h"
+
+namespace mediakit {
+
+namespace Rtc {
+// dtls握手工作线程数，置0时在poller线程上握手，-1为cpu核数，重启生效
+// Threads of the dtls handshake workers, 0 handshakes on the poller thread, -1 for the cpu count, takes effect after restart
+extern const std::string kDtlsWorkerThreads;
+// 排队与执行中的握手任务上限，超过后丢弃新的握手包，由对端重传
+// Max queued and running handshake jobs, new handshake packets beyond it are dropped and retransmitted by the peer
+extern const std::string kDtlsMaxPendingHandshakes;
+} // namespace Rtc
+
+/**
+ * dtls握手工作线程池：ECDHE与证书签名等握手计算在此执行，结果投递回所属poller，避免大量观众同时加入时阻塞媒体转发
+ * Dtls handshake worker pool: handshake crypto such as ECDHE and certificate signing runs here and the result is posted back
+ * to the owning poller, so a join storm of viewers does not block media forwarding
+ */
+class DtlsHandshakePool : public toolkit::TaskExecutorGetterImp {
+public:
+    struct Statistic {
+        // 排队与执行中的握手任务数
+        // Queued and running handshake jobs
+        uint64_t pending;
+        // 投递到工作线程的握手任务数
+        // Handshake jobs run on the workers
+        uint64_t offloaded;
+        // 因队列已满而丢弃的握手包数
+        // Handshake packets dropped because the queue was full
+        uint64_t shed;
+        // 从开始握手到dtls连接建立的耗时(毫秒)
+        // Time from the start of the handshake to the dtls connection in milliseconds
+        const LagHistogram *handshake;
+        // 握手任务在工作线程的排队耗时(毫秒)
+        // Queueing delay of handshake jobs on the workers in milliseconds
+        const LagHistogram *queue_delay;
+    };
+
+    static DtlsHandshakePool &Instance();
+
+    bool enabled() const { return _enabled; }
+
+    /**
+     * 投递握手任务，排队任务达到上限时放弃并返回false
+     * Post a handshake job, gives up and returns false when the queue is full
+     */
+    bool async(std::function<void()> task);
+
+    /**
+     * dtls连接建立，记录握手耗时
+     * The dtls connection is established, record the handshake time
+     */
+    void onHandshakeDone(uint64_t ms) { _handshake.record(ms); }
+
+    Statistic getStatistic() const;
+
+private:
+    DtlsHandshakePool();
+
+private:
+    bool _enabled = false;
+    std::atomic<uint64_t> _pending { 0 };
+    std::atomic<uint64_t> _offloaded { 0 };
+    std::atomic<uint64_t> _shed { 0 };
+    LagHistogram _handshake;
+    LagHistogram _queue_delay;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DTLSHANDSHAKEPOOL_H
@@ -20,6 +20,7 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 // #define MS_LOG_DEV_LEVEL 3
 
 #include "DtlsTransport.hpp"
+#include "DtlsHandshakePool.h"
 #include "logger.h"
 #include <openssl/asn1.h>
 #include <openssl/bn.h>
@@ -584,7 +585,8 @@ namespace RTC
     {
         MS_TRACE();
 
-        if (IsRunning())
+        // The listener is gone if the owner released us while a handshake job was running.
+        if (IsRunning() && this->listener)
         {
             // Send close alert to the peer.
             SSL_shutdown(this->ssl);
@@ -678,6 +680,7 @@ namespace RTC
 
         // Update local role.
         this->localRole = localRole;
+        this->handshakeStartMs = getCurrentMillisecond();
 
         // Set state and notify the listener.
         this->state = DtlsState::CONNECTING;
@@ -739,15 +742,44 @@ namespace RTC
     {
         MS_TRACE();
 
-        int written;
-        int read;
-
         if (!IsRunning())
         {
             MS_WARN_TAG(nullptr,"cannot process data while not running");
             return;
         }
 
+        // 握手任务执行期间收到的数据按序排队，任务结束后再处理
+        // Data received while the handshake job runs is queued in order and processed after the job
+        if (this->handshakeBusy)
+        {
+            if (this->pendingDtlsData.size() < MaxPendingDtlsData)
+                this->pendingDtlsData.emplace_back(reinterpret_cast<const char*>(data), len);
+            else
+                MS_WARN_TAG(dtls, "too much DTLS data pending on the handshake job, dropping it");
+
+            return;
+        }
+
+        // 握手计算(ECDHE、证书签名等)投递到dtls工作线程池
+        // Handshake crypto (ECDHE, certificate signing and so on) is posted to the dtls worker pool
+        if (!this->handshakeDone && mediakit::DtlsHandshakePool::Instance().enabled())
+        {
+            OffloadDtlsData(data, len);
+
+            return;
+        }
+
+        int read = ReadDtlsData(data, len);
+
+        OnDtlsDataRead(read, SSL_get_error(this->ssl, read));
+    }
+
+    int DtlsTransport::ReadDtlsData(const uint8_t* data, size_t len)
+    {
+        MS_TRACE();
+
+        int written;
+
         // Write the received DTLS data into the sslBioFromNetwork.
         written =
           BIO_write(this->sslBioFromNetwork, static_cast<const void*>(data), static_cast<int>(len));
@@ -762,13 +794,18 @@ namespace RTC
         }
 
         // Must call SSL_read() to process received DTLS data.
-        read = SSL_read(this->ssl, static_cast<void*>(DtlsTransport::sslReadBuffer), SslReadBufferSize);
+        return SSL_read(this->ssl, static_cast<void*>(DtlsTransport::sslReadBuffer), SslReadBufferSize);
+    }
+
+    void DtlsTransport::OnDtlsDataRead(int read, int err)
+    {
+        MS_TRACE();
 
         // Send data if it's ready.
         SendPendingOutgoingDtlsData();
 
         // Check SSL status and return if it is bad/closed.
-        if (!CheckStatus(read))
+        if (!CheckError(err))
             return;
 
         // Set/update the DTLS timeout.
@@ -792,6 +829,74 @@ namespace RTC
         }
     }
 
+    void DtlsTransport::OffloadDtlsData(const uint8_t* data, size_t len)
+    {
+        MS_TRACE();
+
+        auto buffer = std::make_shared<std::string>(reinterpret_cast<const char*>(data), len);
+        auto self   = shared_from_this();
+
+        this->handshakeBusy = true;
+
+        auto queued = mediakit::DtlsHandshakePool::Instance().async([self, buffer]() mutable {
+            int read = self->ReadDtlsData(reinterpret_cast<const uint8_t*>(buffer->data()), buffer->size());
+            int err  = SSL_get_error(self->ssl, read);
+
+            // The OpenSSL error queue is thread local, log and clear it here.
+            if (ERR_peek_error() != 0)
+                LOG_OPENSSL_ERROR("SSL_read() failed on the DTLS worker");
+
+            // 将所有权交给poller线程，析构与listener回调只在poller线程上发生
+            // Hand the ownership over to the poller so destruction and listener callbacks only happen there
+            auto poller = self->poller;
+            poller->async(
+              std::bind(
+                [](const DtlsTransport::Ptr& strong_self, int read, int err) {
+                    // 任务执行期间所属者已释放本对象，listener已失效
+                    // The owner released us while the job was running, the listener is gone
+                    if (strong_self.use_count() == 1)
+                    {
+                        strong_self->listener = nullptr;
+
+                        return;
+                    }
+
+                    strong_self->OnDtlsDataOffloaded(read, err);
+                },
+                std::move(self),
+                read,
+                err),
+              false);
+        });
+
+        if (!queued)
+        {
+            // 工作线程过载，丢弃该握手包，由对端重传
+            // The workers are overloaded, drop the handshake data and let the peer retransmit it
+            this->handshakeBusy = false;
+
+            MS_WARN_TAG(dtls, "DTLS handshake workers overloaded, dropping handshake data");
+        }
+    }
+
+    void DtlsTransport::OnDtlsDataOffloaded(int read, int err)
+    {
+        MS_TRACE();
+
+        this->handshakeBusy = false;
+
+        OnDtlsDataRead(read, err);
+
+        // Process the data received while the handshake job was running.
+        while (!this->handshakeBusy && IsRunning() && !this->pendingDtlsData.empty())
+        {
+            auto data = std::move(this->pendingDtlsData.front());
+
+            this->pendingDtlsData.pop_front();
+            ProcessDtlsData(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        }
+    }
+
     void DtlsTransport::SendApplicationData(const uint8_t* data, size_t len)
     {
         MS_TRACE();
@@ -855,6 +960,7 @@ namespace RTC
         this->state            = DtlsState::NEW;
         this->handshakeDone    = false;
         this->handshakeDoneNow = false;
+        this->pendingDtlsData.clear();
 
         // Reset SSL status.
         // NOTE: For this to properly work, SSL_shutdown() must be called before.
@@ -870,10 +976,14 @@ namespace RTC
     {
         MS_TRACE();
 
-        int err;
-        bool wasHandshakeDone = this->handshakeDone;
+        return CheckError(SSL_get_error(this->ssl, returnCode));
+    }
 
-        err = SSL_get_error(this->ssl, returnCode);
+    inline bool DtlsTransport::CheckError(int err)
+    {
+        MS_TRACE();
+
+        bool wasHandshakeDone = this->handshakeDone;
 
         switch (err)
         {
@@ -1303,6 +1413,8 @@ namespace RTC
         std::memcpy(srtpRemoteMasterKey, srtpRemoteKey, srtpKeyLength);
         std::memcpy(srtpRemoteMasterKey + srtpKeyLength, srtpRemoteSalt, srtpSaltLength);
 
+        mediakit::DtlsHandshakePool::Instance().onHandshakeDone(getCurrentMillisecond() - this->handshakeStartMs);
+
         // Set state and notify the listener.
         this->state = DtlsState::CONNECTED;
         this->listener->OnDtlsTransportConnected(
@@ -1434,6 +1546,10 @@ namespace RTC
             return;
         }
 
+        // The ssl instance belongs to the DTLS worker, its handshake job sets the timer again.
+        if (this->handshakeBusy)
+            return;
+
         DTLSv1_handle_timeout(this->ssl);
 
         // If required, send DTLS data.
@@ -24,6 +24,7 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <openssl/ssl.h>
 #include <openssl/x509.h>
 #include <map>
+#include <deque>
 #include <string>
 #include <vector>
 #include "Poller/Timer.h"
@@ -217,6 +218,11 @@ namespace RTC
         }
         void Reset();
         bool CheckStatus(int returnCode);
+        bool CheckError(int err);
+        int ReadDtlsData(const uint8_t* data, size_t len);
+        void OnDtlsDataRead(int read, int err);
+        void OffloadDtlsData(const uint8_t* data, size_t len);
+        void OnDtlsDataOffloaded(int read, int err);
         void SendPendingOutgoingDtlsData();
         bool SetTimeout();
         bool ProcessHandshake();
@@ -245,6 +251,14 @@ namespace RTC
         bool handshakeDone{ false };
         bool handshakeDoneNow{ false };
         std::string remoteCert;
+        // 握手任务在dtls工作线程上执行中，期间ssl实例归工作线程所有
+        // A handshake job is running on a dtls worker, the ssl instance belongs to the worker meanwhile
+        bool handshakeBusy{ false };
+        // 握手任务执行期间收到的dtls数据
+        // Dtls data received while the handshake job runs
+        std::deque<std::string> pendingDtlsData;
+        static constexpr size_t MaxPendingDtlsData{ 32 };
+        uint64_t handshakeStartMs{ 0 };
         //最大不超过mtu
         static constexpr int SslReadBufferSize{ 2000 };
         uint8_t sslReadBuffer[SslReadBufferSize];
@@ -18,6 +18,7 @@
 #include "Common/config.h"
 #include "IceTransport.hpp"
 #include "WebRtcTransport.h"
+#include "UdpBatchSender.h"
 
 using namespace std;
 using namespace toolkit;
@@ -208,6 +209,34 @@ void IceTransport::sendSocketData_l(const Buffer::Ptr& buf, const Pair::Ptr& pai
     }
 }
 
+void IceTransport::sendSocketDataBatch_l(const std::vector<Buffer::Ptr>& bufs, const Pair::Ptr& pair, bool gso) {
+    size_t sent = 0;
+    auto sock = pair->_socket->getSock();
+    // 仅在socket发送队列为空时绕过队列直接发送，保证与队列中数据的先后顺序
+    // Bypass the socket queue only when it is empty, to keep the order with queued data
+    if (sock->sockType() == SockNum::Sock_UDP && !pair->_socket->isSocketBusy() && !sock->getSendBufferCount()) {
+        sockaddr_storage peer_addr;
+        pair->get_peer_addr(peer_addr);
+        auto addr_len = SockUtil::get_sock_len((const struct sockaddr*)&peer_addr);
+        while (sent < bufs.size()) {
+            auto count = UdpBatchSender::send(sock->rawFD(), (struct sockaddr*)&peer_addr, addr_len, bufs, sent, gso);
+            if (!count) {
+                break;
+            }
+            sent += count;
+        }
+    }
+    if (sent == bufs.size()) {
+        return;
+    }
+    // 其余数据包交由socket发送队列，等待可写时发出
+    // The rest go to the socket send queue and are sent when writable
+    UdpBatchSender::addFallback(bufs.size() - sent);
+    for (size_t i = sent; i < bufs.size(); ++i) {
+        sendSocketData_l(bufs[i], pair, i + 1 == bufs.size());
+    }
+}
+
 bool IceTransport::processSocketData(const uint8_t* data, size_t len, const Pair::Ptr& pair) {
 #if 0
     TraceL << pair->dumpString(0) << " data len: " << len;
@@ -2118,6 +2147,22 @@ void IceAgent::sendSocketData(const Buffer::Ptr& buf, const Pair::Ptr& pair, boo
     return sendSocketData_l(buf, use_pair, flush);
 }
 
+void IceAgent::sendSocketDataBatch(const std::vector<Buffer::Ptr>& bufs, bool gso) {
+    auto use_pair = getSelectedPair();
+    if (use_pair == nullptr) {
+        WarnL << "pair should not be nullptr";
+        return;
+    }
+
+    if (use_pair->_relayed_addr) {
+        for (size_t i = 0; i < bufs.size(); ++i) {
+            sendRelayPacket(bufs[i], use_pair, i + 1 == bufs.size());
+        }
+        return;
+    }
+    return sendSocketDataBatch_l(bufs, use_pair, gso);
+}
+
 void IceAgent::sendRelayPacket(const Buffer::Ptr &buffer, const Pair::Ptr &pair, bool flush) {
     // TraceL;
     auto forward_pair = std::make_shared<Pair>(*pair);
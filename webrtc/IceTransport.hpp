@@ -352,6 +352,11 @@ public:
     virtual bool processSocketData(const uint8_t* data, size_t len, const Pair::Ptr& pair);
     virtual void sendSocketData(const toolkit::Buffer::Ptr& buf, const Pair::Ptr& pair, bool flush = true);
     void sendSocketData_l(const toolkit::Buffer::Ptr& buf, const Pair::Ptr& pair, bool flush = true);
+    /**
+     * 向同一pair批量发送数据，udp且socket发送队列为空时通过UdpBatchSender发送，否则逐包发送
+     * Send a batch of data to one pair, via UdpBatchSender for udp when the socket send queue is empty, otherwise packet by packet
+     */
+    void sendSocketDataBatch_l(const std::vector<toolkit::Buffer::Ptr>& bufs, const Pair::Ptr& pair, bool gso);
 
 protected:
     virtual void processStunPacket(const StunPacket::Ptr& packet, const Pair::Ptr& pair);
@@ -539,6 +544,11 @@ public:
     void nominated(const Pair::Ptr& pair, CandidateTuple& candidate);
 
     void sendSocketData(const toolkit::Buffer::Ptr& buf, const Pair::Ptr& pair, bool flush = true) override;
+    /**
+     * 向选中的pair批量发送数据，最后一个数据包发送后flush
+     * Send a batch of data to the selected pair, flushed after the last packet
+     */
+    void sendSocketDataBatch(const std::vector<toolkit::Buffer::Ptr>& bufs, bool gso);
 
     IceAgent::Implementation getImplementation() const {
         return _implementation;
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstdlib>
+#include "JitterBuffer.h"
+#include "Simulcast.h"
+#include "Common/config.h"
+#include "Common/macros.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+namespace Rtc {
+#define RTC_FIELD "rtc."
+const string kAdaptiveJitterBuffer = RTC_FIELD "adaptiveJitterBuffer";
+const string kJitterBufferMinMS = RTC_FIELD "jitterBufferMinMS";
+const string kJitterBufferMaxMS = RTC_FIELD "jitterBufferMaxMS";
+
+static onceToken token([]() {
+    mINI::Instance()[kAdaptiveJitterBuffer] = 0;
+    mINI::Instance()[kJitterBufferMinMS] = 20;
+    mINI::Instance()[kJitterBufferMaxMS] = 1000;
+});
+} // namespace Rtc
+
+// 等待关键帧期间请求关键帧的最小间隔
+// Min interval of key frame requests while waiting for a key frame
+static constexpr uint64_t kKeyFrameRequestIntervalMS = 500;
+
+JitterBuffer::JitterBuffer(TrackType type, CodecId codec) {
+    _type = type;
+    _codec = codec;
+    switch (codec) {
+        case CodecH264:
+        case CodecH265:
+        case CodecVP8:
+        case CodecVP9:
+        case CodecAV1: _key_aware = type == TrackVideo; break;
+        default: _key_aware = false; break;
+    }
+    // 首个关键帧之前的帧无法解码
+    // Frames before the first key frame cannot be decoded
+    _wait_key = _key_aware;
+    updateTargetDelay();
+}
+
+int64_t JitterBuffer::unwrapSeq(uint16_t seq) {
+    if (!_started) {
+        _started = true;
+        _last_seq = seq;
+        return _last_seq;
+    }
+    auto ret = _last_seq + (int16_t)(seq - (uint16_t)_last_seq);
+    if (ret > _last_seq) {
+        _last_seq = ret;
+    }
+    return ret;
+}
+
+void JitterBuffer::inputRtp(const RtpPacket::Ptr &rtp, bool is_rtx, uint64_t now_ms) {
+    bool first = !_started;
+    auto seq = unwrapSeq(rtp->getSeq());
+    if (first) {
+        _next_seq = seq;
+        _highest_seq = seq - 1;
+    }
+    if (seq < _next_seq) {
+        // 该位置已输出或已放弃
+        // This position was released or given up already
+        ++_stats.packets_late;
+        return;
+    }
+    if (!_packets.emplace(seq, Item { rtp, now_ms }).second) {
+        // 重复的包
+        // Duplicated packet
+        return;
+    }
+    if (seq > _highest_seq) {
+        _highest_seq = seq;
+        if (!is_rtx) {
+            updateJitter(rtp, now_ms);
+        }
+    }
+    process(now_ms);
+}
+
+void JitterBuffer::updateJitter(const RtpPacket::Ptr &rtp, uint64_t now_ms) {
+    auto stamp = rtp->getStamp();
+    if (_jitter_started && rtp->sample_rate) {
+        // rfc3550的到达间隔抖动，换算为毫秒
+        // Interarrival jitter of rfc3550, in milliseconds
+        int64_t arrive_diff = now_ms - _last_arrive_ms;
+        int64_t stamp_diff = (int64_t)(int32_t)(stamp - _last_stamp) * 1000 / rtp->sample_rate;
+        auto d = (float)std::abs(arrive_diff - stamp_diff);
+        _jitter += (d - _jitter) / 16;
+        _stats.jitter_ms = _jitter;
+        updateTargetDelay();
+    }
+    _jitter_started = true;
+    _last_arrive_ms = now_ms;
+    _last_stamp = stamp;
+}
+
+void JitterBuffer::updateNackState(uint32_t rtt_ms, uint64_t recovered, uint64_t abandoned) {
+    auto recovered_inc = recovered - _nack_recovered;
+    auto abandoned_inc = abandoned - _nack_abandoned;
+    _nack_recovered = recovered;
+    _nack_abandoned = abandoned;
+    if (recovered_inc + abandoned_inc) {
+        auto ratio = (float)recovered_inc / (recovered_inc + abandoned_inc);
+        _stats.nack_recover_ratio += (ratio - _stats.nack_recover_ratio) / 8;
+    }
+    _rtt_ms = rtt_ms;
+    updateTargetDelay();
+}
+
+void JitterBuffer::updateTargetDelay() {
+    GET_CONFIG(uint32_t, min_ms, Rtc::kJitterBufferMinMS);
+    GET_CONFIG(uint32_t, max_ms, Rtc::kJitterBufferMaxMS);
+    // 3倍抖动覆盖绝大多数到达时间的波动；nack能找回丢包时，再按成功率预留1.5倍rtt给一次重传
+    // Three times the jitter covers most arrival variation; while nack recovers losses, 1.5 rtt scaled by the success ratio is left for a retransmission
+    auto target = 3 * _jitter + _stats.nack_recover_ratio * 1.5f * _rtt_ms;
+    target = MAX(target, (float)min_ms);
+    target = MIN(target, (float)max_ms);
+    if (target > _target_delay) {
+        // 快升慢降，避免网络波动时反复丢帧
+        // Rise fast and fall slowly so a fluctuating network does not drop frames again and again
+        _target_delay = target;
+    } else {
+        _target_delay += (target - _target_delay) / 64;
+    }
+    _stats.target_delay_ms = (uint32_t)_target_delay;
+}
+
+void JitterBuffer::process(uint64_t now_ms) {
+    while (!_packets.empty()) {
+        if (_wait_key) {
+            if (!seekKeyFrame(now_ms)) {
+                break;
+            }
+            continue;
+        }
+        auto deadline = now_ms - _packets.begin()->second.arrive_ms >= _target_delay;
+        if (outputFrame(now_ms, deadline)) {
+            continue;
+        }
+        // 首帧不完整或参考了缺失的帧，超过目标延时后放弃
+        // The head frame is incomplete or references a missing frame, give up after the target delay
+        if (!deadline) {
+            break;
+        }
+        dropFrame(now_ms);
+    }
+}
+
+bool JitterBuffer::outputFrame(uint64_t now_ms, bool deadline) {
+    auto begin = _packets.begin();
+    auto end = begin;
+    if (_type != TrackVideo) {
+        // 音频每个包即一帧
+        // Each audio packet is a frame
+        ++end;
+    } else {
+        auto stamp = begin->second.rtp->getStamp();
+        auto expect = begin->first;
+        bool complete = false;
+        for (; end != _packets.end() && end->first == expect; ++end, ++expect) {
+            if (end->second.rtp->getStamp() != stamp) {
+                // seq连续而时间戳变化，上一帧缺少marker位但是完整
+                // The seq is continuous while the timestamp changes, the previous frame lacks the marker bit but is complete
+                complete = true;
+                break;
+            }
+            if (end->second.rtp->getHeader()->mark) {
+                ++end;
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            return false;
+        }
+    }
+
+    if (begin->first != _next_seq) {
+        // 首帧完整但之前有缺失的包：完整的关键帧不依赖之前的帧，立即跳过；
+        // 不能识别关键帧时无从判断参考关系，等待重传至超时后跳过；否则首帧参考了缺失的帧，由dropFrame处理
+        // The head frame is complete but packets before it are missing: a complete key frame depends on nothing before it and skips them at once;
+        // without key frame recognition the references are unknown, so they are skipped once the retransmission wait times out;
+        // otherwise the head frame references the missing one and is left to dropFrame
+        bool skip = _key_aware ? SimulcastRtpRewriter::isKeyFrameStart(_codec, begin->second.rtp) : deadline;
+        if (!skip) {
+            return false;
+        }
+        if (_type != TrackVideo) {
+            // 音频每个包即一帧
+            // Each audio packet is a frame
+            _stats.frames_dropped += begin->first - _next_seq;
+        }
+        _next_seq = begin->first;
+    }
+
+    _stats.frame_delay_ms += ((float)(now_ms - begin->second.arrive_ms) - _stats.frame_delay_ms) / 16;
+    ++_stats.frames_output;
+    for (auto it = begin; it != end;) {
+        auto rtp = std::move(it->second.rtp);
+        _next_seq = it->first + 1;
+        it = _packets.erase(it);
+        if (_on_rtp) {
+            _on_rtp(std::move(rtp));
+        }
+    }
+    return true;
+}
+
+void JitterBuffer::dropFrame(uint64_t now_ms) {
+    auto begin = _packets.begin();
+    // 丢弃与首个缓存包时间戳相同的包
+    // Drop the packets sharing the timestamp of the first buffered one
+    auto stamp = begin->second.rtp->getStamp();
+    auto end = begin;
+    while (end != _packets.end() && end->second.rtp->getStamp() == stamp) {
+        _next_seq = end->first + 1;
+        ++end;
+    }
+    _packets.erase(begin, end);
+    ++_stats.frames_dropped;
+    if (_key_aware) {
+        // 后续帧参考了丢弃的帧，需等待关键帧
+        // The following frames reference the dropped one, wait for a key frame
+        _wait_key = true;
+        requestKeyFrame(now_ms);
+    }
+}
+
+bool JitterBuffer::seekKeyFrame(uint64_t now_ms) {
+    for (auto it = _packets.begin(); it != _packets.end(); ++it) {
+        if (SimulcastRtpRewriter::isKeyFrameStart(_codec, it->second.rtp)) {
+            // 关键帧之前的帧都无法解码
+            // Frames before the key frame cannot be decoded
+            countDropped(_packets.begin(), it);
+            _packets.erase(_packets.begin(), it);
+            _next_seq = it->first;
+            _wait_key = false;
+            return true;
+        }
+    }
+    // 关键帧的首包可能仍在重传途中，只丢弃超过目标延时的包
+    // The first packet of the key frame may still be on its way as a retransmission, drop only packets past the target delay
+    auto end = _packets.begin();
+    while (end != _packets.end() && now_ms - end->second.arrive_ms >= _target_delay) {
+        _next_seq = end->first + 1;
+        ++end;
+    }
+    countDropped(_packets.begin(), end);
+    _packets.erase(_packets.begin(), end);
+    requestKeyFrame(now_ms);
+    return false;
+}
+
+void JitterBuffer::countDropped(Map::iterator begin, Map::iterator end) {
+    bool first = true;
+    uint32_t stamp = 0;
+    for (auto it = begin; it != end; ++it) {
+        auto cur = it->second.rtp->getStamp();
+        if (first || cur != stamp) {
+            ++_stats.frames_dropped;
+            stamp = cur;
+            first = false;
+        }
+    }
+}
+
+void JitterBuffer::requestKeyFrame(uint64_t now_ms) {
+    if (now_ms - _last_key_request_ms < kKeyFrameRequestIntervalMS) {
+        return;
+    }
+    _last_key_request_ms = now_ms;
+    ++_stats.keyframe_requests;
+    if (_on_key_request) {
+        _on_key_request();
+    }
+}
+
+} // namespace mediakit
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_JITTERBUFFER_H
+#define ZLMEDIAKIT_JITTERBUFFER_H
+
+#include <map>
+#include <memory>
+#include <functional>
+#include "Rtsp/Rtsp.h"
+
+namespace mediakit {
+
+namespace Rtc {
+// webrtc推流是否使用自适应jitter buffer，只输出完整的帧
+// Whether webrtc publishers use the adaptive jitter buffer which releases complete frames only
+extern const std::string kAdaptiveJitterBuffer;
+// jitter buffer等待缺失包的最短、最长时间，单位毫秒
+// Min and max time the jitter buffer waits for missing packets in milliseconds
+extern const std::string kJitterBufferMinMS;
+extern const std::string kJitterBufferMaxMS;
+} // namespace Rtc
+
+/**
+ * webrtc推流接收端的自适应jitter buffer：按帧组装rtp，只按顺序输出完整的帧；
+ * 等待缺失包的最长时间(目标延时)由实测的到达抖动、rtt以及nack重传的成功率决定，网络好时几乎不增加延时；
+ * 视频帧超时仍不完整时丢弃，并丢弃后续帧直到下一个关键帧，同时请求关键帧
+ * Adaptive jitter buffer on the receiving side of webrtc publishers: rtp is assembled into frames and only complete frames are released, in order;
+ * the longest wait for missing packets (the target delay) follows the measured arrival jitter, the rtt and how well nack retransmissions work,
+ * so good links get almost no extra latency.
+ * A video frame still incomplete at its deadline is dropped along with the following frames up to the next key frame, which is requested
+ */
+class JitterBuffer {
+public:
+    using Ptr = std::shared_ptr<JitterBuffer>;
+    using OnRtp = std::function<void(RtpPacket::Ptr rtp)>;
+    using OnKeyFrameRequest = std::function<void()>;
+
+    struct Stats {
+        // 当前目标延时，单位毫秒
+        // Current target delay in milliseconds
+        uint32_t target_delay_ms = 0;
+        // 到达抖动，单位毫秒
+        // Arrival jitter in milliseconds
+        float jitter_ms = 0;
+        // 帧在缓存中的平均等待时长，单位毫秒
+        // Average time frames wait in the buffer in milliseconds
+        float frame_delay_ms = 0;
+        // nack重传成功率
+        // Success ratio of nack retransmissions
+        float nack_recover_ratio = 1;
+        uint64_t frames_output = 0;
+        // 不完整而丢弃的帧数(音频为包数)
+        // Frames dropped as incomplete (packets for audio)
+        uint64_t frames_dropped = 0;
+        // 晚于输出位置到达而丢弃的包数
+        // Packets dropped for arriving behind the output position
+        uint64_t packets_late = 0;
+        uint64_t keyframe_requests = 0;
+    };
+
+    JitterBuffer(TrackType type, CodecId codec);
+
+    void setOnRtp(OnRtp cb) { _on_rtp = std::move(cb); }
+    void setOnKeyFrameRequest(OnKeyFrameRequest cb) { _on_key_request = std::move(cb); }
+
+    /**
+     * 输入rtp，完整的帧将同步输出
+     * Input an rtp, complete frames are released synchronously
+     * @param is_rtx 是否为重传包，重传包不参与抖动统计 / whether it is a retransmission, which is excluded from the jitter
+     */
+    void inputRtp(const RtpPacket::Ptr &rtp, bool is_rtx, uint64_t now_ms);
+
+    /**
+     * 更新nack状态，用于计算目标延时
+     * Update the nack state used for the target delay
+     * @param rtt_ms nack测得的rtt / rtt measured by nack
+     * @param recovered 累计重传成功的包数 / packets recovered by retransmission so far
+     * @param abandoned 累计放弃重传的包数 / packets given up by nack so far
+     */
+    void updateNackState(uint32_t rtt_ms, uint64_t recovered, uint64_t abandoned);
+
+    /**
+     * 检查超时的不完整帧，没有新包到达时也应定期调用
+     * Check incomplete frames past their deadline, should be called periodically even when no packets arrive
+     */
+    void process(uint64_t now_ms);
+
+    const Stats &getStats() const { return _stats; }
+
+private:
+    struct Item {
+        RtpPacket::Ptr rtp;
+        uint64_t arrive_ms;
+    };
+    using Map = std::map<int64_t, Item>;
+
+    int64_t unwrapSeq(uint16_t seq);
+    void updateJitter(const RtpPacket::Ptr &rtp, uint64_t now_ms);
+    void updateTargetDelay();
+    bool outputFrame(uint64_t now_ms, bool deadline);
+    void dropFrame(uint64_t now_ms);
+    bool seekKeyFrame(uint64_t now_ms);
+    void requestKeyFrame(uint64_t now_ms);
+    void countDropped(Map::iterator begin, Map::iterator end);
+
+private:
+    TrackType _type;
+    CodecId _codec;
+    // 能否识别关键帧，不能识别时丢帧后不等待关键帧
+    // Whether key frames can be recognized, if not no key frame is waited for after a drop
+    bool _key_aware;
+    bool _wait_key;
+    OnRtp _on_rtp;
+    OnKeyFrameRequest _on_key_request;
+
+    Map _packets;
+    bool _started = false;
+    int64_t _last_seq = 0;
+    int64_t _next_seq = 0;
+    int64_t _highest_seq = 0;
+
+    // 抖动统计
+    // Jitter statistics
+    bool _jitter_started = false;
+    uint64_t _last_arrive_ms = 0;
+    uint32_t _last_stamp = 0;
+    float _jitter = 0;
+
+    uint32_t _rtt_ms = 0;
+    uint64_t _nack_recovered = 0;
+    uint64_t _nack_abandoned = 0;
+    float _target_delay = 0;
+    uint64_t _last_key_request_ms = 0;
+    Stats _stats;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_JITTERBUFFER_H
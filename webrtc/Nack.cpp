@@ -283,6 +283,7 @@ void NackContext::clearNackStatus(uint16_t seq) {
     // The time between receiving the retransmitted packet and the first nack packet is approximately equal to the rtt time.
     auto rtt = getCurrentMillisecond() - it->second.first_stamp;
     _nack_send_status.erase(it);
+    ++_recovered;
 
     // 限定rtt在合理有效范围内  [AUTO-TRANSLATED:42fbed04]
     // Limit the rtt within a reasonable and valid range.
@@ -308,6 +309,7 @@ void NackContext::recordNack(const FCI_NACK &nack) {
     GET_CONFIG(uint32_t, nack_maxsize, Rtc::kNackMaxSize);
     while (_nack_send_status.size() > nack_maxsize) {
         _nack_send_status.erase(_nack_send_status.begin());
+        ++_abandoned;
     }
 }
 
@@ -322,6 +324,7 @@ uint64_t NackContext::reSendNack() {
             // 该rtp丢失太久了，不再要求重传  [AUTO-TRANSLATED:a0a1e471]
             // This rtp has been lost for too long, no longer require retransmission.
             it = _nack_send_status.erase(it);
+            ++_abandoned;
             continue;
         }
         if (now - it->second.update_stamp < nack_intervalratio * _rtt) {
@@ -340,6 +343,7 @@ uint64_t NackContext::reSendNack() {
             // nack次数太多，移除之  [AUTO-TRANSLATED:1b684a9c]
             // Too many nack times, remove it.
             it = _nack_send_status.erase(it);
+            ++_abandoned;
             continue;
         }
         ++it;
@@ -23,6 +23,15 @@ namespace mediakit {
 // RTC配置项目  [AUTO-TRANSLATED:19940011]
 // RTC configuration project
 namespace Rtc {
+// ~ nack接收端, rtp发送端
+// ~ nack receiver, rtp sender
+// rtp重发缓存列队最大长度，单位毫秒
+// rtp retransmission cache queue maximum length, in milliseconds
+extern const std::string kMaxRtpCacheMS;
+// rtp重发缓存列队最大长度，单位个数
+// rtp retransmission cache queue maximum length, in number
+extern const std::string kMaxRtpCacheSize;
+
 // ~ nack发送端，rtp接收端  [AUTO-TRANSLATED:bb169205]
 // ~ nack sender, rtp receiver
 // 最大保留的rtp丢包状态个数  [AUTO-TRANSLATED:70eee442]
@@ -37,12 +46,12 @@ class NackList {
 public:
     void pushBack(RtpPacket::Ptr rtp);
     void forEach(const FCI_NACK &nack, const std::function<void(const RtpPacket::Ptr &rtp)> &cb);
+    RtpPacket::Ptr *getRtp(uint16_t seq);
 
 private:
     void popFront();
     uint32_t getCacheMS();
     int64_t getNtpStamp(uint16_t seq);
-    RtpPacket::Ptr *getRtp(uint16_t seq);
 
 private:
     uint32_t _cache_ms_check = 0;
@@ -61,6 +70,12 @@ public:
     void setOnNack(onNack cb);
     uint64_t reSendNack();
 
+    int getRtt() const { return _rtt; }
+    // 累计重传成功与放弃重传的包数
+    // Packets recovered by retransmission and packets given up so far
+    uint64_t getRecovered() const { return _recovered; }
+    uint64_t getAbandoned() const { return _abandoned; }
+
 private:
     void eraseFrontSeq();
     void doNack(const FCI_NACK &nack, bool record_nack);
@@ -71,6 +86,8 @@ private:
 private:
     bool _started = false;
     int _rtt = 50;
+    uint64_t _recovered = 0;
+    uint64_t _abandoned = 0;
     onNack _cb;
     std::set<uint16_t> _seq;
     // 最新nack包中的rtp seq值  [AUTO-TRANSLATED:6984d95a]
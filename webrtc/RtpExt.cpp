@@ -580,6 +580,71 @@ void RtpExtContext::setRid(uint32_t ssrc, const string &rid) {
     _ssrc_to_rid[ssrc] = rid;
 }
 
+bool RtpExtContext::setTransportCCSeq(RtpHeader *header, int &len, uint16_t seq) const {
+    auto it = _rtp_ext_type_to_id.find(RtpExtType::transport_cc);
+    if (it == _rtp_ext_type_to_id.end()) {
+        return false;
+    }
+    auto ext_id = it->second;
+    // rtp已携带该扩展(例如转发rtc推流)时直接覆盖
+    // Overwrite directly if the rtp already carries the extension (e.g. forwarding a rtc push stream)
+    auto ext_map = RtpExt::getExtValue(header);
+    auto ext_it = ext_map.find(ext_id);
+    if (ext_it != ext_map.end() && ext_it->second.size() >= 2) {
+        auto ptr = (uint8_t *)ext_it->second.data();
+        ptr[0] = seq >> 8;
+        ptr[1] = seq & 0xFF;
+        return true;
+    }
+
+    uint8_t element[4];
+    auto reserved = header->getExtReserved();
+    if (!header->ext || reserved == kOneByteHeader) {
+        if (ext_id >= (uint8_t)RtpExtType::reserved) {
+            return false;
+        }
+        element[0] = (ext_id << 4) | 1;
+        element[1] = seq >> 8;
+        element[2] = seq & 0xFF;
+        element[3] = (uint8_t)RtpExtType::padding;
+    } else if ((reserved & 0xFFF0) == kTwoByteHeader) {
+        element[0] = ext_id;
+        element[1] = 2;
+        element[2] = seq >> 8;
+        element[3] = seq & 0xFF;
+    } else {
+        return false;
+    }
+
+    auto begin = (uint8_t *)header;
+    if (!header->ext) {
+        // 在csrc之后插入one-byte扩展头及该扩展
+        // Insert a one-byte extension header and the element after the csrc list
+        auto pos = &header->payload + header->getCsrcSize();
+        memmove(pos + 8, pos, len - (pos - begin));
+        pos[0] = kOneByteHeader >> 8;
+        pos[1] = kOneByteHeader & 0xFF;
+        pos[2] = 0;
+        pos[3] = 1;
+        memcpy(pos + 4, element, sizeof(element));
+        header->ext = 1;
+        len += 8;
+        return true;
+    }
+    // 追加到已有扩展末尾，扩展长度增加一个字(4字节)
+    // Append to the end of the existing extensions, the extension length grows by one word (4 bytes)
+    auto ext_size = header->getExtSize();
+    auto ext_data = header->getExtData();
+    auto pos = ext_data + ext_size;
+    memmove(pos + 4, pos, len - (pos - begin));
+    memcpy(pos, element, sizeof(element));
+    auto words = ext_size / 4 + 1;
+    ext_data[-2] = (words >> 8) & 0xFF;
+    ext_data[-1] = words & 0xFF;
+    len += 4;
+    return true;
+}
+
 RtpExt RtpExtContext::changeRtpExtId(const RtpHeader *header, bool is_recv, string *rid_ptr, RtpExtType type) {
     string rid, repaired_rid;
     RtpExt ret;
@@ -125,6 +125,15 @@ public:
     void setRid(uint32_t ssrc, const std::string &rid);
     RtpExt changeRtpExtId(const RtpHeader *header, bool is_recv, std::string *rid_ptr = nullptr, RtpExtType type = RtpExtType::padding);
 
+    /**
+     * 发送rtp时写入transport-cc扩展序号，须在changeRtpExtId之后调用；rtp不含该扩展时插入，调用者须在rtp之后预留至少8个字节
+     * @return 对端未协商transport-cc扩展时返回false
+     * Write the transport-cc sequence number when sending rtp, must be called after changeRtpExtId; the extension is inserted
+     * if the rtp does not carry it, the caller must reserve at least 8 bytes after the rtp
+     * @return false if the peer did not negotiate the transport-cc extension
+     */
+    bool setTransportCCSeq(RtpHeader *header, int &len, uint16_t seq) const;
+
 private:
     void onGetRtp(uint8_t pt, uint32_t ssrc, const std::string &rid);
 
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "RtpFec.h"
+#include "Common/macros.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// ulpfec头(10字节)与level 0头(短掩码，4字节)
+// Ulpfec header (10 bytes) and level 0 header (short mask, 4 bytes)
+static constexpr size_t kFecHeaderSize = 10 + 4;
+
+RtpFecEncoder::RtpFecEncoder(TrackType type, uint8_t red_pt, uint8_t ulpfec_pt) {
+    _type = type;
+    _red_pt = red_pt;
+    _ulpfec_pt = ulpfec_pt;
+}
+
+Buffer::Ptr RtpFecEncoder::wrapRed(const RtpPacket::Ptr &rtp, uint8_t media_pt) {
+    switch (_type) {
+        case TrackVideo: return wrapVideo(rtp, media_pt);
+        case TrackAudio: return wrapAudio(rtp, media_pt);
+        default: return nullptr;
+    }
+}
+
+Buffer::Ptr RtpFecEncoder::wrapVideo(const RtpPacket::Ptr &rtp, uint8_t media_pt) {
+    if (!_ulpfec_pt) {
+        return nullptr;
+    }
+    if (!_group_count) {
+        // 分组开始时按冗余度确定分组大小，分组内的包必须都封装为red
+        // The group size follows the redundancy at the start of a group, all packets of a group must be wrapped in red
+        _group_size = 0;
+        if (_ratio > 0) {
+            _group_size = MAX((size_t)(1 / _ratio + 0.5), (size_t)1);
+            if (_group_size > kMaxGroupSize) {
+                _group_size = kMaxGroupSize;
+            }
+        }
+    }
+    if (!_group_size) {
+        return nullptr;
+    }
+    auto header = rtp->getHeader();
+    auto payload = rtp->getPayload();
+    auto payload_size = rtp->getPayloadSize();
+    size_t header_size = payload - (uint8_t *)header;
+
+    auto ret = BufferRaw::create(header_size + 1 + payload_size);
+    auto ptr = (uint8_t *)ret->data();
+    memcpy(ptr, header, header_size);
+    // padding不拷贝
+    // Padding is not copied
+    ((RtpHeader *)ptr)->padding = 0;
+    ptr[header_size] = media_pt & 0x7F;
+    memcpy(ptr + header_size + 1, payload, payload_size);
+    ret->setSize(header_size + 1 + payload_size);
+    return ret;
+}
+
+Buffer::Ptr RtpFecEncoder::wrapAudio(const RtpPacket::Ptr &rtp, uint8_t media_pt) {
+    auto header = rtp->getHeader();
+    auto payload = rtp->getPayload();
+    auto payload_size = rtp->getPayloadSize();
+    size_t header_size = payload - (uint8_t *)header;
+    auto stamp = rtp->getStamp();
+
+    Buffer::Ptr ret;
+    if (_ratio > 0) {
+        // 冗余块的时间戳偏移为14位，长度为10位
+        // The timestamp offset of a redundant block has 14 bits and its length 10 bits
+        auto offset = stamp - _last_audio_stamp;
+        bool redundant = !_last_audio.empty() && offset && offset < 0x4000 && _last_audio.size() < 0x400;
+        auto size = header_size + (redundant ? 4 + _last_audio.size() : 0) + 1 + payload_size;
+        ret = BufferRaw::create(size);
+        auto ptr = (uint8_t *)ret->data();
+        memcpy(ptr, header, header_size);
+        ((RtpHeader *)ptr)->padding = 0;
+        ptr += header_size;
+        if (redundant) {
+            auto len = _last_audio.size();
+            ptr[0] = 0x80 | (media_pt & 0x7F);
+            ptr[1] = (offset >> 6) & 0xFF;
+            ptr[2] = ((offset & 0x3F) << 2) | ((len >> 8) & 0x03);
+            ptr[3] = len & 0xFF;
+            ptr += 4;
+        }
+        *ptr++ = media_pt & 0x7F;
+        if (redundant) {
+            memcpy(ptr, _last_audio.data(), _last_audio.size());
+            ptr += _last_audio.size();
+        }
+        memcpy(ptr, payload, payload_size);
+        ret->setSize(size);
+    }
+    if (payload_size) {
+        _last_audio.assign((char *)payload, payload_size);
+        _last_audio_stamp = stamp;
+    }
+    return ret;
+}
+
+uint16_t RtpFecEncoder::allocSeq(uint16_t media_seq) {
+    uint16_t sent_seq = media_seq + _seq_offset;
+    auto &media = _media_to_sent[media_seq % kSeqMapSize];
+    media.valid = true;
+    media.key = media_seq;
+    media.value = sent_seq;
+    auto &sent = _sent_to_media[sent_seq % kSeqMapSize];
+    sent.valid = true;
+    sent.fec = false;
+    sent.key = sent_seq;
+    sent.value = media_seq;
+    _next_seq = sent_seq + 1;
+    return sent_seq;
+}
+
+uint16_t RtpFecEncoder::getSentSeq(uint16_t media_seq) const {
+    auto &item = _media_to_sent[media_seq % kSeqMapSize];
+    if (item.valid && item.key == media_seq) {
+        return item.value;
+    }
+    return media_seq + _seq_offset;
+}
+
+bool RtpFecEncoder::getMediaSeq(uint16_t sent_seq, uint16_t &media_seq) const {
+    auto &item = _sent_to_media[sent_seq % kSeqMapSize];
+    if (item.valid && item.key == sent_seq) {
+        media_seq = item.value;
+        return !item.fec;
+    }
+    // 映射表已被覆盖，按当前偏移量估算
+    // The map entry is overwritten, estimate by the current offset
+    media_seq = sent_seq - _seq_offset;
+    return true;
+}
+
+void RtpFecEncoder::onSendRed(const char *buf, size_t len, uint8_t media_pt) {
+    auto header = (RtpHeader *)buf;
+    auto red = header->getPayloadData();
+    size_t header_size = red - (uint8_t *)buf;
+    if (len <= header_size) {
+        return;
+    }
+    auto seq = ntohs(header->seq);
+    if (_group_count && (uint16_t)(seq - _sn_base) >= kMaxGroupSize) {
+        // 源流存在seq跳变，超出掩码范围，先结束当前分组
+        // The source seq jumped out of the mask range, close the current group first
+        flushGroup(ntohl(header->ssrc));
+    }
+    if (!_group_count) {
+        _sn_base = seq;
+        _mask = 0;
+        _xor_header[0] = _xor_header[1] = 0;
+        _xor_stamp = 0;
+        _xor_length = 0;
+        _xor_payload.clear();
+    }
+
+    // 受保护的是去掉red头、pt为媒体pt的原始rtp，固定头之后的csrc、扩展与负载参与异或
+    // The protected packet is the original rtp without the red header and with the media pt,
+    // csrc, extensions and payload after the fixed header take part in the xor
+    auto ptr = (const uint8_t *)buf;
+    _xor_header[0] ^= ptr[0];
+    _xor_header[1] ^= (ptr[1] & 0x80) | (media_pt & 0x7F);
+    _xor_stamp ^= ntohl(header->stamp);
+    size_t ext_size = header_size - RtpPacket::kRtpHeaderSize;
+    size_t payload_size = len - header_size - 1;
+    size_t protect_size = ext_size + payload_size;
+    _xor_length ^= (uint16_t)protect_size;
+    if (_xor_payload.size() < protect_size) {
+        _xor_payload.resize(protect_size, '\0');
+    }
+    auto out = (uint8_t *)&_xor_payload[0];
+    auto ext = ptr + RtpPacket::kRtpHeaderSize;
+    for (size_t i = 0; i < ext_size; ++i) {
+        out[i] ^= ext[i];
+    }
+    // 跳过1字节red头
+    // Skip the 1 byte red header
+    auto payload = red + 1;
+    out += ext_size;
+    for (size_t i = 0; i < payload_size; ++i) {
+        out[i] ^= payload[i];
+    }
+    _mask |= 0x8000 >> (uint16_t)(seq - _sn_base);
+    _last_stamp = ntohl(header->stamp);
+    ++_group_count;
+
+    if (_group_count >= _group_size || header->mark) {
+        // 分组已满或到达帧尾
+        // The group is full or the frame ends
+        flushGroup(ntohl(header->ssrc));
+    }
+}
+
+void RtpFecEncoder::flushGroup(uint32_t ssrc) {
+    if (!_group_count) {
+        return;
+    }
+    auto protect_size = _xor_payload.size();
+    auto size = RtpPacket::kRtpHeaderSize + 1 + kFecHeaderSize + protect_size;
+    auto ret = BufferRaw::create(size);
+    auto ptr = (uint8_t *)ret->data();
+    memset(ptr, 0, RtpPacket::kRtpHeaderSize);
+    auto header = (RtpHeader *)ptr;
+    header->version = RtpPacket::kRtpVersion;
+    header->pt = _red_pt;
+    header->seq = htons(_next_seq);
+    header->stamp = htonl(_last_stamp);
+    header->ssrc = htonl(ssrc);
+    ptr += RtpPacket::kRtpHeaderSize;
+
+    // red头，唯一的块为ulpfec
+    // Red header, the only block is ulpfec
+    *ptr++ = _ulpfec_pt & 0x7F;
+
+    // E与L位为0
+    // E and L bits are 0
+    ptr[0] = _xor_header[0] & 0x3F;
+    ptr[1] = _xor_header[1];
+    ptr[2] = _sn_base >> 8;
+    ptr[3] = _sn_base & 0xFF;
+    ptr[4] = (_xor_stamp >> 24) & 0xFF;
+    ptr[5] = (_xor_stamp >> 16) & 0xFF;
+    ptr[6] = (_xor_stamp >> 8) & 0xFF;
+    ptr[7] = _xor_stamp & 0xFF;
+    ptr[8] = _xor_length >> 8;
+    ptr[9] = _xor_length & 0xFF;
+    ptr[10] = (protect_size >> 8) & 0xFF;
+    ptr[11] = protect_size & 0xFF;
+    ptr[12] = _mask >> 8;
+    ptr[13] = _mask & 0xFF;
+    memcpy(ptr + kFecHeaderSize, _xor_payload.data(), protect_size);
+    ret->setSize(size);
+
+    auto &item = _sent_to_media[_next_seq % kSeqMapSize];
+    item.valid = true;
+    item.fec = true;
+    item.key = _next_seq;
+    ++_next_seq;
+    ++_seq_offset;
+    _group_count = 0;
+    _fec_packets.emplace_back(std::move(ret));
+}
+
+Buffer::Ptr RtpFecEncoder::takeFecPacket() {
+    if (_fec_packets.empty()) {
+        return nullptr;
+    }
+    auto ret = std::move(_fec_packets.front());
+    _fec_packets.pop_front();
+    return ret;
+}
+
+} // namespace mediakit
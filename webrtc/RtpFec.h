@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RTPFEC_H
+#define ZLMEDIAKIT_RTPFEC_H
+
+#include <deque>
+#include <string>
+#include <memory>
+#include "Rtsp/Rtsp.h"
+
+namespace mediakit {
+
+/**
+ * 播放器发送端的red(rfc2198)与ulpfec(rfc5109)封装：冗余度随对端rr汇报的丢包率调整，无丢包时原样发送不增加开销
+ * 视频在丢包时封装为red，每k个媒体包(最多到帧尾)生成一个异或校验的ulpfec包，ulpfec包占用媒体流的seq，后续媒体包的seq顺延；
+ * 音频在丢包时封装为red并携带上一个包作为冗余
+ * Red (rfc2198) and ulpfec (rfc5109) encapsulation on the player side: the redundancy follows the loss reported by the rr of the peer,
+ * nothing changes while there is no loss.
+ * On loss video is wrapped in red and an xor parity ulpfec packet is generated for every k media packets (at most up to the end of the frame),
+ * ulpfec packets take seqs of the media stream so the seq of the following media packets is shifted;
+ * audio is wrapped in red carrying the previous packet as redundancy
+ */
+class RtpFecEncoder {
+public:
+    using Ptr = std::shared_ptr<RtpFecEncoder>;
+
+    /**
+     * @param red_pt 协商的red pt / negotiated red pt
+     * @param ulpfec_pt 协商的ulpfec pt，音频或未协商时为0 / negotiated ulpfec pt, 0 for audio or if not negotiated
+     */
+    RtpFecEncoder(TrackType type, uint8_t red_pt, uint8_t ulpfec_pt);
+
+    uint8_t getRedPt() const { return _red_pt; }
+
+    /**
+     * 设置冗余度，即ulpfec包数与媒体包数之比，在下一个分组开始时生效；音频大于0时携带冗余
+     * Set the redundancy, ulpfec packets per media packet, effective from the next group; audio carries redundancy when above 0
+     */
+    void setRatio(float ratio) { _ratio = ratio; }
+    float getRatio() const { return _ratio; }
+
+    /**
+     * 需要时将媒体rtp封装为red(不含tcp头)，不需要时返回nullptr
+     * Wrap the media rtp in red (without the tcp header) if needed, nullptr otherwise
+     * @param media_pt 协商的媒体pt，作为red块的pt / negotiated media pt, used as the pt of the red blocks
+     */
+    toolkit::Buffer::Ptr wrapRed(const RtpPacket::Ptr &rtp, uint8_t media_pt);
+
+    /**
+     * 为新发送的媒体rtp分配seq(为ulpfec包让出的seq顺延)
+     * Allocate the seq of a newly sent media rtp (shifted by the seqs given to ulpfec packets)
+     */
+    uint16_t allocSeq(uint16_t media_seq);
+
+    /**
+     * 已发送媒体rtp的seq，用于rtx的osn
+     * Seq a media rtp was sent with, used as the osn of rtx
+     */
+    uint16_t getSentSeq(uint16_t media_seq) const;
+
+    /**
+     * 对端nack的seq转换为媒体rtp的seq，ulpfec包或已过期时返回false
+     * Convert a seq nacked by the peer to the seq of the media rtp, false for ulpfec packets or expired seqs
+     */
+    bool getMediaSeq(uint16_t sent_seq, uint16_t &media_seq) const;
+
+    /**
+     * 将即将加密发送的red视频包计入ulpfec分组，此时pt/seq/ssrc/扩展已是最终值
+     * Add the red video packet about to be encrypted to the ulpfec group, pt/seq/ssrc/extensions are final by now
+     */
+    void onSendRed(const char *buf, size_t len, uint8_t media_pt);
+
+    /**
+     * 取出分组完成后生成的ulpfec包(已封装为red的完整rtp)，没有时返回nullptr
+     * Take an ulpfec packet generated when a group is complete (a full rtp wrapped in red), nullptr if none
+     */
+    toolkit::Buffer::Ptr takeFecPacket();
+
+private:
+    toolkit::Buffer::Ptr wrapVideo(const RtpPacket::Ptr &rtp, uint8_t media_pt);
+    toolkit::Buffer::Ptr wrapAudio(const RtpPacket::Ptr &rtp, uint8_t media_pt);
+    void flushGroup(uint32_t ssrc);
+
+private:
+    // ulpfec短掩码最多保护16个包
+    // A short ulpfec mask protects at most 16 packets
+    static constexpr size_t kMaxGroupSize = 16;
+    static constexpr size_t kSeqMapSize = 1024;
+
+    TrackType _type;
+    uint8_t _red_pt;
+    uint8_t _ulpfec_pt;
+    float _ratio = 0;
+
+    // 当前分组的大小，在分组开始时按冗余度确定，0表示不封装
+    // Size of the current group, decided at the start of the group by the redundancy, 0 for no wrapping
+    size_t _group_size = 0;
+    size_t _group_count = 0;
+    uint16_t _sn_base = 0;
+    uint16_t _mask = 0;
+    uint8_t _xor_header[2] = { 0 };
+    uint32_t _xor_stamp = 0;
+    uint32_t _last_stamp = 0;
+    uint16_t _xor_length = 0;
+    std::string _xor_payload;
+    std::deque<toolkit::Buffer::Ptr> _fec_packets;
+
+    // 发送seq = 媒体seq + 偏移量，每发送一个ulpfec包偏移量加1
+    // Sent seq = media seq + offset, the offset grows by one per ulpfec packet
+    uint16_t _seq_offset = 0;
+    uint16_t _next_seq = 0;
+    struct SeqItem {
+        bool valid = false;
+        bool fec = false;
+        uint16_t key = 0;
+        uint16_t value = 0;
+    };
+    SeqItem _media_to_sent[kSeqMapSize];
+    SeqItem _sent_to_media[kSeqMapSize];
+
+    // 音频上一个包的负载，作为下一个red包的冗余
+    // Payload of the previous audio packet, carried as redundancy by the next red packet
+    std::string _last_audio;
+    uint32_t _last_audio_stamp = 0;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RTPFEC_H
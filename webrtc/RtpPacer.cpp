@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "RtpPacer.h"
+#include "Common/macros.h"
+
+using namespace std;
+
+namespace mediakit {
+
+// 空闲时最多累积的发送额度，单位毫秒
+// Max budget accumulated while idle, in milliseconds
+static constexpr uint64_t kMaxBudgetMS = 20;
+
+RtpPacer::RtpPacer(uint32_t max_queue_ms, onSend cb) {
+    _max_queue_ms = MAX(max_queue_ms, (uint32_t)kIntervalMS);
+    _cb = std::move(cb);
+}
+
+void RtpPacer::enqueue(const RtpPacket::Ptr &rtp, bool rtx, uint64_t now_ms) {
+    _queue_bytes += rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    (rtx ? _rtx_queue : _queue).emplace_back(Item { rtp, rtx, now_ms });
+}
+
+uint64_t RtpPacer::getQueueDelay(uint64_t now_ms) const {
+    if (_queue.empty() && _rtx_queue.empty()) {
+        return 0;
+    }
+    uint64_t stamp = UINT64_MAX;
+    if (!_queue.empty()) {
+        stamp = _queue.front().enqueue_ms;
+    }
+    if (!_rtx_queue.empty()) {
+        stamp = MIN(stamp, _rtx_queue.front().enqueue_ms);
+    }
+    return now_ms > stamp ? now_ms - stamp : 0;
+}
+
+void RtpPacer::process(uint64_t now_ms) {
+    if (!_last_process_ms) {
+        _last_process_ms = now_ms;
+    }
+    auto elapsed = MIN(now_ms - MIN(now_ms, _last_process_ms), kMaxBudgetMS);
+    _last_process_ms = now_ms;
+
+    // 排队数据须在max_queue_ms内发完，速率不足时临时提速
+    // Queued data must be sent within max_queue_ms, speed up temporarily if the rate is insufficient
+    auto rate = MAX((double)_rate_bps, _queue_bytes * 8000.0 / _max_queue_ms);
+    _budget = MIN(_budget + rate * elapsed / 8000, rate * kMaxBudgetMS / 8000);
+    while ((!_queue.empty() || !_rtx_queue.empty()) && _budget > 0) {
+        // 重传包优先
+        // Retransmissions first
+        auto &queue = _rtx_queue.empty() ? _queue : _rtx_queue;
+        auto item = std::move(queue.front());
+        queue.pop_front();
+        auto size = item.rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+        _queue_bytes -= size;
+        _budget -= size;
+        // 本轮最后一个包时刷新批量发送缓存
+        // Flush the egress batch on the last packet of this round
+        _cb(item.rtp, item.rtx, (_queue.empty() && _rtx_queue.empty()) || _budget <= 0);
+    }
+}
+
+} // namespace mediakit
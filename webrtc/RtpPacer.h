@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RTPPACER_H
+#define ZLMEDIAKIT_RTPPACER_H
+
+#include <deque>
+#include <memory>
+#include <functional>
+#include "Rtsp/Rtsp.h"
+
+namespace mediakit {
+
+/**
+ * rtp发送平滑器(令牌桶)：按带宽估计值乘以系数的速率发出排队的rtp包，避免关键帧等突发数据一次性涌入网络；
+ * 排队时长超过上限时临时提高发送速率，保证排队时延可控
+ * Rtp pacer (token bucket): queued rtp packets are sent at the bandwidth estimate times a factor, so bursts such as key frames
+ * do not flood the network at once; the rate is raised temporarily when the queue would exceed the max queueing time
+ */
+class RtpPacer {
+public:
+    using Ptr = std::shared_ptr<RtpPacer>;
+    using onSend = std::function<void(const RtpPacket::Ptr &rtp, bool rtx, bool flush)>;
+
+    // 定时发送周期，单位毫秒
+    // Processing interval in milliseconds
+    static constexpr uint32_t kIntervalMS = 5;
+
+    RtpPacer(uint32_t max_queue_ms, onSend cb);
+
+    /**
+     * 设置发送速率，单位bit/s
+     * Set the pacing rate in bit/s
+     */
+    void setPacingRate(uint32_t bps) { _rate_bps = bps; }
+    uint32_t getPacingRate() const { return _rate_bps; }
+
+    void enqueue(const RtpPacket::Ptr &rtp, bool rtx, uint64_t now_ms);
+
+    /**
+     * 按累积的发送额度发出排队的数据包
+     * Send queued packets within the accumulated budget
+     */
+    void process(uint64_t now_ms);
+
+    size_t getQueueSize() const { return _queue.size() + _rtx_queue.size(); }
+    size_t getQueueBytes() const { return _queue_bytes; }
+
+    /**
+     * 最早入队的数据包的排队时长
+     * Queueing time of the oldest packet
+     */
+    uint64_t getQueueDelay(uint64_t now_ms) const;
+
+private:
+    struct Item {
+        RtpPacket::Ptr rtp;
+        bool rtx;
+        uint64_t enqueue_ms;
+    };
+
+    uint32_t _max_queue_ms;
+    uint32_t _rate_bps = 0;
+    uint64_t _last_process_ms = 0;
+    double _budget = 0;
+    size_t _queue_bytes = 0;
+    std::deque<Item> _queue;
+    // 重传包优先于媒体包发出，尽快修复对端已在等待的丢包
+    // Retransmissions are sent ahead of media packets to repair losses the peer is already waiting for
+    std::deque<Item> _rtx_queue;
+    onSend _cb;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RTPPACER_H
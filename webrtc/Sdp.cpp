@@ -1925,6 +1925,11 @@ RETRY:
                     continue;
                 }
                 if (!strcasecmp(plan.codec.data(), "red")) {
+                    // 音频red的fmtp为各块的pt(如111/111)，须为选中的编码
+                    // The fmtp of audio red lists the pt of the blocks (such as 111/111), which must be the selected codec
+                    if (offer_media.type == TrackAudio && !plan.fmtp.empty() && atoi(plan.fmtp.begin()->first.data()) != selected_plan->pt) {
+                        continue;
+                    }
                     if (configure.support_red) {
                         answer_media.plan.emplace_back(plan);
                         pt_selected.emplace(plan.pt);
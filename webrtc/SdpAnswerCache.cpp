@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <set>
+#include <cstring>
+#include "SdpAnswerCache.h"
+#include "Common/config.h"
+#include "Common/macros.h"
+#include "Util/util.h"
+#include "Util/NoticeCenter.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+namespace Rtc {
+#define RTC_FIELD "rtc."
+const string kAnswerCacheSize = RTC_FIELD "answerCacheSize";
+
+static onceToken token([]() { mINI::Instance()[kAnswerCacheSize] = 64; });
+} // namespace Rtc
+
+constexpr char SdpAnswerCache::kIceUfrag[];
+constexpr char SdpAnswerCache::kIcePwd[];
+constexpr char SdpAnswerCache::kSessionId[];
+constexpr char SdpAnswerCache::kSessionVersion[];
+
+static bool splitAttr(const string &line, const char *attr, string &value) {
+    auto len = strlen(attr);
+    if (line.compare(0, len, attr) != 0) {
+        return false;
+    }
+    value = line.substr(len);
+    return true;
+}
+
+bool SdpOfferDynamic::split(const string &offer, string &key) {
+    key.clear();
+    key.reserve(offer.size());
+    Media *media = nullptr;
+    // 与RtcSessionSdp::parse一样忽略各段内重复的行
+    // Duplicated lines of a section are ignored the same way as RtcSessionSdp::parse does
+    std::set<string> line_set;
+    string value;
+    for (auto &line : toolkit::split(offer, "\n")) {
+        trim(line);
+        if (line.size() < 3 || line[1] != '=') {
+            continue;
+        }
+        if (!line_set.emplace(line).second) {
+            continue;
+        }
+        switch (line[0]) {
+            case 'm': {
+                _media.emplace_back();
+                media = &_media.back();
+                line_set.clear();
+                break;
+            }
+            case 'o': {
+                // answer沿用offer的origin，仅session id与version每个会话不同
+                // The answer reuses the origin of the offer, only the session id and version differ per session
+                _origin = line.substr(2);
+                auto fields = toolkit::split(_origin, " ");
+                key.append("o=");
+                for (size_t i = 0; i < fields.size(); ++i) {
+                    if (i != 1 && i != 2) {
+                        key.append(fields[i]).append(" ");
+                    }
+                }
+                key.append("\n");
+                continue;
+            }
+            case 'a': {
+                if (splitAttr(line, "a=ssrc", value) || splitAttr(line, "a=msid:", value)) {
+                    // ssrc与msid每个会话都不同，且会影响协商结果
+                    // Ssrc and msid differ per session and affect the negotiation result
+                    return false;
+                }
+                // 会话级的ice-ufrag/ice-pwd不被解析，同样忽略
+                // Session level ice-ufrag/ice-pwd are not parsed, ignore them too
+                if (splitAttr(line, "a=ice-ufrag:", value)) {
+                    if (media) {
+                        media->ice_ufrag = std::move(value);
+                    }
+                    continue;
+                }
+                if (splitAttr(line, "a=ice-pwd:", value)) {
+                    if (media) {
+                        media->ice_pwd = std::move(value);
+                    }
+                    continue;
+                }
+                if (splitAttr(line, "a=candidate:", value)) {
+                    if (media) {
+                        media->candidate.emplace_back(std::move(value));
+                    }
+                    continue;
+                }
+                if (splitAttr(line, "a=fingerprint:", value)) {
+                    // 摘要算法决定answer中本端的fingerprint，需保留在key中
+                    // The hash algorithm decides the local fingerprint in the answer, keep it in the key
+                    key.append("a=fingerprint:").append(value.substr(0, value.find(' '))).append("\n");
+                    (media ? media->fingerprint : _fingerprint) = std::move(value);
+                    continue;
+                }
+                break;
+            }
+            default: break;
+        }
+        key.append(line).append("\n");
+    }
+    return !_media.empty();
+}
+
+void SdpOfferDynamic::applyTo(RtcSession &offer) const {
+    offer.origin = SdpOrigin();
+    if (!_origin.empty()) {
+        offer.origin.parse(_origin);
+    }
+    auto size = MIN(offer.media.size(), _media.size());
+    for (size_t i = 0; i < size; ++i) {
+        auto &m = offer.media[i];
+        auto &dynamic = _media[i];
+        m.ice_ufrag = dynamic.ice_ufrag;
+        m.ice_pwd = dynamic.ice_pwd;
+        m.fingerprint = SdpAttrFingerprint();
+        auto &fingerprint = dynamic.fingerprint.empty() ? _fingerprint : dynamic.fingerprint;
+        if (!fingerprint.empty()) {
+            m.fingerprint.parse(fingerprint);
+        }
+        m.candidate.clear();
+        for (auto &str : dynamic.candidate) {
+            SdpAttrCandidate candidate;
+            candidate.parse(str);
+            m.candidate.emplace_back(std::move(candidate));
+        }
+    }
+}
+
+INSTANCE_IMP(SdpAnswerCache)
+
+SdpAnswerCache::SdpAnswerCache() {
+    // 编码、码率等配置变更后，缓存的协商结果失效
+    // Cached negotiation results are stale after configurations such as codecs and bitrates change
+    NoticeCenter::Instance().addListener(this, Broadcast::kBroadcastReloadConfig, [this](BroadcastReloadConfigArgs) { clear(); });
+}
+
+SdpAnswerCache::Entry::Ptr SdpAnswerCache::get(const string &key) {
+    GET_CONFIG(size_t, max_count, Rtc::kAnswerCacheSize);
+    if (!max_count) {
+        return nullptr;
+    }
+    lock_guard<mutex> lck(_mtx);
+    auto it = _map.find(key);
+    if (it == _map.end()) {
+        ++_misses;
+        return nullptr;
+    }
+    ++_hits;
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->second;
+}
+
+void SdpAnswerCache::put(const string &key, const RtcSession &offer, const RtcSession &answer) {
+    GET_CONFIG(size_t, max_count, Rtc::kAnswerCacheSize);
+    if (!max_count) {
+        return;
+    }
+    auto entry = std::make_shared<Entry>();
+    entry->offer = offer;
+    entry->answer = answer;
+
+    auto tmp = answer;
+    tmp.origin.session_id = kSessionId;
+    tmp.origin.session_version = kSessionVersion;
+    tmp.origin.reset();
+    for (auto &m : tmp.media) {
+        m.ice_ufrag = kIceUfrag;
+        m.ice_pwd = kIcePwd;
+    }
+    entry->answer_str = tmp.toString();
+
+    lock_guard<mutex> lck(_mtx);
+    auto it = _map.find(key);
+    if (it != _map.end()) {
+        _lru.erase(it->second);
+        _map.erase(it);
+    }
+    _lru.emplace_front(key, std::move(entry));
+    _map.emplace(key, _lru.begin());
+    while (_lru.size() > max_count) {
+        _map.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+}
+
+string SdpAnswerCache::stamp(const Entry &entry, const RtcSession &offer, RtcSession &answer, const string &ice_ufrag, const string &ice_pwd) {
+    auto &session_id = offer.origin.session_id;
+    auto &session_version = offer.origin.session_version;
+    answer = entry.answer;
+    answer.origin.session_id = session_id;
+    answer.origin.session_version = session_version;
+    answer.origin.reset();
+    for (auto &m : answer.media) {
+        m.ice_ufrag = ice_ufrag;
+        m.ice_pwd = ice_pwd;
+    }
+
+    auto ret = entry.answer_str;
+    replace(ret, kSessionId, session_id);
+    replace(ret, kSessionVersion, session_version);
+    replace(ret, kIceUfrag, ice_ufrag);
+    replace(ret, kIcePwd, ice_pwd);
+    return ret;
+}
+
+void SdpAnswerCache::clear() {
+    lock_guard<mutex> lck(_mtx);
+    _map.clear();
+    _lru.clear();
+}
+
+} // namespace mediakit
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SDPANSWERCACHE_H
+#define ZLMEDIAKIT_SDPANSWERCACHE_H
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Sdp.h"
+
+namespace mediakit {
+
+namespace Rtc {
+// 协商结果缓存的最大条数，置0关闭
+// Max entries of the negotiation cache, 0 disables it
+extern const std::string kAnswerCacheSize;
+} // namespace Rtc
+
+/**
+ * offer中每个会话都不同的字段：o=行、各m段的ice-ufrag/ice-pwd/fingerprint/candidate
+ * Fields of an offer that differ per session: the o= line and ice-ufrag/ice-pwd/fingerprint/candidate of each m section
+ */
+class SdpOfferDynamic {
+public:
+    /**
+     * 拆分offer，其余部分作为缓存key；带有ssrc/msid的offer(推流端)不可缓存，返回false
+     * Split the offer, the rest of it is the cache key; offers with ssrc/msid (publishers) are not cacheable, returns false
+     */
+    bool split(const std::string &offer, std::string &key);
+
+    /**
+     * 将本会话的字段填入缓存的offer模板
+     * Fill the fields of this session into the cached offer template
+     */
+    void applyTo(RtcSession &offer) const;
+
+private:
+    struct Media {
+        std::string ice_ufrag;
+        std::string ice_pwd;
+        std::string fingerprint;
+        std::vector<std::string> candidate;
+    };
+    std::string _origin;
+    std::string _fingerprint;
+    std::vector<Media> _media;
+};
+
+/**
+ * webrtc协商结果缓存：同一浏览器版本的offer除会话字段外完全相同，
+ * 按归一化的offer与本端协商参数缓存解析后的offer、协商出的answer及其序列化结果，命中时只需填入ice/origin等会话字段
+ * Webrtc negotiation cache: offers of the same browser version are identical except for per session fields.
+ * The parsed offer, the negotiated answer and its serialization are cached by the normalized offer and the local negotiation
+ * parameters, a hit only fills in per session fields such as ice and origin
+ */
+class SdpAnswerCache {
+public:
+    struct Entry {
+        using Ptr = std::shared_ptr<const Entry>;
+        RtcSession offer;
+        RtcSession answer;
+        // ice-ufrag/ice-pwd/origin为占位符的answer
+        // The answer with placeholders for ice-ufrag/ice-pwd/origin
+        std::string answer_str;
+    };
+
+    static constexpr char kIceUfrag[] = "{ice-ufrag}";
+    static constexpr char kIcePwd[] = "{ice-pwd}";
+    static constexpr char kSessionId[] = "{session-id}";
+    static constexpr char kSessionVersion[] = "{session-version}";
+
+    static SdpAnswerCache &Instance();
+
+    Entry::Ptr get(const std::string &key);
+
+    /**
+     * 缓存协商结果，answer的ice与origin字段将替换为占位符
+     * Cache a negotiation result, ice and origin fields of the answer are replaced with placeholders
+     */
+    void put(const std::string &key, const RtcSession &offer, const RtcSession &answer);
+
+    /**
+     * 以缓存生成本会话的answer
+     * Stamp the answer of this session out of the cache
+     */
+    static std::string stamp(const Entry &entry, const RtcSession &offer, RtcSession &answer, const std::string &ice_ufrag, const std::string &ice_pwd);
+
+    void clear();
+    uint64_t getHits() const { return _hits; }
+    uint64_t getMisses() const { return _misses; }
+
+private:
+    SdpAnswerCache();
+
+private:
+    std::mutex _mtx;
+    std::list<std::pair<std::string, Entry::Ptr> > _lru;
+    std::unordered_map<std::string, decltype(_lru)::iterator> _map;
+    std::atomic<uint64_t> _hits { 0 };
+    std::atomic<uint64_t> _misses { 0 };
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_SDPANSWERCACHE_H
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cmath>
+#include "SendSideBwe.h"
+#include "Common/macros.h"
+
+using namespace std;
+
+namespace mediakit {
+
+// 发送记录环形缓存大小，须为2的幂
+// Size of the send history ring, must be a power of two
+static constexpr size_t kHistorySize = 1 << 14;
+// 发送时间相差5ms以内的数据包视为同一包组
+// Packets sent within 5ms belong to the same group
+static constexpr int64_t kBurstMS = 5;
+// 到达时间跳变超过该值时认为对端时钟重置，重新开始检测
+// An arrival time jump larger than this means the peer clock was reset, the detector starts over
+static constexpr double kArrivalResetMS = 3000;
+// trendline参数，与libwebrtc默认值一致
+// Trendline parameters, same as the defaults of libwebrtc
+static constexpr size_t kTrendWindow = 20;
+static constexpr double kSmoothing = 0.9;
+static constexpr double kThresholdGain = 4.0;
+static constexpr size_t kMaxDeltas = 60;
+static constexpr double kOverusingTimeMS = 10;
+static constexpr double kThresholdUp = 0.0087;
+static constexpr double kThresholdDown = 0.039;
+// 对端确认码率的统计窗口
+// Window of the acknowledged bitrate
+static constexpr double kAckedWindowMS = 500;
+// 两次过载降码率的最小间隔
+// Min interval between two overuse decreases
+static constexpr int64_t kDecreaseIntervalMS = 200;
+// 基于丢包的码率控制的最小统计周期与包数
+// Min period and packet count of the loss based controller
+static constexpr int64_t kLossPeriodMS = 200;
+static constexpr size_t kLossMinPackets = 10;
+
+SendSideBwe::SendSideBwe(uint32_t start_bps, uint32_t min_bps, uint32_t max_bps) {
+    _min_bps = min_bps;
+    _max_bps = MAX(max_bps, min_bps);
+    _delay_bps = _loss_bps = clamp(start_bps);
+    _history.resize(kHistorySize);
+    for (auto &pkt : _history) {
+        pkt.seq = 0;
+        pkt.acked = true;
+        pkt.size = 0;
+        pkt.send_ms = 0;
+    }
+}
+
+uint32_t SendSideBwe::clamp(double bps) const {
+    return (uint32_t)MAX((double)_min_bps, MIN((double)_max_bps, bps));
+}
+
+void SendSideBwe::onPacketSent(uint16_t seq, size_t size, uint64_t now_ms) {
+    _next_seq = seq + 1;
+    auto &pkt = _history[seq & (kHistorySize - 1)];
+    pkt.seq = seq;
+    pkt.acked = false;
+    pkt.size = (uint32_t)size;
+    pkt.send_ms = now_ms;
+}
+
+void SendSideBwe::onRemb(uint32_t bps) {
+    _remb_bps = bps;
+}
+
+uint32_t SendSideBwe::getBitrate() const {
+    // 未收到过twcc反馈时(例如只协商了remb)，直接使用remb
+    // Use remb directly when no twcc feedback was ever received (e.g. only remb was negotiated)
+    double ret = _has_feedback ? MIN(_delay_bps, _loss_bps) : (_remb_bps ? _remb_bps : _delay_bps);
+    if (_remb_bps) {
+        ret = MIN(ret, (double)_remb_bps);
+    }
+    return clamp(ret);
+}
+
+void SendSideBwe::onTransportFeedback(const FCI_TWCC &fci, size_t fci_size, uint64_t now_ms) {
+    auto status = fci.getPacketChunkList(fci_size);
+    // 首个包的recv delta相对参考时间，后续包相对前一个收到的包
+    // The recv delta of the first packet is relative to the reference time, the others to the previous received packet
+    double arrival_ms = fci.getReferenceTime() * 64.0;
+    size_t lost = 0, total = 0;
+    auto seq = fci.getBaseSeq();
+    auto count = fci.getPacketCount();
+    for (uint16_t i = 0; i < count; ++i, ++seq) {
+        auto it = status.find(seq);
+        if (it == status.end()) {
+            continue;
+        }
+        auto &pkt = _history[seq & (kHistorySize - 1)];
+        auto known = pkt.seq == seq && !pkt.acked;
+        if (it->second.first == SymbolStatus::not_received) {
+            // 丢失的包可能在后续反馈中被报告收到，此处仅计入丢包统计
+            // A lost packet may be reported received by a later feedback, only count it for the loss statistics here
+            if (known) {
+                ++lost;
+                ++total;
+            }
+            continue;
+        }
+        arrival_ms += it->second.second * 0.25;
+        if (!known) {
+            continue;
+        }
+        pkt.acked = true;
+        ++total;
+        onPacketFeedback(pkt, arrival_ms, now_ms);
+    }
+    if (!total) {
+        return;
+    }
+    _has_feedback = true;
+    updateLossBasedRate(lost, total, now_ms);
+    updateDelayBasedRate(now_ms);
+}
+
+void SendSideBwe::onPacketFeedback(const SentPacket &pkt, double arrival_ms, uint64_t now_ms) {
+    updateAckedBitrate(arrival_ms, pkt.size);
+    if (!_cur_group.valid) {
+        _cur_group.valid = true;
+        _cur_group.first_send_ms = _cur_group.last_send_ms = pkt.send_ms;
+        _cur_group.last_arrival_ms = arrival_ms;
+        return;
+    }
+    if (pkt.send_ms < _cur_group.first_send_ms) {
+        // 乱序到达的旧包组的包，忽略
+        // A reordered packet of an older group, ignore
+        return;
+    }
+    if ((int64_t)(pkt.send_ms - _cur_group.first_send_ms) <= kBurstMS) {
+        _cur_group.last_send_ms = MAX(_cur_group.last_send_ms, pkt.send_ms);
+        _cur_group.last_arrival_ms = MAX(_cur_group.last_arrival_ms, arrival_ms);
+        return;
+    }
+    if (_prev_group.valid) {
+        onGroupDelta((double)(_cur_group.last_send_ms - _prev_group.last_send_ms), _cur_group.last_arrival_ms - _prev_group.last_arrival_ms,
+                     _cur_group.last_arrival_ms, now_ms);
+    }
+    _prev_group = _cur_group;
+    _cur_group.first_send_ms = _cur_group.last_send_ms = pkt.send_ms;
+    _cur_group.last_arrival_ms = arrival_ms;
+}
+
+void SendSideBwe::onGroupDelta(double send_delta, double arrival_delta, double arrival_ms, uint64_t now_ms) {
+    if (std::fabs(arrival_delta) > kArrivalResetMS) {
+        _first_arrival_ms = -1;
+        _accumulated_delay = _smoothed_delay = 0;
+        _num_deltas = 0;
+        _delay_samples.clear();
+        _usage = BandwidthUsage::normal;
+        return;
+    }
+    _num_deltas = MIN(_num_deltas + 1, (size_t)1000);
+    if (_first_arrival_ms < 0) {
+        _first_arrival_ms = arrival_ms;
+    }
+    // 排队时延的累积值经指数平滑后做线性回归，斜率即为时延梯度
+    // The accumulated queueing delay is smoothed and linearly regressed, the slope is the delay gradient
+    _accumulated_delay += arrival_delta - send_delta;
+    _smoothed_delay = kSmoothing * _smoothed_delay + (1 - kSmoothing) * _accumulated_delay;
+    _delay_samples.emplace_back(arrival_ms - _first_arrival_ms, _smoothed_delay);
+    if (_delay_samples.size() > kTrendWindow) {
+        _delay_samples.pop_front();
+    }
+
+    auto trend = _prev_trend;
+    if (_delay_samples.size() == kTrendWindow) {
+        double sum_x = 0, sum_y = 0;
+        for (auto &pr : _delay_samples) {
+            sum_x += pr.first;
+            sum_y += pr.second;
+        }
+        auto avg_x = sum_x / kTrendWindow, avg_y = sum_y / kTrendWindow;
+        double numerator = 0, denominator = 0;
+        for (auto &pr : _delay_samples) {
+            numerator += (pr.first - avg_x) * (pr.second - avg_y);
+            denominator += (pr.first - avg_x) * (pr.first - avg_x);
+        }
+        if (denominator != 0) {
+            trend = numerator / denominator;
+        }
+    }
+    detect(trend, send_delta, now_ms);
+}
+
+void SendSideBwe::detect(double trend, double send_delta, uint64_t now_ms) {
+    if (_num_deltas < 2) {
+        _usage = BandwidthUsage::normal;
+        return;
+    }
+    auto modified_trend = MIN(_num_deltas, kMaxDeltas) * trend * kThresholdGain;
+    if (modified_trend > _threshold) {
+        if (_time_over_using < 0) {
+            // 假设从上个包组间隔的一半开始过载
+            // Assume the overuse started halfway through the last group interval
+            _time_over_using = send_delta / 2;
+        } else {
+            _time_over_using += send_delta;
+        }
+        ++_overuse_counter;
+        if (_time_over_using > kOverusingTimeMS && _overuse_counter > 1 && trend >= _prev_trend) {
+            _time_over_using = 0;
+            _overuse_counter = 0;
+            _usage = BandwidthUsage::overusing;
+        }
+    } else if (modified_trend < -_threshold) {
+        _time_over_using = -1;
+        _overuse_counter = 0;
+        _usage = BandwidthUsage::underusing;
+    } else {
+        _time_over_using = -1;
+        _overuse_counter = 0;
+        _usage = BandwidthUsage::normal;
+    }
+    _prev_trend = trend;
+    updateThreshold(modified_trend, now_ms);
+}
+
+void SendSideBwe::updateThreshold(double modified_trend, uint64_t now_ms) {
+    if (!_last_threshold_update_ms) {
+        _last_threshold_update_ms = now_ms;
+    }
+    auto abs_trend = std::fabs(modified_trend);
+    if (abs_trend > _threshold + 15) {
+        // 突发的尖峰不参与阈值自适应
+        // Sudden spikes do not adapt the threshold
+        _last_threshold_update_ms = now_ms;
+        return;
+    }
+    auto k = abs_trend < _threshold ? kThresholdDown : kThresholdUp;
+    auto dt = (double)MIN(now_ms - _last_threshold_update_ms, (uint64_t)100);
+    _threshold += k * (abs_trend - _threshold) * dt;
+    _threshold = MAX(6.0, MIN(600.0, _threshold));
+    _last_threshold_update_ms = now_ms;
+}
+
+void SendSideBwe::updateAckedBitrate(double arrival_ms, size_t size) {
+    if (!_acked_window.empty() && std::fabs(arrival_ms - _acked_window.back().first) > kArrivalResetMS) {
+        _acked_window.clear();
+        _acked_window_bytes = 0;
+    }
+    _acked_window.emplace_back(arrival_ms, size);
+    _acked_window_bytes += size;
+    while (arrival_ms - _acked_window.front().first > kAckedWindowMS) {
+        _acked_window_bytes -= _acked_window.front().second;
+        _acked_window.pop_front();
+    }
+    auto span = arrival_ms - _acked_window.front().first;
+    if (span >= 100) {
+        _acked_bps = (uint32_t)(_acked_window_bytes * 8000 / span);
+    }
+}
+
+void SendSideBwe::updateDelayBasedRate(uint64_t now_ms) {
+    switch (_usage) {
+        case BandwidthUsage::overusing: {
+            // 乘性降低到对端确认码率的85%
+            // Multiplicative decrease to 85% of the acknowledged bitrate
+            if (now_ms - _last_decrease_ms > (uint64_t)kDecreaseIntervalMS) {
+                auto target = 0.85 * (_acked_bps ? _acked_bps : _delay_bps);
+                _delay_bps = MIN(_delay_bps, target);
+                _last_decrease_ms = now_ms;
+            }
+            _last_increase_ms = now_ms;
+            break;
+        }
+        case BandwidthUsage::underusing: {
+            // 网络队列正在排空，保持码率
+            // The network queue is draining, hold the rate
+            _last_increase_ms = now_ms;
+            break;
+        }
+        default: {
+            // 每秒乘性增加8%，且不超过对端确认码率的1.5倍
+            // Multiplicative increase of 8% per second, capped at 1.5 times the acknowledged bitrate
+            if (!_last_increase_ms) {
+                _last_increase_ms = now_ms;
+            }
+            auto dt = (double)MIN(now_ms - _last_increase_ms, (uint64_t)1000);
+            _delay_bps *= std::pow(1.08, dt / 1000);
+            if (_acked_bps) {
+                _delay_bps = MIN(_delay_bps, 1.5 * _acked_bps + 10000);
+            }
+            _last_increase_ms = now_ms;
+            break;
+        }
+    }
+    _delay_bps = clamp(_delay_bps);
+}
+
+void SendSideBwe::updateLossBasedRate(size_t lost, size_t total, uint64_t now_ms) {
+    if (!_loss_begin_ms) {
+        _loss_begin_ms = now_ms;
+    }
+    _loss_lost += lost;
+    _loss_total += total;
+    auto elapsed = (int64_t)(now_ms - _loss_begin_ms);
+    if (elapsed < kLossPeriodMS || _loss_total < kLossMinPackets) {
+        return;
+    }
+    _loss_rate = (float)_loss_lost / _loss_total;
+    if (_loss_rate > 0.1f) {
+        _loss_bps *= 1 - 0.5 * _loss_rate;
+    } else if (_loss_rate < 0.02f) {
+        _loss_bps *= std::pow(1.08, MIN(elapsed, (int64_t)1000) / 1000.0);
+    }
+    _loss_bps = clamp(_loss_bps);
+    _loss_lost = _loss_total = 0;
+    _loss_begin_ms = now_ms;
+}
+
+} // namespace mediakit
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SENDSIDEBWE_H
+#define ZLMEDIAKIT_SENDSIDEBWE_H
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "Rtcp/RtcpFCI.h"
+
+namespace mediakit {
+
+/**
+ * 发送端带宽估计(GCC简化版)，输入对端回复的transport-cc反馈与remb：
+ * 基于包组到达时延梯度的trendline过载检测驱动AIMD码率控制，同时按反馈中的丢包率做基于丢包的码率控制，
+ * 最终估计值取两者与remb的最小值
+ * Send side bandwidth estimation (simplified GCC) fed with transport-cc feedback and remb from the peer:
+ * a trendline overuse detector on the delay gradient of packet groups drives an AIMD rate controller,
+ * a loss based controller works on the loss fraction of the feedback, the estimate is the minimum of both and remb
+ */
+class SendSideBwe {
+public:
+    using Ptr = std::shared_ptr<SendSideBwe>;
+
+    enum class BandwidthUsage : uint8_t {
+        normal = 0,
+        underusing,
+        overusing,
+    };
+
+    /**
+     * @param start_bps 初始码率 / start bitrate
+     * @param min_bps 最小码率 / min bitrate
+     * @param max_bps 最大码率 / max bitrate
+     */
+    SendSideBwe(uint32_t start_bps, uint32_t min_bps, uint32_t max_bps);
+
+    /**
+     * 下一个发送包的transport-wide序号
+     * Transport-wide sequence number of the next packet
+     */
+    uint16_t getNextSeq() const { return _next_seq; }
+
+    /**
+     * 记录数据包的实际发出时间与大小，并递增transport-wide序号
+     * Record the actual send time and size of a packet, and advance the transport-wide sequence number
+     */
+    void onPacketSent(uint16_t seq, size_t size, uint64_t now_ms);
+
+    /**
+     * 输入transport-cc反馈
+     * Input a transport-cc feedback
+     */
+    void onTransportFeedback(const FCI_TWCC &fci, size_t fci_size, uint64_t now_ms);
+
+    /**
+     * 输入remb反馈，作为估计值的上限
+     * Input a remb feedback, used as the cap of the estimate
+     */
+    void onRemb(uint32_t bps);
+
+    /**
+     * 获取当前带宽估计值，单位bit/s
+     * Get the current bandwidth estimate in bit/s
+     */
+    uint32_t getBitrate() const;
+
+    /**
+     * 获取对端确认收到的码率，单位bit/s
+     * Get the bitrate acknowledged by the peer in bit/s
+     */
+    uint32_t getAckedBitrate() const { return _acked_bps; }
+
+    float getLossRate() const { return _loss_rate; }
+    BandwidthUsage getUsage() const { return _usage; }
+
+    /**
+     * 是否已收到transport-cc或remb反馈，此前估计值只是初始值
+     * Whether transport-cc or remb feedback was received, the estimate is just the start value before that
+     */
+    bool hasFeedback() const { return _has_feedback || _remb_bps; }
+
+private:
+    struct SentPacket {
+        uint16_t seq;
+        bool acked;
+        uint32_t size;
+        uint64_t send_ms;
+    };
+
+    struct PacketGroup {
+        bool valid = false;
+        uint64_t first_send_ms = 0;
+        uint64_t last_send_ms = 0;
+        double last_arrival_ms = 0;
+    };
+
+    void onPacketFeedback(const SentPacket &pkt, double arrival_ms, uint64_t now_ms);
+    void onGroupDelta(double send_delta, double arrival_delta, double arrival_ms, uint64_t now_ms);
+    void detect(double trend, double send_delta, uint64_t now_ms);
+    void updateThreshold(double modified_trend, uint64_t now_ms);
+    void updateAckedBitrate(double arrival_ms, size_t size);
+    void updateDelayBasedRate(uint64_t now_ms);
+    void updateLossBasedRate(size_t lost, size_t total, uint64_t now_ms);
+    uint32_t clamp(double bps) const;
+
+private:
+    uint32_t _min_bps;
+    uint32_t _max_bps;
+    uint16_t _next_seq = 0;
+    std::vector<SentPacket> _history;
+
+    // 包组与trendline过载检测状态
+    // Packet grouping and trendline overuse detector state
+    PacketGroup _cur_group;
+    PacketGroup _prev_group;
+    double _first_arrival_ms = -1;
+    double _accumulated_delay = 0;
+    double _smoothed_delay = 0;
+    size_t _num_deltas = 0;
+    std::deque<std::pair<double /*arrival*/, double /*smoothed delay*/>> _delay_samples;
+    double _prev_trend = 0;
+    double _threshold = 12.5;
+    uint64_t _last_threshold_update_ms = 0;
+    double _time_over_using = -1;
+    int _overuse_counter = 0;
+    BandwidthUsage _usage = BandwidthUsage::normal;
+
+    // 对端确认收到的码率统计窗口
+    // Window of the acknowledged bitrate
+    std::deque<std::pair<double /*arrival*/, size_t /*size*/>> _acked_window;
+    size_t _acked_window_bytes = 0;
+    uint32_t _acked_bps = 0;
+
+    // 码率控制状态
+    // Rate control state
+    bool _has_feedback = false;
+    double _delay_bps;
+    double _loss_bps;
+    uint32_t _remb_bps = 0;
+    uint64_t _last_increase_ms = 0;
+    uint64_t _last_decrease_ms = 0;
+    float _loss_rate = 0;
+    size_t _loss_lost = 0;
+    size_t _loss_total = 0;
+    uint64_t _loss_begin_ms = 0;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_SENDSIDEBWE_H
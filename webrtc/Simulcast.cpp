@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#include "Simulcast.h"
+#include "Util/util.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 试探升级失败后的退避时间
+// Backoff after a failed up switch probe
+static constexpr uint64_t kProbeMinBackoffMS = 8000;
+static constexpr uint64_t kProbeMaxBackoffMS = 64000;
+// 试探升级后的观察期
+// Observation period after an up switch probe
+static constexpr uint64_t kProbeObserveMS = 5000;
+// 层码率不超过估计值的该比例时才认为能容纳
+// A layer fits only if its bitrate is below this fraction of the estimate
+static constexpr float kBitrateHeadroom = 0.85f;
+
+struct LayerEntry {
+    size_t order;
+    weak_ptr<RtspMediaSource> src;
+};
+
+static mutex s_mtx;
+static unordered_map<string /*vhost/app/stream*/, map<string /*rid*/, LayerEntry>> s_groups;
+
+void SimulcastGroup::addLayer(const MediaTuple &group, const string &rid, size_t order, const RtspMediaSource::Ptr &src) {
+    lock_guard<mutex> lck(s_mtx);
+    s_groups[group.shortUrl()][rid] = LayerEntry { order, src };
+}
+
+void SimulcastGroup::delLayer(const RtspMediaSource::Ptr &src) {
+    lock_guard<mutex> lck(s_mtx);
+    for (auto it = s_groups.begin(); it != s_groups.end();) {
+        for (auto layer = it->second.begin(); layer != it->second.end();) {
+            // 只移除本层与已释放的层，重推时新推流器可能已经登记了同名层
+            // Remove this layer and released ones only, a new pusher may have registered the same rid when the stream was pushed again
+            auto strong = layer->second.src.lock();
+            if (!strong || strong == src) {
+                layer = it->second.erase(layer);
+            } else {
+                ++layer;
+            }
+        }
+        if (it->second.empty()) {
+            it = s_groups.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+vector<SimulcastGroup::Layer> SimulcastGroup::getLayers(const MediaTuple &group) {
+    vector<pair<size_t /*order*/, Layer>> layers;
+    {
+        lock_guard<mutex> lck(s_mtx);
+        auto it = s_groups.find(group.shortUrl());
+        if (it == s_groups.end()) {
+            return vector<Layer>();
+        }
+        for (auto &pr : it->second) {
+            if (auto src = pr.second.src.lock()) {
+                Layer layer;
+                layer.rid = pr.first;
+                layer.src = std::move(src);
+                layers.emplace_back(pr.second.order, std::move(layer));
+            }
+        }
+    }
+    bool height_known = true;
+    for (auto &pr : layers) {
+        auto &layer = pr.second;
+        auto video = dynamic_pointer_cast<VideoTrack>(layer.src->getTrack(TrackVideo, false));
+        layer.height = video ? video->getVideoHeight() : 0;
+        layer.bitrate = layer.src->getBytesSpeed(TrackVideo) * 8;
+        height_known = height_known && layer.height;
+    }
+    // 层的高低由分辨率决定，而非实测码率；高度未全部确定前按sdp中的rid顺序，避免排序在二者之间来回切换
+    // Layers are ranked by resolution rather than the measured bitrate; until all heights are known the rid order of the sdp is used,
+    // so the ranking never flips between the two
+    sort(layers.begin(), layers.end(), [height_known](const pair<size_t, Layer> &a, const pair<size_t, Layer> &b) {
+        if (height_known && a.second.height != b.second.height) {
+            return a.second.height < b.second.height;
+        }
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return a.second.rid < b.second.rid;
+    });
+    vector<Layer> ret;
+    ret.reserve(layers.size());
+    for (auto &pr : layers) {
+        ret.emplace_back(std::move(pr.second));
+    }
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+int SimulcastLayerSelector::select(const vector<SimulcastGroup::Layer> &layers, int cur, int max_height, const SendSideBwe *bwe, uint64_t now_ms) {
+    if (layers.empty()) {
+        return -1;
+    }
+    // 满足观看端分辨率限制的层，高度未知的层不受限制
+    // Layers allowed by the max resolution of the viewer, layers of unknown height are not limited
+    vector<int> allowed;
+    for (int i = 0; i < (int)layers.size(); ++i) {
+        if (!max_height || !layers[i].height || layers[i].height <= max_height) {
+            allowed.emplace_back(i);
+        }
+    }
+    if (allowed.empty()) {
+        // 所有层都超出限制时退到最低层
+        // Fall back to the lowest layer if every layer exceeds the limit
+        allowed.emplace_back(0);
+    }
+    auto estimate = bwe && bwe->hasFeedback() ? bwe->getBitrate() : 0;
+    if (!estimate) {
+        // 尚无带宽反馈(或对端不支持transport-cc/remb)，没有依据升级，保持当前层，否则选择允许的最低层
+        // No bandwidth feedback yet (or the peer supports neither transport-cc nor remb), there is no evidence to step up:
+        // keep the current layer, otherwise select the lowest allowed one
+        return find(allowed.begin(), allowed.end(), cur) != allowed.end() ? cur : allowed.front();
+    }
+    if (!_backoff_ms) {
+        _backoff_ms = kProbeMinBackoffMS;
+    }
+
+    // 估计值能容纳的最高层
+    // The highest layer fitting in the estimate
+    int fit = allowed.front();
+    for (auto i : allowed) {
+        if (layers[i].bitrate <= estimate * kBitrateHeadroom) {
+            fit = i;
+        }
+    }
+    auto it = find(allowed.begin(), allowed.end(), cur);
+    if (it == allowed.end()) {
+        // 首次选择或当前层已不被允许
+        // First selection or the current layer is not allowed anymore
+        _probing = false;
+        return fit;
+    }
+    auto pos = it - allowed.begin();
+    auto lower = pos ? allowed[pos - 1] : cur;
+    bool congested = bwe->getUsage() == SendSideBwe::BandwidthUsage::overusing || bwe->getLossRate() > 0.1f;
+
+    if (_probing) {
+        if (congested) {
+            // 试探失败，退回并加倍退避时间
+            // The probe failed, step back and double the backoff
+            _probing = false;
+            _backoff_ms = MIN(_backoff_ms * 2, kProbeMaxBackoffMS);
+            return lower;
+        }
+        if (now_ms - _probe_ms < kProbeObserveMS) {
+            return cur;
+        }
+        _probing = false;
+        _backoff_ms = kProbeMinBackoffMS;
+    }
+
+    if (layers[cur].bitrate > estimate) {
+        // 估计值已容纳不下当前层，降到能容纳的层
+        // The estimate no longer fits the current layer, step down to the one that fits
+        return MIN(fit, lower);
+    }
+    if (fit > cur) {
+        return fit;
+    }
+    if (pos + 1 < (int)allowed.size() && !congested && bwe->getUsage() == SendSideBwe::BandwidthUsage::normal
+        && bwe->getLossRate() < 0.02f && now_ms - _last_switch_ms >= _backoff_ms) {
+        // 估计值受已确认码率封顶，无法超过当前层太多，只能通过升级试探更高的带宽
+        // The estimate is capped by the acked bitrate and cannot grow far beyond the current layer, so probe by stepping up
+        _probing = true;
+        return allowed[pos + 1];
+    }
+    return cur;
+}
+
+void SimulcastLayerSelector::onSwitched(bool ok, uint64_t now_ms) {
+    _last_switch_ms = now_ms;
+    if (!ok) {
+        _probing = false;
+        return;
+    }
+    _probe_ms = now_ms;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+static bool isH264KeyNal(uint8_t type) {
+    // idr或sps(sps总是位于idr之前)
+    // idr or sps (which always precedes an idr)
+    return type == 5 || type == 7;
+}
+
+static bool isH265KeyNal(uint8_t type) {
+    // irap或vps/sps/pps
+    // irap or vps/sps/pps
+    return (type >= 16 && type <= 21) || (type >= 32 && type <= 34);
+}
+
+bool SimulcastRtpRewriter::isKeyFrameStart(CodecId codec, const RtpPacket::Ptr &rtp) {
+    auto payload = rtp->getPayload();
+    auto size = rtp->getPayloadSize();
+    if (!size) {
+        return false;
+    }
+    switch (codec) {
+        case CodecH264: {
+            auto type = payload[0] & 0x1F;
+            if (type == 24) {
+                // STAP-A
+                for (size_t offset = 1; offset + 2 < size;) {
+                    size_t nal_size = (payload[offset] << 8) | payload[offset + 1];
+                    offset += 2;
+                    if (offset + nal_size > size || !nal_size) {
+                        return false;
+                    }
+                    if (isH264KeyNal(payload[offset] & 0x1F)) {
+                        return true;
+                    }
+                    offset += nal_size;
+                }
+                return false;
+            }
+            if (type == 28) {
+                // FU-A，仅分片起始包
+                // FU-A, the start fragment only
+                return size > 1 && (payload[1] & 0x80) && isH264KeyNal(payload[1] & 0x1F);
+            }
+            return isH264KeyNal(type);
+        }
+        case CodecH265: {
+            if (size < 2) {
+                return false;
+            }
+            auto type = (payload[0] >> 1) & 0x3F;
+            if (type == 48) {
+                // AP
+                for (size_t offset = 2; offset + 2 < size;) {
+                    size_t nal_size = (payload[offset] << 8) | payload[offset + 1];
+                    offset += 2;
+                    if (offset + nal_size > size || !nal_size) {
+                        return false;
+                    }
+                    if (isH265KeyNal((payload[offset] >> 1) & 0x3F)) {
+                        return true;
+                    }
+                    offset += nal_size;
+                }
+                return false;
+            }
+            if (type == 49) {
+                // FU，仅分片起始包
+                // FU, the start fragment only
+                return size > 2 && (payload[2] & 0x80) && isH265KeyNal(payload[2] & 0x3F);
+            }
+            return isH265KeyNal(type);
+        }
+        case CodecVP8: {
+            // https://datatracker.ietf.org/doc/html/rfc7741#section-4.2
+            // 分区起始包(S=1且PID=0)，且vp8帧头P位为0
+            // The start of partition 0 (S=1 and PID=0) with the P bit of the vp8 frame header cleared
+            if ((payload[0] & 0x1F) != 0x10) {
+                return false;
+            }
+            size_t offset = 1;
+            if (payload[0] & 0x80) {
+                if (size < 2) {
+                    return false;
+                }
+                auto ext = payload[1];
+                offset = 2;
+                if (ext & 0x80) {
+                    // PictureID，M位表示15位
+                    // PictureID, 15 bits if the M bit is set
+                    offset += (size > offset && (payload[offset] & 0x80)) ? 2 : 1;
+                }
+                if (ext & 0x40) {
+                    // TL0PICIDX
+                    ++offset;
+                }
+                if (ext & 0x30) {
+                    // TID/KEYIDX
+                    ++offset;
+                }
+            }
+            return offset < size && !(payload[offset] & 0x01);
+        }
+        case CodecVP9: {
+            // https://datatracker.ietf.org/doc/html/draft-ietf-payload-vp9-16#section-4.2
+            // 非帧间预测(P=0)的帧起始包(B=1)
+            // The beginning (B=1) of a frame that is not inter-picture predicted (P=0)
+            return !(payload[0] & 0x40) && (payload[0] & 0x08);
+        }
+        case CodecAV1: {
+            // https://aomediacodec.github.io/av1-rtp-spec/#44-av1-aggregation-header
+            // N=1表示新编码视频序列的首包
+            // N=1 marks the first packet of a new coded video sequence
+            return payload[0] & 0x08;
+        }
+        default: return false;
+    }
+}
+
+void SimulcastRtpRewriter::switchTo(const RtpPacket::Ptr &first, uint64_t now_ms) {
+    if (!_started) {
+        _started = true;
+        return;
+    }
+    // 新层首包的seq紧接上一层最后发出的包
+    // The first packet of the new layer follows the last packet sent of the previous layer
+    _seq_offset = _last_seq + 1 - first->getSeq();
+
+    // 优先按ntp时间戳推算两帧间隔，否则按实际发送间隔；时间戳至少前进1
+    // Derive the frame interval from the ntp timestamps if possible, otherwise from the send interval; the timestamp advances by at least 1
+    uint64_t delta_ms;
+    if (first->ntp_stamp > _last_ntp && _last_ntp && first->ntp_stamp - _last_ntp < 1000) {
+        delta_ms = first->ntp_stamp - _last_ntp;
+    } else {
+        delta_ms = now_ms - MIN(now_ms, _last_ms);
+    }
+    uint32_t delta = MAX((uint32_t)(delta_ms * first->sample_rate / 1000), 1u);
+    _stamp_offset = _last_stamp + delta - first->getStamp();
+}
+
+RtpPacket::Ptr SimulcastRtpRewriter::rewrite(const RtpPacket::Ptr &rtp, uint64_t now_ms) {
+    _started = true;
+    auto ret = rtp;
+    if (_seq_offset || _stamp_offset) {
+        ret = RtpPacket::create();
+        ret->assign(rtp->data(), rtp->size());
+        ret->type = rtp->type;
+        ret->sample_rate = rtp->sample_rate;
+        ret->ntp_stamp = rtp->ntp_stamp;
+        ret->track_index = rtp->track_index;
+        auto header = ret->getHeader();
+        header->seq = htons((uint16_t)(rtp->getSeq() + _seq_offset));
+        header->stamp = htonl(rtp->getStamp() + _stamp_offset);
+    }
+    _last_seq = ret->getSeq();
+    _last_stamp = ret->getStamp();
+    _last_ntp = ret->ntp_stamp;
+    _last_ms = now_ms;
+    return ret;
+}
+
+} // namespace mediakit
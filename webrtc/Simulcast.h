@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SIMULCAST_H
+#define ZLMEDIAKIT_SIMULCAST_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "SendSideBwe.h"
+#include "Rtsp/RtspMediaSource.h"
+
+namespace mediakit {
+
+/**
+ * simulcast推流各rid层的登记表，以推流的流名为组名；播放组名时可在各层之间切换
+ * Registry of the rid layers of simulcast pushers, keyed by the pushed stream name; playing the group name switches among the layers
+ */
+class SimulcastGroup {
+public:
+    struct Layer {
+        std::string rid;
+        RtspMediaSource::Ptr src;
+        // 视频高度，未知时为0
+        // Video height, 0 if unknown
+        int height = 0;
+        // 实测视频码率，单位bit/s，仅用于选层，不参与排序(关键帧与静止画面会使其大幅波动)
+        // Measured video bitrate in bit/s, used for selection only and not for ranking (key frames and still scenes make it swing widely)
+        uint32_t bitrate = 0;
+    };
+
+    /**
+     * 登记simulcast层
+     * @param order rid在sdp(a=simulcast)中的顺序，高度未知时按该顺序排序 / order of the rid in the sdp (a=simulcast), used for ranking when heights are unknown
+     * Register a simulcast layer
+     */
+    static void addLayer(const MediaTuple &group, const std::string &rid, size_t order, const RtspMediaSource::Ptr &src);
+    static void delLayer(const RtspMediaSource::Ptr &src);
+
+    /**
+     * 获取组内各层，按分辨率(高度)从低到高排序，任一层高度未知时按rid在sdp中的顺序排序；非simulcast流返回空
+     * Get the layers of the group ranked by resolution (height) ascending, or by the rid order of the sdp if any height is unknown;
+     * empty if the stream is not simulcast
+     */
+    static std::vector<Layer> getLayers(const MediaTuple &group);
+};
+
+/**
+ * 根据带宽估计与观看端最大分辨率选择simulcast层：
+ * 拥塞(过载或丢包>10%)或估计值低于当前层码率时降级；估计值能容纳更高层时直接升级；
+ * 估计值被已确认码率封顶时，在网络稳定一段时间后试探升一级，试探失败则指数退避
+ * Select the simulcast layer by the bandwidth estimate and the max resolution requested by the viewer:
+ * step down on congestion (overuse or loss > 10%) or when the estimate drops below the current layer bitrate; step up directly
+ * when the estimate fits a higher layer; since the estimate is capped by the acked bitrate, probe one layer up after a stable
+ * period, with exponential backoff when the probe fails
+ */
+class SimulcastLayerSelector {
+public:
+    /**
+     * @param layers 按分辨率从低到高排序的各层 / layers ranked by resolution ascending
+     * @param cur 当前层下标，未选择时为-1 / index of the current layer, -1 if none
+     * @param max_height 观看端要求的最大高度，0为不限制 / max height requested by the viewer, 0 for unlimited
+     * @param bwe 带宽估计器，可为空 / the bandwidth estimator, may be null
+     * @return 目标层下标 / index of the target layer
+     */
+    int select(const std::vector<SimulcastGroup::Layer> &layers, int cur, int max_height, const SendSideBwe *bwe, uint64_t now_ms);
+
+    /**
+     * 层切换已在关键帧处生效，或等待关键帧超时而放弃
+     * A layer switch took effect at a key frame, or was abandoned after waiting too long for one
+     */
+    void onSwitched(bool ok, uint64_t now_ms);
+
+private:
+    // 试探升级后的观察期内不因估计值偏低而降级，此时估计值尚未随新层码率上涨
+    // During the observation period after a probe the estimate has not yet caught up with the new layer, so only congestion steps down
+    bool _probing = false;
+    uint64_t _probe_ms = 0;
+    uint64_t _last_switch_ms = 0;
+    uint64_t _backoff_ms = 0;
+};
+
+/**
+ * 切换simulcast层或抽帧时改写视频rtp的seq与时间戳，使得播放端看到的是一条连续的流；ssrc由WebRtcTransportImp统一改写
+ * Rewrite seq and timestamp of video rtp on simulcast layer switches or frame thinning so the player sees a single continuous stream;
+ * ssrc is rewritten by WebRtcTransportImp anyway
+ */
+class SimulcastRtpRewriter {
+public:
+    /**
+     * 判断rtp是否为关键帧的起始包，仅在关键帧处切换层；不支持的编码返回false
+     * Whether the rtp starts a key frame, layers are switched at key frames only; false for unsupported codecs
+     */
+    static bool isKeyFrameStart(CodecId codec, const RtpPacket::Ptr &rtp);
+
+    /**
+     * 以新层的首个rtp计算seq与时间戳偏移量
+     * Compute the seq and timestamp offsets from the first rtp of the new layer
+     */
+    void switchTo(const RtpPacket::Ptr &first, uint64_t now_ms);
+
+    /**
+     * 丢弃了一个视频rtp，后续rtp的seq前移以免播放端认为丢包
+     * A video rtp was dropped, shift the seq of the following ones so the player does not see a loss
+     */
+    void dropPacket() { --_seq_offset; }
+
+    /**
+     * 改写视频rtp，偏移量为0时返回原包，否则返回拷贝(源rtp被多个播放器共享，不能原地修改)
+     * Rewrite a video rtp, returns the rtp itself when there is no offset, otherwise a copy (the source rtp is shared by all players)
+     */
+    RtpPacket::Ptr rewrite(const RtpPacket::Ptr &rtp, uint64_t now_ms);
+
+private:
+    bool _started = false;
+    uint16_t _seq_offset = 0;
+    uint32_t _stamp_offset = 0;
+    uint16_t _last_seq = 0;
+    uint32_t _last_stamp = 0;
+    uint64_t _last_ntp = 0;
+    uint64_t _last_ms = 0;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_SIMULCAST_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include "UdpBatchSender.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+
+#if defined(__linux__) || defined(__linux)
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static atomic<uint64_t> s_packets { 0 };
+static atomic<uint64_t> s_gso_packets { 0 };
+static atomic<uint64_t> s_syscalls { 0 };
+static atomic<uint64_t> s_fallback_packets { 0 };
+
+#if defined(__linux__) || defined(__linux)
+// 内核或网卡不支持GSO时(如缺少校验和卸载)，首次失败后全局关闭
+// GSO is disabled globally after the first failure when the kernel or NIC does not support it (e.g. without checksum offload)
+static atomic<bool> s_gso_supported { true };
+// 单个GSO报文的最大负载与分片数
+// Max payload and segments of a GSO datagram
+static constexpr size_t kMaxGsoBytes = 65000;
+static constexpr size_t kMaxGsoSegments = 64;
+
+size_t UdpBatchSender::send(int fd, const struct sockaddr *addr, socklen_t addr_len, const vector<Buffer::Ptr> &packets, size_t offset, bool gso) {
+    gso = gso && s_gso_supported;
+    auto total = MIN(packets.size() - MIN(packets.size(), offset), kMaxPackets);
+    if (!total) {
+        return 0;
+    }
+
+    struct mmsghdr msgs[kMaxPackets];
+    struct iovec iovs[kMaxPackets];
+    char controls[kMaxPackets][CMSG_SPACE(sizeof(uint16_t))];
+    size_t counts[kMaxPackets];
+    size_t msg_count = 0;
+    memset(msgs, 0, sizeof(struct mmsghdr) * kMaxPackets);
+
+    for (size_t i = 0; i < total;) {
+        auto &head = packets[offset + i];
+        size_t count = 1;
+        size_t bytes = head->size();
+        if (gso) {
+            // GSO要求除最后一片外各片等长，且最后一片不大于分片大小
+            // GSO requires all segments but the last to be equally sized, and the last one no larger
+            while (i + count < total && count < kMaxGsoSegments) {
+                auto size = packets[offset + i + count]->size();
+                if (size > head->size() || bytes + size > kMaxGsoBytes) {
+                    break;
+                }
+                bytes += size;
+                ++count;
+                if (size < head->size()) {
+                    break;
+                }
+            }
+        }
+        for (size_t j = 0; j < count; ++j) {
+            auto &packet = packets[offset + i + j];
+            iovs[i + j].iov_base = packet->data();
+            iovs[i + j].iov_len = packet->size();
+        }
+        auto &hdr = msgs[msg_count].msg_hdr;
+        hdr.msg_name = (void *)addr;
+        hdr.msg_namelen = addr_len;
+        hdr.msg_iov = &iovs[i];
+        hdr.msg_iovlen = count;
+        if (count > 1) {
+            hdr.msg_control = controls[msg_count];
+            hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            auto cmsg = CMSG_FIRSTHDR(&hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment = head->size();
+            memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+        }
+        counts[msg_count++] = count;
+        i += count;
+    }
+
+    int ret;
+    do {
+        ret = sendmmsg(fd, msgs, msg_count, 0);
+    } while (ret == -1 && errno == EINTR);
+    ++s_syscalls;
+
+    if (ret <= 0) {
+        auto err = errno;
+        if (gso && msg_count < total && (err == EIO || err == EINVAL || err == ENOPROTOOPT || err == EOPNOTSUPP)) {
+            if (s_gso_supported.exchange(false)) {
+                WarnL << "Udp GSO is not supported, disabled: " << strerror(err);
+            }
+            return send(fd, addr, addr_len, packets, offset, false);
+        }
+        return 0;
+    }
+
+    size_t sent = 0;
+    for (int i = 0; i < ret; ++i) {
+        sent += counts[i];
+        if (counts[i] > 1) {
+            s_gso_packets += counts[i];
+        }
+    }
+    s_packets += sent;
+    return sent;
+}
+#else
+size_t UdpBatchSender::send(int fd, const struct sockaddr *addr, socklen_t addr_len, const vector<Buffer::Ptr> &packets, size_t offset, bool gso) {
+    return 0;
+}
+#endif
+
+void UdpBatchSender::addFallback(size_t packets) {
+    s_fallback_packets += packets;
+}
+
+UdpBatchSender::Statistic UdpBatchSender::getStatistic() {
+    Statistic ret;
+    ret.packets = s_packets;
+    ret.gso_packets = s_gso_packets;
+    ret.syscalls = s_syscalls;
+    ret.fallback_packets = s_fallback_packets;
+    return ret;
+}
+
+} // namespace mediakit
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_UDPBATCHSENDER_H
+#define ZLMEDIAKIT_UDPBATCHSENDER_H
+
+#include <vector>
+#include <cstdint>
+#include "Network/Buffer.h"
+#include "Network/sockutil.h"
+
+namespace mediakit {
+
+/**
+ * 向同一对端批量发送udp数据包：linux下通过一次sendmmsg发出整批数据，
+ * 并将连续的等长数据包合并为UDP_SEGMENT(GSO)超大报文，由内核或网卡完成分片
+ * Send a batch of udp packets to one peer: on linux the whole batch goes out with a single sendmmsg,
+ * and runs of equally sized packets are merged into UDP_SEGMENT (GSO) super datagrams segmented by the kernel or NIC
+ */
+class UdpBatchSender {
+public:
+    // 单次系统调用最多发送的数据包个数
+    // Max packets sent per syscall
+    static constexpr size_t kMaxPackets = 64;
+
+    struct Statistic {
+        // 批量发出的数据包个数
+        // Packets sent in batches
+        uint64_t packets;
+        // 其中以GSO超大报文发出的数据包个数
+        // Packets of them sent as GSO super datagrams
+        uint64_t gso_packets;
+        // 批量发送的系统调用次数
+        // Syscalls of batch sending
+        uint64_t syscalls;
+        // 因socket发送队列非空、非udp或发送失败而回退到逐包发送的数据包个数
+        // Packets falling back to per packet sending because the socket queue was not empty, not udp, or the batch failed
+        uint64_t fallback_packets;
+    };
+
+    /**
+     * 从offset开始发送数据包，最多发送kMaxPackets个
+     * @return 已发出的数据包个数，未发出的需由调用者通过其他方式发送
+     * Send packets starting at offset, at most kMaxPackets
+     * @return Number of packets sent, the caller must send the rest by other means
+     */
+    static size_t send(int fd, const struct sockaddr *addr, socklen_t addr_len, const std::vector<toolkit::Buffer::Ptr> &packets,
+                       size_t offset, bool gso);
+
+    static void addFallback(size_t packets);
+
+    static Statistic getStatistic();
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_UDPBATCHSENDER_H
@@ -11,6 +11,9 @@
 #include "WebRtcPlayer.h"
 
 #include "Common/config.h"
+#include "Common/Parser.h"
+#include "Common/StreamCpuStat.h"
+#include "Common/FrameTracer.h"
 #include "Extension/Factory.h"
 #include "Util/base64.h"
 
@@ -25,6 +28,10 @@ const string kBfilter = RTC_FIELD "bfilter";
 static onceToken token([]() { mINI::Instance()[kBfilter] = 0; });
 } // namespace Rtc
 
+// 开始播放后该时长内的关键帧请求视为加入时的请求
+// Key frame requests within this period after playback starts are considered joining requests
+static constexpr uint64_t kJoinKeyFrameMS = 3000;
+
 H264BFrameFilter::H264BFrameFilter()
     : _last_seq(0)
     , _last_stamp(0)
@@ -226,72 +233,285 @@ void WebRtcPlayer::onStartWebRTC() {
         onShutdown(SockException(Err_shutdown, "rtsp media source was shutdown"));
         return;
     }
+    // 基类据此决定是否开启发送端带宽估计
+    // The base class decides whether to run the send side bandwidth estimation by them
+    GET_CONFIG(bool, frame_thinning, General::kFrameThinning);
+    _thinning = frame_thinning && !_bfliter_flag;
+    GET_CONFIG(bool, simulcast_switch, Rtc::kSimulcastSwitch);
+    auto layers = simulcast_switch ? SimulcastGroup::getLayers(_media_info) : vector<SimulcastGroup::Layer>();
+    for (auto &layer : layers) {
+        if (layer.src == playSrc) {
+            _simulcast = true;
+            _rid = layer.rid;
+        }
+    }
     WebRtcTransportImp::onStartWebRTC();
     if (canSendRtp()) {
+        GET_CONFIG(bool, shared_nack_cache, Rtc::kSharedNackCache);
+        if (shared_nack_cache && !_bfliter_flag && !_simulcast && !_thinning) {
+            // 过滤b帧、切换simulcast层或抽帧时发送的rtp与源rtp不一一对应，只能使用各自的nack_list
+            // With b frames filtered, simulcast layers switched or frames thinned the rtp sent does not map one to one to the source rtp, so the own nack_list is used
+            GET_CONFIG(uint32_t, max_rtp_cache_ms, Rtc::kMaxRtpCacheMS);
+            GET_CONFIG(uint32_t, max_rtp_cache_size, Rtc::kMaxRtpCacheSize);
+            setRetransmitCache(playSrc->getRetransmitCache(max_rtp_cache_size, max_rtp_cache_ms));
+        }
         playSrc->pause(false);
-        _reader = playSrc->getRing()->attach(getPoller(), true);
-        weak_ptr<WebRtcPlayer> weak_self = static_pointer_cast<WebRtcPlayer>(shared_from_this());
-        weak_ptr<Session> weak_session = static_pointer_cast<Session>(getSession());
-        _reader->setGetInfoCB([weak_session]() {
-            Any ret;
-            ret.set(static_pointer_cast<Session>(weak_session.lock()));
-            return ret;
-        });
-        _reader->setReadCB([weak_self](const RtspMediaSource::RingDataType &pkt) {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
+        _reader = attachReader(playSrc, true);
+        _play_ticker.resetTime();
+        auto video = playSrc->getTrack(TrackVideo, false);
+        _video_codec = video ? video->getCodecId() : CodecInvalid;
+        if (_simulcast) {
+            _max_height = atoi(Parser::parseArgs(_media_info.params)["max_height"].data());
+            _selector.onSwitched(true, getCurrentMillisecond());
+            weak_ptr<WebRtcPlayer> weak_self = static_pointer_cast<WebRtcPlayer>(shared_from_this());
+            _simulcast_timer = std::make_shared<Timer>(1.0f, [weak_self]() {
+                auto strong_self = weak_self.lock();
+                if (!strong_self) {
+                    return false;
+                }
+                strong_self->checkSimulcastLayer();
+                return true;
+            }, getPoller());
+        }
+    }
+}
+
+WebRtcPlayer::RingReader::Ptr WebRtcPlayer::attachReader(const RtspMediaSource::Ptr &src, bool use_cache) {
+    auto reader = src->getRing()->attach(getPoller(), use_cache);
+    auto reader_ptr = reader.get();
+    auto cpu_stat = StreamCpuStat::get(*src);
+    auto tracer = FrameTracer::get(*src);
+    weak_ptr<WebRtcPlayer> weak_self = static_pointer_cast<WebRtcPlayer>(shared_from_this());
+    weak_ptr<Session> weak_session = static_pointer_cast<Session>(getSession());
+    reader->setGetInfoCB([weak_session]() {
+        Any ret;
+        ret.set(static_pointer_cast<Session>(weak_session.lock()));
+        return ret;
+    });
+    reader->setReadCB([weak_self, reader_ptr, cpu_stat, tracer](const RtspMediaSource::RingDataType &pkt) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        CpuTimeScope cpu_scope(cpu_stat, CpuStage::send);
+        strong_self->onReaderData(reader_ptr, pkt);
+        if (tracer && tracer->enabled()) {
+            pkt->for_each([&](const RtpPacket::Ptr &rtp) { tracer->onSend(rtp->getStampMS(false), "webrtc"); });
+        }
+    });
+    reader->setDetachCB([weak_self, reader_ptr]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        strong_self->onReaderDetach(reader_ptr);
+    });
+
+    reader->setMessageCB([weak_self](const toolkit::Any &data) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        if (data.is<Buffer>()) {
+            auto &buffer = data.get<Buffer>();
+            // PPID 51: 文本string  [AUTO-TRANSLATED:69a8cf81]
+            // PPID 51: Text string
+            // PPID 53: 二进制  [AUTO-TRANSLATED:faf00c3e]
+            // PPID 53: Binary
+            strong_self->sendDatachannel(0, 51, buffer.data(), buffer.size());
+        } else {
+            WarnL << "Send unknown message type to webrtc player: " << data.type_name();
+        }
+    });
+    return reader;
+}
+
+void WebRtcPlayer::onReaderData(const RingReader *reader, const RtspMediaSource::RingDataType &pkt) {
+    size_t skip = 0;
+    if (_pending_reader && reader == _pending_reader.get()) {
+        // 目标层收到关键帧后才切换，此前的数据丢弃
+        // Switch to the target layer at its key frame, data before it is dropped
+        RtpPacket::Ptr key_rtp;
+        pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+            if (key_rtp) {
                 return;
             }
-
-            if (strong_self->_send_config_frames_once && !pkt->empty()) {
-                const auto &first_rtp = pkt->front();
-                strong_self->sendConfigFrames(first_rtp->getSeq(), first_rtp->sample_rate, first_rtp->getStamp(), first_rtp->ntp_stamp);
-                strong_self->_send_config_frames_once = false;
+            if (rtp->type == TrackVideo && SimulcastRtpRewriter::isKeyFrameStart(_video_codec, rtp)) {
+                key_rtp = rtp;
+                return;
             }
+            ++skip;
+        });
+        if (!key_rtp) {
+            return;
+        }
+        auto now = getCurrentMillisecond();
+        InfoL << "RTC播放器(" << _media_info.shortUrl() << ")切换simulcast层: " << _rid << " -> " << _pending_rid
+              << ", 等待关键帧耗时(ms):" << _pending_ticker.elapsedTime();
+        _reader = std::move(_pending_reader);
+        _play_src = _pending_src;
+        _rid = std::move(_pending_rid);
+        _rewriter.switchTo(key_rtp, now);
+        _selector.onSwitched(true, now);
+    } else if (reader != _reader.get()) {
+        return;
+    }
+
+    if (_send_config_frames_once && !pkt->empty()) {
+        const auto &first_rtp = pkt->front();
+        sendConfigFrames(first_rtp->getSeq(), first_rtp->sample_rate, first_rtp->getStamp(), first_rtp->ntp_stamp);
+        _send_config_frames_once = false;
+    }
+
+    if (_simulcast || _thinning) {
+        sendRewrittenRtp(pkt, skip);
+        return;
+    }
 
-            size_t i = 0;
-            pkt->for_each([&](const RtpPacket::Ptr &rtp) {
-                if (strong_self->_bfliter_flag) {
-                    if (TrackVideo == rtp->type && strong_self->_is_h264) {
-                        auto rtp_filter = strong_self->_bfilter->processPacket(rtp);
-                        if (rtp_filter) {
-                            strong_self->onSendRtp(rtp_filter, ++i == pkt->size());
-                        }
-                    } else {
-                        strong_self->onSendRtp(rtp, ++i == pkt->size());
-                    }
-                } else {
-                    strong_self->onSendRtp(rtp, ++i == pkt->size());
+    size_t i = 0;
+    pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+        if (_bfliter_flag) {
+            if (TrackVideo == rtp->type && _is_h264) {
+                auto rtp_filter = _bfilter->processPacket(rtp);
+                if (rtp_filter) {
+                    onSendRtp(rtp_filter, ++i == pkt->size());
                 }
-            });
-        });
-        _reader->setDetachCB([weak_self]() {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
-                return;
+            } else {
+                onSendRtp(rtp, ++i == pkt->size());
             }
-            strong_self->onShutdown(SockException(Err_shutdown, "rtsp ring buffer detached"));
-        });
+        } else {
+            onSendRtp(rtp, ++i == pkt->size());
+        }
+    });
+}
+
+void WebRtcPlayer::onReaderDetach(const RingReader *reader) {
+    if (_pending_reader && reader == _pending_reader.get()) {
+        // 目标层已注销，放弃切换
+        // The target layer was unregistered, give up the switch
+        cancelSimulcastSwitch();
+        return;
+    }
+    if (reader == _reader.get()) {
+        onShutdown(SockException(Err_shutdown, "rtsp ring buffer detached"));
+    }
+}
 
-        _reader->setMessageCB([weak_self](const toolkit::Any &data) {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
+void WebRtcPlayer::sendRewrittenRtp(const RtspMediaSource::RingDataType &pkt, size_t skip) {
+    auto now = getCurrentMillisecond();
+    RtpPacket::Ptr last;
+    size_t i = 0;
+    pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+        if (i++ < skip) {
+            return;
+        }
+        RtpPacket::Ptr out;
+        if (rtp->type == TrackVideo) {
+            if (_thinning && _thinner.dropRtp(_video_codec, rtp)) {
+                _rewriter.dropPacket();
                 return;
             }
-            if (data.is<Buffer>()) {
-                auto &buffer = data.get<Buffer>();
-                // PPID 51: 文本string  [AUTO-TRANSLATED:69a8cf81]
-                // PPID 51: Text string
-                // PPID 53: 二进制  [AUTO-TRANSLATED:faf00c3e]
-                // PPID 53: Binary
-                strong_self->sendDatachannel(0, 51, buffer.data(), buffer.size());
-            } else {
-                WarnL << "Send unknown message type to webrtc player: " << data.type_name();
+            out = _rewriter.rewrite(rtp, now);
+        } else if (_simulcast) {
+            // 各层的音频是同一路rtp，切换层后跳过已发送过的音频
+            // Audio of every layer is the same rtp, skip audio already sent after a layer switch
+            auto seq = rtp->getSeq();
+            if (_audio_seq_valid && (int16_t)(seq - _last_audio_seq) <= 0) {
+                return;
             }
-        });
+            _audio_seq_valid = true;
+            _last_audio_seq = seq;
+            out = rtp;
+        } else {
+            out = rtp;
+        }
+        // 延后一个包发送，确保最后发出的包带flush标记
+        // Send one packet behind so the last one sent carries the flush flag
+        if (last) {
+            onSendRtp(last, false);
+        }
+        last = std::move(out);
+    });
+    if (last) {
+        onSendRtp(last, true);
     }
 }
 
+bool WebRtcPlayer::needSendSideBwe() const {
+    // simulcast层选择与抽帧依赖带宽估计
+    // Simulcast layer selection and frame thinning rely on the bandwidth estimate
+    return _simulcast || _thinning || WebRtcTransportImp::needSendSideBwe();
+}
+
+void WebRtcPlayer::onSendBitrateEstimate(uint32_t bps) {
+    if (!_thinning) {
+        return;
+    }
+    auto play_src = _play_src.lock();
+    if (!play_src) {
+        return;
+    }
+    auto thinning = _thinner.isThinning();
+    _thinner.updateByBitrate(bps, play_src->getBytesSpeed() * 8);
+    if (thinning != _thinner.isThinning()) {
+        InfoL << "RTC播放器(" << _media_info.shortUrl() << ")" << (thinning ? "停止" : "开始") << "抽帧, 带宽估计(bps):" << bps
+              << ", 已丢弃帧数:" << _thinner.getDroppedFrames();
+    }
+}
+
+void WebRtcPlayer::checkSimulcastLayer() {
+    auto now = getCurrentMillisecond();
+    if (_pending_reader) {
+        if (_pending_ticker.elapsedTime() < 5000) {
+            return;
+        }
+        WarnL << "RTC播放器(" << _media_info.shortUrl() << ")等待simulcast层关键帧超时: " << _pending_rid;
+        cancelSimulcastSwitch();
+    }
+    auto layers = SimulcastGroup::getLayers(_media_info);
+    auto play_src = _play_src.lock();
+    int cur = -1;
+    for (int i = 0; i < (int)layers.size(); ++i) {
+        if (layers[i].src == play_src) {
+            cur = i;
+            break;
+        }
+    }
+    auto target = _selector.select(layers, cur, _max_height, getSendSideBwe().get(), now);
+    if (target >= 0 && target != cur) {
+        switchSimulcastLayer(layers[target]);
+    }
+}
+
+void WebRtcPlayer::onRecvKeyFrameRequest() {
+    // 切换simulcast层期间新层的关键帧已在请求中
+    // A key frame of the new layer is requested already while switching simulcast layers
+    auto src = _pending_reader ? _pending_src.lock() : _play_src.lock();
+    if (!src) {
+        return;
+    }
+    // 浏览器在开始播放时会请求关键帧，而加入时已从gop缓存收到了关键帧
+    // Browsers ask for a key frame when playback starts, while a key frame came from the gop cache on joining
+    src->requestKeyFrame(!_pending_reader && _play_ticker.elapsedTime() < kJoinKeyFrameMS);
+}
+
+void WebRtcPlayer::switchSimulcastLayer(const SimulcastGroup::Layer &layer) {
+    // 只接收实时数据，在目标层的下一个关键帧处切换，并请求推流端尽快产生关键帧
+    // Receive live data only and switch at the next key frame of the target layer, asking the pusher for one right away
+    _pending_rid = layer.rid;
+    _pending_src = layer.src;
+    _pending_reader = attachReader(layer.src, false);
+    _pending_ticker.resetTime();
+    layer.src->requestKeyFrame();
+}
+
+void WebRtcPlayer::cancelSimulcastSwitch() {
+    _pending_reader = nullptr;
+    _pending_src.reset();
+    _pending_rid.clear();
+    _selector.onSwitched(false, getCurrentMillisecond());
+}
+
 void WebRtcPlayer::onDestory() {
     auto duration = getDuration();
     auto bytes_usage = getBytesUsage();
@@ -317,6 +537,23 @@ void WebRtcPlayer::onRtcConfigure(RtcConfigure &configure) const {
     // This is playing
     configure.audio.direction = configure.video.direction = RtpDirection::sendonly;
     configure.setPlayRtspInfo(playSrc->getSdp());
+
+    GET_CONFIG(bool, fec, Rtc::kFec);
+    if (fec) {
+        // 视频的ulpfec封装在red中，音频red携带冗余帧
+        // Video ulpfec is carried in red, audio red carries redundant frames
+        configure.audio.support_red = configure.video.support_red = configure.video.support_ulpfec = true;
+    }
+}
+
+std::string WebRtcPlayer::getNegotiationKey() const {
+    auto playSrc = _play_src.lock();
+    if (!playSrc) {
+        return "";
+    }
+    // answer的编码与轨道取决于播放源的sdp
+    // Codecs and tracks of the answer depend on the sdp of the play source
+    return WebRtcTransportImp::getNegotiationKey() + '\n' + playSrc->getSdp();
 }
 
 void WebRtcPlayer::sendConfigFrames(uint32_t before_seq, uint32_t sample_rate, uint32_t timestamp, uint64_t ntp_timestamp) {
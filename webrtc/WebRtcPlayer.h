@@ -12,6 +12,8 @@
 #define ZLMEDIAKIT_WEBRTCPLAYER_H
 
 #include "WebRtcTransport.h"
+#include "Simulcast.h"
+#include "Common/FrameThinner.h"
 #include "Rtsp/RtspMediaSource.h"
 
 namespace mediakit {
@@ -134,12 +136,25 @@ protected:
     void onStartWebRTC() override;
     void onDestory() override;
     void onRtcConfigure(RtcConfigure &configure) const override;
+    std::string getNegotiationKey() const override;
+    void onSendBitrateEstimate(uint32_t bps) override;
+    void onRecvKeyFrameRequest() override;
+    bool needSendSideBwe() const override;
 
 private:
     WebRtcPlayer(const toolkit::EventPoller::Ptr &poller, const RtspMediaSource::Ptr &src, const MediaInfo &info);
 
     void sendConfigFrames(uint32_t before_seq, uint32_t sample_rate, uint32_t timestamp, uint64_t ntp_timestamp);
 
+    using RingReader = RtspMediaSource::RingType::RingReader;
+    RingReader::Ptr attachReader(const RtspMediaSource::Ptr &src, bool use_cache);
+    void onReaderData(const RingReader *reader, const RtspMediaSource::RingDataType &pkt);
+    void onReaderDetach(const RingReader *reader);
+    void sendRewrittenRtp(const RtspMediaSource::RingDataType &pkt, size_t skip);
+    void checkSimulcastLayer();
+    void switchSimulcastLayer(const SimulcastGroup::Layer &layer);
+    void cancelSimulcastSwitch();
+
 private:
     // 媒体相关元数据  [AUTO-TRANSLATED:f4cf8045]
     // Media related metadata
@@ -155,10 +170,38 @@ private:
     // 播放rtsp源的reader对象  [AUTO-TRANSLATED:7b305055]
     // Reader object for playing rtsp source
     RtspMediaSource::RingType::RingReader::Ptr _reader;
+    // 开始播放的计时，刚加入时的关键帧请求可由gop缓存满足
+    // Ticker since playing started, key frame requests right after joining may be served by the gop cache
+    toolkit::Ticker _play_ticker;
 
     bool _is_h264 { false };
     bool _bfliter_flag { false };
     std::shared_ptr<H264BFrameFilter> _bfilter;
+
+    // 播放simulcast推流的主流名时，在各rid层之间切换
+    // Switch among the rid layers when playing the main stream name of a simulcast push
+    bool _simulcast { false };
+    // 观看端通过url参数max_height限制的最大高度
+    // Max height limited by the viewer with the url param max_height
+    int _max_height { 0 };
+    CodecId _video_codec { CodecInvalid };
+    std::string _rid;
+    // 等待关键帧的目标层
+    // Target layer waiting for a key frame
+    std::string _pending_rid;
+    std::weak_ptr<RtspMediaSource> _pending_src;
+    RingReader::Ptr _pending_reader;
+    toolkit::Ticker _pending_ticker;
+    bool _audio_seq_valid { false };
+    uint16_t _last_audio_seq { 0 };
+    SimulcastLayerSelector _selector;
+    SimulcastRtpRewriter _rewriter;
+    toolkit::Timer::Ptr _simulcast_timer;
+
+    // 带宽不足时丢弃不被参考的帧，需改写seq，因此不能与共享重传缓存同时使用
+    // Drop frames nobody references when bandwidth is short, seq is rewritten so it cannot work with the shared retransmission cache
+    bool _thinning { false };
+    FrameThinner _thinner;
 };
 
 }// namespace mediakit
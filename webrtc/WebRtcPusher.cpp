@@ -8,9 +8,11 @@
  * may be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
 #include "WebRtcPusher.h"
 #include "Common/config.h"
 #include "Rtsp/RtspMediaSourceImp.h"
+#include "Simulcast.h"
 
 using namespace std;
 using namespace toolkit;
@@ -82,9 +84,25 @@ toolkit::EventPoller::Ptr WebRtcPusher::getOwnerPoller(MediaSource &sender) {
     return getPoller();
 }
 
+// rid在sdp(a=simulcast)中的顺序，未协商的rid排在最后
+// Order of the rid in the sdp (a=simulcast), rids not negotiated go last
+static size_t getRidOrder(const RtcSession &sdp, const string &rid) {
+    for (auto &m : sdp.media) {
+        if (m.type != TrackVideo) {
+            continue;
+        }
+        auto it = find(m.rtp_rids.begin(), m.rtp_rids.end(), rid);
+        return it - m.rtp_rids.begin();
+    }
+    return 0;
+}
+
 void WebRtcPusher::onRecvRtp(MediaTrack &track, const string &rid, RtpPacket::Ptr rtp) {
     if (!_simulcast) {
         assert(_push_src);
+        if (rtp->type == TrackVideo) {
+            _video_ssrc = rtp->getSSRC();
+        }
         _push_src->onWrite(rtp, false);
         return;
     }
@@ -106,6 +124,10 @@ void WebRtcPusher::onRecvRtp(MediaTrack &track, const string &rid, RtpPacket::Pt
             _push_src_sim_ownership[rid] = src_imp->getOwnership();
             src_imp->setListener(static_pointer_cast<WebRtcPusher>(shared_from_this()));
             src = src_imp;
+            _push_src_sim_ssrc[rid] = rtp->getSSRC();
+            // 登记为simulcast层，播放主流名时可在各层之间切换
+            // Register it as a simulcast layer, players of the main stream name can switch among the layers
+            SimulcastGroup::addLayer(_push_src->getMediaTuple(), rid, getRidOrder(*_answer_sdp, rid), src);
         }
         src->onWrite(std::move(rtp), false);
     }
@@ -120,6 +142,12 @@ void WebRtcPusher::onStartWebRTC() {
 }
 
 void WebRtcPusher::onDestory() {
+    if (_simulcast) {
+        std::lock_guard<std::recursive_mutex> lock(_mtx);
+        for (auto &pr : _push_src_sim) {
+            SimulcastGroup::delLayer(pr.second);
+        }
+    }
     auto duration = getDuration();
     auto bytes_usage = getBytesUsage();
     // 流量统计事件广播  [AUTO-TRANSLATED:6b0b1234]
@@ -156,6 +184,31 @@ float WebRtcPusher::getLossRate(MediaSource &sender,TrackType type) {
     return WebRtcTransportImp::getLossRate(type);
 }
 
+bool WebRtcPusher::requestKeyFrame(MediaSource &sender, bool joining) {
+    uint32_t ssrc = _video_ssrc;
+    if (_simulcast) {
+        std::lock_guard<std::recursive_mutex> lock(_mtx);
+        for (auto &pr : _push_src_sim) {
+            if (pr.second.get() == &sender) {
+                ssrc = _push_src_sim_ssrc[pr.first];
+                break;
+            }
+        }
+    }
+    if (!ssrc) {
+        return false;
+    }
+    // 可能在其他线程调用，切换到本对象线程发送
+    // May be called from other threads, send it on the poller of this object
+    weak_ptr<WebRtcPusher> weak_self = static_pointer_cast<WebRtcPusher>(shared_from_this());
+    getPoller()->async([weak_self, ssrc]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->sendRtcpPli(ssrc);
+        }
+    }, false);
+    return true;
+}
+
 void WebRtcPusher::OnDtlsTransportClosed(const RTC::DtlsTransport *dtlsTransport) {
    // 主动关闭推流，那么不等待重推  [AUTO-TRANSLATED:1ff514d7]
    // Actively close the stream, then do not wait for re-pushing
@@ -59,6 +59,9 @@ protected:
     // 获取丢包率  [AUTO-TRANSLATED:ec61b378]
     // Get packet loss rate
     float getLossRate(MediaSource &sender,TrackType type) override;
+    // 向推流端发送pli请求关键帧
+    // Send a pli to the pusher for a key frame
+    bool requestKeyFrame(MediaSource &sender, bool joining) override;
 
 private:
     WebRtcPusher(const toolkit::EventPoller::Ptr &poller, const RtspMediaSource::Ptr &src,
@@ -83,6 +86,10 @@ private:
     std::recursive_mutex _mtx;
     std::unordered_map<std::string/*rid*/, RtspMediaSource::Ptr> _push_src_sim;
     std::unordered_map<std::string/*rid*/, std::shared_ptr<void> > _push_src_sim_ownership;
+    // 各rid视频的ssrc，用于按层请求关键帧
+    // Video ssrc of each rid, used to request key frames per layer
+    std::unordered_map<std::string/*rid*/, uint32_t> _push_src_sim_ssrc;
+    std::atomic<uint32_t> _video_ssrc { 0 };
 };
 
 class WebRtcPlayerClient : public WebRtcTransportImp {
@@ -17,7 +17,10 @@
 #include "Network/sockutil.h"
 #include "Common/config.h"
 #include "Nack.h"
+#include "JitterBuffer.h"
+#include "SdpAnswerCache.h"
 #include "RtpExt.h"
+#include "UdpBatchSender.h"
 #include "Rtcp/Rtcp.h"
 #include "Rtcp/RtcpFCI.h"
 #include "Rtcp/RtcpContext.h"
@@ -28,6 +31,7 @@
 #include "WebRtcEchoTest.h"
 #include "WebRtcPlayer.h"
 #include "WebRtcPusher.h"
+#include "Simulcast.h"
 #include "Rtsp/RtspMediaSourceImp.h"
 
 #define RTP_SSRC_OFFSET 1
@@ -82,6 +86,29 @@ const string kMinBitrate = RTC_FIELD "min_bitrate";
 // Data channel setting
 const string kDataChannelEcho = RTC_FIELD "datachannel_echo";
 
+// 批量发送设置
+// Batch sending settings
+const string kEgressBatch = RTC_FIELD "egressBatch";
+const string kEgressGSO = RTC_FIELD "egressGSO";
+
+// 播放器共享重传缓存设置
+// Shared retransmission cache setting of players
+const string kSharedNackCache = RTC_FIELD "sharedNackCache";
+
+// 发送端带宽估计与平滑发送设置
+// Send side bandwidth estimation and pacing settings
+const string kSendBwe = RTC_FIELD "sendBwe";
+const string kPacer = RTC_FIELD "pacer";
+const string kPacingFactor = RTC_FIELD "pacingFactor";
+const string kPacerMaxQueueMS = RTC_FIELD "pacerMaxQueueMS";
+const string kSimulcastSwitch = RTC_FIELD "simulcastSwitch";
+
+// 前向纠错设置
+// Forward error correction settings
+const string kFec = RTC_FIELD "fec";
+const string kFecLossFactor = RTC_FIELD "fecLossFactor";
+const string kFecMaxRatio = RTC_FIELD "fecMaxRatio";
+
 static onceToken token([]() {
     mINI::Instance()[kTimeOutSec] = 15;
     mINI::Instance()[kExternIP] = "";
@@ -95,6 +122,17 @@ static onceToken token([]() {
     mINI::Instance()[kMinBitrate] = 0;
 
     mINI::Instance()[kDataChannelEcho] = true;
+    mINI::Instance()[kEgressBatch] = 1;
+    mINI::Instance()[kEgressGSO] = 1;
+    mINI::Instance()[kSharedNackCache] = 1;
+    mINI::Instance()[kSendBwe] = 0;
+    mINI::Instance()[kPacer] = 0;
+    mINI::Instance()[kPacingFactor] = 2.5;
+    mINI::Instance()[kPacerMaxQueueMS] = 500;
+    mINI::Instance()[kSimulcastSwitch] = 1;
+    mINI::Instance()[kFec] = 0;
+    mINI::Instance()[kFecLossFactor] = 2;
+    mINI::Instance()[kFecMaxRatio] = 0.5;
 
     mINI::Instance()[kSignalingPort] = 3000;
     mINI::Instance()[kSignalingSslPort] = 3001;
@@ -349,6 +387,7 @@ void WebRtcTransport::getTransportInfo(const std::function<void(Json::Value)>& c
             } else {
                 result["ice_checklists"] = Json::nullValue;
             }
+            strong_self->getReceiveInfo(result);
             
             
         } catch (const std::exception& ex) {
@@ -693,6 +732,30 @@ std::string WebRtcTransport::createOfferSdp() {
 
 std::string WebRtcTransport::getAnswerSdp(const string &offer) {
     try {
+        SdpOfferDynamic dynamic;
+        string cache_key = getNegotiationKey();
+        if (!cache_key.empty()) {
+            string offer_key;
+            if (dynamic.split(offer, offer_key)) {
+                cache_key += '\n' + offer_key;
+            } else {
+                cache_key.clear();
+            }
+        }
+        auto entry = cache_key.empty() ? nullptr : SdpAnswerCache::Instance().get(cache_key);
+        if (entry) {
+            // 命中缓存，只需填入本会话的ice、dtls与origin字段
+            // Cache hit, only ice, dtls and origin fields of this session are filled in
+            _offer_sdp = std::make_shared<RtcSession>(entry->offer);
+            dynamic.applyTo(*_offer_sdp);
+            onCheckSdp(SdpType::offer, *_offer_sdp);
+            _offer_sdp->checkValid();
+            setRemoteDtlsFingerprint(SdpType::offer, *_offer_sdp);
+
+            _answer_sdp = std::make_shared<RtcSession>();
+            return SdpAnswerCache::stamp(*entry, *_offer_sdp, *_answer_sdp, _ice_agent->getUfrag(), _ice_agent->getPassword());
+        }
+
         // // 解析offer sdp ////  [AUTO-TRANSLATED:87c1f337]
         // // Parse offer sdp ////
         _offer_sdp = std::make_shared<RtcSession>();
@@ -712,6 +775,9 @@ std::string WebRtcTransport::getAnswerSdp(const string &offer) {
         onCheckSdp(SdpType::answer, *_answer_sdp);
         setSdpBitrate(*_answer_sdp);
         _answer_sdp->checkValid();
+        if (!cache_key.empty()) {
+            SdpAnswerCache::Instance().put(cache_key, *_offer_sdp, *_answer_sdp);
+        }
         return _answer_sdp->toString();
     } catch (exception &ex) {
         onShutdown(SockException(Err_shutdown, ex.what()));
@@ -783,9 +849,9 @@ void WebRtcTransport::inputSockData(const char *buf, int len, const IceTransport
 void WebRtcTransport::sendRtpPacket(const char *buf, int len, bool flush, void *ctx) {
     if (_srtp_session_send) {
         auto pkt = _packet_pool.obtain2();
-        // 预留rtx加入的两个字节  [AUTO-TRANSLATED:d1eb5cd7]
-        // Reserve two bytes for rtx joining
-        pkt->setCapacity((size_t)len + SRTP_MAX_TRAILER_LEN + 2);
+        // 预留rtx加入的两个字节以及插入transport-cc扩展的8个字节
+        // Reserve two bytes for rtx joining and eight bytes for inserting the transport-cc extension
+        pkt->setCapacity((size_t)len + SRTP_MAX_TRAILER_LEN + 2 + 8);
         memcpy(pkt->data(), buf, len);
         onBeforeEncryptRtp(pkt->data(), len, ctx);
         if (_srtp_session_send->EncryptRtp(reinterpret_cast<uint8_t *>(pkt->data()), &len)) {
@@ -859,13 +925,39 @@ void WebRtcTransportImp::onDestory() {
           << ", duration=" << getDuration()
           << ", bytes=" << getBytesUsage()
           << ", video_loss=" << video_loss
-          << ", audio_loss=" << audio_loss;
+          << ", audio_loss=" << audio_loss
+          << ", send_bwe=" << getSendBitrateEstimate();
+    _pacer_timer = nullptr;
     WebRtcTransport::onDestory();
     unregisterSelf();
 }
 
 void WebRtcTransportImp::onSendSockData(Buffer::Ptr buf, bool flush, const IceTransport::Pair::Ptr& pair) {
-    return _ice_agent->sendSocketData(buf, pair, flush);
+    GET_CONFIG(bool, egress_batch, Rtc::kEgressBatch);
+    if (!egress_batch) {
+        return _ice_agent->sendSocketData(buf, pair, flush);
+    }
+    if (pair) {
+        // 指定了pair的数据(stun/dtls等)不参与合并，先发出已缓存的数据以保持顺序
+        // Data with a specified pair (stun/dtls etc.) is not batched, send the pending batch first to keep the order
+        flushEgressBatch();
+        return _ice_agent->sendSocketData(buf, pair, flush);
+    }
+    // 同一次环形缓存回调中的数据包加密后暂存，直到flush时一次性发出
+    // Packets of one ring buffer callback are held after encryption and sent at once on flush
+    _egress_batch.emplace_back(std::move(buf));
+    if (flush || _egress_batch.size() >= UdpBatchSender::kMaxPackets) {
+        flushEgressBatch();
+    }
+}
+
+void WebRtcTransportImp::flushEgressBatch() {
+    if (_egress_batch.empty()) {
+        return;
+    }
+    GET_CONFIG(bool, egress_gso, Rtc::kEgressGSO);
+    _ice_agent->sendSocketDataBatch(_egress_batch, egress_gso);
+    _egress_batch.clear();
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -923,6 +1015,12 @@ void WebRtcTransportImp::onStartWebRTC() {
             // 该类型的track 才支持发送  [AUTO-TRANSLATED:b7c1e631]
             // This type of track supports sending
             _type_to_track[m_answer.type] = track;
+
+            auto red = m_answer.getPlan("red");
+            auto ulpfec = m_answer.getPlan("ulpfec");
+            if (red && (m_answer.type == TrackAudio || ulpfec)) {
+                track->fec = std::make_shared<RtpFecEncoder>(m_answer.type, red->pt, ulpfec ? ulpfec->pt : 0);
+            }
         }
         // send ssrc --> MediaTrack
         _ssrc_to_track[track->answer_ssrc_rtp] = track;
@@ -974,6 +1072,65 @@ void WebRtcTransportImp::onStartWebRTC() {
             ++index;
         }
     }
+    startSendSideBwe();
+}
+
+bool WebRtcTransportImp::needSendSideBwe() const {
+    GET_CONFIG(bool, send_bwe, Rtc::kSendBwe);
+    return send_bwe;
+}
+
+void WebRtcTransportImp::startSendSideBwe() {
+    if (!needSendSideBwe() || !canSendRtp()) {
+        return;
+    }
+    auto support_fb = [this](const string &name) {
+        return _answer_sdp->supportRtcpFb(name, TrackVideo) || _answer_sdp->supportRtcpFb(name, TrackAudio);
+    };
+    if (!support_fb(SdpConst::kTWCCRtcpFb) && !support_fb(SdpConst::kRembRtcpFb)) {
+        // 对端不会回复任何带宽反馈
+        // The peer will not send any bandwidth feedback
+        return;
+    }
+    // 复用sdp中的x-google比特率设置(单位kbps)作为估计值的初始值与上下限
+    // Reuse the x-google bitrate settings (kbps) of the sdp as the start value and bounds of the estimate
+    GET_CONFIG(uint32_t, start_bitrate, Rtc::kStartBitrate);
+    GET_CONFIG(uint32_t, min_bitrate, Rtc::kMinBitrate);
+    GET_CONFIG(uint32_t, max_bitrate, Rtc::kMaxBitrate);
+    _bwe = std::make_shared<SendSideBwe>((start_bitrate ? start_bitrate : 2000) * 1000, (min_bitrate ? min_bitrate : 100) * 1000,
+                                         (max_bitrate ? max_bitrate : 50000) * 1000);
+
+    GET_CONFIG(bool, pacer, Rtc::kPacer);
+    if (!pacer) {
+        return;
+    }
+    GET_CONFIG(uint32_t, max_queue_ms, Rtc::kPacerMaxQueueMS);
+    _pacer = std::make_shared<RtpPacer>(max_queue_ms, [this](const RtpPacket::Ptr &rtp, bool rtx, bool flush) { sendRtpNow(rtp, flush, rtx); });
+    GET_CONFIG(float, pacing_factor, Rtc::kPacingFactor);
+    _pacer->setPacingRate(_bwe->getBitrate() * pacing_factor);
+
+    weak_ptr<WebRtcTransportImp> weak_self = static_pointer_cast<WebRtcTransportImp>(shared_from_this());
+    _pacer_timer = std::make_shared<Timer>(RtpPacer::kIntervalMS / 1000.0f, [weak_self]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return false;
+        }
+        strong_self->_pacer->process(getCurrentMillisecond());
+        return true;
+    }, getPoller());
+}
+
+uint32_t WebRtcTransportImp::getSendBitrateEstimate() const {
+    return _bwe ? _bwe->getBitrate() : 0;
+}
+
+void WebRtcTransportImp::onBitrateFeedback() {
+    auto bps = _bwe->getBitrate();
+    if (_pacer) {
+        GET_CONFIG(float, pacing_factor, Rtc::kPacingFactor);
+        _pacer->setPacingRate(bps * pacing_factor);
+    }
+    onSendBitrateEstimate(bps);
 }
 
 void WebRtcTransportImp::onCheckAnswer(RtcSession &sdp) {
@@ -1098,6 +1255,16 @@ void WebRtcTransportImp::onRtcConfigure(RtcConfigure &configure) const {
     }
 }
 
+std::string WebRtcTransportImp::getNegotiationKey() const {
+    _StrPrinter printer;
+    printer << typeid(*this).name() << ' ' << RoleStr(getRole()) << ' ' << SignalingProtocolsStr(getSignalingProtocols()) << ' '
+            << _local_ip << ' ' << _preferred_tcp;
+    for (auto &cand : _cands) {
+        printer << '\n' << cand.toString();
+    }
+    return printer;
+}
+
 void WebRtcTransportImp::setPreferredTcp(bool flag) {
     _preferred_tcp = flag;
 }
@@ -1114,20 +1281,30 @@ void WebRtcTransportImp::setIceCandidate(vector<SdpAttrCandidate> cands) {
 
 class RtpChannel : public RtpTrackImp, public std::enable_shared_from_this<RtpChannel> {
 public:
-    RtpChannel(EventPoller::Ptr poller, RtpTrackImp::OnSorted cb, function<void(const FCI_NACK &nack)> on_nack) {
+    RtpChannel(EventPoller::Ptr poller, TrackType type, CodecId codec, RtpTrackImp::OnSorted cb,
+               function<void(const FCI_NACK &nack)> on_nack, function<void()> on_key_request) {
         _poller = std::move(poller);
         _on_nack = std::move(on_nack);
-        setOnSorted(std::move(cb));
         // 设置jitter buffer参数  [AUTO-TRANSLATED:eede98b6]
         // Set jitter buffer parameters
         GET_CONFIG(uint32_t, nack_maxms, Rtc::kNackMaxMS);
         GET_CONFIG(uint32_t, nack_max_rtp, Rtc::kNackMaxSize);
-        RtpTrackImp::setParams(nack_max_rtp, nack_maxms, nack_max_rtp / 2);
+        GET_CONFIG(bool, adaptive_jitter, Rtc::kAdaptiveJitterBuffer);
+        if (adaptive_jitter) {
+            // 由自适应jitter buffer排序并组帧，rtp不经过排序器(其会丢弃seq回退的重传包)
+            // The adaptive jitter buffer sorts and assembles frames, rtp bypasses the sorter (it would drop retransmissions behind its position)
+            _jitter_buffer = std::make_shared<JitterBuffer>(type, codec);
+            _jitter_buffer->setOnRtp(std::move(cb));
+            _jitter_buffer->setOnKeyFrameRequest(std::move(on_key_request));
+        } else {
+            setOnSorted(std::move(cb));
+            RtpTrackImp::setParams(nack_max_rtp, nack_maxms, nack_max_rtp / 2);
+        }
         _nack_ctx.setOnNack([this](const FCI_NACK &nack) { onNack(nack); });
     }
 
     RtpPacket::Ptr inputRtp(TrackType type, int sample_rate, uint8_t *ptr, size_t len, bool is_rtx) {
-        auto rtp = RtpTrack::inputRtp(type, sample_rate, ptr, len);
+        auto rtp = _jitter_buffer ? decodeRtp(type, sample_rate, ptr, len) : RtpTrack::inputRtp(type, sample_rate, ptr, len);
         if (!rtp) {
             return rtp;
         }
@@ -1138,6 +1315,11 @@ public:
             // Statistics of rtp reception, which is convenient for generating nack rtcp packets
             _rtcp_context.onRtp(seq, rtp->getStamp(), rtp->ntp_stamp, sample_rate, len);
         }
+        if (_jitter_buffer) {
+            updateNackState();
+            _jitter_buffer->inputRtp(rtp, is_rtx, getCurrentMillisecond());
+            startJitterTimer();
+        }
         return rtp;
     }
     void onRtcp(RtcpHeader *sr) { 
@@ -1155,7 +1337,50 @@ public:
         return _rtcp_context.getLostInterval() * 100 / expected;
     }
 
+    void getReceiveInfo(Json::Value &info) const {
+        info["ssrc"] = getSSRC();
+        info["nack_rtt"] = _nack_ctx.getRtt();
+        info["nack_recovered"] = (Json::UInt64)_nack_ctx.getRecovered();
+        info["nack_abandoned"] = (Json::UInt64)_nack_ctx.getAbandoned();
+        if (!_jitter_buffer) {
+            return;
+        }
+        auto &stats = _jitter_buffer->getStats();
+        Json::Value jitter;
+        jitter["target_delay_ms"] = stats.target_delay_ms;
+        jitter["jitter_ms"] = stats.jitter_ms;
+        jitter["frame_delay_ms"] = stats.frame_delay_ms;
+        jitter["nack_recover_ratio"] = stats.nack_recover_ratio;
+        jitter["frames_output"] = (Json::UInt64)stats.frames_output;
+        jitter["frames_dropped"] = (Json::UInt64)stats.frames_dropped;
+        jitter["packets_late"] = (Json::UInt64)stats.packets_late;
+        jitter["keyframe_requests"] = (Json::UInt64)stats.keyframe_requests;
+        info["jitter_buffer"] = std::move(jitter);
+    }
+
 private:
+    void updateNackState() {
+        _jitter_buffer->updateNackState(_nack_ctx.getRtt(), _nack_ctx.getRecovered(), _nack_ctx.getAbandoned());
+    }
+
+    void startJitterTimer() {
+        if (_jitter_task) {
+            return;
+        }
+        // 没有新包到达时也要按时放弃超时的不完整帧
+        // Incomplete frames past their deadline must be given up even when no new packets arrive
+        weak_ptr<RtpChannel> weak_self = shared_from_this();
+        _jitter_task = _poller->doDelayTask(10, [weak_self]() -> uint64_t {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return 0;
+            }
+            strong_self->updateNackState();
+            strong_self->_jitter_buffer->process(getCurrentMillisecond());
+            return 10;
+        });
+    }
+
     void starNackTimer() {
         if (_delay_task) {
             return;
@@ -1184,6 +1409,8 @@ private:
     RtcpContextForRecv _rtcp_context;
     EventPoller::Ptr _poller;
     EventPoller::DelayTask::Ptr _delay_task;
+    EventPoller::DelayTask::Ptr _jitter_task;
+    JitterBuffer::Ptr _jitter_buffer;
     function<void(const FCI_NACK &nack)> _on_nack;
 };
 
@@ -1209,6 +1436,23 @@ float WebRtcTransportImp::getLossRate(TrackType type) {
     return -1;
 }
 
+void WebRtcTransportImp::getReceiveInfo(Json::Value &info) const {
+    Json::Value receivers(Json::arrayValue);
+    for (auto &track : _type_to_track) {
+        if (!track) {
+            continue;
+        }
+        for (auto &pr : track->rtp_channel) {
+            Json::Value item;
+            item["type"] = getTrackString(track->media->type);
+            item["rid"] = pr.first;
+            pr.second->getReceiveInfo(item);
+            receivers.append(std::move(item));
+        }
+    }
+    info["receivers"] = std::move(receivers);
+}
+
 void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
     _bytes_usage += len;
     auto rtcps = RtcpHeader::loadFromBytes((char *)buf, len);
@@ -1246,6 +1490,14 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
                 if (it != _ssrc_to_track.end()) {
                     auto &track = it->second;
                     track->rtcp_context_send->onRtcp(rtcp);
+                    if (track->fec) {
+                        // 冗余度跟随该观看端汇报的丢包率
+                        // The redundancy follows the loss reported by this viewer
+                        GET_CONFIG(float, loss_factor, Rtc::kFecLossFactor);
+                        GET_CONFIG(float, max_ratio, Rtc::kFecMaxRatio);
+                        auto ratio = item->fraction / 256.0f * loss_factor;
+                        track->fec->setRatio(MIN(ratio, max_ratio));
+                    }
                 } else {
                     WarnL << "未识别的rr rtcp包:" << rtcp->dumpString();
                 }
@@ -1272,10 +1524,34 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
         case RtcpType::RTCP_PSFB:
         case RtcpType::RTCP_RTPFB: {
             if ((RtcpType)rtcp->pt == RtcpType::RTCP_PSFB) {
+                switch ((PSFBType)rtcp->report_count) {
+                    case PSFBType::RTCP_PSFB_REMB: {
+                        if (_bwe) {
+                            RtcpFB *fb = (RtcpFB *)rtcp;
+                            _bwe->onRemb(fb->getFci<FCI_REMB>().getBitRate());
+                            onBitrateFeedback();
+                        }
+                        break;
+                    }
+                    case PSFBType::RTCP_PSFB_PLI:
+                    case PSFBType::RTCP_PSFB_FIR: onRecvKeyFrameRequest(); break;
+                    default: break;
+                }
                 break;
             }
             // RTPFB
             switch ((RTPFBType)rtcp->report_count) {
+            case RTPFBType::RTCP_RTPFB_TWCC: {
+                if (!_bwe) {
+                    break;
+                }
+                // 对端对本端发送的rtp的transport-cc反馈
+                // Transport-cc feedback of the peer on the rtp sent by us
+                RtcpFB *fb = (RtcpFB *)rtcp;
+                _bwe->onTransportFeedback(fb->getFci<FCI_TWCC>(), fb->getFciSize(), getCurrentMillisecond());
+                onBitrateFeedback();
+                break;
+            }
             case RTPFBType::RTCP_RTPFB_NACK: {
                 RtcpFB *fb = (RtcpFB *)rtcp;
                 auto it = _ssrc_to_track.find(fb->ssrc_media);
@@ -1285,6 +1561,30 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
                 }
                 auto &track = it->second;
                 auto &fci = fb->getFci<FCI_NACK>();
+                if (track->rtx_cache || track->fec) {
+                    auto seq = fci.getPid();
+                    for (auto bit : fci.getBitArray()) {
+                        uint16_t media_seq = seq++;
+                        if (!bit) {
+                            continue;
+                        }
+                        // ulpfec包占用了seq，需转换为媒体rtp的seq，ulpfec包本身不重传
+                        // Ulpfec packets take seqs, convert to the seq of the media rtp, ulpfec packets themselves are not retransmitted
+                        if (track->fec && !track->fec->getMediaSeq(media_seq, media_seq)) {
+                            continue;
+                        }
+                        RtpPacket::Ptr rtp;
+                        if (track->rtx_cache) {
+                            rtp = track->rtx_cache->get(track->media->type, media_seq - track->rtx_cache_seq_offset);
+                        } else if (auto ptr = track->nack_list.getRtp(media_seq)) {
+                            rtp = *ptr;
+                        }
+                        if (rtp) {
+                            onSendRtp(rtp, true, true);
+                        }
+                    }
+                    break;
+                }
                 track->nack_list.forEach(fci, [&](const RtpPacket::Ptr &rtp) {
                     // rtp重传  [AUTO-TRANSLATED:62a37e46]
                     // rtp retransmission
@@ -1327,7 +1627,8 @@ void WebRtcTransportImp::createRtpChannel(const string &rid, uint32_t ssrc, Medi
     auto &ref = track.rtp_channel[rid];
     weak_ptr<WebRtcTransportImp> weak_self = static_pointer_cast<WebRtcTransportImp>(shared_from_this());
     ref = std::make_shared<RtpChannel>(
-        getPoller(), [&track, this, rid](RtpPacket::Ptr rtp) mutable { onSortedRtp(track, rid, std::move(rtp)); },
+        getPoller(), track.media->type, getCodecId(track.plan_rtp->codec),
+        [&track, this, rid](RtpPacket::Ptr rtp) mutable { onSortedRtp(track, rid, std::move(rtp)); },
         [&track, weak_self, ssrc](const FCI_NACK &nack) mutable {
             // nack发送可能由定时器异步触发  [AUTO-TRANSLATED:186d6723]
             // Nack sending may be triggered asynchronously by a timer
@@ -1335,6 +1636,14 @@ void WebRtcTransportImp::createRtpChannel(const string &rid, uint32_t ssrc, Medi
             if (strong_self) {
                 strong_self->onSendNack(track, nack, ssrc);
             }
+        },
+        [weak_self, ssrc]() {
+            // jitter buffer丢弃了不完整的帧，向推流端请求关键帧
+            // The jitter buffer dropped an incomplete frame, request a key frame from the publisher
+            auto strong_self = weak_self.lock();
+            if (strong_self) {
+                strong_self->sendRtcpPli(ssrc);
+            }
         });
     InfoL << "create rtp receiver of ssrc:" << ssrc << ", rid:" << rid << ", codec:" << track.plan_rtp->codec;
 }
@@ -1493,12 +1802,9 @@ void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool r
         return;
     }
     if (!rtx) {
-        // 统计rtp发送情况，好做sr汇报  [AUTO-TRANSLATED:142028b2]
-        // Statistics of RTP sending, for SR reporting
-        track->rtcp_context_send->onRtp(
-            rtp->getSeq(), rtp->getStamp(), rtp->ntp_stamp, rtp->sample_rate,
-            rtp->size() - RtpPacket::kRtpTcpHeaderSize);
-        track->nack_list.pushBack(rtp);
+        if (!track->rtx_cache) {
+            track->nack_list.pushBack(rtp);
+        }
 #if 0
         // 此处模拟发送丢包  [AUTO-TRANSLATED:9612f08e]
         // Simulate packet loss here
@@ -1511,10 +1817,64 @@ void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool r
         // Send RTX retransmission packets
         // TraceL << "send rtx rtp:" << rtp->getSeq();
     }
-    pair<bool /*rtx*/, MediaTrack *> ctx { rtx, track.get() };
-    sendRtpPacket(rtp->data() + RtpPacket::kRtpTcpHeaderSize, rtp->size() - RtpPacket::kRtpTcpHeaderSize, flush, &ctx);
-    _bytes_usage += rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    if (_pacer && rtp->type == TrackVideo) {
+        // 视频rtp经平滑器排队发送，音频rtp数据量小且对时延敏感，直接发送
+        // Video rtp is queued in the pacer, audio rtp is small and latency sensitive so it is sent directly
+        auto now = getCurrentMillisecond();
+        _pacer->enqueue(rtp, rtx, now);
+        if (flush) {
+            _pacer->process(now);
+        }
+    } else {
+        sendRtpNow(rtp, flush, rtx);
+    }
+}
+
+// sendRtpPacket传给onBeforeEncryptRtp的上下文
+// Context passed to onBeforeEncryptRtp by sendRtpPacket
+struct SendRtpContext {
+    bool rtx;
+    MediaTrack *track;
+    // 已封装为red的媒体rtp
+    // Media rtp wrapped in red
+    bool red;
+    // ulpfec包
+    // Ulpfec packet
+    bool fec;
+};
+
+void WebRtcTransportImp::sendRtpNow(const RtpPacket::Ptr &rtp, bool flush, bool rtx) {
+    auto &track = _type_to_track[rtp->type];
+    if (!track) {
+        return;
+    }
+    SendRtpContext ctx { rtx, track.get(), false, false };
+    auto data = rtp->data() + RtpPacket::kRtpTcpHeaderSize;
+    auto size = rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    Buffer::Ptr red;
+    if (!rtx && track->fec && (red = track->fec->wrapRed(rtp, track->plan_rtp->pt))) {
+        data = red->data();
+        size = red->size();
+        ctx.red = true;
+    }
+    sendRtpPacket(data, size, flush, &ctx);
+    _bytes_usage += size;
+
+    if (!rtx && track->fec) {
+        SendRtpContext fec_ctx { false, track.get(), false, true };
+        while (auto fec = track->fec->takeFecPacket()) {
+            sendRtpPacket(fec->data(), fec->size(), flush, &fec_ctx);
+            _bytes_usage += fec->size();
+        }
+    }
 
+    if (!rtx) {
+        // 统计rtp发送情况，好做sr汇报；在实际发出时统计，平滑器排队中的包不计入sr  [AUTO-TRANSLATED:142028b2]
+        // Statistics of RTP sending, for SR reporting; counted when actually sent, packets queued in the pacer are not reported in sr
+        track->rtcp_context_send->onRtp(
+            rtp->getSeq(), rtp->getStamp(), rtp->ntp_stamp, rtp->sample_rate,
+            rtp->size() - RtpPacket::kRtpTcpHeaderSize);
+    }
     if (track->rtcp_context_send) {
         auto sr = track->rtcp_context_send->createRtcpSR(track->answer_ssrc_rtp);
         if (sr && sr->size() > 0) {
@@ -1523,36 +1883,59 @@ void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool r
     }
 }
 
+void WebRtcTransportImp::setRetransmitCache(const RtpRetransmitCache::Ptr &cache) {
+    for (auto &track : _type_to_track) {
+        if (track) {
+            track->rtx_cache = cache;
+        }
+    }
+}
+
 void WebRtcTransportImp::onBeforeEncryptRtp(const char *buf, int &len, void *ctx) {
-    auto pr = (pair<bool /*rtx*/, MediaTrack *> *)ctx;
+    auto pr = (SendRtpContext *)ctx;
     auto header = (RtpHeader *)buf;
+    auto &fec = pr->track->fec;
 
-    if (!pr->first || !pr->second->plan_rtx) {
+    if (pr->fec) {
+        // ulpfec包已是最终形式，只需写入transport-cc扩展
+        // The ulpfec packet is final, only the transport-cc extension is written
+    } else if (!pr->rtx || !pr->track->plan_rtx) {
         // 普通的rtp,或者不支持rtx, 修改目标pt和ssrc  [AUTO-TRANSLATED:e1264971]
         // Ordinary RTP, or does not support RTX, modify the target PT and SSRC
-        pr->second->rtp_ext_ctx->changeRtpExtId(header, false);
-        header->pt = pr->second->plan_rtp->pt;
-        header->ssrc = htonl(pr->second->answer_ssrc_rtp);
+        pr->track->rtp_ext_ctx->changeRtpExtId(header, false);
+        header->pt = pr->red ? fec->getRedPt() : pr->track->plan_rtp->pt;
+        header->ssrc = htonl(pr->track->answer_ssrc_rtp);
+        if (fec) {
+            // 为ulpfec包让出的seq顺延
+            // Shift the seq past those taken by ulpfec packets
+            auto seq = ntohs(header->seq);
+            header->seq = htons(pr->rtx ? fec->getSentSeq(seq) : fec->allocSeq(seq));
+        }
     } else {
         // 重传的rtp, rtx  [AUTO-TRANSLATED:e863a518]
         // Retransmitted RTP, RTX
-        pr->second->rtp_ext_ctx->changeRtpExtId(header, false);
-        header->pt = pr->second->plan_rtx->pt;
-        if (pr->second->answer_ssrc_rtx) {
+        pr->track->rtp_ext_ctx->changeRtpExtId(header, false);
+        header->pt = pr->track->plan_rtx->pt;
+        if (pr->track->answer_ssrc_rtx) {
             // 有rtx单独的ssrc,有些情况下，浏览器支持rtx，但是未指定rtx单独的ssrc  [AUTO-TRANSLATED:181cee9a]
             // RTX has a separate SSRC, in some cases, the browser supports RTX, but does not specify a separate SSRC for RTX
-            header->ssrc = htonl(pr->second->answer_ssrc_rtx);
+            header->ssrc = htonl(pr->track->answer_ssrc_rtx);
         } else {
             // 未单独指定rtx的ssrc，那么使用rtp的ssrc  [AUTO-TRANSLATED:dcafdd75]
             // If RTX SSRC is not specified separately, use the RTP SSRC
-            header->ssrc = htonl(pr->second->answer_ssrc_rtp);
+            header->ssrc = htonl(pr->track->answer_ssrc_rtp);
         }
 
         auto origin_seq = ntohs(header->seq);
+        if (fec) {
+            // osn为该包首次发送时的seq
+            // The osn is the seq the packet was first sent with
+            origin_seq = fec->getSentSeq(origin_seq);
+        }
         // seq跟原来的不一样  [AUTO-TRANSLATED:803f9a5e]
         // The sequence is different from the original
-        header->seq = htons(_rtx_seq[pr->second->media->type]);
-        ++_rtx_seq[pr->second->media->type];
+        header->seq = htons(_rtx_seq[pr->track->media->type]);
+        ++_rtx_seq[pr->track->media->type];
 
         auto payload = header->getPayloadData();
         auto payload_size = header->getPayloadSize(len);
@@ -1566,6 +1949,21 @@ void WebRtcTransportImp::onBeforeEncryptRtp(const char *buf, int &len, void *ctx
         payload[1] = origin_seq & 0xFF;
         len += 2;
     }
+
+    if (_bwe) {
+        // 写入transport-wide序号并记录发送时间，供对端transport-cc反馈时计算时延梯度
+        // Write the transport-wide sequence number and record the send time for the delay gradient of transport-cc feedback
+        auto seq = _bwe->getNextSeq();
+        if (pr->track->rtp_ext_ctx->setTransportCCSeq(header, len, seq)) {
+            _bwe->onPacketSent(seq, len, getCurrentMillisecond());
+        }
+    }
+
+    if (pr->red && fec) {
+        // 以最终发送的内容计算ulpfec
+        // Ulpfec is computed over the content finally sent
+        fec->onSendRed(buf, len, pr->track->plan_rtp->pt);
+    }
 }
 
 void WebRtcTransportImp::safeShutdown(const SockException &ex) {
@@ -1751,6 +2149,18 @@ void play_plugin(SocketHelper &sender, const WebRtcArgs &args, const onCreateWeb
             return;
         }
 
+        GET_CONFIG(bool, simulcast_switch, Rtc::kSimulcastSwitch);
+        auto layers = simulcast_switch ? SimulcastGroup::getLayers(info) : vector<SimulcastGroup::Layer>();
+        if (!layers.empty()) {
+            // simulcast推流的主流名本身不注册，播放时从最低层开始，由播放器按带宽估计切换
+            // The main stream name of a simulcast push is not registered itself, start from the lowest layer and let the player switch by the bandwidth estimate
+            info.schema = "rtc";
+            auto rtc = WebRtcPlayer::create(EventPollerPool::Instance().getPoller(), layers.front().src, info,
+                WebRtcTransport::Role::PEER, WebRtcTransport::SignalingProtocols::WHEP_WHIP);
+            cb(*rtc);
+            return;
+        }
+
         // webrtc播放的是rtsp的源  [AUTO-TRANSLATED:649ae489]
         // WebRTC plays the RTSP source
         info.schema = RTSP_SCHEMA;
@@ -25,6 +25,9 @@
 #include "Network/Session.h"
 #include "Nack.h"
 #include "TwccContext.h"
+#include "SendSideBwe.h"
+#include "RtpPacer.h"
+#include "RtpFec.h"
 #include "SctpAssociation.hpp"
 #include "Rtcp/RtcpContext.h"
 #include "Rtsp/RtspMediaSource.h"
@@ -55,6 +58,39 @@ extern const std::string kIceUfrag;
 extern const std::string kIcePwd;
 extern const std::string kExternIP;
 extern const std::string kInterfaces;
+// 是否合并发送一批rtp数据包(linux下使用sendmmsg)
+// Whether to send a batch of rtp packets at once (sendmmsg on linux)
+extern const std::string kEgressBatch;
+// 批量发送时是否将等长数据包合并为GSO报文
+// Whether to merge equally sized packets into GSO datagrams when sending in batches
+extern const std::string kEgressGSO;
+// 播放器是否使用媒体源共享的rtp重传缓存
+// Whether players use the rtp retransmission cache shared by the media source
+extern const std::string kSharedNackCache;
+// 是否根据对端的transport-cc/remb反馈做发送端带宽估计
+// Whether to run send side bandwidth estimation on transport-cc/remb feedback of the peer
+extern const std::string kSendBwe;
+// 是否按带宽估计值平滑发送视频rtp
+// Whether to pace video rtp by the bandwidth estimate
+extern const std::string kPacer;
+// 平滑发送速率相对带宽估计值的倍数
+// Pacing rate as a multiple of the bandwidth estimate
+extern const std::string kPacingFactor;
+// 平滑发送的最大排队时长，单位毫秒
+// Max queueing time of the pacer in milliseconds
+extern const std::string kPacerMaxQueueMS;
+// 播放simulcast推流的主流名时是否按带宽估计自动切换rid层
+// Whether players of the main stream name of a simulcast push switch rid layers by the bandwidth estimate
+extern const std::string kSimulcastSwitch;
+// 播放器是否协商red/ulpfec，并在对端汇报丢包时发送前向纠错
+// Whether players negotiate red/ulpfec and send forward error correction when the peer reports loss
+extern const std::string kFec;
+// 前向纠错冗余度相对对端丢包率的倍数
+// Forward error correction redundancy as a multiple of the loss reported by the peer
+extern const std::string kFecLossFactor;
+// 前向纠错的最大冗余度
+// Max forward error correction redundancy
+extern const std::string kFecMaxRatio;
 }//namespace RTC
 
 class WebRtcInterface {
@@ -220,6 +256,18 @@ protected:
     virtual void onBeforeEncryptRtcp(const char *buf, int &len, void *ctx) = 0;
     virtual void onRtcpBye() = 0;
 
+    /**
+     * 在getTransportInfo结果中追加接收端统计信息，在poller线程调用
+     * Append receive side statistics to the result of getTransportInfo, called on the poller thread
+     */
+    virtual void getReceiveInfo(Json::Value &info) const {}
+
+    /**
+     * 除offer外影响协商结果的本端参数，相同时可复用缓存的answer；返回空则不缓存
+     * Local parameters besides the offer that affect the negotiation result, equal ones may reuse a cached answer; empty disables the cache
+     */
+    virtual std::string getNegotiationKey() const { return ""; }
+
 protected:
     void sendRtcpRemb(uint32_t ssrc, size_t bit_rate);
     void sendRtcpPli(uint32_t ssrc);
@@ -275,6 +323,15 @@ public:
 
     //for send rtp
     NackList nack_list;
+    // 同一媒体源的各播放器共享的重传缓存，不为空时不再使用nack_list
+    // Retransmission cache shared by all players of the media source, nack_list is unused if set
+    RtpRetransmitCache::Ptr rtx_cache;
+    // 本播放器发送的seq减去源rtp的seq
+    // Seq sent by this player minus the seq of the source rtp
+    uint16_t rtx_cache_seq_offset = 0;
+    // 协商了red/ulpfec时不为空
+    // Not null if red/ulpfec is negotiated
+    RtpFecEncoder::Ptr fec;
     RtcpContext::Ptr rtcp_context_send;
 
     //for recv rtp
@@ -320,6 +377,12 @@ public:
     bool canRecvRtp(const RtcMedia& media) const;
     void onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool rtx = false);
 
+    /**
+     * 获取发送端带宽估计值，单位bit/s，未开启或对端不支持transport-cc/remb时返回0
+     * Get the send side bandwidth estimate in bit/s, 0 if disabled or the peer supports neither transport-cc nor remb
+     */
+    uint32_t getSendBitrateEstimate() const;
+
     void createRtpChannel(const std::string &rid, uint32_t ssrc, MediaTrack &track);
     void safeShutdown(const toolkit::SockException &ex);
 
@@ -350,6 +413,33 @@ protected:
     void updateTicker();
     float getLossRate(TrackType type);
     void onRtcpBye() override;
+    void getReceiveInfo(Json::Value &info) const override;
+    std::string getNegotiationKey() const override;
+
+    /**
+     * 使用媒体源共享的rtp重传缓存代替各track自己的nack_list
+     * Use the rtp retransmission cache shared by the media source instead of the nack_list of each track
+     */
+    void setRetransmitCache(const RtpRetransmitCache::Ptr &cache);
+
+    /**
+     * 收到transport-cc/remb反馈后带宽估计值更新，可据此选择码率层或丢帧
+     * The bandwidth estimate was updated by transport-cc/remb feedback, layer selection or frame dropping may follow it
+     */
+    virtual void onSendBitrateEstimate(uint32_t bps) {}
+
+    /**
+     * 对端通过pli/fir请求关键帧
+     * The peer asked for a key frame with pli/fir
+     */
+    virtual void onRecvKeyFrameRequest() {}
+    const SendSideBwe::Ptr &getSendSideBwe() const { return _bwe; }
+
+    /**
+     * 是否做发送端带宽估计，默认取rtc.sendBwe配置；依赖带宽估计的播放器可强制开启
+     * Whether to run the send side bandwidth estimation, rtc.sendBwe by default; players relying on the estimate may force it on
+     */
+    virtual bool needSendSideBwe() const;
 
 private:
     void onSortedRtp(MediaTrack &track, const std::string &rid, RtpPacket::Ptr rtp);
@@ -360,6 +450,10 @@ private:
     void unregisterSelf();
     void unrefSelf();
     void onCheckAnswer(RtcSession &sdp);
+    void flushEgressBatch();
+    void startSendSideBwe();
+    void onBitrateFeedback();
+    void sendRtpNow(const RtpPacket::Ptr &rtp, bool flush, bool rtx);
 
 private:
     bool _preferred_tcp = false;
@@ -398,6 +492,14 @@ private:
     // http访问时的host ip  [AUTO-TRANSLATED:e8fe6957]
     // Host ip for http access
     std::string _local_ip;
+    // 已加密待批量发送的数据包
+    // Encrypted packets pending a batch send
+    std::vector<toolkit::Buffer::Ptr> _egress_batch;
+    // 发送端带宽估计与视频rtp平滑发送
+    // Send side bandwidth estimation and video rtp pacing
+    SendSideBwe::Ptr _bwe;
+    RtpPacer::Ptr _pacer;
+    toolkit::Timer::Ptr _pacer_timer;
 };
 
 class WebRtcTransportManager {